@@ -0,0 +1,170 @@
+// ===========================================
+// AVAILABILITY.CPP (benchmark)
+// Choix rarest-first à l'échelle d'un essaim (availability.hpp).
+//
+// Essaim synthétique : 10 % de seeds, 30 % de téléchargements séquentiels
+// (préfixe de longueur aléatoire), 60 % de pairs aux pièces aléatoires
+// (densité uniforme entre 0 et 1) ; nous voulons la moitié des pièces.
+//   1) mémoire : bitmaps compressées vs un bitfield plein par pair ;
+//   2) mises à jour incrémentales (have / lose) par seconde ;
+//   3) décisions (pièce la plus rare d'un pair tiré au hasard) par seconde :
+//      noyaux AVX2, portables, et référence "bitfield plein + parcours
+//      scalaire" avec les mêmes compteurs ;
+//   4) pour mémoire : une décision qui recalcule la rareté de zéro.
+//
+// Usage : availability [pieces] [peers] [decisions]   (défauts 200000, 2000, 50000)
+// ===========================================
+
+#include "availability.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+static double seconds_since(clock_type::time_point t0) {
+  return std::chrono::duration<double>(clock_type::now() - t0).count();
+}
+
+// Référence : bitfield plein par pair, parcours scalaire bit à bit
+static std::uint32_t plain_pick(const std::vector<std::uint64_t>& peer, const std::vector<std::uint64_t>& wanted,
+                                const p2p::availability& av) {
+  std::uint32_t best = UINT32_MAX, best_piece = 0;
+  for (std::size_t w = 0; w < wanted.size(); ++w)
+    for (std::uint64_t bits = peer[w] & wanted[w]; bits; bits &= bits - 1) {
+      auto i = static_cast<std::uint32_t>(w * 64 + std::size_t(std::countr_zero(bits)));
+      if (av.count(i) < best) {
+        best = av.count(i);
+        best_piece = i;
+      }
+    }
+  return best_piece;
+}
+
+int main(int argc, char** argv) {
+  std::size_t pieces = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 200000;
+  std::size_t peers = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 2000;
+  std::size_t decisions = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 50000;
+  std::size_t nwords = (pieces + 63) / 64;
+
+  // --- essaim ---
+  std::mt19937_64 rng(3);
+  std::vector<std::vector<std::uint64_t>> plain(peers, std::vector<std::uint64_t>(nwords, 0));
+  for (std::size_t p = 0; p < peers; ++p) {
+    auto& bits = plain[p];
+    auto set = [&](std::size_t i) { bits[i / 64] |= std::uint64_t(1) << (i % 64); };
+    double kind = std::uniform_real_distribution<double>(0, 1)(rng);
+    if (kind < 0.1) {
+      for (std::size_t i = 0; i < pieces; ++i) set(i);
+    } else if (kind < 0.4) {
+      std::size_t prefix = rng() % pieces;
+      for (std::size_t i = 0; i < prefix; ++i) set(i);
+    } else {
+      double density = std::uniform_real_distribution<double>(0, 1)(rng);
+      std::bernoulli_distribution has(density);
+      for (std::size_t i = 0; i < pieces; ++i)
+        if (has(rng)) set(i);
+    }
+  }
+
+  std::cout << pieces << " pieces, " << peers << " peers\n" << std::fixed;
+
+  auto build = [&](const p2p::bitmap_detail::implementation_t& impl) {
+    p2p::availability av(pieces, impl);
+    std::mt19937_64 want_rng(5);
+    for (std::uint32_t i = 0; i < pieces; ++i)
+      if (want_rng() & 1) av.set_wanted(i, true);
+    for (std::uint32_t p = 0; p < peers; ++p) av.bitfield(p, plain[p].data());
+    av.refresh_floors();
+    return av;
+  };
+
+  auto t0 = clock_type::now();
+  p2p::availability av = build(p2p::bitmap_detail::implementation());
+  double build_s = seconds_since(t0);
+  std::size_t plain_bytes = peers * nwords * 8;
+  std::cout << std::setprecision(1) << "build from bitfields : " << build_s * 1e3 << " ms\n"
+            << "memory               : " << double(av.memory_bytes()) / (1 << 20) << " MiB compressed vs "
+            << double(plain_bytes) / (1 << 20) << " MiB plain bitfields\n";
+
+  // --- mises à jour incrémentales ---
+  {
+    constexpr std::size_t updates = 2000000;
+    std::mt19937_64 urng(9);
+    std::size_t changed = 0;
+    t0 = clock_type::now();
+    for (std::size_t u = 0; u < updates; ++u) {
+      auto p = static_cast<std::uint32_t>(urng() % peers);
+      auto i = static_cast<std::uint32_t>(urng() % pieces);
+      changed += (u % 8 == 0) ? av.lose(p, i) : av.have(p, i);
+    }
+    double s = seconds_since(t0);
+    std::cout << "have/lose updates    : " << std::setprecision(2) << double(updates) / s / 1e6 << " M/s ("
+              << changed << " changed)\n";
+    // Les bitfields pleins suivent, pour comparer les décisions à état égal
+    for (std::uint32_t p = 0; p < peers; ++p) {
+      std::fill(plain[p].begin(), plain[p].end(), 0);
+      av.peer(p).for_each([&](std::uint32_t i) { plain[p][i / 64] |= std::uint64_t(1) << (i % 64); });
+    }
+  }
+
+  // --- décisions ---
+  std::vector<std::uint32_t> asked(decisions);
+  {
+    std::mt19937_64 drng(11);
+    for (auto& a : asked) a = static_cast<std::uint32_t>(drng() % peers);
+  }
+  std::cout << "\n" << std::left << std::setw(26) << "picker" << std::right << std::setw(14) << "decisions/s"
+            << std::setw(12) << "us each\n";
+  std::vector<std::uint16_t> chosen_rarity(decisions);
+  auto report = [&](const char* name, double s, std::size_t n) {
+    std::cout << std::left << std::setw(26) << name << std::right << std::setprecision(0) << std::setw(14)
+              << double(n) / s << std::setprecision(2) << std::setw(11) << s / double(n) * 1e6 << "\n";
+  };
+  for (const auto* impl : {&p2p::bitmap_detail::implementation(), &p2p::bitmap_detail::portable}) {
+    p2p::availability local = build(*impl);
+    for (std::uint32_t p = 0; p < peers; ++p) local.bitfield(p, plain[p].data());
+    local.refresh_floors();
+    t0 = clock_type::now();
+    std::size_t mismatched = 0;
+    for (std::size_t d = 0; d < decisions; ++d) {
+      auto piece = local.pick(asked[d]);
+      std::uint16_t rarity = piece ? local.count(*piece) : 0;
+      if (impl == &p2p::bitmap_detail::implementation()) chosen_rarity[d] = rarity;
+      else mismatched += rarity != chosen_rarity[d];
+    }
+    double s = seconds_since(t0);
+    std::string name = std::string("compressed, ") + impl->name;
+    report(name.c_str(), s, decisions);
+    if (mismatched) std::cout << "  MISMATCH: " << mismatched << " decisions differ\n";
+  }
+  {
+    std::size_t n = std::min<std::size_t>(decisions, 20000);
+    std::size_t mismatched = 0;
+    t0 = clock_type::now();
+    for (std::size_t d = 0; d < n; ++d) {
+      std::uint32_t piece = plain_pick(plain[asked[d]], av.wanted_words(), av);
+      mismatched += av.count(piece) != chosen_rarity[d] && chosen_rarity[d] != 0;
+    }
+    report("plain bitfield, scalar", seconds_since(t0), n);
+    if (mismatched) std::cout << "  MISMATCH: " << mismatched << " decisions differ\n";
+  }
+  {
+    std::size_t n = 5;
+    std::vector<std::uint16_t> counts(pieces);
+    t0 = clock_type::now();
+    for (std::size_t d = 0; d < n; ++d) {
+      std::fill(counts.begin(), counts.end(), 0);
+      for (const auto& bits : plain)
+        for (std::size_t w = 0; w < nwords; ++w)
+          for (std::uint64_t b = bits[w]; b; b &= b - 1) ++counts[w * 64 + std::size_t(std::countr_zero(b))];
+      (void)plain_pick(plain[asked[d]], av.wanted_words(), av);
+    }
+    report("recount from scratch", seconds_since(t0), n);
+  }
+  return 0;
+}
@@ -0,0 +1,185 @@
+// ===========================================
+// CHUNK_CACHE.CPP (benchmark)
+// Cache des chunks chauds (chunk_cache.hpp) sous une charge de Zipf.
+//
+// Un catalogue de N chunks, des requêtes tirées selon une loi de Zipf
+// (quelques chunks très demandés, une longue traîne). Un défaut de cache
+// simule une lecture disque (allocation du chunk) puis put().
+//   - "zipf"      : requêtes de Zipf seules ;
+//   - "zipf+scan" : une requête sur deux vient d'un balayage séquentiel de
+//                   la traîne froide (réindexation, seed d'un gros fichier).
+// Comparaison avec un LRU de même budget. On mesure le taux de succès, le
+// débit (plusieurs threads) et la mémoire (octets en cache, RSS).
+//
+// Usage : chunk_cache [budget_mib] [threads] [zipf_s]   (défauts 64, 4, 0.99)
+// ===========================================
+
+#include "chunk_cache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t catalog = 1000000;
+constexpr std::size_t chunk_size = 4096;
+
+static std::size_t resident_bytes() {
+  std::size_t pages_total = 0, pages_resident = 0;
+  std::ifstream statm("/proc/self/statm");
+  statm >> pages_total >> pages_resident;
+  return pages_resident * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+static p2p::digest id_of(std::uint64_t rank) {
+  p2p::digest d{};
+  std::uint64_t z = (rank + 1) * 0x9e3779b97f4a7c15ull;
+  for (int w = 0; w < 4; ++w) {
+    z ^= z >> 31;
+    z *= 0xbf58476d1ce4e5b9ull;
+    std::memcpy(d.data() + 8 * w, &z, 8);
+  }
+  return d;
+}
+
+// Tirage de Zipf par inversion de la fonction de répartition
+class zipf {
+public:
+  zipf(std::size_t n, double s) : cdf_(n) {
+    double sum = 0;
+    for (std::size_t i = 0; i < n; ++i) cdf_[i] = (sum += 1.0 / std::pow(double(i + 1), s));
+    for (auto& c : cdf_) c /= sum;
+  }
+  std::size_t operator()(std::mt19937_64& rng) const {
+    double u = std::uniform_real_distribution<double>(0, 1)(rng);
+    return std::size_t(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+  }
+
+private:
+  std::vector<double> cdf_;
+};
+
+// Référence : LRU global sous un seul mutex, même budget
+class lru_cache {
+public:
+  explicit lru_cache(std::size_t budget) : budget_(budget) {}
+
+  std::optional<p2p::iobuf> get(const p2p::digest& id) {
+    std::lock_guard lock(mutex_);
+    auto it = index_.find(id);
+    if (it == index_.end()) {
+      ++misses_;
+      return std::nullopt;
+    }
+    ++hits_;
+    order_.splice(order_.begin(), order_, it->second);
+    return it->second->second.clone();
+  }
+
+  void put(const p2p::digest& id, p2p::iobuf data) {
+    std::lock_guard lock(mutex_);
+    if (index_.count(id)) return;
+    bytes_ += data.size();
+    order_.emplace_front(id, std::move(data));
+    index_.emplace(id, order_.begin());
+    while (bytes_ > budget_) {
+      bytes_ -= order_.back().second.size();
+      index_.erase(order_.back().first);
+      order_.pop_back();
+    }
+  }
+
+  double hit_ratio() const { return double(hits_) / double(hits_ + misses_); }
+  std::size_t bytes() const { return bytes_; }
+
+private:
+  std::size_t budget_;
+  std::size_t bytes_ = 0;
+  std::uint64_t hits_ = 0, misses_ = 0;
+  std::mutex mutex_;
+  std::list<std::pair<p2p::digest, p2p::iobuf>> order_;
+  std::unordered_map<p2p::digest, decltype(order_)::iterator, p2p::digest_hash> index_;
+};
+
+static double cache_hit_ratio(const p2p::chunk_cache& c) { return c.stats().hit_ratio(); }
+static double cache_hit_ratio(const lru_cache& c) { return c.hit_ratio(); }
+
+struct result {
+  double hit_ratio;
+  double mops;
+  std::size_t bytes;
+};
+
+template <typename Cache>
+static result run(Cache& cache, const zipf& dist, std::size_t threads, std::size_t requests, bool scan) {
+  std::atomic<std::uint64_t> scan_pos{catalog / 2};
+  auto worker = [&](std::size_t t) {
+    std::mt19937_64 rng(100 + t);
+    for (std::size_t r = 0; r < requests; ++r) {
+      std::uint64_t rank = (scan && (r & 1)) ? scan_pos++ % catalog : dist(rng);
+      p2p::digest id = id_of(rank);
+      if (auto hit = cache.get(id)) continue;   // le clone serait envoyé au pair
+      p2p::iobuf data = p2p::iobuf::create(chunk_size);
+      data.commit(chunk_size);   // "lu sur disque"
+      cache.put(id, std::move(data));
+    }
+  };
+  auto t0 = clock_type::now();
+  std::vector<std::thread> pool;
+  for (std::size_t t = 0; t < threads; ++t) pool.emplace_back(worker, t);
+  for (auto& th : pool) th.join();
+  double s = std::chrono::duration<double>(clock_type::now() - t0).count();
+  return {cache_hit_ratio(cache), double(threads * requests) / s / 1e6, cache.bytes()};
+}
+
+int main(int argc, char** argv) {
+  std::size_t budget = ((argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 64) << 20;
+  std::size_t threads = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 4;
+  double s = (argc > 3) ? std::strtod(argv[3], nullptr) : 0.99;
+  constexpr std::size_t requests = 1000000;   // par thread
+
+  zipf dist(catalog, s);
+  std::cout << "catalog " << catalog << " chunks of " << chunk_size << " B ("
+            << catalog * chunk_size / (1 << 20) << " MiB), budget " << (budget >> 20) << " MiB, zipf s="
+            << s << ", " << threads << " threads x " << requests << " requests\n\n"
+            << std::left << std::setw(11) << "workload" << std::setw(11) << "policy" << std::right
+            << std::setw(10) << "hit %" << std::setw(10) << "Mops/s" << std::setw(14) << "cached MiB"
+            << std::setw(12) << "RSS MiB\n";
+
+  for (bool scan : {false, true}) {
+    const char* name = scan ? "zipf+scan" : "zipf";
+    {
+      p2p::chunk_cache cache(budget, 16, chunk_size);
+      result r = run(cache, dist, threads, requests, scan);
+      std::cout << std::left << std::setw(11) << name << std::setw(11) << "w-tinylfu" << std::right
+                << std::fixed << std::setprecision(1) << std::setw(10) << 100 * r.hit_ratio << std::setw(10)
+                << std::setprecision(2) << r.mops << std::setw(14) << (r.bytes >> 20) << std::setw(11)
+                << (resident_bytes() >> 20) << "\n";
+    }
+    {
+      lru_cache cache(budget);
+      result r = run(cache, dist, threads, requests, scan);
+      std::cout << std::left << std::setw(11) << name << std::setw(11) << "lru" << std::right << std::fixed
+                << std::setprecision(1) << std::setw(10) << 100 * r.hit_ratio << std::setw(10)
+                << std::setprecision(2) << r.mops << std::setw(14) << (r.bytes >> 20) << std::setw(11)
+                << (resident_bytes() >> 20) << "\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,156 @@
+// ===========================================
+// CHUNK_INDEX.CPP (benchmark)
+// Index persistant des chunks (chunk_index.hpp) : démarrage et recherches.
+//
+//   1) construction : N insertions (journal + table), puis fermeture ;
+//   2) démarrage à froid : pages de la table retirées du cache (fadvise),
+//      ouverture, puis recherches aléatoires (présentes / absentes),
+//      d'abord à froid puis à chaud ;
+//   3) reprise après arrêt brutal : un processus fils insère, fait sync()
+//      puis meurt sans checkpoint ; le parent rouvre, rejoue le journal et
+//      vérifie les entrées ;
+//   4) pour comparaison : reconstruire une unordered_map en mémoire à partir
+//      d'une liste plate (le minimum d'un démarrage "par balayage").
+//
+// Usage : chunk_index [millions] [directory]   (défauts 10 et /tmp)
+// ===========================================
+
+#include "chunk_index.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using clock_type = std::chrono::steady_clock;
+
+static double ms_since(clock_type::time_point t0) {
+  return std::chrono::duration<double, std::milli>(clock_type::now() - t0).count();
+}
+
+// Empreinte synthétique n° i (splitmix64) : uniforme comme un vrai SHA-256
+static p2p::digest key(std::uint64_t i) {
+  p2p::digest d;
+  std::uint64_t x = i * 0x9e3779b97f4a7c15ull;
+  for (int w = 0; w < 4; ++w) {
+    std::uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z ^= z >> 31;
+    std::memcpy(d.data() + 8 * w, &z, 8);
+  }
+  return d;
+}
+
+static p2p::chunk_location location(std::uint64_t i) {
+  return {i * 65536, static_cast<std::uint32_t>(i % 1000), 65536};
+}
+
+static void drop_cache(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+}
+
+// ns par recherche pour `count` clés ; hits = clés présentes trouvées
+static double lookups(const p2p::chunk_index& index, std::uint64_t first, std::uint64_t n,
+                      std::size_t count, std::size_t& hits) {
+  std::uint64_t x = 12345;
+  hits = 0;
+  auto t0 = clock_type::now();
+  for (std::size_t q = 0; q < count; ++q) {
+    x = x * 6364136223846793005ull + 1442695040888963407ull;
+    auto found = index.find(key(first + (x >> 11) % n));
+    hits += found.has_value();
+  }
+  return ms_since(t0) * 1e6 / double(count);
+}
+
+int main(int argc, char** argv) {
+  std::uint64_t n = ((argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10) * 1000000;
+  std::string path = std::string((argc > 2) ? argv[2] : "/tmp") + "/p2p_chunk_index.bin";
+  ::unlink(path.c_str());
+  ::unlink((path + ".wal").c_str());
+
+  std::cout << "entries            : " << n << " (" << path << ")\n" << std::fixed << std::setprecision(1);
+
+  // --- 1) construction ---
+  {
+    auto t0 = clock_type::now();
+    p2p::chunk_index index(path, n);
+    for (std::uint64_t i = 0; i < n; ++i) index.insert(key(i), location(i));
+    index.sync();
+    double build = ms_since(t0);
+    t0 = clock_type::now();
+    index.checkpoint();
+    std::cout << "build              : " << build << " ms (" << double(n) / build / 1e3
+              << " M inserts/s), checkpoint " << ms_since(t0) << " ms\n"
+              << "table              : " << (index.capacity() * 48 >> 20) << " MiB, load "
+              << std::setprecision(2) << double(index.size()) / double(index.capacity()) << "\n"
+              << std::setprecision(1);
+  }
+
+  // --- 2) démarrage à froid ---
+  drop_cache(path);
+  {
+    auto t0 = clock_type::now();
+    p2p::chunk_index index(path);
+    double open_ms = ms_since(t0);
+    std::size_t hits = 0;
+    constexpr std::size_t queries = 1000000;
+    double cold = lookups(index, 0, n, queries, hits);
+    double warm = lookups(index, 0, n, queries, hits);
+    std::size_t misses_found = 0;
+    double miss = lookups(index, n, n, queries, misses_found);
+    std::cout << "cold open          : " << std::setprecision(3) << open_ms << " ms ("
+              << index.size() << " entries)\n" << std::setprecision(0)
+              << "lookup, cold cache : " << cold << " ns\n"
+              << "lookup, warm       : " << warm << " ns (" << hits << "/" << queries << " found)\n"
+              << "lookup, absent     : " << miss << " ns (" << misses_found << " false positives)\n";
+  }
+
+  // --- 3) arrêt brutal ---
+  constexpr std::uint64_t extra = 100000;
+  if (pid_t pid = ::fork(); pid == 0) {
+    p2p::chunk_index index(path);
+    for (std::uint64_t i = n; i < n + extra; ++i) index.insert(key(i), location(i));
+    index.erase(key(0));
+    index.sync();
+    ::_exit(0);   // ni destructeur ni checkpoint
+  } else {
+    ::waitpid(pid, nullptr, 0);
+  }
+  {
+    auto t0 = clock_type::now();
+    p2p::chunk_index index(path);
+    double open_ms = ms_since(t0);
+    bool ok = index.size() == n + extra - 1 && !index.find(key(0));
+    for (std::uint64_t i = 1; i < n + extra; i += 997) ok &= index.find(key(i)).has_value();
+    std::cout << "crash recovery     : " << std::setprecision(1) << open_ms << " ms, "
+              << index.wal_records() << " journal records replayed, " << (ok ? "ok" : "FAILED") << "\n";
+  }
+
+  // --- 4) comparaison : reconstruction en mémoire ---
+  {
+    std::vector<std::pair<p2p::digest, p2p::chunk_location>> flat;
+    flat.reserve(n);
+    for (std::uint64_t i = 0; i < n; ++i) flat.emplace_back(key(i), location(i));
+    auto t0 = clock_type::now();
+    std::unordered_map<p2p::digest, p2p::chunk_location, p2p::digest_hash> map;
+    map.reserve(n);
+    for (const auto& [k, v] : flat) map.emplace(k, v);
+    std::cout << "unordered_map build: " << ms_since(t0) << " ms (from an in-memory list, no disk I/O)\n";
+  }
+
+  ::unlink(path.c_str());
+  ::unlink((path + ".wal").c_str());
+  return 0;
+}
@@ -0,0 +1,140 @@
+// ===========================================
+// CHUNK_READER.CPP (benchmark)
+// Ruée sur un chunk populaire : coalescence des lectures (chunk_reader.hpp).
+//
+// Un fichier de données de N chunks de 256 KiB, leur index (chunk_index),
+// un disk_device (O_DIRECT par défaut : chaque lecture va au disque), un
+// pool CPU pour les SHA-256 et un chunk_cache.
+// Par vague : `hot` chunks encore jamais servis sont annoncés, puis
+// `sessions` demandes arrivent réparties sur `spread_ms` ms, chacune pour
+// l'un de ces chunks. On compare :
+//   - sans coalescence : chaque défaut de cache lit et vérifie le chunk,
+//     tant que la première lecture n'a pas rempli le cache ;
+//   - single-flight : une lecture et un hachage par chunk, les demandes
+//     suivantes se rattachent au chargement en vol.
+// On mesure les lectures disque et hachages évités et la latence des
+// demandes (de l'arrivée à la réponse).
+//
+// Usage : chunk_reader [sessions] [hot] [waves] [spread_ms] [direct] [dir]
+//         (défauts 500, 4, 10, 5, 1, /tmp)
+// ===========================================
+
+#include "chunk_reader.hpp"
+
+#include <asio/steady_timer.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t chunk_size = 256 << 10;
+
+int main(int argc, char** argv) {
+  std::size_t sessions = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 500;
+  std::size_t hot = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 4;
+  std::size_t waves = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 10;
+  std::size_t spread_ms = (argc > 4) ? std::strtoull(argv[4], nullptr, 10) : 5;
+  bool direct = (argc > 5) ? std::strtoull(argv[5], nullptr, 10) != 0 : true;
+  std::string dir = (argc > 6) ? argv[6] : "/tmp";
+  std::string data_path = dir + "/p2p_reader.bin";
+  std::string index_path = dir + "/p2p_reader.idx";
+  std::size_t chunks = 2 * hot * waves;   // deux modes, des chunks neufs à chaque vague
+
+  // --- données et index ---
+  std::vector<p2p::digest> ids(chunks);
+  {
+    ::unlink(index_path.c_str());
+    ::unlink((index_path + ".wal").c_str());
+    int fd = ::open(data_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    p2p::chunk_index index(index_path, chunks * 2);
+    std::mt19937_64 rng(1);
+    std::vector<std::uint64_t> buf(chunk_size / 8);
+    for (std::size_t c = 0; c < chunks; ++c) {
+      for (auto& w : buf) w = rng();
+      ids[c] = p2p::sha256_of(buf.data(), chunk_size);
+      if (::pwrite(fd, buf.data(), chunk_size, static_cast<off_t>(c * chunk_size)) != static_cast<ssize_t>(chunk_size)) {
+        std::cerr << "write failed\n";
+        return 1;
+      }
+      index.insert(ids[c], {c * chunk_size, 0, static_cast<std::uint32_t>(chunk_size)});
+    }
+    ::fsync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+    index.checkpoint();
+  }
+
+  std::cout << sessions << " requests per wave over " << spread_ms << " ms for " << hot << " new chunks of "
+            << (chunk_size >> 10) << " KiB, " << waves << " waves, " << (direct ? "O_DIRECT" : "page cache")
+            << ", sha256 " << p2p::sha256_implementation() << "\n\n"
+            << std::left << std::setw(16) << "mode" << std::right << std::setw(10) << "requests" << std::setw(12)
+            << "disk reads" << std::setw(9) << "hashes" << std::setw(11) << "coalesced" << std::setw(7) << "hits"
+            << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << "\n"
+            << std::fixed;
+
+  p2p::chunk_index index(index_path);
+  std::uint64_t reads[2] = {0, 0};
+  for (int mode = 0; mode < 2; ++mode) {
+    asio::io_context io;
+    asio::thread_pool cpu(2);
+    p2p::disk_options dopts;
+    dopts.direct = direct;
+    p2p::disk_device disk(io, dopts);
+    auto file = disk.open(data_path, O_RDONLY);
+    p2p::chunk_cache cache(64 << 20, 16, chunk_size);
+    p2p::chunk_reader_options ropts;
+    ropts.coalesce = mode == 1;
+    p2p::chunk_reader reader(io, index, disk, {file}, &cache, &cpu, ropts);
+
+    std::vector<double> latency;
+    std::size_t errors = 0;
+    std::mt19937_64 rng(7);
+    for (std::size_t w = 0; w < waves; ++w) {
+      std::size_t first = (mode * waves + w) * hot;
+      std::vector<std::unique_ptr<asio::steady_timer>> timers;
+      for (std::size_t s = 0; s < sessions; ++s) {
+        auto t = std::make_unique<asio::steady_timer>(io);
+        auto delay = std::chrono::microseconds(rng() % (spread_ms * 1000 + 1));
+        t->expires_after(delay);
+        const p2p::digest& id = ids[first + rng() % hot];
+        t->async_wait([&, id](std::error_code) {
+          auto t0 = clock_type::now();
+          reader.async_get(id, [&, t0](std::error_code ec, p2p::iobuf data) {
+            errors += ec || data.size() != chunk_size;
+            latency.push_back(std::chrono::duration<double, std::milli>(clock_type::now() - t0).count());
+          });
+        });
+        timers.push_back(std::move(t));
+      }
+      io.restart();
+      io.run();
+    }
+
+    const auto& st = reader.stats();
+    std::sort(latency.begin(), latency.end());
+    auto pct = [&](double p) { return latency[std::min(latency.size() - 1, std::size_t(p * double(latency.size())))]; };
+    std::cout << std::left << std::setw(16) << (mode ? "single-flight" : "no coalescing") << std::right
+              << std::setw(10) << st.requests << std::setw(12) << st.disk_reads << std::setw(9) << st.verified
+              << std::setw(11) << st.coalesced << std::setw(7) << st.cache_hits << std::setprecision(2)
+              << std::setw(10) << pct(0.5) << std::setw(10) << pct(0.99) << std::setw(10) << latency.back() << "\n";
+    if (errors) std::cout << "  " << errors << " failed requests\n";
+    reads[mode] = st.disk_reads;
+  }
+  std::cout << "\ndisk reads and hashes saved: " << reads[0] - reads[1] << " (" << std::setprecision(1)
+            << 100.0 * double(reads[0] - reads[1]) / double(std::max<std::uint64_t>(reads[0], 1)) << " %)\n";
+
+  ::unlink(data_path.c_str());
+  ::unlink(index_path.c_str());
+  ::unlink((index_path + ".wal").c_str());
+  return 0;
+}
@@ -0,0 +1,207 @@
+// ===========================================
+// COMPRESSION.CPP (benchmark)
+// Ratio et coût CPU de la compression des trames.
+//
+//   1) micro-benchmark : chaque codec compilé sur un corpus synthétique
+//      de messages P2P (listes de pairs, manifestes, lots de gossip,
+//      petits messages de contrôle) ;
+//   2) bout en bout : un client fait le handshake "HELLO" avec le serveur
+//      asynchrone, envoie le corpus en trames brutes et reçoit l'écho
+//      compressé ; on compare les octets reçus sur le fil aux octets bruts
+//      et on vérifie le CRC32C et le contenu après décompression.
+//
+// Usage : compression [rounds] [zstd_dictionary]
+// ===========================================
+
+#include "async_server.hpp"
+#include "compression.hpp"
+#include "frame.hpp"
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace net = asio;
+using tcp = net::ip::tcp;
+
+// -------------------------------------------
+// Corpus : messages typiques d'un nœud P2P
+// -------------------------------------------
+static std::vector<std::string> make_corpus() {
+  std::mt19937 rng(42);
+  auto hex = [&](int n) {
+    static const char digits[] = "0123456789abcdef";
+    std::string s;
+    for (int i = 0; i < n; ++i) s += digits[rng() % 16];
+    return s;
+  };
+  std::vector<std::string> corpus;
+  char line[256];
+
+  for (int m = 0; m < 200; ++m) {  // listes de pairs
+    std::string s;
+    for (int i = 0; i < 50; ++i) {
+      std::snprintf(line, sizeof line, "peer 10.%u.%u.%u:%u id=%s\n", unsigned(rng() % 4),
+                    unsigned(rng() % 256), unsigned(rng() % 256), 6881 + unsigned(rng() % 8),
+                    hex(16).c_str());
+      s += line;
+    }
+    corpus.push_back(std::move(s));
+  }
+  for (int m = 0; m < 100; ++m) {  // manifestes
+    std::string s;
+    for (int i = 0; i < 40; ++i) {
+      std::snprintf(line, sizeof line, "{\"path\":\"datasets/run-%03d/part-%05d.bin\",\"size\":%u,\"chunk\":\"%s\"}\n",
+                    m, i, unsigned(1 << 20) + unsigned(rng() % 4096), hex(64).c_str());
+      s += line;
+    }
+    corpus.push_back(std::move(s));
+  }
+  for (int m = 0; m < 200; ++m) {  // lots de gossip
+    std::string s;
+    for (int i = 0; i < 30; ++i) {
+      std::snprintf(line, sizeof line, "have piece=%u from=%s ttl=%u\n", unsigned(rng() % 100000),
+                    hex(8).c_str(), unsigned(rng() % 8));
+      s += line;
+    }
+    corpus.push_back(std::move(s));
+  }
+  for (int m = 0; m < 1000; ++m) {  // petits messages de contrôle
+    std::snprintf(line, sizeof line, "{\"type\":\"keepalive\",\"node\":\"%s\",\"seq\":%u,\"load\":0.%02u}",
+                  hex(16).c_str(), unsigned(m), unsigned(rng() % 100));
+    corpus.push_back(line);
+  }
+  return corpus;
+}
+
+static void micro_bench(const std::vector<std::string>& corpus, std::size_t rounds,
+                        const p2p::compression_config& cfg) {
+  std::size_t raw_total = 0;
+  for (const auto& m : corpus) raw_total += m.size();
+
+  for (p2p::codec c : p2p::available_codecs()) {
+    if (c == p2p::codec::none) continue;
+    p2p::compressor comp(cfg);
+    std::string packed, back;
+    std::size_t wire = 0;
+    bool valid = true;
+    for (std::size_t r = 0; r < rounds; ++r) {
+      for (const auto& m : corpus) {
+        if (comp.compress(c, m.data(), m.size(), packed)) {
+          wire += packed.size();
+          valid &= comp.decompress(c, packed.data(), packed.size(), m.size(), back) && back == m;
+        } else {
+          wire += m.size();
+        }
+      }
+    }
+    const auto& st = comp.stats();
+    double mb = double(raw_total * rounds) / 1e6;
+    std::cout << p2p::codec_name(c) << (cfg.zstd_dictionary.empty() ? "" : " (dictionary)") << "\n"
+              << "  wire / raw         : " << double(wire) / double(raw_total * rounds) << "\n"
+              << "  ratio (compressed) : " << st.ratio() << "\n"
+              << "  frames compressed  : " << st.frames_compressed << ", raw: " << st.frames_raw << "\n"
+              << "  compress           : " << mb / (double(st.compress_ns) / 1e9) << " MB/s, "
+              << double(st.compress_ns) / double(corpus.size() * rounds) << " ns/frame\n"
+              << "  decompress         : " << double(st.decompress_ns) / double(st.frames_compressed) << " ns/frame\n"
+              << "  round-trip check   : " << (valid ? "ok" : "FAILED") << "\n";
+  }
+}
+
+// Lit une trame complète (en-tête + payload) depuis la socket
+static bool read_frame(tcp::socket& sock, p2p::frame_header& h, std::string& payload) {
+  char head[p2p::frame_header::max_size];
+  net::error_code ec;
+  net::read(sock, net::buffer(head, p2p::frame_header::base_size), ec);
+  if (ec) return false;
+  std::size_t extra = p2p::frame_header::size_for(static_cast<std::uint8_t>(head[4])) - p2p::frame_header::base_size;
+  if (extra) net::read(sock, net::buffer(head + p2p::frame_header::base_size, extra), ec);
+  if (ec) return false;
+  h = *p2p::decode_frame_header(head, sizeof head);
+  payload.resize(h.length);
+  net::read(sock, net::buffer(payload), ec);
+  return !ec;
+}
+
+static void end_to_end(const std::vector<std::string>& corpus, const p2p::compression_config& cfg) {
+  net::io_context io;
+  net::thread_pool cpu(2);
+  p2p::async_server server(io, tcp::endpoint(net::ip::address_v4::loopback(), 0));
+  server.verbose = false;
+  server.set_compression(cfg, &cpu);
+  server.start();
+  std::thread server_thread([&] { io.run(); });
+
+  net::io_context cio;
+  tcp::socket sock(cio);
+  sock.connect(server.local_endpoint());
+  std::string hello = "HELLO codecs=" + p2p::codec_list() + "\n";
+  net::write(sock, net::buffer(hello));
+  net::streambuf hs;
+  net::read_until(sock, hs, '\n');
+  std::string answer(static_cast<const char*>(hs.data().data()), hs.size());
+  std::cout << "handshake          : " << answer;
+
+  // Tout le corpus en trames brutes, écrit par un thread pendant qu'on lit
+  std::thread writer([&] {
+    for (const auto& m : corpus) {
+      p2p::iobuf f = p2p::iobuf::copy(m.data(), m.size(), p2p::frame_header::max_size);
+      p2p::prepend_frame_header(f, p2p::codec::none, m.size(), true);
+      net::write(sock, f.buffers());
+    }
+  });
+
+  p2p::compressor local(cfg);
+  std::size_t raw = 0, wire = 0;
+  bool valid = true;
+  for (const auto& m : corpus) {
+    p2p::frame_header h;
+    std::string payload, plain;
+    if (!read_frame(sock, h, payload)) {
+      valid = false;
+      break;
+    }
+    raw += m.size() + p2p::frame_header::base_size + 4;
+    wire += h.size() + h.length;
+    valid &= h.has_crc() && p2p::crc32c::value(payload.data(), payload.size()) == h.crc;
+    if (h.compressed())
+      valid &= local.decompress(h.payload_codec(), payload.data(), payload.size(), h.raw_length, plain) && plain == m;
+    else
+      valid &= payload == m;
+  }
+  writer.join();
+  sock.close();
+  io.stop();
+  server_thread.join();
+  cpu.join();
+
+  auto& st = server.compression().stats();
+  std::cout << "end-to-end bytes   : " << wire << " on wire for " << raw << " raw ("
+            << double(wire) / double(raw) << ")\n"
+            << "server cpu         : " << st.compress_ns / 1000 << " us compressing "
+            << st.frames_compressed << " frames\n"
+            << "echo check         : " << (valid ? "ok" : "FAILED") << "\n";
+}
+
+int main(int argc, char** argv) {
+  std::size_t rounds = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 20;
+  p2p::compression_config cfg;
+  if (argc > 2) cfg.zstd_dictionary = argv[2];
+
+  try {
+    auto corpus = make_corpus();
+    std::cout << "codecs compiled    : " << p2p::codec_list() << "\n";
+    micro_bench(corpus, rounds, cfg);
+    end_to_end(corpus, cfg);
+  } catch (const std::exception& ex) {
+    std::cerr << "[bench] fatal: " << ex.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
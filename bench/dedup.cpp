@@ -0,0 +1,144 @@
+// ===========================================
+// DEDUP.CPP (benchmark)
+// Découpage FastCDC et déduplication dans le chunk_store.
+//
+//   1) débit du découpage seul (GB/s sur un cœur) et tailles obtenues ;
+//   2) jeux de données synthétiques, chacun stocké deux fois :
+//      chunks FastCDC vs chunks de taille fixe (même taille moyenne) ;
+//      on affiche le ratio de déduplication et les octets économisés.
+//        - versions : un fichier texte et 8 versions avec quelques
+//                     insertions / suppressions / remplacements ;
+//        - shifted  : le même fichier précédé d'un octet ;
+//        - bundle   : archives composées des mêmes bibliothèques,
+//                     séparées par des en-têtes de longueur variable.
+//
+// Usage : dedup [file_mib]   (taille du fichier de base, défaut 32)
+// ===========================================
+
+#include "chunk_store.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using bytes = std::vector<std::uint8_t>;
+
+// Texte pseudo-aléatoire à partir d'un vocabulaire (compressible, peu répétitif)
+static bytes make_text(std::size_t size, std::mt19937_64& rng) {
+  static const char* words[] = {"peer", "chunk", "piece", "swarm", "seed", "have", "want",
+                                "request", "cancel", "bitfield", "tracker", "node", "hash",
+                                "verify", "upload", "download", "choke", "interested"};
+  bytes out;
+  out.reserve(size + 16);
+  while (out.size() < size) {
+    const char* w = words[rng() % std::size(words)];
+    out.insert(out.end(), w, w + std::strlen(w));
+    out.push_back(rng() % 12 ? ' ' : '\n');
+    if (rng() % 5 == 0) {
+      auto num = std::to_string(rng() % 100000);
+      out.insert(out.end(), num.begin(), num.end());
+      out.push_back(' ');
+    }
+  }
+  out.resize(size);
+  return out;
+}
+
+static bytes edit(const bytes& base, int edits, std::mt19937_64& rng) {
+  bytes v = base;
+  for (int e = 0; e < edits; ++e) {
+    std::size_t at = rng() % v.size();
+    std::size_t len = 1 + rng() % 100;
+    bytes patch = make_text(len, rng);
+    switch (rng() % 3) {
+      case 0: v.insert(v.begin() + at, patch.begin(), patch.end()); break;
+      case 1: v.erase(v.begin() + at, v.begin() + std::min(v.size(), at + len)); break;
+      default:
+        for (std::size_t i = 0; i < len && at + i < v.size(); ++i) v[at + i] = patch[i];
+    }
+  }
+  return v;
+}
+
+// Même interface que chunk_store::add_file, en taille fixe
+static void add_fixed(p2p::chunk_store& store, const bytes& f, std::size_t block) {
+  for (std::size_t off = 0; off < f.size(); off += block)
+    store.put(f.data() + off, std::min(block, f.size() - off));
+}
+
+static void report(const char* name, const std::vector<bytes>& files) {
+  p2p::chunk_store cdc, fixed;
+  bool roundtrip = true;
+  for (const auto& f : files) {
+    auto recipe = cdc.add_file(f.data(), f.size());
+    auto back = cdc.assemble(recipe);
+    roundtrip &= back && back->to_string() == std::string(f.begin(), f.end());
+    add_fixed(fixed, f, cdc.chunker().params().avg_size);
+  }
+  for (auto* s : {&cdc, &fixed}) {
+    auto st = s->stats();
+    std::cout << std::left << std::setw(10) << name << std::setw(8) << (s == &cdc ? "fastcdc" : "fixed")
+              << std::right << std::setw(12) << (st.logical_bytes >> 10) << std::setw(12)
+              << (st.stored_bytes >> 10) << std::setw(12) << (st.bytes_saved() >> 10) << std::setw(10)
+              << std::fixed << std::setprecision(2) << st.dedup_ratio() << "x"
+              << std::setw(10) << st.chunks << "\n";
+  }
+  if (!roundtrip) std::cout << "  assemble: MISMATCH\n";
+}
+
+int main(int argc, char** argv) {
+  std::size_t file_size = ((argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 32) << 20;
+  std::mt19937_64 rng(5);
+
+  // --- 1) débit du découpage ---
+  bytes noise(256 << 20);
+  for (auto& b : noise) b = static_cast<std::uint8_t>(rng());
+  p2p::fastcdc chunker;
+  std::size_t chunks = 0, smallest = SIZE_MAX, largest = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  chunker.split(noise.data(), noise.size(), [&](std::size_t, std::size_t len) {
+    ++chunks;
+    smallest = std::min(smallest, len);
+    largest = std::max(largest, len);
+  });
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  std::cout << "fastcdc chunking   : " << std::fixed << std::setprecision(2)
+            << double(noise.size()) / s / 1e9 << " GB/s (1 core), " << chunks << " chunks, avg "
+            << noise.size() / chunks << " B, min " << smallest << ", max " << largest << "\n\n";
+  noise = bytes();
+
+  // --- 2) déduplication ---
+  std::cout << std::left << std::setw(10) << "dataset" << std::setw(8) << "chunker" << std::right
+            << std::setw(12) << "logical KiB" << std::setw(12) << "stored KiB" << std::setw(12)
+            << "saved KiB" << std::setw(11) << "dedup" << std::setw(10) << "chunks\n";
+
+  bytes base = make_text(file_size, rng);
+  std::vector<bytes> versions{base};
+  for (int v = 0; v < 8; ++v) versions.push_back(edit(versions.back(), 20, rng));
+  report("versions", versions);
+
+  bytes shifted{'#'};
+  shifted.insert(shifted.end(), base.begin(), base.end());
+  report("shifted", {base, shifted});
+
+  std::vector<bytes> libs;
+  for (int l = 0; l < 8; ++l) libs.push_back(make_text(1 << 20, rng));
+  std::vector<bytes> bundles;
+  for (int b = 0; b < 6; ++b) {
+    bytes out;
+    for (int i = 0; i < 5; ++i) {
+      bytes header = make_text(100 + rng() % 400, rng);
+      out.insert(out.end(), header.begin(), header.end());
+      const bytes& lib = libs[rng() % libs.size()];
+      out.insert(out.end(), lib.begin(), lib.end());
+    }
+    bundles.push_back(std::move(out));
+  }
+  report("bundle", bundles);
+  return 0;
+}
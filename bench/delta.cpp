@@ -0,0 +1,108 @@
+// ===========================================
+// DELTA.CPP (benchmark)
+// Transfert différentiel (delta.hpp) vs transfert complet.
+//
+// Un fichier de base, puis une nouvelle version avec N petites
+// modifications (insertion, suppression ou remplacement de 1 à 100 octets).
+// Pour chaque cas : octets sur le fil (signature + delta vs fichier
+// complet), temps CPU de chaque étape, et durée estimée du transfert sur
+// un lien à `mbit` Mbit/s. Le cas "unrelated" (aucun bloc commun) mesure
+// la recherche roulante dans le pire cas : chaque position est testée.
+//
+// Usage : delta [file_mib] [mbit]   (défauts 64 et 100)
+// ===========================================
+
+#include "delta.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using bytes = std::vector<std::uint8_t>;
+using clock_type = std::chrono::steady_clock;
+
+static double ms_since(clock_type::time_point t0) {
+  return std::chrono::duration<double, std::milli>(clock_type::now() - t0).count();
+}
+
+static bytes random_bytes(std::size_t n, std::mt19937_64& rng) {
+  bytes out(n);
+  for (auto& b : out) b = static_cast<std::uint8_t>(rng() % 64 + 32);  // texte-ish
+  return out;
+}
+
+static bytes edit(const bytes& base, int edits, std::mt19937_64& rng) {
+  bytes v = base;
+  for (int e = 0; e < edits; ++e) {
+    std::size_t at = rng() % v.size();
+    std::size_t len = 1 + rng() % 100;
+    bytes patch = random_bytes(len, rng);
+    switch (rng() % 3) {
+      case 0: v.insert(v.begin() + at, patch.begin(), patch.end()); break;
+      case 1: v.erase(v.begin() + at, v.begin() + std::min(v.size(), at + len)); break;
+      default:
+        for (std::size_t i = 0; i < len && at + i < v.size(); ++i) v[at + i] = patch[i];
+    }
+  }
+  return v;
+}
+
+int main(int argc, char** argv) {
+  std::size_t file_size = ((argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 64) << 20;
+  double mbit = (argc > 2) ? std::strtod(argv[2], nullptr) : 100.0;
+  double bytes_per_ms = mbit * 1e6 / 8 / 1000;
+  std::mt19937_64 rng(3);
+  bytes base = random_bytes(file_size, rng);
+
+  std::cout << "file " << (file_size >> 20) << " MiB, link " << mbit << " Mbit/s\n\n"
+            << std::left << std::setw(11) << "case" << std::right << std::setw(7) << "block"
+            << std::setw(11) << "sig KiB" << std::setw(11) << "delta KiB" << std::setw(10) << "wire %"
+            << std::setw(9) << "sig ms" << std::setw(10) << "delta ms" << std::setw(10) << "apply ms"
+            << std::setw(11) << "scan MB/s" << std::setw(10) << "full s" << std::setw(10) << "sync s"
+            << "  check\n";
+
+  struct scenario {
+    const char* name;
+    bytes data;
+  };
+  std::vector<scenario> cases;
+  for (int edits : {1, 10, 100}) cases.push_back({nullptr, edit(base, edits, rng)});
+  cases[0].name = "1 edit";
+  cases[1].name = "10 edits";
+  cases[2].name = "100 edits";
+  cases.push_back({"unrelated", random_bytes(file_size, rng)});
+
+  for (std::size_t block : {2048u, 8192u}) {
+    auto t0 = clock_type::now();
+    auto sig = p2p::delta::make_signature(base.data(), base.size(), block);
+    double sig_ms = ms_since(t0);
+
+    for (const auto& c : cases) {
+      p2p::delta::delta_stats st;
+      t0 = clock_type::now();
+      auto d = p2p::delta::make_delta(sig, c.data.data(), c.data.size(), &st);
+      double delta_ms = ms_since(t0);
+      t0 = clock_type::now();
+      auto rebuilt = p2p::delta::apply_delta(base.data(), base.size(), block, d.data(), d.size());
+      double apply_ms = ms_since(t0);
+
+      double wire = double(sig.wire_size() + d.size());
+      double full_s = double(c.data.size()) / bytes_per_ms / 1000;
+      double sync_s = (wire / bytes_per_ms + sig_ms + delta_ms + apply_ms) / 1000;
+      std::cout << std::left << std::setw(11) << c.name << std::right << std::setw(7) << block
+                << std::setw(11) << (sig.wire_size() >> 10) << std::setw(11) << (d.size() >> 10)
+                << std::setw(10) << std::fixed << std::setprecision(2) << 100 * wire / double(c.data.size())
+                << std::setw(9) << std::setprecision(0) << sig_ms << std::setw(10) << delta_ms
+                << std::setw(10) << apply_ms << std::setw(11)
+                << double(c.data.size()) / 1e3 / delta_ms << std::setw(10) << std::setprecision(2)
+                << full_s << std::setw(10) << sync_s << "  "
+                << (rebuilt && *rebuilt == c.data ? "ok" : "FAILED") << " (" << st.copied_blocks
+                << " blocks, " << st.false_hits << " false hits)\n";
+    }
+  }
+  return 0;
+}
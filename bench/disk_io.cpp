@@ -0,0 +1,262 @@
+// ===========================================
+// DISK_IO.CPP (benchmark)
+// Charge mixte réseau + disque sur un seul io_context (disk_io.hpp).
+//
+// Des pairs "bavards" font des allers-retours de petits messages avec le
+// serveur asynchrone pendant que le même io_context lit et écrit des
+// chunks de 64 KiB à des offsets aléatoires d'un gros fichier (3 lectures
+// pour 1 écriture, O_DIRECT par défaut : le page cache ne masque rien).
+//   - "no disk"      : référence, réseau seul ;
+//   - "blocking"     : pread / pwrite directement sur le thread I/O ;
+//   - "disk_device"  : disk_device asynchrone, opérations en vol bornées.
+// On mesure la latence des allers-retours (p50 / p99 / max) et le débit
+// disque obtenu en parallèle.
+// Avant la mesure, une écriture en plusieurs segments de longueur non
+// alignée est relue et comparée octet par octet, avec et sans O_DIRECT :
+// le moteur compilé (io_uring ou pool de threads) doit rendre ce qu'il a écrit.
+//
+// Usage : disk_io [chatty] [rounds] [file_mib] [depth] [direct 0/1] [directory]
+//         (défauts 32, 300, 512, 16, 1, /tmp)
+// ===========================================
+
+#include "async_server.hpp"
+#include "disk_io.hpp"
+
+#include <asio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace net = asio;
+using tcp = net::ip::tcp;
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t chunk = 64 * 1024;
+constexpr std::size_t alignment = 4096;
+
+struct workload {
+  std::size_t chatty = 32;     // connexions bavardes
+  std::size_t rounds = 300;    // allers-retours par connexion
+  std::size_t file_mib = 512;  // taille du fichier de chunks
+  std::size_t depth = 16;      // opérations disque simultanées
+  bool direct = true;          // O_DIRECT
+  std::string path;
+};
+
+enum class mode { none, blocking, device };
+
+struct result {
+  double p50_us, p99_us, max_us;
+  double disk_mib_s;
+  std::uint64_t disk_ops;
+  std::size_t peak_queued = 0;
+};
+
+// Fichier de chunks rempli une fois (données non nulles)
+static void prepare(const workload& w) {
+  int fd = ::open(w.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) throw std::system_error(errno, std::generic_category(), "open " + w.path);
+  std::vector<char> block(1 << 20);
+  std::mt19937_64 rng(1);
+  for (auto& c : block) c = static_cast<char>(rng());
+  for (std::size_t i = 0; i < w.file_mib; ++i)
+    if (::write(fd, block.data(), block.size()) != static_cast<ssize_t>(block.size()))
+      throw std::system_error(errno, std::generic_category(), "write");
+  ::fsync(fd);
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+}
+
+// Écriture puis relecture via disk_device ; exception si les octets diffèrent
+static void verify(const workload& w, bool direct) {
+  net::io_context io;
+  p2p::disk_options opts;
+  opts.direct = direct;
+  p2p::disk_device device(io, opts);
+  auto file = device.open(w.path, O_RDWR);
+
+  // Trois segments, longueur totale non multiple de l'alignement
+  std::string expected(chunk + 1000, '\0');
+  std::mt19937_64 rng(3);
+  for (auto& c : expected) c = static_cast<char>(rng());
+  p2p::iobuf data = p2p::iobuf::copy(expected.data(), 1000);
+  data.append(p2p::iobuf::copy(expected.data() + 1000, chunk / 2));
+  data.append(p2p::iobuf::copy(expected.data() + 1000 + chunk / 2, expected.size() - 1000 - chunk / 2));
+
+  const std::uint64_t offset = 3 * chunk;
+  std::error_code error;
+  std::string actual;
+  device.async_write(file, offset, std::move(data), [&](std::error_code ec, std::size_t n) {
+    if (ec || n != expected.size()) {
+      error = ec ? ec : std::make_error_code(std::errc::io_error);
+      return;
+    }
+    device.async_read(file, offset, expected.size(), [&](std::error_code ec, p2p::iobuf back) {
+      error = ec;
+      actual = back.to_string();
+    });
+  });
+  io.run();
+  if (error) throw std::system_error(error, "verify write/read");
+  if (actual != expected)
+    throw std::runtime_error(std::string("verify: read back differs from written data") +
+                             (direct ? " (O_DIRECT)" : " (page cache)"));
+}
+
+static result run(mode m, const workload& w) {
+  net::io_context io;
+  p2p::async_server server(io, tcp::endpoint(net::ip::address_v4::loopback(), 0));
+  server.verbose = false;
+  server.start();
+  unsigned short port = server.local_endpoint().port();
+
+  // --- charge disque, pilotée depuis le thread du serveur ---
+  std::mt19937_64 rng(7);
+  std::uint64_t chunks = w.file_mib * (1 << 20) / chunk;
+  std::atomic<bool> stop{false};
+  std::uint64_t ops = 0, bytes = 0;
+  std::size_t running = 0;
+  std::promise<void> drained;
+
+  p2p::disk_options opts;
+  opts.max_in_flight = w.depth;
+  opts.direct = w.direct;
+  p2p::disk_device device(io, opts);
+  auto file = device.open(w.path, O_RDWR);
+
+  p2p::buffer_pool blocking_pool(chunk, 4, alignment);
+  auto block = blocking_pool.acquire();
+  std::fill(block.data(), block.data() + chunk, 'w');
+  auto write_data = p2p::iobuf::copy(block.data(), chunk);
+
+  std::function<void()> issue;
+  auto finished = [&](std::size_t n) {
+    ++ops;
+    bytes += n;
+    if (!stop.load()) issue();
+    else if (--running == 0) drained.set_value();
+  };
+  issue = [&] {
+    std::uint64_t offset = (rng() % chunks) * chunk;
+    bool write = rng() % 4 == 0;
+    if (m == mode::blocking) {
+      net::post(io, [&, offset, write] {
+        int fd = file->native_handle();
+        ssize_t r = write ? ::pwrite(fd, block.data(), chunk, static_cast<off_t>(offset))
+                          : ::pread(fd, block.data(), chunk, static_cast<off_t>(offset));
+        finished(r > 0 ? static_cast<std::size_t>(r) : 0);
+      });
+    } else if (write) {
+      device.async_write(file, offset, write_data.clone(),
+                         [&](std::error_code, std::size_t n) { finished(n); });
+    } else {
+      device.async_read(file, offset, chunk, [&](std::error_code, p2p::iobuf data) { finished(data.size()); });
+    }
+  };
+  if (m != mode::none) {
+    // disk_device : deux fois plus de demandes que d'emplacements (file d'attente exercée)
+    running = (m == mode::device) ? 2 * w.depth : w.depth;
+    std::size_t n = running;
+    net::post(io, [&, n] { for (std::size_t i = 0; i < n; ++i) issue(); });
+  } else {
+    drained.set_value();
+  }
+
+  std::thread server_thread([&] { io.run(); });
+
+  // --- pairs bavards : latence de chaque aller-retour ---
+  net::io_context cio;
+  std::vector<tcp::socket> peers;
+  for (std::size_t i = 0; i < w.chatty; ++i) {
+    peers.emplace_back(cio);
+    peers.back().connect(tcp::endpoint(net::ip::address_v4::loopback(), port));
+    peers.back().set_option(tcp::no_delay(true));
+  }
+  std::string msg = "have 1234 5678 peer-list-delta ok\n";
+  std::vector<char> reply(256);
+  std::vector<double> latencies;
+  latencies.reserve(w.chatty * w.rounds);
+  auto t0 = clock_type::now();
+  for (std::size_t r = 0; r < w.rounds; ++r) {
+    for (auto& p : peers) {
+      auto s = clock_type::now();
+      net::write(p, net::buffer(msg));
+      net::read(p, net::buffer(reply.data(), msg.size() + 8));
+      latencies.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - s).count());
+    }
+  }
+  double elapsed = std::chrono::duration<double>(clock_type::now() - t0).count();
+
+  // --- arrêt : la charge disque se vide, puis les sessions ---
+  stop = true;
+  drained.get_future().wait();
+  result res{};
+  res.disk_ops = ops;
+  res.disk_mib_s = double(bytes) / elapsed / (1 << 20);
+  res.peak_queued = device.stats().peak_queued;
+  for (auto& p : peers) p.close();
+  for (;;) {
+    std::promise<std::size_t> open;
+    net::post(io, [&] { open.set_value(server.sessions()); });
+    if (open.get_future().get() == 0) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  io.stop();
+  server_thread.join();
+
+  std::sort(latencies.begin(), latencies.end());
+  res.p50_us = latencies[latencies.size() / 2];
+  res.p99_us = latencies[latencies.size() * 99 / 100];
+  res.max_us = latencies.back();
+  return res;
+}
+
+int main(int argc, char** argv) {
+  workload w;
+  if (argc > 1) w.chatty = std::strtoull(argv[1], nullptr, 10);
+  if (argc > 2) w.rounds = std::strtoull(argv[2], nullptr, 10);
+  if (argc > 3) w.file_mib = std::strtoull(argv[3], nullptr, 10);
+  if (argc > 4) w.depth = std::max<std::size_t>(1, std::strtoull(argv[4], nullptr, 10));
+  if (argc > 5) w.direct = std::strtoul(argv[5], nullptr, 10) != 0;
+  w.path = std::string((argc > 6) ? argv[6] : "/tmp") + "/p2p_disk_io.bin";
+
+  try {
+    prepare(w);
+    verify(w, false);
+    if (w.direct) verify(w, true);
+    std::cout << "engine " << p2p::disk_device::engine() << ", " << w.chatty << " peers x " << w.rounds
+              << " round trips, " << w.file_mib << " MiB file, " << chunk / 1024 << " KiB chunks (3 reads : 1 write), depth "
+              << w.depth << (w.direct ? ", O_DIRECT" : ", page cache") << "\n\n"
+              << std::left << std::setw(13) << "disk path" << std::right << std::setw(10) << "p50 us"
+              << std::setw(10) << "p99 us" << std::setw(11) << "max us" << std::setw(11) << "disk MiB/s"
+              << std::setw(11) << "disk ops" << std::setw(13) << "peak queued\n";
+    for (auto [m, name] : {std::pair{mode::none, "no disk"}, std::pair{mode::blocking, "blocking"},
+                           std::pair{mode::device, "disk_device"}}) {
+      result r = run(m, w);
+      std::cout << std::left << std::setw(13) << name << std::right << std::fixed << std::setprecision(0)
+                << std::setw(10) << r.p50_us << std::setw(10) << r.p99_us << std::setw(11) << r.max_us
+                << std::setprecision(1) << std::setw(11) << r.disk_mib_s << std::setw(11) << r.disk_ops
+                << std::setw(12) << r.peak_queued << "\n";
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << "[bench] fatal: " << ex.what() << "\n";
+    ::unlink(w.path.c_str());
+    return 1;
+  }
+  ::unlink(w.path.c_str());
+  return 0;
+}
@@ -0,0 +1,162 @@
+// ===========================================
+// HASHING.CPP (benchmark)
+// Débit SHA-256 du moteur de hachage des chunks.
+//
+//   1) vecteurs de test connus + API en flux sur un iobuf dispersé ;
+//   2) GB/s sur un cœur selon la taille des chunks : portable, SHA-NI
+//      un flux, et hash_many (SHA-NI deux flux entrelacés) ;
+//   3) passage à l'échelle : hash_chunks sur un gros tampon avec
+//      1, 2, 4… threads, débit total et débit par cœur.
+//
+// Usage : hashing [total_mib]   (volume par mesure, défaut 256)
+// ===========================================
+
+#include "iobuf.hpp"
+#include "sha256.hpp"
+
+#include <asio/thread_pool.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <span>
+#include <thread>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+static double seconds_since(clock_type::time_point t0) {
+  return std::chrono::duration<double>(clock_type::now() - t0).count();
+}
+
+// Empreinte avec une fonction de compression donnée (pour comparer les implémentations)
+static p2p::digest hash_with(p2p::sha256_detail::compress_fn fn, const std::uint8_t* p, std::size_t n) {
+  std::uint32_t st[8];
+  std::memcpy(st, p2p::sha256_detail::initial_state, sizeof st);
+  fn(st, p, n / 64);
+  std::uint8_t tail[128] = {};
+  std::size_t rest = n % 64;
+  std::memcpy(tail, p + n - rest, rest);
+  tail[rest] = 0x80;
+  std::size_t len = rest < 56 ? 64 : 128;
+  for (int i = 0; i < 8; ++i) tail[len - 1 - i] = static_cast<std::uint8_t>((std::uint64_t(n) * 8) >> (8 * i));
+  fn(st, tail, len / 64);
+  p2p::digest d;
+  for (int i = 0; i < 32; ++i) d[i] = static_cast<std::uint8_t>(st[i / 4] >> (24 - 8 * (i % 4)));
+  return d;
+}
+
+static bool self_test(const std::vector<std::uint8_t>& data) {
+  bool ok = p2p::to_hex(p2p::sha256_of("", 0)) ==
+              "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" &&
+            p2p::to_hex(p2p::sha256_of("abc", 3)) ==
+              "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+  std::string million(1000000, 'a');
+  ok &= p2p::to_hex(p2p::sha256_of(million.data(), million.size())) ==
+        "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+
+  // Chaque taille : sélection courante == portable, flux dispersé == contigu
+  std::vector<std::span<const std::uint8_t>> chunks;
+  for (std::size_t n : {0u, 1u, 55u, 56u, 63u, 64u, 65u, 1000u, 4096u, 65537u}) {
+    p2p::digest ref = hash_with(p2p::sha256_detail::compress_portable, data.data(), n);
+    ok &= p2p::sha256_of(data.data(), n) == ref;
+    p2p::iobuf chain;
+    for (std::size_t off = 0; off < n; off += 1500)
+      chain.append(p2p::iobuf::copy(data.data() + off, std::min<std::size_t>(1500, n - off)));
+    p2p::sha256 h;
+    h.update_buffers(chain.buffers());
+    ok &= h.finish() == ref;
+    chunks.emplace_back(data.data() + n, n);  // tailles inégales deux à deux
+  }
+  std::vector<p2p::digest> many(chunks.size());
+  p2p::hash_many(chunks, many.data());
+  for (std::size_t i = 0; i < chunks.size(); ++i)
+    ok &= many[i] == hash_with(p2p::sha256_detail::compress_portable, chunks[i].data(), chunks[i].size());
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  std::size_t total = ((argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 256) << 20;
+
+  std::vector<std::uint8_t> data(total);
+  std::mt19937_64 rng(11);
+  for (std::size_t i = 0; i + 8 <= data.size(); i += 8) {
+    std::uint64_t v = rng();
+    std::memcpy(data.data() + i, &v, 8);
+  }
+
+  std::cout << "selected implementation: " << p2p::sha256_implementation() << "\n"
+            << "self test              : " << (self_test(data) ? "ok" : "FAILED") << "\n\n";
+
+  // --- 2) un cœur ---
+  struct candidate {
+    const char* name;
+    int mode;  // 0 portable, 1 SHA-NI un flux, 2 hash_many
+  };
+  std::vector<candidate> impls = {{"portable", 0}};
+#ifdef P2P_SHA256_X86
+  if (p2p::sha256_detail::implementation().shani) impls.push_back({"sha-ni", 1});
+#endif
+  impls.push_back({"hash_many", 2});
+
+  std::cout << std::setw(10) << "chunk";
+  for (const auto& c : impls) std::cout << std::setw(12) << c.name;
+  std::cout << "   (GB/s, 1 core)\n";
+
+  for (std::size_t size : {1024u, 16384u, 262144u, 1u << 20}) {
+    std::size_t count = total / size;
+    std::vector<std::span<const std::uint8_t>> chunks;
+    for (std::size_t c = 0; c < count; ++c) chunks.emplace_back(data.data() + c * size, size);
+    std::vector<p2p::digest> out(count);
+
+    std::cout << std::setw(10) << size;
+    for (const auto& c : impls) {
+      // Le portable est lent : un quart du volume
+      std::size_t n = (c.mode == 0) ? std::max<std::size_t>(1, count / 4) : count;
+      auto t0 = clock_type::now();
+      switch (c.mode) {
+        case 0:
+          for (std::size_t i = 0; i < n; ++i)
+            out[i] = hash_with(p2p::sha256_detail::compress_portable, chunks[i].data(), size);
+          break;
+#ifdef P2P_SHA256_X86
+        case 1:
+          for (std::size_t i = 0; i < n; ++i)
+            out[i] = hash_with(p2p::sha256_detail::compress_shani1, chunks[i].data(), size);
+          break;
+#endif
+        default:
+          p2p::hash_many(chunks, out.data());
+          break;
+      }
+      double s = seconds_since(t0);
+      std::cout << std::setw(12) << std::fixed << std::setprecision(2) << double(n * size) / s / 1e9;
+    }
+    std::cout << "\n";
+  }
+
+  // --- 3) passage à l'échelle sur le pool CPU ---
+  std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  std::cout << "\nhash_chunks, " << (total >> 20) << " MiB in 256 KiB chunks (" << cores
+            << " hardware threads)\n"
+            << std::setw(10) << "threads" << std::setw(12) << "GB/s" << std::setw(14) << "GB/s/core"
+            << std::setw(10) << "speedup\n";
+  double base = 0;
+  std::vector<p2p::digest> reference;
+  for (std::size_t threads = 1; threads <= std::max<std::size_t>(cores, 2); threads *= 2) {
+    asio::thread_pool pool(threads);
+    auto t0 = clock_type::now();
+    auto digests = p2p::hash_chunks(pool, data.data(), data.size(), 256 * 1024, threads);
+    double gbs = double(data.size()) / seconds_since(t0) / 1e9;
+    pool.join();
+    if (reference.empty()) {
+      reference = digests;
+      base = gbs;
+    }
+    std::cout << std::setw(10) << threads << std::setw(12) << gbs << std::setw(14)
+              << gbs / double(std::min(threads, cores)) << std::setw(9) << gbs / base << "x"
+              << (digests == reference ? "" : "  MISMATCH") << "\n";
+  }
+  return 0;
+}
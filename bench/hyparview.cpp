@@ -0,0 +1,170 @@
+// ===========================================
+// HYPARVIEW.CPP (benchmark)
+// Appartenance à degré borné (hyparview.hpp) dans le lanceur d'essaim.
+//
+// Pour des essaims de plus en plus grands (jusqu'à `nodes`) :
+//   - les nœuds entrent un par un (un toutes les 5 ms) par un contact
+//     tiré parmi les membres, puis maintain() toutes les 10 s ;
+//   - après une minute de régime établi : connexions (vue active) et vue
+//     passive par nœud, mémoire par nœud, messages par nœud et par
+//     seconde, part des nœuds dans la plus grande composante connexe du
+//     graphe des vues actives ;
+//   - puis `kill` % des nœuds tombent d'un coup ; leurs voisins actifs
+//     l'apprennent par la rupture de la session (un RTT). On mesure la
+//     connexité juste après, le temps (s) pour que 95 % des survivants
+//     aient retrouvé une vue active pleine, et la connexité finale.
+//
+// Usage : hyparview [nodes] [kill_percent]   (défauts 10000, 20)
+// ===========================================
+
+#include "hyparview.hpp"
+#include "swarm.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+struct snapshot {
+  double active_avg = 0;
+  std::size_t active_max = 0;
+  double passive_avg = 0;
+  double full = 0;        // part des vivants à vue active pleine
+  double connected = 0;   // part des vivants dans la plus grande composante
+};
+
+static snapshot measure(const swarm::network& net, const std::vector<std::unique_ptr<p2p::hyparview>>& nodes,
+                        std::size_t active_size) {
+  snapshot s;
+  std::size_t n = nodes.size(), alive = 0;
+  std::vector<std::vector<std::uint32_t>> adj(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    if (!net.alive(i)) continue;
+    ++alive;
+    const auto& a = nodes[i]->active();
+    s.active_avg += double(a.size());
+    s.active_max = std::max(s.active_max, a.size());
+    s.passive_avg += double(nodes[i]->passive().size());
+    s.full += a.size() >= active_size;
+    for (auto j : a) {
+      if (!net.alive(j)) continue;
+      adj[i].push_back(std::uint32_t(j));
+      adj[j].push_back(std::uint32_t(i));
+    }
+  }
+  std::vector<std::uint8_t> seen(n, 0);
+  std::size_t best = 0;
+  std::vector<std::uint32_t> stack;
+  for (std::size_t r = 0; r < n; ++r) {
+    if (seen[r] || !net.alive(r)) continue;
+    std::size_t size = 0;
+    seen[r] = 1;
+    stack.assign(1, std::uint32_t(r));
+    while (!stack.empty()) {
+      auto v = stack.back();
+      stack.pop_back();
+      ++size;
+      for (auto w : adj[v])
+        if (!seen[w]) {
+          seen[w] = 1;
+          stack.push_back(w);
+        }
+    }
+    best = std::max(best, size);
+  }
+  s.active_avg /= double(alive);
+  s.passive_avg /= double(alive);
+  s.full /= double(alive);
+  s.connected = double(best) / double(alive);
+  return s;
+}
+
+int main(int argc, char** argv) {
+  std::size_t max_nodes = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10000;
+  double kill = ((argc > 2) ? std::strtod(argv[2], nullptr) : 20.0) / 100.0;
+  const double join_every = 0.005, period = 10.0, settle = 60.0, window = 30.0;
+  p2p::hyparview_options opts;
+
+  std::cout << "active view " << opts.active_size << ", passive view " << opts.passive_size << ", maintain every "
+            << period << " s; then " << kill * 100 << " % of the nodes fail at once\n\n"
+            << std::setw(7) << "nodes" << std::setw(9) << "conns" << std::setw(6) << "max" << std::setw(9)
+            << "passive" << std::setw(9) << "B/node" << std::setw(11) << "msg/node/s" << std::setw(11) << "connected"
+            << " |" << std::setw(13) << "after fail" << std::setw(11) << "95% full" << std::setw(11) << "connected"
+            << "\n" << std::fixed;
+
+  std::vector<std::size_t> sizes;
+  for (std::size_t n = max_nodes; n >= 1000 && sizes.size() < 4; n /= 2) sizes.insert(sizes.begin(), n);
+  if (sizes.empty()) sizes.push_back(max_nodes);
+
+  for (std::size_t n : sizes) {
+    swarm::network net(n);
+    std::vector<std::unique_ptr<p2p::hyparview>> nodes(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      nodes[i] = std::make_unique<p2p::hyparview>(
+          i,
+          [&net, &nodes, i](p2p::node_id to, p2p::hyparview_message m) {
+            std::size_t bytes = m.wire_size();
+            net.send(i, to, bytes, [&nodes, i, to, m = std::move(m)] { nodes[to]->receive(i, m); },
+                     [&nodes, i, to] { nodes[i]->connection_lost(to); });
+          },
+          opts);
+    }
+    std::function<void(std::size_t)> tick = [&](std::size_t i) {
+      if (!net.alive(i)) return;
+      nodes[i]->maintain();
+      net.after(period, [&tick, i] { tick(i); });
+    };
+    for (std::size_t i = 1; i < n; ++i) {
+      net.at(double(i) * join_every, [&, i] {
+        nodes[i]->join(std::uniform_int_distribution<std::size_t>(0, i - 1)(net.rng()));
+        net.after(std::uniform_real_distribution<double>(0, period)(net.rng()), [&tick, i] { tick(i); });
+      });
+    }
+    net.at(std::uniform_real_distribution<double>(0, period)(net.rng()), [&tick] { tick(0); });
+
+    double joined = double(n) * join_every;
+    net.run_until(joined + settle);
+    std::uint64_t m0 = net.total_messages();
+    net.run_until(joined + settle + window);
+    double per_node = double(net.total_messages() - m0) / window / double(n);
+    snapshot steady = measure(net, nodes, opts.active_size);
+    std::size_t mem = 0;
+    for (const auto& node : nodes) mem += node->memory_bytes();
+
+    // --- pannes ---
+    std::vector<std::size_t> order(n);
+    for (std::size_t i = 0; i < n; ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), net.rng());
+    std::size_t killed = std::size_t(kill * double(n));
+    for (std::size_t k = 0; k < killed; ++k) {
+      std::size_t v = order[k];
+      net.kill(v);
+      for (auto w : nodes[v]->active())
+        net.after(2 * net.latency(v, w), [&nodes, w, v] { nodes[w]->connection_lost(v); });
+    }
+    double t_fail = net.now();
+    snapshot hit = measure(net, nodes, opts.active_size);
+    double repair = -1;
+    for (double t = 0.1; t <= 60.0; t += 0.1) {
+      net.run_until(t_fail + t);
+      if (measure(net, nodes, opts.active_size).full >= 0.95) {
+        repair = t;
+        break;
+      }
+    }
+    net.run_until(t_fail + 60.0);
+    snapshot after = measure(net, nodes, opts.active_size);
+
+    std::cout << std::setw(7) << n << std::setprecision(2) << std::setw(9) << steady.active_avg << std::setw(6)
+              << steady.active_max << std::setw(9) << steady.passive_avg << std::setprecision(0) << std::setw(9)
+              << double(mem) / double(n) << std::setprecision(2) << std::setw(11) << per_node << std::setprecision(1)
+              << std::setw(10) << steady.connected * 100 << "%" << " |" << std::setw(12) << hit.connected * 100 << "%"
+              << std::setw(11);
+    if (repair < 0) std::cout << "> 60";
+    else std::cout << std::setprecision(1) << repair;
+    std::cout << std::setw(10) << after.connected * 100 << "%\n";
+  }
+  return 0;
+}
@@ -0,0 +1,163 @@
+// ===========================================
+// IDLE_CONNS.CPP (benchmark)
+// Mesure la mémoire résidente par connexion inactive du serveur asynchrone.
+//
+// Déroulé :
+//   1) le processus lance p2p::async_server sur 127.0.0.1 (port éphémère) ;
+//   2) il fork un enfant qui ouvre N connexions et ne dit plus rien ;
+//      les connexions sont réparties sur plusieurs adresses 127.x.y.1
+//      pour ne pas épuiser les ports éphémères d'une seule adresse source ;
+//   3) quand toutes les sessions sont acceptées, on lit le RSS du serveur
+//      et on affiche les octets par connexion inactive.
+//
+// Usage : idle_conns [N]   (défaut 1000000)
+// Remarque : 1M connexions demandent `ulimit -n` > 1M pour le serveur ET
+//            l'enfant, et un net.core.somaxconn confortable. La mémoire
+//            noyau des sockets n'apparaît pas dans le RSS.
+// Linux uniquement (fork, /proc/self/statm).
+// ===========================================
+
+#include "async_server.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+namespace net = asio;
+using tcp = net::ip::tcp;
+
+// Mémoire résidente du processus courant, en octets
+static std::size_t resident_bytes() {
+  std::ifstream statm("/proc/self/statm");
+  std::size_t pages_total = 0, pages_resident = 0;
+  statm >> pages_total >> pages_resident;
+  return pages_resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Tente de relever la limite de descripteurs au maximum autorisé
+static void raise_fd_limit(std::size_t wanted) {
+  rlimit rl{};
+  if (getrlimit(RLIMIT_NOFILE, &rl) != 0) return;
+  rlim_t target = static_cast<rlim_t>(wanted);
+  if (rl.rlim_max != RLIM_INFINITY && target > rl.rlim_max) target = rl.rlim_max;
+  if (target > rl.rlim_cur) {
+    rl.rlim_cur = target;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+}
+
+// -------------------------------------------
+// Côté enfant : ouvre n connexions bloquantes puis attend d'être tué.
+// Écrit dans `report` le nombre de connexions réellement ouvertes.
+// -------------------------------------------
+static void run_clients(unsigned short port, std::size_t n, int report) {
+  constexpr std::size_t per_source = 20000;  // connexions par adresse source
+  std::size_t opened = 0;
+
+  sockaddr_in dst{};
+  dst.sin_family = AF_INET;
+  dst.sin_port = htons(port);
+  dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  for (std::size_t i = 0; i < n; ++i) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+      std::perror("[bench] socket");
+      break;
+    }
+    // Source 127.a.b.1 avec (a,b) dérivés de l'index de groupe
+    std::uint32_t group = static_cast<std::uint32_t>(i / per_source) + 1;
+    sockaddr_in src{};
+    src.sin_family = AF_INET;
+    src.sin_addr.s_addr = htonl(0x7F000001u | (group << 8));
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&src), sizeof src) != 0 ||
+        ::connect(fd, reinterpret_cast<sockaddr*>(&dst), sizeof dst) != 0) {
+      std::perror("[bench] connect");
+      ::close(fd);
+      break;
+    }
+    ++opened;
+  }
+
+  if (::write(report, &opened, sizeof opened) != sizeof opened) _exit(1);
+  for (;;) pause();  // garder les connexions ouvertes (et muettes)
+}
+
+int main(int argc, char** argv) {
+  std::size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  raise_fd_limit(n + 1024);
+
+  try {
+    net::io_context io;
+    p2p::async_server server(io, tcp::endpoint(net::ip::address_v4::loopback(), 0));
+    server.verbose = false;
+    server.start();
+    unsigned short port = server.local_endpoint().port();
+
+    // Mesure de référence avant toute connexion
+    io.poll();
+    std::size_t rss_before = resident_bytes();
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+      std::perror("[bench] pipe");
+      return 1;
+    }
+
+    io.notify_fork(net::execution_context::fork_prepare);
+    pid_t child = fork();
+    if (child == 0) {
+      io.notify_fork(net::execution_context::fork_child);
+      ::close(fds[0]);
+      run_clients(port, n, fds[1]);
+      _exit(0);
+    }
+    io.notify_fork(net::execution_context::fork_parent);
+    ::close(fds[1]);
+
+    // On lit le compte rendu de l'enfant sans bloquer la boucle d'E/S
+    net::posix::stream_descriptor report(io, fds[0]);
+    std::size_t opened = 0;
+    bool reported = false;
+    report.async_read_some(net::buffer(&opened, sizeof opened),
+      [&](const net::error_code&, std::size_t) { reported = true; });
+
+    auto t0 = std::chrono::steady_clock::now();
+    while (!reported || server.sessions() < opened) {
+      io.run_for(std::chrono::milliseconds(50));
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    // Laisser passer les derniers handlers puis mesurer
+    io.run_for(std::chrono::milliseconds(200));
+    std::size_t rss_after = resident_bytes();
+    std::size_t conns = server.sessions();
+    double per_conn = conns ? double(rss_after - rss_before) / double(conns) : 0.0;
+
+    std::cout << "connections      : " << conns << " / " << n << " requested\n"
+              << "setup time       : "
+              << std::chrono::duration<double>(t1 - t0).count() << " s\n"
+              << "rss before       : " << rss_before / 1024 << " KiB\n"
+              << "rss after        : " << rss_after / 1024 << " KiB\n"
+              << "bytes per idle   : " << per_conn << "\n"
+              << "pool bytes       : " << server.pool().bytes_in_use() << " in use, "
+              << server.pool().bytes_cached() << " cached\n";
+
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+  } catch (const std::exception& ex) {
+    std::cerr << "[bench] fatal: " << ex.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,205 @@
+// ===========================================
+// MANIFEST.CPP (benchmark)
+// Manifeste d'une grosse collection lu sur place (manifest.hpp).
+//
+// Collection synthétique : N fichiers aux chemins réalistes
+// (répertoires imbriqués), 1 à 3 chunks chacun, 5 % de chunks partagés.
+//   1) écriture en flux (manifest_writer) : durée, mémoire du processus ;
+//   2) ouverture à froid (fichier évincé du cache de pages) : durée et RSS ;
+//   3) recherches par chemin et par empreinte, à froid puis à chaud :
+//      latence et RSS après coup, séparé en mémoire anonyme (propre au
+//      processus) et pages du fichier (cache de pages, récupérables) ;
+//   4) pour comparaison, dans un processus fils : lecture et parsing du
+//      même manifeste vers des conteneurs classiques (unordered_map) :
+//      durée avant la première recherche et RSS.
+//
+// Usage : manifest [millions_of_files] [directory] [parse]   (défauts 10, /tmp, 1)
+// ===========================================
+
+#include "manifest.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using clock_type = std::chrono::steady_clock;
+
+static double ms_since(clock_type::time_point t0) {
+  return std::chrono::duration<double, std::milli>(clock_type::now() - t0).count();
+}
+
+// VmRSS / RssAnon / RssFile / VmHWM de /proc/self/status, en Mio
+static double proc_status_mib(const char* key) {
+  std::ifstream in("/proc/self/status");
+  std::string line;
+  while (std::getline(in, line))
+    if (line.rfind(key, 0) == 0) return std::strtod(line.c_str() + std::strlen(key) + 1, nullptr) / 1024;
+  return 0;
+}
+
+static std::string path_of(std::uint64_t i) {
+  return "datasets/shard-" + std::to_string(i % 997) + "/part-" + std::to_string(i / 997 % 1009) + "/object-" +
+         std::to_string(i) + ".bin";
+}
+
+static p2p::digest chunk_id(std::uint64_t i) {
+  p2p::digest d;
+  std::uint64_t x = (i + 1) * 0x9e3779b97f4a7c15ull;
+  for (std::size_t k = 0; k < d.size(); k += 8) {
+    x ^= x >> 31;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 29;
+    std::memcpy(d.data() + k, &x, 8);
+  }
+  return d;
+}
+
+// Évince le fichier du cache de pages (ouverture "à froid" sans privilèges)
+static void evict(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  ::fdatasync(fd);
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+}
+
+int main(int argc, char** argv) {
+  std::uint64_t files = ((argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10) * 1000000;
+  std::string path = std::string((argc > 2) ? argv[2] : "/tmp") + "/p2p_manifest.bin";
+  bool parse = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) != 0 : true;
+  std::cout << std::fixed << std::setprecision(1);
+
+  // --- 1) écriture en flux ---
+  std::uint64_t chunks = 0;
+  std::uint64_t shared = 0;
+  {
+    double rss0 = proc_status_mib("VmRSS:");
+    auto t0 = clock_type::now();
+    p2p::manifest_writer writer(path);
+    std::mt19937_64 rng(1);
+    std::vector<p2p::chunk_ref> recipe;
+    for (std::uint64_t f = 0; f < files; ++f) {
+      recipe.clear();
+      std::size_t n = 1 + rng() % 3;
+      for (std::size_t k = 0; k < n; ++k) {
+        bool dup = chunks > 0 && rng() % 20 == 0;   // chunk déjà vu ailleurs
+        shared += dup;
+        recipe.push_back({chunk_id(dup ? rng() % chunks : chunks), static_cast<std::uint32_t>(65536 + rng() % 65536)});
+        if (!dup) ++chunks;
+      }
+      writer.add_file(path_of(f), 0, recipe);
+    }
+    writer.finish();
+    std::cout << files << " files, " << writer.chunk_count() << " chunk entries (" << shared << " shared)\n"
+              << "streaming build      : " << ms_since(t0) / 1e3 << " s, +"
+              << proc_status_mib("VmRSS:") - rss0 << " MiB RSS\n";
+  }
+
+  // --- 2) ouverture à froid ---
+  evict(path);
+  double rss0 = proc_status_mib("VmRSS:");
+  auto t0 = clock_type::now();
+  p2p::manifest m(path);
+  double open_us = ms_since(t0) * 1e3;
+  std::cout << "manifest size        : " << double(m.mapped_bytes()) / (1 << 20) << " MiB\n"
+            << std::setprecision(2) << "cold open            : " << open_us << " us, +"
+            << proc_status_mib("VmRSS:") - rss0 << " MiB RSS\n";
+
+  // --- 3) recherches ---
+  constexpr std::size_t lookups = 100000;
+  std::mt19937_64 rng(7);
+  std::vector<std::string> paths(lookups);
+  std::vector<p2p::digest> ids(lookups);
+  for (std::size_t i = 0; i < lookups; ++i) {
+    paths[i] = path_of(rng() % files);
+    ids[i] = chunk_id(rng() % chunks);
+  }
+  double anon0 = proc_status_mib("RssAnon:");
+  double file0 = proc_status_mib("RssFile:");
+  for (const char* pass : {"cold", "warm"}) {
+    std::size_t found = 0;
+    t0 = clock_type::now();
+    for (const auto& p : paths) found += m.find(p).has_value();
+    double path_us = ms_since(t0) * 1e3 / lookups;
+    t0 = clock_type::now();
+    for (const auto& id : ids) found += m.find_chunk(id) != nullptr;
+    double chunk_us = ms_since(t0) * 1e3 / lookups;
+    std::cout << "lookups (" << pass << ")       : path " << path_us << " us, chunk " << chunk_us << " us ("
+              << found << "/" << 2 * lookups << " found)\n";
+  }
+  std::cout << std::setprecision(1) << "RSS after lookups    : +" << proc_status_mib("RssAnon:") - anon0
+            << " MiB anonymous, +" << proc_status_mib("RssFile:") - file0 << " MiB file pages\n";
+
+  // --- 4) comparaison : parsing vers des conteneurs classiques ---
+  if (!parse) {
+    ::unlink(path.c_str());
+    return 0;
+  }
+  evict(path);
+  std::cout.flush();
+  if (pid_t pid = ::fork(); pid == 0) {
+    struct file_rec {
+      std::uint64_t size;
+      std::uint64_t first_chunk;
+      std::uint32_t chunk_count;
+    };
+    double base = proc_status_mib("VmRSS:");
+    t0 = clock_type::now();
+    std::ifstream in(path, std::ios::binary);
+    p2p::manifest_format::header h;
+    in.read(reinterpret_cast<char*>(&h), sizeof h);
+    std::vector<p2p::manifest_format::file_entry> entries(h.files);
+    std::vector<p2p::manifest_format::chunk_entry> chunk_entries(h.chunks);
+    std::string strings(h.strings_size, '\0');
+    in.seekg(static_cast<std::streamoff>(h.files_offset));
+    in.read(reinterpret_cast<char*>(entries.data()), static_cast<std::streamsize>(h.files * sizeof(entries[0])));
+    in.read(reinterpret_cast<char*>(chunk_entries.data()),
+            static_cast<std::streamsize>(h.chunks * sizeof(chunk_entries[0])));
+    in.read(strings.data(), static_cast<std::streamsize>(h.strings_size));
+
+    struct digest_hash {
+      std::size_t operator()(const p2p::digest& d) const {
+        std::size_t v;
+        std::memcpy(&v, d.data(), sizeof v);
+        return v;
+      }
+    };
+    std::unordered_map<std::string, file_rec> by_path;
+    std::unordered_map<p2p::digest, std::uint32_t, digest_hash> by_chunk;
+    by_path.reserve(entries.size());
+    by_chunk.reserve(chunk_entries.size());
+    for (const auto& e : entries)
+      by_path.emplace(strings.substr(e.path_offset, e.path_length), file_rec{e.size, e.first_chunk, e.chunk_count});
+    for (std::uint32_t c = 0; c < chunk_entries.size(); ++c) by_chunk.emplace(chunk_entries[c].id, c);
+    strings = std::string();
+    entries = {};
+    double load_s = ms_since(t0) / 1e3;
+    std::size_t found = 0;
+    t0 = clock_type::now();
+    for (const auto& p : paths) found += by_path.count(p);
+    for (const auto& id : ids) found += by_chunk.count(id);
+    double lookup_us = ms_since(t0) * 1e3 / (2 * lookups);
+    std::cout << "parsed containers    : " << load_s << " s before the first lookup, +"
+              << proc_status_mib("VmRSS:") - base << " MiB RSS (peak " << proc_status_mib("VmHWM:")
+              << " MiB), " << std::setprecision(2) << lookup_us << " us/lookup (" << found << " found)\n";
+    std::cout.flush();
+    ::_exit(0);
+  } else {
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      std::cout << "parsed containers    : child failed (out of memory?)\n";
+  }
+  ::unlink(path.c_str());
+  return 0;
+}
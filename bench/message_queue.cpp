@@ -0,0 +1,138 @@
+// ===========================================
+// MESSAGE_QUEUE.CPP (benchmark)
+// File persistante des messages pour pairs hors ligne (message_queue.hpp).
+//
+// 1) Ajouts durables par seconde : `sessions` sessions en boucle fermée
+//    (chacune attend que son message soit durable avant le suivant),
+//    messages de `size` octets, pendant `seconds` s :
+//      - fsync par message : un fdatasync par ajout ;
+//      - commit groupé : un fdatasync couvre tous les ajouts en attente.
+// 2) Pairs hors ligne : `messages` messages pour `peers` pairs, arrêt,
+//    réouverture (relecture mmap), retour des pairs et vidage par lots de
+//    64 avec ack ; 1 % des pairs restent absents et bloquent de vieux
+//    segments jusqu'à compact().
+//
+// Usage : message_queue [sessions] [seconds] [size] [messages] [peers] [dir]
+//         (défauts 64, 2, 256, 200000, 1000, /tmp)
+// ===========================================
+
+#include "message_queue.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+static double seconds_since(clock_type::time_point t0) {
+  return std::chrono::duration<double>(clock_type::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+  std::size_t sessions = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 64;
+  double seconds = (argc > 2) ? std::strtod(argv[2], nullptr) : 2.0;
+  std::size_t size = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 256;
+  std::size_t messages = (argc > 4) ? std::strtoull(argv[4], nullptr, 10) : 200000;
+  std::size_t peers = (argc > 5) ? std::strtoull(argv[5], nullptr, 10) : 1000;
+  std::string dir = std::string((argc > 6) ? argv[6] : "/tmp") + "/p2p_mqueue";
+  std::vector<char> payload(size, 'm');
+
+  // --- 1) ajouts durables ---
+  std::cout << sessions << " sessions, " << size << " B messages, " << seconds << " s per mode\n\n"
+            << std::left << std::setw(22) << "mode" << std::right << std::setw(12) << "appends/s" << std::setw(9)
+            << "syncs" << std::setw(11) << "avg batch" << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms"
+            << "\n" << std::fixed;
+  double rate[2] = {0, 0};
+  for (int mode = 0; mode < 2; ++mode) {
+    std::filesystem::remove_all(dir);
+    asio::io_context io;
+    p2p::message_queue_options opts;
+    opts.group_commit = mode == 1;
+    p2p::message_queue queue(io, dir, opts);
+    std::vector<double> latency;
+    auto t0 = clock_type::now();
+    bool stop = false;
+    std::function<void(std::uint64_t)> send = [&](std::uint64_t peer) {
+      auto start = clock_type::now();
+      queue.append(peer, payload, [&, peer, start](std::error_code ec, std::uint64_t) {
+        if (ec) {
+          std::cerr << "sync failed: " << ec.message() << "\n";
+          std::exit(1);
+        }
+        latency.push_back(std::chrono::duration<double, std::milli>(clock_type::now() - start).count());
+        stop = stop || seconds_since(t0) >= seconds;
+        if (!stop) send(peer);
+      });
+    };
+    for (std::size_t s = 0; s < sessions; ++s) send(s);
+    io.run();
+    double elapsed = seconds_since(t0);
+    const auto& st = queue.stats();
+    std::sort(latency.begin(), latency.end());
+    auto pct = [&](double p) { return latency[std::min(latency.size() - 1, std::size_t(p * double(latency.size())))]; };
+    rate[mode] = double(st.durable) / elapsed;
+    std::cout << std::left << std::setw(22) << (mode ? "group commit" : "fsync per message") << std::right
+              << std::setprecision(0) << std::setw(12) << rate[mode] << std::setw(9) << st.syncs
+              << std::setprecision(1) << std::setw(11) << double(st.durable) / double(std::max<std::uint64_t>(st.syncs, 1))
+              << std::setprecision(2) << std::setw(10) << pct(0.5) << std::setw(10) << pct(0.99) << "\n";
+  }
+  std::cout << "group commit speedup: " << std::setprecision(1) << rate[1] / std::max(rate[0], 1e-9) << "x\n\n";
+
+  // --- 2) pairs hors ligne, reprise, vidage, compaction ---
+  std::filesystem::remove_all(dir);
+  p2p::message_queue_options opts;
+  opts.segment_size = 4 << 20;
+  std::size_t offline = std::max<std::size_t>(peers / 100, 1);
+  {
+    asio::io_context io;
+    p2p::message_queue queue(io, dir, opts);
+    std::mt19937_64 rng(3);
+    auto t0 = clock_type::now();
+    for (std::size_t i = 0; i < messages; ++i) queue.append(rng() % peers, payload);
+    io.run();
+    std::cout << messages << " messages for " << peers << " offline peers: " << std::setprecision(0)
+              << double(messages) / seconds_since(t0) << " durable appends/s, " << queue.stats().syncs << " syncs, "
+              << queue.segments() << " segments of " << (opts.segment_size >> 20) << " MiB\n";
+  }
+  asio::io_context io;
+  auto t0 = clock_type::now();
+  p2p::message_queue queue(io, dir, opts);
+  std::cout << "reopen: " << queue.stats().replayed << " pending messages replayed in " << std::setprecision(1)
+            << seconds_since(t0) * 1000 << " ms\n";
+
+  t0 = clock_type::now();
+  std::size_t drained = 0, batches = 0;
+  for (std::size_t peer = offline; peer < peers; ++peer) {
+    std::uint64_t last = 0;
+    for (;;) {
+      auto batch = queue.next_batch(peer, last);
+      if (batch.empty()) break;
+      ++batches;
+      drained += batch.size();
+      last = batch.back().seq;
+    }
+    queue.ack(peer, last);
+  }
+  io.run();
+  double drain_s = seconds_since(t0);
+  std::cout << "reconnect: " << drained << " messages to " << peers - offline << " peers in " << batches
+            << " batches, " << std::setprecision(0) << double(drained) / drain_s << " msg/s; "
+            << queue.pending_peers() << " peers still offline pin " << queue.segments() << " segments ("
+            << (queue.disk_bytes() >> 20) << " MiB)\n";
+
+  t0 = clock_type::now();
+  std::size_t removed = queue.compact();
+  std::cout << "compact: " << queue.stats().moved << " messages moved, " << removed << " segments removed in "
+            << std::setprecision(1) << seconds_since(t0) * 1000 << " ms, " << queue.segments() << " left ("
+            << (queue.disk_bytes() >> 20) << " MiB)\n";
+
+  std::filesystem::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,381 @@
+// ===========================================
+// PLAYBACK.CPP (benchmark)
+// Lecture continue pendant le téléchargement (playback.hpp).
+//
+// Réseau émulé (simulation à événements discrets, temps virtuel) :
+//   - des pairs aux débits montants log-normaux (médiane 150 KiB/s, de
+//     quelques dizaines de KiB/s à quelques MiB/s), RTT de 20 à 200 ms,
+//     débit bruité à chaque transfert et pauses occasionnelles (4 s,
+//     congestion) ; 20 % de seeds, les autres ont 50 à 90 % des pièces ;
+//   - chaque pair sert ses demandes une à une, 2 demandes en attente au plus ;
+//   - le lecteur attend `prebuffer` pièces pour démarrer, puis consomme au
+//     débit du média ; une pièce absente quand il l'atteint = une coupure.
+//
+// Stratégies comparées sur les mêmes essaims et le même hasard :
+//   rarest-first seul, séquentiel (plus petite pièce manquante), tous deux
+//   sans fin de partie, et playback_picker (échéances dans la fenêtre,
+//   rarest-first au-delà, redemandes). Moyennes sur `runs` essaims tirés
+//   au hasard : délai de démarrage, coupures (nombre, durée), fin du
+//   téléchargement, octets perdus en demandes annulées.
+//
+// Enfin, playback_reader pour de vrai (disk_device, io_context) : un
+// thread lit le fichier en séquence pendant que les pièces arrivent.
+//
+// Usage : playback [peers] [pieces] [bitrate_kib] [runs]   (défauts 40, 512, 1280, 20)
+// ===========================================
+
+#include "playback.hpp"
+
+#include <asio/steady_timer.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+constexpr std::size_t piece_size = 256 << 10;
+constexpr std::size_t pipeline = 2;        // demandes en attente par pair
+constexpr std::size_t prebuffer = 8;       // pièces avant de démarrer (1,6 s à 1,25 Mio/s)
+
+using time_point = p2p::playback_picker::time_point;
+
+static time_point at(double t) {
+  return time_point{} + std::chrono::duration_cast<p2p::playback_picker::clock::duration>(std::chrono::duration<double>(t));
+}
+
+// -------------------------------------------
+// Stratégies
+// -------------------------------------------
+struct strategy {
+  virtual ~strategy() = default;
+  virtual std::optional<std::uint32_t> pick(std::uint32_t peer, double now) = 0;
+  virtual std::vector<std::uint32_t> completed(std::uint32_t peer, std::uint32_t piece, double now) = 0;
+  virtual void playhead(std::uint64_t, double) {}
+  virtual void measured(std::uint32_t, std::size_t, double) {}
+};
+
+struct rarest_first : strategy {
+  p2p::availability& av;
+  explicit rarest_first(p2p::availability& a) : av(a) {
+    for (std::uint32_t i = 0; i < av.pieces(); ++i) av.set_wanted(i, true);
+  }
+  std::optional<std::uint32_t> pick(std::uint32_t peer, double) override {
+    auto piece = av.pick(peer);
+    if (piece) av.set_wanted(*piece, false);
+    return piece;
+  }
+  std::vector<std::uint32_t> completed(std::uint32_t, std::uint32_t, double) override { return {}; }
+};
+
+struct sequential : strategy {
+  p2p::availability& av;
+  std::vector<bool> taken;
+  explicit sequential(p2p::availability& a) : av(a), taken(a.pieces(), false) {}
+  std::optional<std::uint32_t> pick(std::uint32_t peer, double) override {
+    for (std::uint32_t i = 0; i < taken.size(); ++i)
+      if (!taken[i] && av.has(peer, i)) {
+        taken[i] = true;
+        return i;
+      }
+    return std::nullopt;
+  }
+  std::vector<std::uint32_t> completed(std::uint32_t, std::uint32_t, double) override { return {}; }
+};
+
+struct streaming : strategy {
+  p2p::playback_picker picker;
+  streaming(p2p::availability& av, std::uint64_t size, p2p::playback_options opts)
+    : picker(av, size, piece_size, opts) {}
+  std::optional<std::uint32_t> pick(std::uint32_t peer, double now) override { return picker.pick(peer, at(now)); }
+  std::vector<std::uint32_t> completed(std::uint32_t peer, std::uint32_t piece, double now) override {
+    return picker.completed(peer, piece, at(now));
+  }
+  void playhead(std::uint64_t pos, double now) override { picker.set_playhead(pos, at(now)); }
+  void measured(std::uint32_t peer, std::size_t bytes, double seconds) override {
+    picker.record_rate(peer, bytes, seconds);
+  }
+};
+
+// -------------------------------------------
+// Réseau émulé
+// -------------------------------------------
+struct peer_model {
+  double rate;   // octets/s
+  double rtt;    // s
+  std::vector<std::uint64_t> bits;
+};
+
+struct result {
+  double startup = 0;
+  std::size_t stalls = 0;
+  double stalled = 0;
+  double download = 0;
+  std::uint64_t wasted = 0;   // octets de transferts annulés en cours
+};
+
+static result run(const std::vector<peer_model>& models, std::size_t pieces, double bitrate, strategy& s,
+                  std::uint64_t seed) {
+  struct peer_state {
+    std::deque<std::uint32_t> queue;
+    bool busy = false;
+    std::uint32_t serving = 0;
+    double started = 0;
+    std::uint64_t generation = 0;
+  };
+  struct event {
+    double t;
+    int kind;   // 0 : fin de transfert, 1 : fin de lecture d'une pièce
+    std::uint32_t peer, piece;
+    std::uint64_t generation;
+    bool operator>(const event& o) const { return t > o.t; }
+  };
+  std::priority_queue<event, std::vector<event>, std::greater<>> events;
+  std::vector<peer_state> peers(models.size());
+  std::vector<bool> have(pieces, false);
+  std::size_t have_count = 0;
+  std::mt19937_64 rng(seed);
+  std::lognormal_distribution<double> noise(0, 0.5);
+  std::uniform_real_distribution<double> unit(0, 1);
+  double now = 0;
+  result r;
+
+  auto start_next = [&](std::uint32_t p) {
+    auto& ps = peers[p];
+    if (ps.busy || ps.queue.empty()) return;
+    ps.busy = true;
+    ps.serving = ps.queue.front();
+    ps.queue.pop_front();
+    ps.started = now;
+    double d = models[p].rtt + double(piece_size) / (models[p].rate * noise(rng));
+    if (unit(rng) < 0.03) d += 4.0;   // pause : congestion, choke
+    events.push({now + d, 0, p, ps.serving, ps.generation});
+  };
+  auto fill = [&](std::uint32_t p) {
+    auto& ps = peers[p];
+    while (ps.queue.size() + ps.busy < pipeline) {
+      auto piece = s.pick(p, now);
+      if (!piece) break;
+      ps.queue.push_back(*piece);
+    }
+    start_next(p);
+  };
+  auto cancel = [&](std::uint32_t p, std::uint32_t piece) {
+    auto& ps = peers[p];
+    if (auto it = std::find(ps.queue.begin(), ps.queue.end(), piece); it != ps.queue.end()) {
+      ps.queue.erase(it);
+    } else if (ps.busy && ps.serving == piece) {
+      r.wasted += static_cast<std::uint64_t>(double(piece_size) * std::min(1.0, (now - ps.started) * models[p].rate /
+                                                                                 double(piece_size)));
+      ps.busy = false;
+      ++ps.generation;
+      start_next(p);
+    }
+  };
+
+  // Lecteur
+  bool playing = false, finished = false, stalled = false;
+  std::size_t next = 0;            // pièce à lire ensuite
+  double stall_start = 0;
+  auto try_play = [&] {
+    if (finished || playing) return;
+    if (next == 0) {
+      for (std::size_t i = 0; i < std::min(prebuffer, pieces); ++i)
+        if (!have[i]) return;
+      r.startup = now;
+    } else {
+      if (!have[next]) return;
+      if (stalled) r.stalled += now - stall_start;
+      stalled = false;
+    }
+    playing = true;
+    s.playhead(std::uint64_t(next) * piece_size, now);
+    events.push({now + double(piece_size) / bitrate, 1, 0, static_cast<std::uint32_t>(next), 0});
+  };
+
+  s.playhead(0, 0);
+  for (std::uint32_t p = 0; p < peers.size(); ++p) fill(p);
+  while (!events.empty() && !(finished && have_count == pieces)) {
+    event e = events.top();
+    events.pop();
+    now = e.t;
+    if (e.kind == 1) {
+      next = e.piece + 1;
+      playing = false;
+      if (next == pieces) {
+        finished = true;
+        continue;
+      }
+      if (!have[next]) {
+        ++r.stalls;
+        stalled = true;
+        stall_start = now;
+        s.playhead(std::uint64_t(next) * piece_size, now);
+      }
+      try_play();
+      continue;
+    }
+    auto& ps = peers[e.peer];
+    if (e.generation != ps.generation) continue;   // transfert annulé
+    ps.busy = false;
+    s.measured(e.peer, piece_size, now - ps.started);
+    if (!have[e.piece]) {
+      have[e.piece] = true;
+      if (++have_count == pieces) r.download = now;
+      for (std::uint32_t other : s.completed(e.peer, e.piece, now)) cancel(other, e.piece);
+    }
+    if (!playing) {
+      if (next > 0) s.playhead(std::uint64_t(next) * piece_size, now);
+      try_play();
+    }
+    for (std::uint32_t p = 0; p < peers.size(); ++p) fill(p);
+  }
+  return r;
+}
+
+// -------------------------------------------
+// playback_reader pour de vrai
+// -------------------------------------------
+static void reader_check(std::size_t pieces) {
+  std::string path = "/tmp/p2p_playback.bin";
+  std::uint64_t size = std::uint64_t(pieces) * piece_size;
+  asio::io_context io;
+  p2p::disk_device disk(io);
+  auto file = disk.open(path, O_RDWR | O_CREAT | O_TRUNC);
+  if (::ftruncate(file->native_handle(), static_cast<off_t>(size)) != 0) return;
+  p2p::availability av(pieces);
+  p2p::playback_picker picker(av, size, piece_size);
+  p2p::playback_reader reader(io, picker, disk, file, size);
+
+  // Les pièces arrivent toutes les 2 ms, dans l'ordre
+  asio::steady_timer timer(io);
+  std::uint32_t arrived = 0;
+  std::vector<char> data(piece_size);
+  std::function<void()> deliver = [&] {
+    std::fill(data.begin(), data.end(), static_cast<char>('a' + arrived % 26));
+    if (::pwrite(file->native_handle(), data.data(), piece_size, static_cast<off_t>(arrived) * piece_size) < 0) return;
+    picker.completed(0, arrived);
+    if (++arrived == pieces) return;
+    timer.expires_after(std::chrono::milliseconds(2));
+    timer.async_wait([&](std::error_code) { deliver(); });
+  };
+  auto guard = asio::make_work_guard(io);
+  std::thread io_thread([&] { io.run(); });
+  asio::post(io, deliver);
+
+  std::uint64_t total = 0, bad = 0, reads = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (;;) {
+    p2p::iobuf chunk = reader.read(64 << 10);
+    if (chunk.size() == 0) break;
+    char expected = static_cast<char>('a' + (total / piece_size) % 26);
+    for (const auto& seg : chunk.segments())
+      for (std::size_t i = 0; i < seg.length; ++i) bad += seg.data()[i] != expected;
+    total += chunk.size();
+    ++reads;
+  }
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  guard.reset();
+  io.stop();
+  io_thread.join();
+  ::unlink(path.c_str());
+  std::cout << "\nplayback_reader: " << reads << " blocking reads, " << (total >> 20) << " MiB in " << std::setprecision(0)
+            << ms << " ms while " << pieces << " pieces arrived every 2 ms, " << bad << " bad bytes\n";
+}
+
+int main(int argc, char** argv) {
+  std::size_t npeers = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 40;
+  std::size_t pieces = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 512;
+  double bitrate = double((argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 1280) * 1024;
+  std::size_t runs = (argc > 4) ? std::strtoull(argv[4], nullptr, 10) : 20;
+  std::uint64_t size = std::uint64_t(pieces) * piece_size;
+
+  const std::vector<std::string> names = {"rarest-first", "sequential", "deadline, window 16", "deadline, window 32",
+                                          "deadline, window 64"};
+  struct total {
+    double startup = 0, worst_startup = 0, stalled = 0, download = 0, wasted = 0;
+    std::size_t stalls = 0, runs_with_stalls = 0;
+    p2p::playback_stats picks;
+  };
+  std::vector<total> totals(names.size());
+  double swarm_rate = 0;
+
+  for (std::uint64_t seed = 1; seed <= runs; ++seed) {
+    // --- essaim ---
+    std::mt19937_64 rng(seed);
+    std::lognormal_distribution<double> rate(std::log(150.0 * 1024), 1.0);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::vector<peer_model> models(npeers);
+    for (auto& m : models) {
+      m.rate = rate(rng);
+      m.rtt = 0.02 + 0.18 * unit(rng);
+      swarm_rate += m.rate / double(runs);
+      m.bits.assign((pieces + 63) / 64, 0);
+      double density = unit(rng) < 0.2 ? 1.0 : 0.5 + 0.4 * unit(rng);
+      for (std::size_t i = 0; i < pieces; ++i)
+        if (unit(rng) < density) m.bits[i / 64] |= std::uint64_t(1) << (i % 64);
+    }
+    auto swarm = [&] {
+      auto av = std::make_unique<p2p::availability>(pieces);
+      for (std::uint32_t p = 0; p < npeers; ++p) av->bitfield(p, models[p].bits.data());
+      return av;
+    };
+
+    for (std::size_t k = 0; k < names.size(); ++k) {
+      auto av = swarm();
+      std::unique_ptr<strategy> s;
+      if (k == 0) {
+        s = std::make_unique<rarest_first>(*av);
+      } else if (k == 1) {
+        s = std::make_unique<sequential>(*av);
+      } else {
+        p2p::playback_options opts;
+        opts.window = std::size_t(8) << k;
+        opts.bitrate = bitrate;
+        s = std::make_unique<streaming>(*av, size, opts);
+      }
+      result r = run(models, pieces, bitrate, *s, seed);
+      total& t = totals[k];
+      t.startup += r.startup / double(runs);
+      t.worst_startup = std::max(t.worst_startup, r.startup);
+      t.stalls += r.stalls;
+      t.runs_with_stalls += r.stalls > 0;
+      t.stalled += r.stalled / double(runs);
+      t.download += r.download / double(runs);
+      t.wasted += double(r.wasted) / (1 << 20) / double(runs);
+      if (auto* st = dynamic_cast<streaming*>(s.get())) {
+        t.picks.deadline_picks += st->picker.stats().deadline_picks;
+        t.picks.rarest_picks += st->picker.stats().rarest_picks;
+        t.picks.duplicates += st->picker.stats().duplicates;
+      }
+    }
+  }
+
+  std::cout << runs << " swarms of " << npeers << " peers (" << std::fixed << std::setprecision(1)
+            << swarm_rate / (1 << 20) << " MiB/s total upload on average), " << pieces << " x " << (piece_size >> 10)
+            << " KiB pieces, media " << bitrate / 1024 << " KiB/s (" << double(size) / bitrate << " s)\n"
+            << "means per run; stalls = total over all runs (runs with a stall)\n\n"
+            << std::left << std::setw(22) << "strategy" << std::right << std::setw(11) << "startup s" << std::setw(9)
+            << "worst" << std::setw(13) << "stalls" << std::setw(11) << "stalled s" << std::setw(12) << "complete s"
+            << std::setw(12) << "wasted MiB\n";
+  for (std::size_t k = 0; k < names.size(); ++k) {
+    const total& t = totals[k];
+    std::string stalls = std::to_string(t.stalls) + " (" + std::to_string(t.runs_with_stalls) + ")";
+    std::cout << std::left << std::setw(22) << names[k] << std::right << std::setprecision(2) << std::setw(11)
+              << t.startup << std::setw(9) << t.worst_startup << std::setw(13) << stalls << std::setw(11) << t.stalled
+              << std::setw(12) << t.download << std::setw(11) << t.wasted << "\n";
+  }
+  const auto& st = totals.back().picks;
+  std::cout << "window 64: " << st.deadline_picks / runs << " deadline picks, " << st.rarest_picks / runs
+            << " rarest-first, " << st.duplicates / runs << " duplicates per run\n";
+
+  reader_check(64);
+  return 0;
+}
@@ -0,0 +1,258 @@
+// ===========================================
+// PLUMTREE.CPP (benchmark)
+// Diffusion de gros messages (plumtree.hpp) sur HyParView, dans le
+// lanceur d'essaim, contre une rumeur pure (inondation des voisins actifs).
+//
+// `nodes` nœuds forment la vue active HyParView (entrées une par une, puis
+// régime établi), chacun avec un débit montant de `up` Mo/s et descendant
+// de 5 × up. Puis `rounds` messages de `size` Mio partent chacun d'une
+// source au hasard, un toutes les 10 s (plus pour les très gros messages) :
+//   - multiplicateur de bande passante : messages complets émis /
+//     (vivants − 1) ; 1 = chaque nœud reçoit le message une seule fois ;
+//   - couverture et latence (médiane des nœuds, puis dernier nœud = couverture
+//     complète), en moyenne sur les messages ;
+//   - la première diffusion de plumtree inonde (tous les liens sont eager au
+//     départ) : elle est comptée à part ;
+//   - puis des liens actifs sont rompus pendant que chaque message est en
+//     vol (5 % des nœuds perdent un voisin, les deux côtés l'apprennent) :
+//     les gossip / ihave / graft encore en route depuis un ancien voisin ne
+//     doivent recréer aucun lien ; en fin de run, on compte les liens
+//     eager / lazy hors de la vue active HyParView (attendu : 0) ;
+//   - puis `kill` % des nœuds tombent d'un coup, juste avant un nouveau lot
+//     de messages : l'arbre se répare (ihave → graft, voisins neufs de
+//     HyParView).
+//
+// Usage : plumtree [nodes] [size_mib] [rounds] [up_MBps] [kill_percent]
+//         (défauts 1000, 1, 10, 10, 5)
+// ===========================================
+
+#include "hyparview.hpp"
+#include "plumtree.hpp"
+#include "swarm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using time_point = p2p::plumtree::time_point;
+
+static time_point at(double t) {
+  return time_point{} + std::chrono::duration_cast<p2p::plumtree::clock::duration>(std::chrono::duration<double>(t));
+}
+
+static double seconds(time_point t) { return std::chrono::duration<double>(t - time_point{}).count(); }
+
+struct result {
+  double multiplier = 0;   // messages complets émis / (vivants − 1)
+  double coverage = 0;     // part des vivants atteints
+  double median = 0;       // latence médiane (s)
+  double full = 0;         // latence du dernier nœud atteint (s)
+  std::size_t count = 0;
+
+  void add(const result& r) {
+    multiplier += r.multiplier;
+    coverage += r.coverage;
+    median += r.median;
+    full += r.full;
+    ++count;
+  }
+
+  result mean() const {
+    result r = *this;
+    double n = double(std::max<std::size_t>(count, 1));
+    r.multiplier /= n;
+    r.coverage /= n;
+    r.median /= n;
+    r.full /= n;
+    return r;
+  }
+};
+
+struct run_result {
+  result first, steady, churn, after_fail;
+  std::size_t stray_links = 0;   // voisins eager / lazy hors de la vue active
+};
+
+static run_result run(std::size_t n, std::size_t size, std::size_t rounds, double up, double kill, bool prune) {
+  const double join_every = 0.005, period = 10.0, settle = 30.0;
+  swarm::network net(n);
+  for (std::size_t i = 0; i < n; ++i) net.set_bandwidth(i, up, 5 * up);
+
+  p2p::plumtree_options popts;
+  popts.prune = prune;
+  // Un message complet met size / up par saut, un ihave presque rien : l'ihave d'un voisin lazy devance
+  // le message de plusieurs sauts sans que la branche soit cassée
+  double transfer = double(size) / up;
+  double spacing = std::max(10.0, 100 * transfer);
+  popts.ihave_timeout = std::chrono::milliseconds(std::int64_t(std::max(0.5, 30 * transfer) * 1000));
+  std::vector<std::unique_ptr<p2p::plumtree>> trees(n);
+  std::vector<std::unique_ptr<p2p::hyparview>> views(n);
+  std::vector<double> armed(n, -1);   // échéance de tick() programmée, -1 : aucune
+  std::vector<double> delivered_at(n, -1);
+
+  std::function<void(std::size_t)> arm = [&](std::size_t i) {
+    time_point next = trees[i]->next_deadline();
+    if (next == time_point::max()) return;
+    double when = seconds(next) + 1e-6;   // arrondi du temps virtuel : jamais avant l'échéance
+    if (armed[i] >= 0 && armed[i] <= when) return;
+    armed[i] = when;
+    net.at(when, [&, i, when] {
+      if (armed[i] != when || !net.alive(i)) return;
+      armed[i] = -1;
+      trees[i]->tick(at(net.now()));
+      arm(i);
+    });
+  };
+
+  for (std::size_t i = 0; i < n; ++i) {
+    trees[i] = std::make_unique<p2p::plumtree>(
+        i,
+        [&, i](p2p::node_id to, p2p::plumtree_message m) {
+          std::size_t bytes = m.wire_size();
+          net.send(
+              i, to, bytes,
+              [&, i, to, m = std::move(m)] {
+                trees[to]->receive(i, m, at(net.now()));
+                arm(to);
+              },
+              [&views, i, to] { views[i]->connection_lost(to); });
+        },
+        [&delivered_at, &net, i](std::uint64_t, const p2p::iobuf&) { delivered_at[i] = net.now(); }, popts);
+    views[i] = std::make_unique<p2p::hyparview>(
+        i,
+        [&net, &views, i](p2p::node_id to, p2p::hyparview_message m) {
+          std::size_t bytes = m.wire_size();
+          net.send(i, to, bytes, [&views, i, to, m = std::move(m)] { views[to]->receive(i, m); },
+                   [&views, i, to] { views[i]->connection_lost(to); });
+        },
+        p2p::hyparview_options{}, [&trees, i](p2p::node_id node, bool is_up) {
+          if (is_up) trees[i]->neighbor_up(node);
+          else trees[i]->neighbor_down(node);
+        });
+  }
+
+  std::function<void(std::size_t)> maintain = [&](std::size_t i) {
+    if (!net.alive(i)) return;
+    views[i]->maintain();
+    net.after(period, [&maintain, i] { maintain(i); });
+  };
+  for (std::size_t i = 1; i < n; ++i) {
+    net.at(double(i) * join_every, [&, i] {
+      views[i]->join(std::uniform_int_distribution<std::size_t>(0, i - 1)(net.rng()));
+      net.after(std::uniform_real_distribution<double>(0, period)(net.rng()), [&maintain, i] { maintain(i); });
+    });
+  }
+  net.at(std::uniform_real_distribution<double>(0, period)(net.rng()), [&maintain] { maintain(0); });
+  net.run_until(double(n) * join_every + settle);
+
+  std::vector<char> data(size);
+  for (std::size_t k = 0; k < size; ++k) data[k] = char(k * 131);
+  p2p::iobuf payload = p2p::iobuf::copy(data.data(), data.size());
+  std::uint64_t next_id = 1;
+
+  // drop : part des nœuds qui perdent un lien actif pendant la diffusion
+  auto broadcast = [&](double drop) {
+    std::size_t source;
+    do source = std::uniform_int_distribution<std::size_t>(0, n - 1)(net.rng());
+    while (!net.alive(source));
+    std::fill(delivered_at.begin(), delivered_at.end(), -1);
+    std::uint64_t sent0 = 0;
+    for (const auto& t : trees) sent0 += t->stats().payloads_sent;
+
+    double t0 = net.now();
+    trees[source]->broadcast(next_id++, payload.clone());
+    arm(source);
+    for (std::size_t k = 0; k < std::size_t(drop * double(n)); ++k) {
+      net.at(t0 + transfer * (1 + double(k % 4)), [&] {
+        std::size_t v = std::uniform_int_distribution<std::size_t>(0, n - 1)(net.rng());
+        if (!net.alive(v) || views[v]->active().empty()) return;
+        p2p::node_id w = p2p::overlay::random_element(views[v]->active(), net.rng());
+        views[v]->connection_lost(w);
+        views[w]->connection_lost(v);
+      });
+    }
+    net.run_until(t0 + spacing);
+
+    result r;
+    std::vector<double> lat;
+    std::size_t alive = 0;
+    std::uint64_t sent = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      sent += trees[i]->stats().payloads_sent;
+      if (!net.alive(i)) continue;
+      ++alive;
+      if (delivered_at[i] >= 0) lat.push_back(delivered_at[i] - t0);
+    }
+    std::sort(lat.begin(), lat.end());
+    r.multiplier = double(sent - sent0) / double(alive - 1);
+    r.coverage = double(lat.size()) / double(alive);
+    r.median = lat[lat.size() / 2];
+    r.full = lat.back();
+    return r;
+  };
+
+  run_result out;
+  out.first = broadcast(0);
+  out.first.count = 1;
+  for (std::size_t k = 1; k < rounds; ++k) out.steady.add(broadcast(0));
+  for (std::size_t k = 0; k < rounds; ++k) out.churn.add(broadcast(0.05));
+
+  // --- pannes : les voisins actifs l'apprennent au bout d'un RTT ---
+  std::vector<std::size_t> order(n);
+  for (std::size_t i = 0; i < n; ++i) order[i] = i;
+  std::shuffle(order.begin(), order.end(), net.rng());
+  std::size_t killed = std::size_t(kill * double(n));
+  for (std::size_t k = 0; k < killed; ++k) {
+    std::size_t v = order[k];
+    net.kill(v);
+    for (auto w : views[v]->active())
+      net.after(2 * net.latency(v, w), [&views, w, v] { views[w]->connection_lost(v); });
+  }
+  for (std::size_t k = 0; k < rounds; ++k) out.after_fail.add(broadcast(0));
+
+  for (std::size_t i = 0; i < n; ++i) {
+    if (!net.alive(i)) continue;
+    for (const auto* links : {&trees[i]->eager(), &trees[i]->lazy()})
+      for (p2p::node_id x : *links) out.stray_links += !p2p::overlay::contains(views[i]->active(), x);
+  }
+  return out;
+}
+
+static void print(const char* name, const char* phase, const result& r) {
+  std::cout << std::setw(10) << name << std::setw(12) << phase << std::setprecision(2) << std::setw(8)
+            << r.multiplier << "x" << std::setprecision(1) << std::setw(9) << r.coverage * 100 << "%" << std::setprecision(2)
+            << std::setw(10) << r.median << std::setw(10) << r.full << "\n";
+}
+
+int main(int argc, char** argv) {
+  std::size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000;
+  double mib = (argc > 2) ? std::strtod(argv[2], nullptr) : 1.0;
+  std::size_t rounds = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 10;
+  double up = ((argc > 4) ? std::strtod(argv[4], nullptr) : 10.0) * 1e6;
+  double kill = ((argc > 5) ? std::strtod(argv[5], nullptr) : 5.0) / 100.0;
+  std::size_t size = std::size_t(mib * 1024 * 1024);
+
+  std::cout << n << " nodes on HyParView (active view " << p2p::hyparview_options{}.active_size << "), "
+            << mib << " MiB messages, " << up / 1e6 << " MB/s up / " << 5 * up / 1e6 << " MB/s down per node, "
+            << rounds << " messages per phase; then " << kill * 100 << " % of the nodes fail\n\n"
+            << std::setw(10) << "" << std::setw(12) << "phase" << std::setw(9) << "traffic" << std::setw(10)
+            << "coverage" << std::setw(10) << "p50 s" << std::setw(10) << "full s" << "\n" << std::fixed;
+
+  run_result flood = run(n, size, rounds, up, kill, false);
+  print("gossip", "first", flood.first);
+  print("", "steady", flood.steady.mean());
+  print("", "link churn", flood.churn.mean());
+  print("", "after fail", flood.after_fail.mean());
+  run_result tree = run(n, size, rounds, up, kill, true);
+  print("plumtree", "first", tree.first);
+  print("", "steady", tree.steady.mean());
+  print("", "link churn", tree.churn.mean());
+  print("", "after fail", tree.after_fail.mean());
+  std::cout << "\nlinks outside the active view: gossip " << flood.stray_links << ", plumtree " << tree.stray_links
+            << "\n";
+  return 0;
+}
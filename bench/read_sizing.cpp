@@ -0,0 +1,129 @@
+// ===========================================
+// READ_SIZING.CPP (benchmark)
+// Compare une taille de lecture fixe (4 KiB) et la taille adaptative.
+//
+// Charge mixte sur le serveur asynchrone :
+//   - des pairs "bavards" : petits messages en aller-retour ;
+//   - des pairs "en masse" : plusieurs MiB de lignes envoyées d'un coup.
+// On affiche les octets moyens par appel read_some et la mémoire des
+// blocs de lecture : pic total emprunté, et taille de bloc qu'une session
+// emprunte en régime établi (moyenne mesurée à la fermeture).
+//
+// Usage : read_sizing [chatty] [rounds] [bulk] [bulk_mib]
+// ===========================================
+
+#include "async_server.hpp"
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace net = asio;
+using tcp = net::ip::tcp;
+
+struct workload {
+  std::size_t chatty = 50;      // connexions bavardes
+  std::size_t rounds = 200;     // allers-retours par connexion bavarde
+  std::size_t bulk = 4;         // connexions en masse
+  std::size_t bulk_mib = 8;     // MiB envoyés par connexion en masse
+};
+
+// Un pair en masse : un thread écrit, un autre lit toutes les réponses
+static void bulk_peer(unsigned short port, std::size_t bytes) {
+  net::io_context io;
+  tcp::socket sock(io);
+  sock.connect(tcp::endpoint(net::ip::address_v4::loopback(), port));
+
+  std::string line(1023, 'b');
+  line.push_back('\n');
+  std::size_t lines = bytes / line.size();
+  std::size_t expected = lines * (line.size() + 8);  // + "# echo> "
+
+  std::thread reader([&] {
+    std::vector<char> buf(64 * 1024);
+    std::size_t got = 0;
+    net::error_code ec;
+    while (got < expected && !ec) got += sock.read_some(net::buffer(buf), ec);
+  });
+
+  std::string batch;
+  for (int i = 0; i < 64; ++i) batch += line;
+  for (std::size_t sent = 0; sent < lines; sent += 64)
+    net::write(sock, net::buffer(batch));
+  reader.join();
+}
+
+static p2p::read_stats run(const p2p::read_sizing& sizing, const workload& w) {
+  net::io_context io;
+  p2p::async_server server(io, tcp::endpoint(net::ip::address_v4::loopback(), 0), sizing);
+  server.verbose = false;
+  server.start();
+  unsigned short port = server.local_endpoint().port();
+  std::thread server_thread([&] { io.run(); });
+
+  // Pairs en masse en parallèle
+  std::vector<std::thread> bulk;
+  for (std::size_t i = 0; i < w.bulk; ++i)
+    bulk.emplace_back(bulk_peer, port, w.bulk_mib * 1024 * 1024);
+
+  // Pairs bavards : un petit message à la fois, réponse attendue
+  net::io_context cio;
+  std::vector<tcp::socket> peers;
+  for (std::size_t i = 0; i < w.chatty; ++i) {
+    peers.emplace_back(cio);
+    peers.back().connect(tcp::endpoint(net::ip::address_v4::loopback(), port));
+  }
+  std::string msg = "have 1234 5678 peer-list-delta ok\n";
+  std::vector<char> reply(256);
+  for (std::size_t r = 0; r < w.rounds; ++r) {
+    for (auto& p : peers) net::write(p, net::buffer(msg));
+    for (auto& p : peers) net::read(p, net::buffer(reply.data(), msg.size() + 8));
+  }
+
+  for (auto& t : bulk) t.join();
+  for (auto& p : peers) p.close();
+  // Laisser le serveur constater les fermetures avant de l'arrêter
+  // (le compteur est lu depuis le thread du serveur)
+  for (;;) {
+    std::promise<std::size_t> open;
+    net::post(io, [&] { open.set_value(server.sessions()); });
+    if (open.get_future().get() == 0) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  io.stop();
+  server_thread.join();
+  return server.stats();
+}
+
+static void report(const char* name, const p2p::read_stats& st, std::size_t sessions) {
+  std::cout << name << "\n"
+            << "  read syscalls      : " << st.reads << "\n"
+            << "  bytes per read     : " << st.bytes_per_read() << "\n"
+            << "  full reads         : " << (st.reads ? 100.0 * double(st.full_reads) / double(st.reads) : 0.0) << " %\n"
+            << "  peak buffer bytes  : " << st.peak_bytes_in_use << "\n"
+            << "  block per session  : " << st.block_per_session() << " (" << st.closed
+            << " of " << sessions << " sessions)\n";
+}
+
+int main(int argc, char** argv) {
+  workload w;
+  if (argc > 1) w.chatty = std::strtoull(argv[1], nullptr, 10);
+  if (argc > 2) w.rounds = std::strtoull(argv[2], nullptr, 10);
+  if (argc > 3) w.bulk = std::strtoull(argv[3], nullptr, 10);
+  if (argc > 4) w.bulk_mib = std::strtoull(argv[4], nullptr, 10);
+  std::size_t sessions = w.chatty + w.bulk;
+
+  try {
+    report("fixed 4 KiB reads", run(p2p::read_sizing{4096, 4096, 4096}, w), sessions);
+    report("adaptive 512 B .. 64 KiB", run(p2p::read_sizing{}, w), sessions);
+  } catch (const std::exception& ex) {
+    std::cerr << "[bench] fatal: " << ex.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
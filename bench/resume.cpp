@@ -0,0 +1,181 @@
+// ===========================================
+// RESUME.CPP (benchmark)
+// Reprise d'un téléchargement interrompu (resume_state.hpp).
+//
+//   1) téléchargement simulé : les pièces sont écrites (piece_writer),
+//      marquées complètes et validées par lots (commit) ; arrêt propre
+//      aux trois quarts ;
+//   2) redémarrage propre : ouverture du fichier annexe, rien à relire ;
+//   3) arrêt brutal : un processus fils reprend, écrit encore quelques
+//      pièces, en corrompt une, et meurt entre l'écriture et le commit.
+//      Au redémarrage, le mtime ne correspond plus : le téléchargement
+//      repart aussitôt, la vérification tourne en arrière-plan sur le
+//      pool CPU ; on mesure le délai avant qu'une pièce demandée par un
+//      pair (prioritize) soit servable, puis la durée totale ;
+//   4) pour comparaison : re-hacher tout le fichier avant de reprendre.
+//
+// Usage : resume [file_mib] [piece_kib] [threads] [directory]
+//         (défauts 512, 256, 2, /tmp)
+// ===========================================
+
+#include "piece_writer.hpp"
+#include "resume_state.hpp"
+
+#include <asio/thread_pool.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using clock_type = std::chrono::steady_clock;
+
+static double ms_since(clock_type::time_point t0) {
+  return std::chrono::duration<double, std::milli>(clock_type::now() - t0).count();
+}
+
+// Contenu de la pièce i (déterministe)
+static std::vector<std::uint8_t> piece_data(std::size_t i, std::size_t size) {
+  std::vector<std::uint8_t> out(size);
+  std::uint64_t x = (i + 1) * 0x9e3779b97f4a7c15ull;
+  for (std::size_t k = 0; k + 8 <= size; k += 8) {
+    x ^= x >> 31;
+    x *= 0xbf58476d1ce4e5b9ull;
+    std::memcpy(out.data() + k, &x, 8);
+  }
+  return out;
+}
+
+static void write_pieces(p2p::piece_writer& writer, p2p::resume_state& state, std::size_t first,
+                         std::size_t last, std::size_t piece) {
+  std::vector<std::size_t> done;
+  for (std::size_t i = first; i < last; ++i) {
+    auto bytes = piece_data(i, piece);
+    writer.add(i, p2p::iobuf::copy(bytes.data(), bytes.size()));
+    done.push_back(i);
+    if (done.size() == 64 || i + 1 == last) {   // commit groupé : données durables, puis journal
+      writer.sync();
+      for (std::size_t d : done) state.mark_complete(d);
+      state.commit();
+      done.clear();
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  std::uint64_t size = ((argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 512) << 20;
+  std::size_t piece = ((argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 256) << 10;
+  std::size_t threads = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 2;
+  std::string path = std::string((argc > 4) ? argv[4] : "/tmp") + "/p2p_resume.bin";
+  if (piece == 0 || piece % 8 || size % piece) {
+    std::cerr << "file size must be a multiple of the piece size (itself a multiple of 8)\n";
+    return 1;
+  }
+  std::size_t pieces = static_cast<std::size_t>(size / piece);
+  ::unlink(path.c_str());
+  ::unlink((path + ".resume").c_str());
+
+  std::vector<p2p::digest> hashes(pieces);
+  for (std::size_t i = 0; i < pieces; ++i) {
+    auto bytes = piece_data(i, piece);
+    hashes[i] = p2p::sha256_of(bytes.data(), bytes.size());
+  }
+  std::cout << (size >> 20) << " MiB file, " << (piece >> 10) << " KiB pieces (" << pieces << "), sha256 "
+            << p2p::sha256_implementation() << ", " << threads << " verify threads\n"
+            << std::fixed << std::setprecision(2);
+
+  // --- 1) téléchargement jusqu'aux trois quarts, arrêt propre ---
+  std::size_t stop_at = pieces * 3 / 4;
+  {
+    auto t0 = clock_type::now();
+    p2p::piece_writer writer(path, size, piece);
+    p2p::resume_state state(path, size, piece, hashes);
+    write_pieces(writer, state, 0, stop_at, piece);
+    std::cout << "download to 75 %     : " << ms_since(t0) << " ms\n";
+  }
+
+  // --- 2) redémarrage propre ---
+  {
+    auto t0 = clock_type::now();
+    p2p::resume_state state(path);
+    double open_ms = ms_since(t0);
+    auto st = state.stats();
+    std::cout << "clean restart        : " << open_ms << " ms, " << st.complete << "/" << st.pieces
+              << " pieces trusted, verification needed: " << (state.needs_verification() ? "yes" : "no") << "\n";
+  }
+
+  // --- 3) arrêt brutal entre écriture et commit ---
+  std::size_t corrupt = stop_at / 2;
+  if (pid_t pid = ::fork(); pid == 0) {
+    p2p::piece_writer writer(path, size, piece);
+    p2p::resume_state state(path, size, piece, hashes);
+    write_pieces(writer, state, stop_at, stop_at + 32, piece);
+    auto bytes = piece_data(stop_at + 32, piece);
+    writer.add(stop_at + 32, p2p::iobuf::copy(bytes.data(), bytes.size()));   // écrite, jamais validée
+    writer.sync();
+    std::uint8_t flip = 0xff;   // bit pourri dans une pièce déjà validée
+    if (::pwrite(writer.native_handle(), &flip, 1, static_cast<off_t>(corrupt * piece + 100)) != 1) ::_exit(1);
+    ::fdatasync(writer.native_handle());
+    ::_exit(0);   // ni destructeur ni checkpoint
+  } else {
+    ::waitpid(pid, nullptr, 0);
+  }
+  {
+    asio::thread_pool pool(threads);
+    auto t0 = clock_type::now();
+    p2p::resume_state state(path, size, piece, hashes);
+    double open_ms = ms_since(t0);
+    auto st = state.stats();
+    std::cout << "crash restart        : " << open_ms << " ms to resume (" << st.replayed
+              << " journal records), " << st.unverified << " pieces to re-verify\n";
+
+    // Un pair demande la pièce 0 : vérifiée avant le reste de la file
+    std::size_t wanted = 0;
+    std::promise<void> finished;
+    state.verify_async(pool, [&](const p2p::resume_stats&) { finished.set_value(); });
+    state.prioritize(wanted);
+    while (state.state(wanted) == p2p::piece_state::unverified) std::this_thread::yield();
+    double first_ms = ms_since(t0);
+    finished.get_future().wait();
+    state.wait_verified();
+    double all_ms = ms_since(t0);
+    st = state.stats();
+    std::cout << "  requested piece    : servable after " << first_ms << " ms\n"
+              << "  background verify  : " << all_ms << " ms (" << double(st.verified + st.failed) * double(piece)
+                 / (all_ms / 1e3) / (1 << 20) << " MiB/s), " << st.verified << " ok, " << st.failed << " failed"
+              << (state.state(corrupt) == p2p::piece_state::missing ? " (corrupted piece caught)" : "") << "\n";
+  }
+  {
+    auto t0 = clock_type::now();
+    p2p::resume_state state(path);
+    std::cout << "restart after verify : " << ms_since(t0) << " ms, verification needed: "
+              << (state.needs_verification() ? "yes" : "no") << "\n";
+  }
+
+  // --- 4) comparaison : tout re-hacher avant de reprendre ---
+  {
+    auto t0 = clock_type::now();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    std::vector<std::uint8_t> buf(piece);
+    std::size_t good = 0;
+    for (std::size_t i = 0; i < pieces; ++i) {
+      if (::pread(fd, buf.data(), piece, static_cast<off_t>(i * piece)) != static_cast<ssize_t>(piece)) continue;
+      good += p2p::sha256_of(buf.data(), piece) == hashes[i];
+    }
+    ::close(fd);
+    std::cout << "full re-hash         : " << ms_since(t0) << " ms before resuming (" << good << " good pieces)\n";
+  }
+
+  ::unlink(path.c_str());
+  ::unlink((path + ".resume").c_str());
+  return 0;
+}
@@ -0,0 +1,194 @@
+// ===========================================
+// SWARM.HPP (benchmarks)
+// Lanceur d'essaim en processus : des milliers de nœuds sur un réseau
+// émulé, en temps virtuel (simulation à événements discrets).
+//
+//   - latences : chaque nœud a une position dans un plan (5 régions, de
+//     taille et de peuplement inégaux) et une latence d'accès (dernier
+//     kilomètre, loi exponentielle) ; latence aller entre a et b =
+//     distance + accès(a) + accès(b), bruitée à chaque message ;
+//   - débits (facultatifs) : liens montant et descendant par nœud ; un
+//     message occupe la file montante de l'émetteur puis la file
+//     descendante du récepteur (0 = débit illimité) ;
+//   - pannes : kill(n) ; un message vers un nœud mort est perdu et, si
+//     l'émetteur a fourni `failed`, il l'apprend au bout d'un RTT
+//     (connexion refusée, RST) ;
+//   - pertes (facultatives) : send_datagram() perd chaque message avec la
+//     probabilité `loss`, sans prévenir l'émetteur (UDP) ;
+//   - comptage des messages et octets émis par nœud.
+//
+// Les protocoles testés sont sans E/S (overlay.hpp) : leurs callbacks
+// `send` appellent network::send. Mono-thread.
+// ===========================================
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace swarm {
+
+struct network_options {
+  std::uint64_t seed = 1;
+  double jitter = 0.05;          // bruit relatif de la latence de chaque message
+  double access_ms = 5.0;        // moyenne de la latence d'accès
+  double loss = 0;               // probabilité de perte d'un message (datagrammes)
+};
+
+class network {
+public:
+  network(std::size_t nodes, network_options opts = {})
+    : opts_(opts), rng_(opts.seed), x_(nodes), y_(nodes), access_(nodes), alive_(nodes, 1),
+      up_bps_(nodes, 0), down_bps_(nodes, 0), up_free_(nodes, 0), down_free_(nodes, 0),
+      sent_(nodes, 0), bytes_(nodes, 0) {
+    // Régions (centre en ms, étendue, poids) : deux grosses, trois petites
+    const double region[5][4] = {{0, 0, 12, 0.35}, {70, 10, 15, 0.30}, {150, 60, 10, 0.15},
+                                 {40, 120, 20, 0.12}, {-60, 90, 10, 0.08}};
+    std::discrete_distribution<int> pick{region[0][3], region[1][3], region[2][3], region[3][3], region[4][3]};
+    std::normal_distribution<double> spread(0, 1);
+    std::exponential_distribution<double> access(1.0 / opts_.access_ms);
+    for (std::size_t n = 0; n < nodes; ++n) {
+      const double* r = region[pick(rng_)];
+      x_[n] = r[0] + r[2] * spread(rng_);
+      y_[n] = r[1] + r[2] * spread(rng_);
+      access_[n] = 0.5 + access(rng_);
+    }
+  }
+
+  std::size_t size() const { return alive_.size(); }
+
+  // -------------------------------------------
+  // Temps virtuel (secondes)
+  // -------------------------------------------
+  double now() const { return now_; }
+
+  void at(double when, std::function<void()> fn) { events_.push({std::max(when, now_), seq_++, std::move(fn)}); }
+  void after(double delay, std::function<void()> fn) { at(now_ + delay, std::move(fn)); }
+
+  bool step() {
+    if (events_.empty()) return false;
+    event e = std::move(const_cast<event&>(events_.top()));
+    events_.pop();
+    now_ = e.when;
+    e.fn();
+    return true;
+  }
+
+  void run_until(double t) {
+    while (!events_.empty() && events_.top().when <= t) step();
+    now_ = std::max(now_, t);
+  }
+
+  void run() {
+    while (step()) {}
+  }
+
+  std::size_t pending_events() const { return events_.size(); }
+
+  // -------------------------------------------
+  // Réseau
+  // -------------------------------------------
+
+  // Latence aller de base, en secondes
+  double latency(std::size_t a, std::size_t b) const {
+    if (a == b) return 0;
+    return (std::hypot(x_[a] - x_[b], y_[a] - y_[b]) + access_[a] + access_[b]) / 1000.0;
+  }
+
+  // Latence aller d'un message (bruitée)
+  double sample_latency(std::size_t a, std::size_t b) {
+    return latency(a, b) * (1.0 + std::abs(std::normal_distribution<double>(0, opts_.jitter)(rng_)));
+  }
+
+  void set_bandwidth(std::size_t node, double up_bytes_per_s, double down_bytes_per_s) {
+    up_bps_[node] = up_bytes_per_s;
+    down_bps_[node] = down_bytes_per_s;
+  }
+
+  // `delivered` à l'arrivée du dernier octet si `to` est vivant ; sinon
+  // `failed` chez l'émetteur un RTT après l'envoi
+  void send(std::size_t from, std::size_t to, std::size_t bytes, std::function<void()> delivered,
+            std::function<void()> failed = {}) {
+    if (!alive_[from]) return;
+    ++sent_[from];
+    bytes_[from] += bytes;
+    double depart = now_;
+    if (up_bps_[from] > 0) {
+      up_free_[from] = std::max(up_free_[from], now_) + double(bytes) / up_bps_[from];
+      depart = up_free_[from];
+    }
+    double arrive = depart + sample_latency(from, to);
+    if (down_bps_[to] > 0) {
+      down_free_[to] = std::max(down_free_[to], arrive) + double(bytes) / down_bps_[to];
+      arrive = down_free_[to];
+    }
+    at(arrive, [this, from, to, delivered = std::move(delivered), failed = std::move(failed)] {
+      if (alive_[to]) {
+        delivered();
+      } else if (failed && alive_[from]) {
+        after(latency(to, from), [this, from, failed] {
+          if (alive_[from]) failed();
+        });
+      }
+    });
+  }
+
+  // Datagramme : perdu avec la probabilité `loss`, jamais signalé
+  void send_datagram(std::size_t from, std::size_t to, std::size_t bytes, std::function<void()> delivered) {
+    if (opts_.loss > 0 && std::uniform_real_distribution<double>(0, 1)(rng_) < opts_.loss) {
+      if (alive_[from]) {
+        ++sent_[from];
+        bytes_[from] += bytes;
+      }
+      return;
+    }
+    send(from, to, bytes, std::move(delivered));
+  }
+
+  void kill(std::size_t n) { alive_[n] = 0; }
+  void revive(std::size_t n) { alive_[n] = 1; }
+  bool alive(std::size_t n) const { return alive_[n] != 0; }
+
+  std::uint64_t messages_sent(std::size_t n) const { return sent_[n]; }
+  std::uint64_t bytes_sent(std::size_t n) const { return bytes_[n]; }
+
+  std::uint64_t total_messages() const {
+    std::uint64_t t = 0;
+    for (auto s : sent_) t += s;
+    return t;
+  }
+
+  std::uint64_t total_bytes() const {
+    std::uint64_t t = 0;
+    for (auto b : bytes_) t += b;
+    return t;
+  }
+
+  std::mt19937_64& rng() { return rng_; }
+
+private:
+  struct event {
+    double when;
+    std::uint64_t seq;
+    std::function<void()> fn;
+    bool operator>(const event& o) const { return when != o.when ? when > o.when : seq > o.seq; }
+  };
+
+  network_options opts_;
+  std::mt19937_64 rng_;
+  std::vector<double> x_, y_, access_;   // ms
+  std::vector<std::uint8_t> alive_;
+  std::vector<double> up_bps_, down_bps_, up_free_, down_free_;
+  std::vector<std::uint64_t> sent_, bytes_;
+  std::priority_queue<event, std::vector<event>, std::greater<>> events_;
+  std::uint64_t seq_ = 0;
+  double now_ = 0;
+};
+
+} // namespace swarm
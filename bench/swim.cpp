@@ -0,0 +1,154 @@
+// ===========================================
+// SWIM.CPP (benchmark)
+// Détecteur de pannes SWIM (swim.hpp) dans le lanceur d'essaim.
+//
+// Pour des groupes de plus en plus grands (jusqu'à `nodes`), sur UDP
+// émulé avec `loss` % de pertes :
+//   - régime établi (60 s) : messages et octets émis par nœud et par
+//     seconde, mémoire par nœud, fausses suspicions (sondages sans
+//     réponse d'un nœud vivant) et faux décès (nœuds vivants déclarés
+//     morts, démentis trop tard) ;
+//   - `victims` nœuds tombent d'un coup : délai moyen avant la première
+//     suspicion, avant la première déclaration de décès, et avant que
+//     tous les survivants le sachent mort.
+// Un battement de cœur tous-vers-tous à la même période coûterait N − 1
+// messages par nœud et par période.
+//
+// Usage : swim [nodes] [loss_percent] [victims]   (défauts 10000, 1, 10)
+// ===========================================
+
+#include "swim.hpp"
+#include "swarm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using time_point = p2p::swim::time_point;
+
+static time_point at(double t) {
+  return time_point{} + std::chrono::duration_cast<p2p::swim::clock::duration>(std::chrono::duration<double>(t));
+}
+
+static double seconds(time_point t) { return std::chrono::duration<double>(t - time_point{}).count(); }
+
+int main(int argc, char** argv) {
+  std::size_t max_nodes = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10000;
+  double loss = ((argc > 2) ? std::strtod(argv[2], nullptr) : 1.0) / 100.0;
+  std::size_t victims = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 10;
+  const double warmup = 10.0, window = 60.0, horizon = 120.0;
+  p2p::swim_options opts;
+  double period = std::chrono::duration<double>(opts.period).count();
+
+  std::cout << "period " << period << " s, ping timeout " << opts.ping_timeout.count() << " ms, " << opts.indirect
+            << " indirect probes, " << loss * 100 << " % packet loss, " << victims << " nodes fail at once\n\n"
+            << std::setw(7) << "nodes" << std::setw(11) << "msg/node/s" << std::setw(9) << "B/node/s" << std::setw(10)
+            << "mem KiB" << std::setw(12) << "false susp" << std::setw(12) << "false dead" << " |" << std::setw(11)
+            << "suspect s" << std::setw(9) << "dead s" << std::setw(10) << "all know" << "\n" << std::fixed;
+
+  std::vector<std::size_t> sizes;
+  for (std::size_t n = max_nodes; n >= 1000 && sizes.size() < 4; n /= 2) sizes.insert(sizes.begin(), n);
+  if (sizes.empty()) sizes.push_back(max_nodes);
+
+  for (std::size_t n : sizes) {
+    swarm::network_options nopts;
+    nopts.loss = loss;
+    swarm::network net(n, nopts);
+
+    // Victimes : instants de première suspicion, premier décès, nombre de survivants qui la savent morte
+    std::vector<std::size_t> victim_of(n, SIZE_MAX);
+    std::vector<double> first_suspect(victims, -1), first_dead(victims, -1), all_dead(victims, -1);
+    std::vector<std::size_t> known_dead(victims, 0);
+    std::vector<std::uint8_t> falsely_dead(n, 0);
+    bool measuring = false;
+    double t_fail = 0;
+
+    std::vector<std::unique_ptr<p2p::swim>> nodes(n);
+    std::vector<p2p::node_id> everyone(n);
+    for (std::size_t i = 0; i < n; ++i) everyone[i] = i;
+    for (std::size_t i = 0; i < n; ++i) {
+      nodes[i] = std::make_unique<p2p::swim>(
+          i,
+          [&net, &nodes, i](p2p::node_id to, p2p::swim_message m) {
+            std::size_t bytes = m.wire_size();
+            net.send_datagram(i, to, bytes, [&net, &nodes, i, to, m = std::move(m)] {
+              nodes[to]->receive(i, m, at(net.now()));
+            });
+          },
+          opts,
+          [&, i](p2p::node_id node, p2p::member_state state) {
+            if (!net.alive(i)) return;
+            std::size_t v = victim_of[node];
+            if (v == SIZE_MAX) {
+              if (measuring && state == p2p::member_state::dead) falsely_dead[node] = 1;
+              return;
+            }
+            double t = net.now() - t_fail;
+            if (state == p2p::member_state::suspect && first_suspect[v] < 0) first_suspect[v] = t;
+            if (state == p2p::member_state::dead) {
+              if (first_dead[v] < 0) first_dead[v] = t;
+              if (++known_dead[v] == n - victims) all_dead[v] = t;
+            }
+          });
+      nodes[i]->add_members(everyone);
+    }
+
+    std::function<void(std::size_t)> tick = [&](std::size_t i) {
+      if (!net.alive(i)) return;
+      time_point next = nodes[i]->tick(at(net.now()));
+      net.at(seconds(next) + 1e-6, [&tick, i] { tick(i); });   // arrondi du temps virtuel : jamais avant l'échéance
+    };
+    for (std::size_t i = 0; i < n; ++i)
+      net.at(std::uniform_real_distribution<double>(0, period)(net.rng()), [&tick, i] { tick(i); });
+
+    net.run_until(warmup);
+    measuring = true;
+    std::uint64_t m0 = net.total_messages(), b0 = net.total_bytes(), s0 = 0, false_suspect = 0;
+    for (const auto& node : nodes) s0 += node->stats().suspected;
+    net.run_until(warmup + window);
+    measuring = false;
+    for (const auto& node : nodes) false_suspect += node->stats().suspected;
+    false_suspect -= s0;
+    auto false_dead = std::count(falsely_dead.begin(), falsely_dead.end(), 1);
+    double msgs = double(net.total_messages() - m0) / window / double(n);
+    double bytes = double(net.total_bytes() - b0) / window / double(n);
+    std::size_t mem = 0;
+    for (const auto& node : nodes) mem += node->memory_bytes();
+
+    // --- pannes ---
+    std::vector<std::size_t> order(n);
+    for (std::size_t i = 0; i < n; ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), net.rng());
+    t_fail = net.now();
+    for (std::size_t v = 0; v < victims; ++v) {
+      victim_of[order[v]] = v;
+      net.kill(order[v]);
+    }
+    net.run_until(t_fail + horizon);
+
+    auto mean = [&](const std::vector<double>& xs) {
+      double sum = 0;
+      for (double x : xs) {
+        if (x < 0) return -1.0;
+        sum += x;
+      }
+      return sum / double(xs.size());
+    };
+    std::cout << std::setw(7) << n << std::setprecision(2) << std::setw(11) << msgs << std::setprecision(0)
+              << std::setw(9) << bytes << std::setw(10) << double(mem) / double(n) / 1024 << std::setw(12)
+              << false_suspect << std::setw(12) << false_dead << " |" << std::setprecision(1);
+    auto cell = [&](double x, int width) {
+      if (x < 0) std::cout << std::setw(width) << "> " + std::to_string(int(horizon));
+      else std::cout << std::setw(width) << x;
+    };
+    cell(mean(first_suspect), 11);
+    cell(mean(first_dead), 9);
+    cell(mean(all_dead), 10);
+    std::cout << "\n";
+  }
+  return 0;
+}
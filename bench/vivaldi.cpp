@@ -0,0 +1,249 @@
+// ===========================================
+// VIVALDI.CPP (benchmark)
+// Coordonnées Vivaldi (vivaldi.hpp) dans le lanceur d'essaim : précision
+// des RTT prédits et gain sur les choix qui en dépendent.
+//
+// `nodes` nœuds font tourner SWIM (swim.hpp) ; chaque message porte les
+// coordonnées de son émetteur (16 octets) et chaque sondage direct
+// acquitté donne un échantillon de RTT (on_rtt) : aucune mesure dédiée.
+//   - erreur relative |prédit − réel| / réel sur des paires tirées au
+//     hasard (médiane, 90e centile), au fil du temps ;
+//   - recherche DHT (Kademlia itératif, k = 8, α = 3, identifiants
+//     aléatoires de 64 bits) : seaux remplis au hasard, ou par les k plus
+//     proches en RTT prédit parmi 64 candidats du seau (proximity
+//     neighbor selection) ; latence d'une recherche = somme des tours, un
+//     tour = le plus lent de ses α allers-retours ;
+//   - source de téléchargement parmi 20 pairs qui ont le chunk, et relais
+//     parmi 30 candidats (RTT a → r → b) : au hasard, par Vivaldi, et
+//     l'optimum (RTT réels, inconnus en pratique).
+//
+// Usage : vivaldi [nodes] [seconds]   (défauts 5000, 600)
+// ===========================================
+
+#include "swarm.hpp"
+#include "swim.hpp"
+#include "vivaldi.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <vector>
+
+using time_point = p2p::swim::time_point;
+
+static time_point at(double t) {
+  return time_point{} + std::chrono::duration_cast<p2p::swim::clock::duration>(std::chrono::duration<double>(t));
+}
+
+static double seconds(time_point t) { return std::chrono::duration<double>(t - time_point{}).count(); }
+
+static std::uint64_t mix(std::uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+static double percentile(std::vector<double> xs, double p) {
+  std::sort(xs.begin(), xs.end());
+  return xs[std::min(xs.size() - 1, std::size_t(p * double(xs.size())))];
+}
+
+int main(int argc, char** argv) {
+  std::size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 5000;
+  double duration = (argc > 2) ? std::strtod(argv[2], nullptr) : 600.0;
+  const std::size_t k = 8, alpha = 3, bucket_candidates = 64, trials = 2000;
+  p2p::swim_options sopts;
+
+  swarm::network net(n);
+  auto rtt = [&net](std::size_t a, std::size_t b) { return 2000 * net.latency(a, b); };   // ms
+
+  std::vector<std::unique_ptr<p2p::vivaldi>> coords(n);
+  std::vector<std::unique_ptr<p2p::swim>> nodes(n);
+  std::vector<p2p::node_id> everyone(n);
+  for (std::size_t i = 0; i < n; ++i) everyone[i] = i;
+  for (std::size_t i = 0; i < n; ++i) {
+    coords[i] = std::make_unique<p2p::vivaldi>(i);
+    nodes[i] = std::make_unique<p2p::swim>(
+        i,
+        [&, i](p2p::node_id to, p2p::swim_message m) {
+          std::size_t bytes = m.wire_size();
+          net.send(i, to, bytes, [&, i, to, m = std::move(m)] { nodes[to]->receive(i, m, at(net.now())); });
+        },
+        sopts, p2p::swim::change_fn{},
+        [&, i](p2p::node_id, p2p::swim::clock::duration sample, const std::optional<p2p::vivaldi_coord>& remote) {
+          if (!remote) return;
+          coords[i]->update(*remote, sample);
+          nodes[i]->set_coord(coords[i]->coord());
+        });
+    nodes[i]->set_coord(coords[i]->coord());
+    nodes[i]->add_members(everyone);
+  }
+  std::function<void(std::size_t)> tick = [&](std::size_t i) {
+    time_point next = nodes[i]->tick(at(net.now()));
+    net.at(seconds(next) + 1e-6, [&tick, i] { tick(i); });   // arrondi du temps virtuel : jamais avant l'échéance
+  };
+  double period = std::chrono::duration<double>(sopts.period).count();
+  for (std::size_t i = 0; i < n; ++i)
+    net.at(std::uniform_real_distribution<double>(0, period)(net.rng()), [&tick, i] { tick(i); });
+
+  auto coord_of = [&coords](p2p::node_id x) { return &coords[x]->coord(); };
+  auto pick = [&net](std::size_t bound) { return std::uniform_int_distribution<std::size_t>(0, bound - 1)(net.rng()); };
+  auto predicted = [&](std::size_t a, std::size_t b) { return p2p::vivaldi_distance(coords[a]->coord(), coords[b]->coord()); };
+
+  std::cout << n << " nodes, SWIM period " << period << " s, coordinates piggybacked on every message (+"
+            << p2p::vivaldi_coord::wire_size << " B), one RTT sample per acked direct probe\n\n"
+            << std::setw(8) << "time s" << std::setw(10) << "samples" << std::setw(13) << "median err"
+            << std::setw(10) << "p90 err" << "\n" << std::fixed;
+  for (double t : {10.0, 30.0, 60.0, 120.0, 180.0, 300.0, 600.0}) {
+    if (t > duration) break;
+    net.run_until(t);
+    std::vector<double> errors;
+    for (std::size_t s = 0; s < 20000; ++s) {
+      std::size_t a = pick(n), b = pick(n);
+      if (a == b) continue;
+      double real = rtt(a, b);
+      errors.push_back(std::abs(predicted(a, b) - real) / real);
+    }
+    double samples = 0;
+    for (const auto& c : coords) samples += double(c->samples());
+    std::cout << std::setprecision(0) << std::setw(8) << t << std::setprecision(1) << std::setw(10)
+              << samples / double(n) << std::setw(12) << percentile(errors, 0.5) * 100 << "%" << std::setw(9)
+              << percentile(errors, 0.9) * 100 << "%\n";
+  }
+
+  // --- recherche DHT : seaux remplis au hasard ou par proximité ---
+  std::vector<std::uint64_t> id(n);
+  for (std::size_t i = 0; i < n; ++i) id[i] = mix(i);
+  std::vector<std::vector<p2p::node_id>> plain(n), proximity(n);
+  {
+    std::vector<std::vector<p2p::node_id>> bucket(64);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (auto& b : bucket) b.clear();
+      for (std::size_t j = 0; j < n; ++j)
+        if (j != i) bucket[63 - std::countl_zero(id[i] ^ id[j])].push_back(j);
+      for (auto& b : bucket) {
+        if (b.empty()) continue;
+        std::shuffle(b.begin(), b.end(), net.rng());
+        plain[i].insert(plain[i].end(), b.begin(), b.begin() + std::ptrdiff_t(std::min(k, b.size())));
+        std::span<const p2p::node_id> cands(b.data(), std::min(bucket_candidates, b.size()));
+        auto best = p2p::nearest(coords[i]->coord(), cands, k, coord_of);
+        proximity[i].insert(proximity[i].end(), best.begin(), best.end());
+      }
+    }
+  }
+
+  struct lookup_result {
+    double latency = 0;
+    std::size_t rounds = 0;
+    bool found = false;
+  };
+  auto lookup = [&](std::size_t src, std::size_t target, const std::vector<std::vector<p2p::node_id>>& table) {
+    std::uint64_t key = id[target];
+    struct entry {
+      std::uint64_t distance;
+      p2p::node_id node;
+      bool queried;
+    };
+    std::vector<entry> shortlist;
+    auto merge = [&](const std::vector<p2p::node_id>& contacts) {
+      for (p2p::node_id c : contacts)
+        if (std::none_of(shortlist.begin(), shortlist.end(), [c](const entry& e) { return e.node == c; }))
+          shortlist.push_back({id[c] ^ key, c, c == src});
+      std::sort(shortlist.begin(), shortlist.end(), [](const entry& a, const entry& b) { return a.distance < b.distance; });
+      if (shortlist.size() > k) shortlist.resize(k);
+    };
+    auto closest = [&](std::size_t node) {
+      std::vector<p2p::node_id> out = table[node];
+      std::sort(out.begin(), out.end(), [&](p2p::node_id a, p2p::node_id b) { return (id[a] ^ key) < (id[b] ^ key); });
+      if (out.size() > k) out.resize(k);
+      return out;
+    };
+    lookup_result r;
+    merge(closest(src));
+    for (;;) {
+      std::vector<p2p::node_id> batch;
+      for (auto& e : shortlist)
+        if (!e.queried && batch.size() < alpha) {
+          e.queried = true;
+          batch.push_back(e.node);
+        }
+      if (batch.empty()) break;
+      double slowest = 0;
+      for (p2p::node_id q : batch) slowest = std::max(slowest, rtt(src, q));
+      r.latency += slowest;
+      ++r.rounds;
+      for (p2p::node_id q : batch) merge(closest(q));
+    }
+    r.found = !shortlist.empty() && shortlist.front().node == target;
+    return r;
+  };
+
+  double lat_plain = 0, lat_prox = 0, rounds_plain = 0, rounds_prox = 0;
+  std::size_t found_plain = 0, found_prox = 0;
+  std::vector<double> all_plain, all_prox;
+  for (std::size_t t = 0; t < trials; ++t) {
+    std::size_t src = pick(n), target = pick(n);
+    if (src == target) continue;
+    lookup_result a = lookup(src, target, plain), b = lookup(src, target, proximity);
+    lat_plain += a.latency;
+    lat_prox += b.latency;
+    all_plain.push_back(a.latency);
+    all_prox.push_back(b.latency);
+    rounds_plain += double(a.rounds);
+    rounds_prox += double(b.rounds);
+    found_plain += a.found;
+    found_prox += b.found;
+  }
+  double lookups = double(all_plain.size());
+  std::cout << "\nDHT lookup (k " << k << ", alpha " << alpha << ")" << std::setw(10) << "mean ms" << std::setw(9)
+            << "p90 ms" << std::setw(8) << "rounds" << std::setw(8) << "found\n"
+            << std::setw(28) << "random buckets" << std::setprecision(0) << std::setw(10) << lat_plain / lookups
+            << std::setw(9) << percentile(all_plain, 0.9) << std::setprecision(1) << std::setw(8)
+            << rounds_plain / lookups << std::setw(7) << double(found_plain) / lookups * 100 << "%\n"
+            << std::setw(28) << "proximity (Vivaldi)" << std::setprecision(0) << std::setw(10) << lat_prox / lookups
+            << std::setw(9) << percentile(all_prox, 0.9) << std::setprecision(1) << std::setw(8)
+            << rounds_prox / lookups << std::setw(7) << double(found_prox) / lookups * 100 << "%\n";
+
+  // --- source de téléchargement et relais ---
+  double src_random = 0, src_viv = 0, src_best = 0, relay_random = 0, relay_viv = 0, relay_best = 0, direct = 0;
+  for (std::size_t t = 0; t < trials; ++t) {
+    std::size_t me = pick(n);
+    std::vector<p2p::node_id> holders;
+    while (holders.size() < 20) {
+      std::size_t h = pick(n);
+      if (h != me && !p2p::overlay::contains(holders, h)) holders.push_back(h);
+    }
+    src_random += rtt(me, holders[0]);
+    src_viv += rtt(me, p2p::nearest(coords[me]->coord(), holders, 1, coord_of)[0]);
+    double best = 1e18;
+    for (auto h : holders) best = std::min(best, rtt(me, h));
+    src_best += best;
+
+    std::size_t a = pick(n), b = pick(n);
+    std::vector<p2p::node_id> relays;
+    while (relays.size() < 30) {
+      std::size_t r = pick(n);
+      if (r != a && r != b && !p2p::overlay::contains(relays, r)) relays.push_back(r);
+    }
+    auto via = [&](std::size_t r) { return rtt(a, r) + rtt(r, b); };
+    relay_random += via(relays[0]);
+    relay_viv += via(*p2p::best_relay(coords[a]->coord(), coords[b]->coord(), relays, coord_of));
+    best = 1e18;
+    for (auto r : relays) best = std::min(best, via(r));
+    relay_best += best;
+    direct += rtt(a, b);
+  }
+  double tr = double(trials);
+  std::cout << "\nmean RTT ms" << std::setw(17) << "random" << std::setw(10) << "Vivaldi" << std::setw(10) << "optimal"
+            << "\n" << std::setprecision(1) << std::setw(28) << "download source (of 20)" << std::setw(10)
+            << src_random / tr << std::setw(10) << src_viv / tr << std::setw(10) << src_best / tr << "\n"
+            << std::setw(28) << "relay a->r->b (of 30)" << std::setw(10) << relay_random / tr << std::setw(10)
+            << relay_viv / tr << std::setw(10) << relay_best / tr << "   (direct a->b " << direct / tr << ")\n";
+  return 0;
+}
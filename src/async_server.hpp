@@ -0,0 +1,534 @@
+// ===========================================
+// ASYNC_SERVER.HPP
+// Serveur TCP asynchrone (protocole "ligne" identique à server_sync)
+// Objectif : tenir un très grand nombre de connexions inactives
+//            avec un coût mémoire minimal par session.
+//
+// Principe :
+//   - une session inactive ne garde AUCUN tampon de réception ;
+//   - on attend que la socket soit lisible avec async_wait(wait_read) ;
+//   - seulement à ce moment on emprunte un tampon au pool, on fait
+//     un read_some non bloquant, on traite les lignes, puis on rend le tampon.
+//   - une ligne qui dépasse limits.memory_limit part dans un spill_file ;
+//     au-delà de limits.max_line, la connexion est fermée.
+//   - la réponse est un iobuf : le préfixe "# echo> " est statique et la
+//     ligne est une tranche du bloc lu (pas de copie quand la ligne tient
+//     dans une seule lecture). Le bloc revient au pool après l'écriture.
+//   - la taille de lecture s'adapte à chaque session (read_sizing) : elle
+//     grandit quand une lecture remplit le bloc et rétrécit quand les
+//     lectures reviennent presque vides, entre min_read et max_read.
+//   - plus de descripteurs (EMFILE, ENFILE) ou de mémoire noyau : l'accept
+//     est réarmé après une attente croissante (10 ms → 1 s), pas en boucle.
+//   - une ligne "HELLO codecs=zstd,lz4" négocie un codec et fait passer la
+//     session en mode trames (frame.hpp) ; chaque trame est renvoyée en écho,
+//     compressée au-dessus du seuil. La (dé)compression tourne sur le pool
+//     CPU si le serveur en a un, jamais sur le thread d'E/S.
+// ===========================================
+#pragma once
+
+#include "buffer_pool.hpp"
+#include "compression.hpp"
+#include "frame.hpp"
+#include "iobuf.hpp"
+#include "line_limits.hpp"
+
+#include <asio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace p2p {
+
+namespace net = asio;
+using tcp = net::ip::tcp;
+
+class async_server;
+
+// -------------------------------------------
+// Bornes de la taille de lecture adaptative (puissances de deux).
+// min_read == max_read donne une taille fixe.
+// -------------------------------------------
+struct read_sizing {
+  std::size_t min_read = 512;
+  std::size_t initial_read = 4096;
+  std::size_t max_read = 64 * 1024;
+};
+
+// Compteurs de lecture cumulés sur toutes les sessions
+struct read_stats {
+  std::uint64_t reads = 0;        // appels read_some réussis
+  std::uint64_t bytes = 0;        // octets reçus
+  std::uint64_t full_reads = 0;   // lectures qui ont rempli le bloc
+  std::size_t peak_bytes_in_use = 0;  // pic mémoire des blocs empruntés
+  std::uint64_t closed = 0;           // sessions terminées
+  std::uint64_t final_block_bytes = 0;  // somme des tailles de lecture à la fermeture
+
+  double bytes_per_read() const { return reads ? double(bytes) / double(reads) : 0.0; }
+  double block_per_session() const {
+    return closed ? double(final_block_bytes) / double(closed) : 0.0;
+  }
+};
+
+// -------------------------------------------
+// Une session = une connexion cliente.
+// État volontairement compact : la socket, un pointeur vers le serveur
+// une chaîne pour la ligne incomplète (vide, donc sans allocation,
+// tant que le pair n'envoie rien) et deux octets pour la taille de lecture.
+// -------------------------------------------
+class session : public std::enable_shared_from_this<session> {
+public:
+  session(tcp::socket sock, async_server& server);
+
+  void start();
+
+private:
+  // Réponse à envoyer : suite de morceaux, iobuf en mémoire ou ligne
+  // débordée sur disque (relue par morceaux au moment de l'écriture).
+  struct reply_part {
+    iobuf data;
+    std::unique_ptr<spill_file> file;
+  };
+  using reply = std::vector<reply_part>;
+
+  void wait_readable();
+  void on_readable(const net::error_code& ec);
+  bool consume(iobuf data, reply& out, std::vector<iobuf>& frames);
+  bool take_frames(iobuf& data, std::vector<iobuf>& frames);
+  void process_frames(std::shared_ptr<reply> out, std::vector<iobuf> frames);
+  void append_to_line(const char* data, std::size_t n);
+  void write_parts(std::shared_ptr<reply> parts, std::size_t index);
+  void adapt_read_size(std::size_t n, std::size_t block);
+  void close();
+
+  tcp::socket socket_;
+  async_server* server_;
+  std::string pending_;                 // fin de ligne pas encore reçue (souvent vide)
+  std::unique_ptr<spill_file> spill_;   // non nul seulement pour une ligne géante
+  std::uint8_t read_class_ = 0;         // classe de taille du prochain bloc lu
+  std::uint8_t small_reads_ = 0;        // lectures "presque vides" consécutives
+  codec codec_ = codec::none;           // codec négocié au handshake
+  bool framed_ = false;                 // après "HELLO" : protocole par trames
+};
+
+// -------------------------------------------
+// Le serveur : acceptor + pools de tampons (par classe de taille)
+// partagés par toutes les sessions.
+// -------------------------------------------
+class async_server {
+public:
+  async_server(net::io_context& io, const tcp::endpoint& ep,
+               read_sizing sizing = {}, line_limits limits = {})
+    : acceptor_(io, ep),
+      accept_retry_(io),
+      pool_(sizing.min_read, sizing.max_read),
+      initial_class_(static_cast<std::uint8_t>(pool_.class_for(sizing.initial_read))),
+      limits_(limits) {}
+
+  void start() { do_accept(); }
+
+  sized_buffer_pool& pool() { return pool_; }
+  std::uint8_t initial_class() const { return initial_class_; }
+  read_stats& stats() { return stats_; }
+  compressor& compression() { return *compressor_; }
+  net::thread_pool* cpu_pool() { return cpu_pool_; }
+
+  // Compression des trames : configuration + pool CPU (optionnel ; sans
+  // pool, la compression se fait sur le thread d'E/S). Le pool doit être
+  // arrêté (join) avant la destruction du serveur.
+  void set_compression(compression_config cfg, net::thread_pool* cpu) {
+    compressor_ = std::make_unique<compressor>(std::move(cfg));
+    cpu_pool_ = cpu;
+  }
+  const line_limits& limits() const { return limits_; }
+  std::size_t sessions() const { return sessions_; }
+  tcp::endpoint local_endpoint() const { return acceptor_.local_endpoint(); }
+
+  // Compteurs mis à jour par les sessions
+  void on_session_open() { ++sessions_; }
+  void on_session_close() { --sessions_; }
+
+  // Quand verbose est faux, on ne journalise pas chaque connexion
+  // (indispensable quand on ouvre des centaines de milliers de sessions).
+  bool verbose = true;
+
+private:
+  void do_accept() {
+    acceptor_.async_accept([this](net::error_code ec, tcp::socket sock) {
+      if (ec) {
+        if (ec == net::error::operation_aborted) return;
+        if (out_of_resources(ec)) {
+          // Rien ne se libère tant qu'on ne rend pas la main : on attend
+          // (un seul message par série d'échecs)
+          if (accept_backoff_.count() == 0) std::cerr << "[server] accept error: " << ec.message() << ", backing off\n";
+          accept_backoff_ = std::min(std::max(2 * accept_backoff_, std::chrono::milliseconds(10)),
+                                     std::chrono::milliseconds(1000));
+          accept_retry_.expires_after(accept_backoff_);
+          accept_retry_.async_wait([this](net::error_code wait_ec) {
+            if (!wait_ec) do_accept();
+          });
+          return;
+        }
+        std::cerr << "[server] accept error: " << ec.message() << "\n";
+      } else {
+        accept_backoff_ = {};
+        if (verbose) {
+          net::error_code ignore;
+          std::cout << "[server] client: " << sock.remote_endpoint(ignore) << "\n";
+        }
+        std::make_shared<session>(std::move(sock), *this)->start();
+      }
+      do_accept();
+    });
+  }
+
+  static bool out_of_resources(const net::error_code& ec) {
+    return ec == net::error::no_descriptors || ec == net::error::no_buffer_space || ec == net::error::no_memory ||
+           ec == std::errc::too_many_files_open_in_system;
+  }
+
+  tcp::acceptor acceptor_;
+  net::steady_timer accept_retry_;
+  std::chrono::milliseconds accept_backoff_{0};   // 0 : pas en échec
+  sized_buffer_pool pool_;
+  std::uint8_t initial_class_;
+  line_limits limits_;
+  read_stats stats_;
+  std::unique_ptr<compressor> compressor_ = std::make_unique<compressor>();
+  net::thread_pool* cpu_pool_ = nullptr;
+  std::size_t sessions_ = 0;
+};
+
+// ===========================================
+// Implémentation de session
+// ===========================================
+
+inline session::session(tcp::socket sock, async_server& server)
+  : socket_(std::move(sock)), server_(&server), read_class_(server.initial_class()) {}
+
+inline void session::start() {
+  server_->on_session_open();
+  net::error_code ignore;
+  // Non bloquant : un réveil "lisible" peut être faux (would_block),
+  // on ne doit jamais bloquer le thread de l'io_context.
+  socket_.non_blocking(true, ignore);
+  wait_readable();
+}
+
+inline void session::wait_readable() {
+  // Aucune mémoire de réception n'est réservée pendant l'attente.
+  socket_.async_wait(tcp::socket::wait_read,
+    [self = shared_from_this()](const net::error_code& ec) {
+      self->on_readable(ec);
+    });
+}
+
+inline void session::on_readable(const net::error_code& ec) {
+  if (ec) {
+    close();
+    return;
+  }
+
+  auto out = std::make_shared<reply>();  // réponses construites pendant la lecture
+  std::vector<iobuf> frames;             // trames complètes (mode trames)
+  {
+    // Tampon emprunté uniquement pour la durée de la lecture
+    auto lease = server_->pool().acquire(read_class_);
+    net::error_code rec;
+    std::size_t n = socket_.read_some(net::buffer(lease.data(), lease.size()), rec);
+
+    if (rec == net::error::would_block || rec == net::error::try_again) {
+      wait_readable();  // faux réveil : on se rendort
+      return;
+    }
+    if (rec) {          // eof ou erreur : fin de session
+      close();
+      return;
+    }
+    adapt_read_size(n, lease.size());
+
+    // Le bloc devient un slab partagé : les tranches de la réponse le
+    // référencent, il retournera au pool quand l'écriture sera terminée.
+    std::size_t capacity = lease.size();
+    iobuf data = iobuf::wrap(std::move(lease).share(), capacity, 0, n);
+
+    bool ok = false;
+    try {
+      ok = consume(std::move(data), *out, frames);
+      if (!ok) {
+        std::cerr << "[server] line or frame exceeds max_line (" << server_->limits().max_line
+                  << " bytes), closing\n";
+      }
+    } catch (const std::system_error& ex) {
+      // Disque plein, /tmp inaccessible... : on abandonne cette session seulement
+      std::cerr << "[server] spill error: " << ex.what() << "\n";
+    }
+    if (!ok) {
+      close();
+      return;
+    }
+  }
+
+  if (frames.empty()) write_parts(std::move(out), 0);
+  else process_frames(std::move(out), std::move(frames));
+}
+
+inline bool session::consume(iobuf data, reply& out, std::vector<iobuf>& frames) {
+  if (framed_) return take_frames(data, frames);
+
+  static constexpr char prefix[] = "# echo> ";
+  static constexpr char newline[] = "\n";
+
+  // Ajoute un iobuf à la réponse en le chaînant au morceau précédent
+  auto add = [&out](iobuf b) {
+    if (out.empty() || out.back().file) out.emplace_back();
+    out.back().data.append(std::move(b));
+  };
+
+  // Découpage en lignes : chaque '\n' termine un message.
+  // `data` tient dans un seul segment (un bloc lu) : recherche linéaire.
+  for (;;) {
+    const auto& seg = data.segments().front();
+    auto* nl = static_cast<const char*>(std::memchr(seg.data(), '\n', seg.length));
+    if (!nl) break;
+    iobuf line = data.split(static_cast<std::size_t>(nl - seg.data()));
+    data.trim_start(1);  // le '\n'
+
+    if (!spill_ && pending_.empty() && line.size() < 128 &&
+        line.to_string().starts_with("HELLO codecs=")) {
+      // Handshake : on choisit un codec parmi ceux du pair, puis le reste
+      // de la connexion (y compris la suite de ce bloc) est en trames.
+      codec_ = negotiate(line.to_string().substr(13));
+      std::string hello = "HELLO codec=" + std::string(codec_name(codec_)) +
+                          " threshold=" + std::to_string(server_->compression().config().threshold) + "\n";
+      add(iobuf::copy(hello.data(), hello.size()));
+      framed_ = true;
+      return data.empty() || take_frames(data, frames);
+    }
+
+    add(iobuf::wrap_static(prefix, sizeof prefix - 1));
+    if (spill_) {
+      // Ligne géante : la fin est ajoutée au fichier, la réponse relue depuis le disque
+      for (const auto& s : line.segments()) append_to_line(s.data(), s.length);
+      if (spill_->size() > server_->limits().max_line) return false;
+      spill_->rewind();
+      out.push_back(reply_part{{}, std::move(spill_)});
+    } else if (!pending_.empty()) {
+      // Début de ligne reçu lors d'une lecture précédente : une seule copie
+      add(iobuf::copy(pending_.data(), pending_.size()));
+      add(std::move(line));
+      pending_.clear();
+    } else {
+      add(std::move(line));  // cas courant : tranche du bloc lu, zéro copie
+    }
+    add(iobuf::wrap_static(newline, 1));
+    if (data.empty()) break;
+  }
+
+  // Ligne incomplète : copiée, pour que le bloc puisse retourner au pool
+  for (const auto& s : data.segments()) append_to_line(s.data(), s.length);
+  if (spill_ && spill_->size() > server_->limits().max_line) return false;
+  if (pending_.empty()) pending_.shrink_to_fit();  // redevenir compact
+  return true;
+}
+
+inline bool session::take_frames(iobuf& data, std::vector<iobuf>& frames) {
+  // Une trame partielle est gardée en mémoire et raw_length dimensionne le
+  // tampon de décompression : les deux sont bornés par max_frame
+  const std::size_t max_frame = server_->limits().max_frame;
+
+  // Découpe les trames complètes de [p, p + n) ; renvoie les octets consommés.
+  // `slice(off, len)` fabrique l'iobuf d'une trame (tranche ou copie).
+  auto extract = [&](const char* p, std::size_t n, auto&& slice) -> std::optional<std::size_t> {
+    std::size_t off = 0;
+    while (auto h = decode_frame_header(p + off, n - off)) {
+      if (h->length > max_frame || h->raw_length > max_frame) return std::nullopt;
+      std::size_t total = h->size() + h->length;
+      if (n - off < total) break;
+      frames.push_back(slice(off, total));
+      off += total;
+    }
+    return off;
+  };
+
+  if (pending_.empty()) {
+    // Cas courant : trames découpées directement dans le bloc lu (zéro copie)
+    const auto& seg = data.segments().front();
+    auto used = extract(seg.data(), seg.length, [&](std::size_t, std::size_t len) {
+      return data.split(len);
+    });
+    if (!used) return false;
+  } else {
+    // Début de trame reçu lors d'une lecture précédente : on complète la copie
+    for (const auto& s : data.segments()) pending_.append(s.data(), s.length);
+    data.clear();
+    auto used = extract(pending_.data(), pending_.size(), [&](std::size_t off, std::size_t len) {
+      return iobuf::copy(pending_.data() + off, len);
+    });
+    if (!used) return false;
+    pending_.erase(0, *used);
+  }
+
+  // Trame incomplète : copiée, pour que le bloc puisse retourner au pool
+  for (const auto& s : data.segments()) pending_.append(s.data(), s.length);
+  if (pending_.empty()) pending_.shrink_to_fit();
+  return pending_.size() <= max_frame + frame_header::max_size;
+}
+
+inline void session::process_frames(std::shared_ptr<reply> out, std::vector<iobuf> frames) {
+  // Travail CPU : décompression des trames reçues puis compression des
+  // échos. Les iobuf référencent des blocs du buffer_pool (mono-thread) :
+  // ils sont renvoyés au thread d'E/S pour y être libérés.
+  auto job = [self = shared_from_this(), out = std::move(out), frames = std::move(frames)]() mutable {
+    compressor& comp = self->server_->compression();
+    bool ok = true;
+    for (auto& f : frames) {
+      const char* p = f.segments().front().data();
+      frame_header h = *decode_frame_header(p, f.size());
+      const char* payload = p + h.size();
+
+      // Intégrité : CRC32C vérifié sur les segments de la trame, sans copie
+      if (!verify_frame_crc(h, f)) {
+        ok = false;
+        break;
+      }
+
+      std::string raw;
+      std::string_view body(payload, h.length);
+      if (h.compressed()) {
+        if (!comp.decompress(h.payload_codec(), payload, h.length, h.raw_length, raw)) {
+          ok = false;
+          break;
+        }
+        body = raw;
+      }
+
+      // Écho : même contenu, compressé selon le codec négocié si ça vaut le coup
+      std::string packed;
+      iobuf echo;
+      codec used = codec::none;
+      if (comp.compress(self->codec_, body.data(), body.size(), packed)) {
+        echo = iobuf::copy(packed.data(), packed.size(), frame_header::max_size);
+        used = self->codec_;
+      } else if (h.compressed()) {
+        echo = iobuf::copy(raw.data(), raw.size(), frame_header::max_size);
+      } else {
+        echo = f.clone();           // payload brut reçu : renvoyé sans copie
+        echo.trim_start(h.size());
+      }
+      // L'écho porte un CRC si la trame reçue en avait un
+      prepend_frame_header(echo, used, body.size(), h.has_crc());
+      out->emplace_back();
+      out->back().data = std::move(echo);
+    }
+
+    auto exec = self->socket_.get_executor();
+    net::post(exec, [self = std::move(self), out = std::move(out), frames = std::move(frames), ok]() mutable {
+      frames.clear();
+      if (!ok) {
+        std::cerr << "[server] corrupt frame (crc or compressed data), closing\n";
+        self->close();
+        return;
+      }
+      self->write_parts(std::move(out), 0);
+    });
+  };
+
+  if (auto* cpu = server_->cpu_pool()) net::post(*cpu, std::move(job));
+  else job();
+}
+
+inline void session::append_to_line(const char* data, std::size_t n) {
+  if (!spill_ && pending_.size() + n > server_->limits().memory_limit) {
+    // La ligne devient trop grosse pour la mémoire : bascule sur disque
+    spill_ = std::make_unique<spill_file>();
+    spill_->append(pending_.data(), pending_.size());
+    pending_.clear();
+    pending_.shrink_to_fit();
+  }
+  if (spill_) spill_->append(data, n);
+  else pending_.append(data, n);
+}
+
+inline void session::write_parts(std::shared_ptr<reply> parts, std::size_t index) {
+  if (index == parts->size()) {
+    wait_readable();  // tout est envoyé : retour à l'état inactif
+    return;
+  }
+
+  auto on_written = [self = shared_from_this()](const net::error_code& wec) {
+    if (wec) {
+      std::cerr << "[server] write error: " << wec.message() << "\n";
+      self->close();
+      return false;
+    }
+    return true;
+  };
+
+  reply_part& part = (*parts)[index];
+  if (!part.file) {
+    // Écriture scatter/gather : un const_buffer par segment de l'iobuf
+    net::async_write(socket_, part.data.buffers(),
+      [this, parts, index, on_written](const net::error_code& wec, std::size_t) {
+        if (on_written(wec)) write_parts(parts, index + 1);
+      });
+    return;
+  }
+
+  // Morceau sur disque : on relit un bloc du pool à la fois
+  auto lease = server_->pool().acquire(read_class_);
+  std::size_t n = part.file->read(lease.data(), lease.size());
+  if (n == 0) {
+    write_parts(std::move(parts), index + 1);
+    return;
+  }
+  auto chunk = net::buffer(lease.data(), n);
+  net::async_write(socket_, chunk,
+    [this, parts, index, on_written, lease = std::move(lease)](const net::error_code& wec, std::size_t) {
+      if (on_written(wec)) write_parts(parts, index);
+    });
+}
+
+inline void session::adapt_read_size(std::size_t n, std::size_t block) {
+  read_stats& st = server_->stats();
+  ++st.reads;
+  st.bytes += n;
+  std::size_t in_use = server_->pool().bytes_in_use();
+  if (in_use > st.peak_bytes_in_use) st.peak_bytes_in_use = in_use;
+
+  // Même règle que l'allocateur adaptatif de Netty :
+  //  - bloc rempli → le pair a sans doute encore des données : on double ;
+  //  - deux lectures de suite sous la moitié du bloc → on divise par deux.
+  if (n == block) {
+    ++st.full_reads;
+    small_reads_ = 0;
+    if (read_class_ + 1u < server_->pool().classes()) ++read_class_;
+  } else if (n <= block / 2 && read_class_ > 0) {
+    if (++small_reads_ >= 2) {
+      --read_class_;
+      small_reads_ = 0;
+    }
+  } else {
+    small_reads_ = 0;
+  }
+}
+
+inline void session::close() {
+  net::error_code ignore;
+  socket_.shutdown(tcp::socket::shutdown_both, ignore);
+  socket_.close(ignore);
+  server_->on_session_close();
+  server_->stats().closed += 1;
+  server_->stats().final_block_bytes += server_->pool().class_size(read_class_);
+  if (server_->verbose) std::cout << "[server] connection closed\n";
+}
+
+} // namespace p2p
@@ -0,0 +1,223 @@
+// ===========================================
+// AVAILABILITY.HPP
+// Disponibilité des pièces dans l'essaim et choix rarest-first
+// Objectif : avec des milliers de pairs et des centaines de milliers de
+//            pièces, ne jamais recalculer la rareté de zéro ni garder un
+//            bitfield plein par pair.
+//
+//   - une piece_bitmap (compressée) par pair ;
+//   - rareté tenue à jour incrémentalement : counts[i] = nombre de pairs
+//     qui ont la pièce i, ajusté à chaque have / lose / départ ;
+//   - histogramme des raretés des pièces voulues : on connaît à tout
+//     moment la rareté minimale atteignable, ce qui arrête la recherche
+//     dès qu'un candidat l'atteint ;
+//   - choix pour un pair : (pièces du pair) ∧ (pièces voulues) mot à mot
+//     (AND vectorisé), puis minimum des compteurs sous masque (SIMD).
+//     Des minorants de rareté par mot (64 pièces) et par bloc (4096
+//     pièces), abaissés à chaque décrément et recalculés exactement un
+//     bloc par choix, évitent d'examiner ce qui ne peut pas battre le
+//     meilleur candidat déjà trouvé.
+//
+// Mono-thread (le thread de l'io_context qui gère les pairs).
+// Identifiants de pairs denses (indice de session), fournis par l'appelant.
+// ===========================================
+#pragma once
+
+#include "piece_bitmap.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace p2p {
+
+class availability {
+public:
+  explicit availability(std::size_t pieces, const bitmap_detail::implementation_t& impl = bitmap_detail::implementation())
+    : pieces_(pieces),
+      nwords_((pieces + 63) / 64),
+      counts_(nwords_ * 64, 0),
+      word_floor_(nwords_, 0),
+      block_floor_((nwords_ + block_words - 1) / block_words, 0),
+      wanted_(nwords_, 0),
+      hist_(2, 0),
+      impl_(&impl) {}
+
+  std::size_t pieces() const { return pieces_; }
+  std::uint16_t count(std::uint32_t piece) const { return counts_.at(piece); }
+  const char* implementation() const { return impl_->name; }
+
+  // -------------------------------------------
+  // Pairs
+  // -------------------------------------------
+
+  // Message "bitfield" : remplace tout ce que l'on savait du pair
+  void bitfield(std::uint32_t peer, const std::uint64_t* words) {
+    remove_peer(peer);
+    piece_bitmap& b = peer_slot(peer);
+    b = piece_bitmap::from_words(words, pieces_);
+    b.for_each([&](std::uint32_t i) { bump(i, +1); });
+  }
+
+  // Message "have" : true si c'est nouveau
+  bool have(std::uint32_t peer, std::uint32_t piece) {
+    check(piece);
+    if (!peer_slot(peer).add(piece)) return false;
+    bump(piece, +1);
+    return true;
+  }
+
+  // Le pair n'a plus la pièce (cache évincé, message "lose") : true si elle y était
+  bool lose(std::uint32_t peer, std::uint32_t piece) {
+    check(piece);
+    if (peer >= peers_.size() || !peers_[peer].remove(piece)) return false;
+    bump(piece, -1);
+    return true;
+  }
+
+  void remove_peer(std::uint32_t peer) {
+    if (peer >= peers_.size()) return;
+    peers_[peer].for_each([&](std::uint32_t i) { bump(i, -1); });
+    peers_[peer].clear();
+  }
+
+  const piece_bitmap& peer(std::uint32_t peer) const { return peers_.at(peer); }
+  bool has(std::uint32_t peer, std::uint32_t piece) const { return peer < peers_.size() && peers_[peer].contains(piece); }
+
+  // -------------------------------------------
+  // Nos pièces voulues (manquantes et pas encore demandées)
+  // -------------------------------------------
+  void set_wanted(std::uint32_t piece, bool want) {
+    check(piece);
+    std::uint64_t bit = std::uint64_t(1) << (piece % 64);
+    std::uint64_t& w = wanted_[piece / 64];
+    if (bool(w & bit) == want) return;
+    w ^= bit;
+    hist_at(counts_[piece]) += want ? 1 : -1;
+    wanted_count_ += want ? 1 : -1;
+  }
+
+  bool wanted(std::uint32_t piece) const { return wanted_.at(piece / 64) >> (piece % 64) & 1; }
+  std::size_t wanted_count() const { return wanted_count_; }
+  const std::vector<std::uint64_t>& wanted_words() const { return wanted_; }
+
+  // Nombre de pièces voulues que le pair possède (0 = pas intéressé)
+  std::size_t interest(std::uint32_t peer) const {
+    if (peer >= peers_.size()) return 0;
+    return peers_[peer].and_cardinality(wanted_.data(), nwords_, *impl_);
+  }
+
+  // Pièce voulue la plus rare parmi celles du pair
+  std::optional<std::uint32_t> pick(std::uint32_t peer) {
+    if (peer >= peers_.size() || wanted_count_ == 0) return std::nullopt;
+    refresh_floors(1);
+    std::uint32_t floor = std::max<std::uint32_t>(min_wanted_count(), 1);   // le pair l'a : compteur ≥ 1
+    std::uint32_t best = bitmap_detail::no_candidate;
+    std::uint64_t best_piece = 0;
+    const piece_bitmap& has = peers_[peer];
+    std::uint64_t out[block_words];
+    std::uint32_t index[block_words];
+    // Bloc de départ tournant : répartit les égalités entre les demandeurs
+    std::size_t blocks = block_floor_.size();
+    std::size_t start = (rotation_++ * 7919) % blocks;
+    for (std::size_t k = 0; k < blocks && (best >> 8) > floor; ++k) {
+      std::size_t b = (start + k) % blocks;
+      if (block_floor_[b] >= (best >> 8)) continue;   // aucun compteur du bloc ne fait mieux
+      std::size_t first = b * block_words;
+      std::size_t found = has.common_words(wanted_.data(), first, std::min(block_words, nwords_ - first), out,
+                                           index, *impl_);
+      for (std::size_t f = 0; f < found; ++f) {
+        if (word_floor_[index[f]] >= (best >> 8)) continue;
+        std::uint32_t r = impl_->masked_min(counts_.data() + std::size_t(index[f]) * 64, out[f]);
+        if (r < best) {
+          best = r;
+          best_piece = std::uint64_t(index[f]) * 64 + (r & 0xff);
+        }
+      }
+    }
+    if (best == bitmap_detail::no_candidate) return std::nullopt;
+    return static_cast<std::uint32_t>(best_piece);
+  }
+
+  // Recalcule exactement les minorants de `blocks` blocs (tous par défaut)
+  void refresh_floors(std::size_t blocks = SIZE_MAX) {
+    blocks = std::min(blocks, block_floor_.size());
+    for (std::size_t k = 0; k < blocks; ++k) {
+      std::size_t b = refresh_next_;
+      if (++refresh_next_ == block_floor_.size()) refresh_next_ = 0;
+      std::uint16_t block_min = UINT16_MAX;
+      for (std::size_t w = b * block_words; w < std::min(nwords_, (b + 1) * block_words); ++w) {
+        const std::uint16_t* c = counts_.data() + w * 64;
+        std::uint16_t m = UINT16_MAX;
+        for (std::size_t i = 0; i < 64; ++i) m = std::min(m, c[i]);
+        word_floor_[w] = m;
+        block_min = std::min(block_min, m);
+      }
+      block_floor_[b] = block_min;
+    }
+  }
+
+  // Octets de l'état (bitmaps des pairs + compteurs + pièces voulues)
+  std::size_t memory_bytes() const {
+    std::size_t total = counts_.capacity() * 2 + (word_floor_.capacity() + block_floor_.capacity()) * 2 +
+                        wanted_.capacity() * 8 + hist_.capacity() * 4;
+    for (const auto& p : peers_) total += p.memory_bytes();
+    return total;
+  }
+
+private:
+  void check(std::uint32_t piece) const {
+    if (piece >= pieces_) throw std::out_of_range("availability: piece index");
+  }
+
+  piece_bitmap& peer_slot(std::uint32_t peer) {
+    if (peer >= peers_.size()) peers_.resize(peer + 1);
+    return peers_[peer];
+  }
+
+  std::uint32_t& hist_at(std::size_t count) {
+    if (count >= hist_.size()) hist_.resize(count + 1, 0);
+    return hist_[count];
+  }
+
+  void bump(std::uint32_t piece, int delta) {
+    std::uint16_t& c = counts_[piece];
+    if (delta > 0 && c == UINT16_MAX - 1) throw std::length_error("availability: too many peers for one piece");
+    if (wanted_[piece / 64] >> (piece % 64) & 1) {
+      --hist_at(c);
+      ++hist_at(c + delta);
+    }
+    c = static_cast<std::uint16_t>(c + delta);
+    if (delta < 0) {   // les minorants restent des minorants
+      word_floor_[piece / 64] = std::min(word_floor_[piece / 64], c);
+      block_floor_[piece / 64 / block_words] = std::min(block_floor_[piece / 64 / block_words], c);
+    }
+  }
+
+  // Plus petite rareté parmi les pièces voulues
+  std::uint32_t min_wanted_count() const {
+    for (std::size_t c = 0; c < hist_.size(); ++c)
+      if (hist_[c]) return static_cast<std::uint32_t>(c);
+    return 0;
+  }
+
+  std::size_t pieces_;
+  std::size_t nwords_;
+  static constexpr std::size_t block_words = 64;   // 4096 pièces par bloc de minorant
+
+  std::vector<std::uint16_t> counts_;   // rareté, complétée à un multiple de 64
+  std::vector<std::uint16_t> word_floor_;    // minorant de counts_ par mot de 64 pièces
+  std::vector<std::uint16_t> block_floor_;   // minorant par bloc de block_words mots
+  std::size_t refresh_next_ = 0;
+  std::vector<std::uint64_t> wanted_;
+  std::vector<std::uint32_t> hist_;     // hist_[c] = pièces voulues de rareté c
+  std::size_t wanted_count_ = 0;
+  std::vector<piece_bitmap> peers_;
+  std::size_t rotation_ = 0;            // bloc de départ : répartit les égalités
+  const bitmap_detail::implementation_t* impl_;
+};
+
+} // namespace p2p
@@ -0,0 +1,164 @@
+// ===========================================
+// BUFFER_POOL.HPP
+// Pool de tampons de réception réutilisables
+// Objectif : une session inactive ne possède AUCUN tampon.
+//            Elle en emprunte un au pool le temps d'un read_some,
+//            puis le rend immédiatement.
+// ===========================================
+#pragma once
+
+#include <bit>          // std::bit_ceil
+#include <cstddef>      // std::size_t
+#include <memory>       // std::unique_ptr, std::shared_ptr
+#include <new>          // std::align_val_t
+#include <vector>       // liste libre
+
+namespace p2p {
+
+// Libère un bloc selon son alignement (0 = new[] ordinaire)
+struct block_deleter {
+  std::size_t alignment = 0;
+  void operator()(char* p) const {
+    if (alignment)
+      ::operator delete[](p, std::align_val_t(alignment));
+    else
+      delete[] p;
+  }
+};
+
+// Pool mono-thread (utilisé depuis le thread qui fait tourner l'io_context).
+// Les blocs libérés sont conservés dans une liste libre bornée pour éviter
+// un aller-retour malloc/free à chaque lecture.
+//
+// L'état du pool est partagé (shared_ptr) : un bloc encore référencé par
+// un iobuf peut survivre au pool lui-même sans accès à de la mémoire libérée.
+class buffer_pool {
+public:
+  using block_ptr = std::unique_ptr<char[], block_deleter>;
+
+private:
+  struct state {
+    std::size_t block_size;
+    std::size_t max_free;
+    std::size_t alignment;
+    std::size_t in_use = 0;
+    std::vector<block_ptr> free;
+
+    block_ptr allocate() const {
+      if (!alignment) return block_ptr(new char[block_size]);
+      return block_ptr(static_cast<char*>(::operator new[](block_size, std::align_val_t(alignment))),
+                       block_deleter{alignment});
+    }
+
+    void give_back(block_ptr block) {
+      --in_use;
+      if (free.size() < max_free) free.push_back(std::move(block));
+      // sinon : le unique_ptr libère le bloc en sortant de la portée
+    }
+  };
+
+public:
+  // Tampon emprunté : rendu automatiquement au pool à la destruction (RAII).
+  class lease {
+  public:
+    lease() = default;
+    lease(std::shared_ptr<state> pool, block_ptr data)
+      : pool_(std::move(pool)), data_(std::move(data)) {}
+    lease(lease&&) noexcept = default;
+    lease& operator=(lease&& other) noexcept {
+      release();
+      pool_ = std::move(other.pool_);
+      data_ = std::move(other.data_);
+      return *this;
+    }
+    ~lease() { release(); }
+
+    char* data() const { return data_.get(); }
+    std::size_t size() const { return pool_ ? pool_->block_size : 0; }
+
+    // Transforme l'emprunt en bloc partagé (slab d'un iobuf) : le bloc
+    // retourne au pool quand la dernière référence disparaît.
+    std::shared_ptr<char[]> share() && {
+      return std::shared_ptr<char[]>(data_.release(), [pool = std::move(pool_)](char* p) {
+        pool->give_back(block_ptr(p, block_deleter{pool->alignment}));
+      });
+    }
+
+  private:
+    void release() {
+      if (pool_ && data_) pool_->give_back(std::move(data_));
+    }
+
+    std::shared_ptr<state> pool_;
+    block_ptr data_;
+  };
+
+  // block_size : taille d'un tampon ; max_free : nombre de blocs gardés en réserve ;
+  // alignment : adresse des blocs multiple de `alignment` (O_DIRECT), 0 = sans contrainte
+  explicit buffer_pool(std::size_t block_size, std::size_t max_free = 64, std::size_t alignment = 0)
+    : state_(std::make_shared<state>(state{block_size, max_free, alignment, 0, {}})) {}
+
+  buffer_pool(const buffer_pool&) = delete;
+  buffer_pool& operator=(const buffer_pool&) = delete;
+
+  lease acquire() {
+    ++state_->in_use;
+    auto& free = state_->free;
+    if (free.empty()) return lease(state_, state_->allocate());
+    auto block = std::move(free.back());
+    free.pop_back();
+    return lease(state_, std::move(block));
+  }
+
+  std::size_t block_size() const { return state_->block_size; }
+  std::size_t alignment() const { return state_->alignment; }
+  std::size_t in_use() const { return state_->in_use; }
+  std::size_t cached() const { return state_->free.size(); }
+
+private:
+  std::shared_ptr<state> state_;
+};
+
+// -------------------------------------------
+// Pools par classes de taille : puissances de deux de min_size à max_size.
+// Une session qui lit peu emprunte un petit bloc, une session qui reçoit
+// en masse un gros bloc ; chaque classe garde sa propre liste libre.
+// -------------------------------------------
+class sized_buffer_pool {
+public:
+  sized_buffer_pool(std::size_t min_size, std::size_t max_size, std::size_t max_free = 64) {
+    std::size_t size = std::bit_ceil(min_size ? min_size : 1);
+    max_size = std::bit_ceil(max_size < size ? size : max_size);
+    for (; size <= max_size; size *= 2)
+      classes_.push_back(std::make_unique<buffer_pool>(size, max_free));
+  }
+
+  std::size_t classes() const { return classes_.size(); }
+  std::size_t class_size(std::size_t cls) const { return classes_[cls]->block_size(); }
+
+  // Plus petite classe dont les blocs contiennent `size` octets
+  std::size_t class_for(std::size_t size) const {
+    std::size_t cls = 0;
+    while (cls + 1 < classes_.size() && class_size(cls) < size) ++cls;
+    return cls;
+  }
+
+  buffer_pool::lease acquire(std::size_t cls) { return classes_[cls]->acquire(); }
+
+  // Mémoire des blocs actuellement empruntés / gardés en réserve
+  std::size_t bytes_in_use() const {
+    std::size_t total = 0;
+    for (const auto& c : classes_) total += c->in_use() * c->block_size();
+    return total;
+  }
+  std::size_t bytes_cached() const {
+    std::size_t total = 0;
+    for (const auto& c : classes_) total += c->cached() * c->block_size();
+    return total;
+  }
+
+private:
+  std::vector<std::unique_ptr<buffer_pool>> classes_;
+};
+
+} // namespace p2p
@@ -0,0 +1,295 @@
+// ===========================================
+// CHUNK_CACHE.HPP
+// Cache mémoire des chunks populaires (W-TinyLFU)
+// Objectif : un chunk demandé par beaucoup de pairs à la fois est servi
+//            depuis la mémoire, sans relire le disque à chaque envoi,
+//            et un balayage séquentiel (réindexation, seed d'un gros
+//            fichier froid) ne chasse pas les chunks chauds.
+//
+// Par shard (une empreinte → un shard, chaque shard a son mutex) :
+//   - fenêtre LRU (1 % du budget) : les nouveaux venus y entrent ;
+//   - zone principale SLRU : "probation" (20 %) puis "protected" (80 %)
+//     après un deuxième accès ;
+//   - esquisse de fréquence (count-min, compteurs 4 bits saturés, divisés
+//     par deux périodiquement) : quand la fenêtre déborde, son plus ancien
+//     chunk n'entre en zone principale que s'il est plus fréquent que la
+//     victime de probation — sinon il est rejeté.
+//
+// Budget strict en octets (somme des tailles des chunks en cache).
+// Les entrées sont des iobuf : get() renvoie un clone qui partage le slab,
+// donc un envoi en cours garde ses données même si le cache les évince,
+// sans aucune copie.
+// ===========================================
+#pragma once
+
+#include "iobuf.hpp"
+#include "sha256.hpp"    // digest, digest_hash
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace p2p {
+
+struct cache_stats {
+  std::atomic<std::uint64_t> hits{0};
+  std::atomic<std::uint64_t> misses{0};
+  std::atomic<std::uint64_t> admitted{0};   // fenêtre → zone principale
+  std::atomic<std::uint64_t> rejected{0};   // candidat moins fréquent que la victime
+  std::atomic<std::uint64_t> evicted{0};
+
+  double hit_ratio() const {
+    auto h = hits.load(), m = misses.load();
+    return (h + m) ? double(h) / double(h + m) : 0.0;
+  }
+};
+
+namespace cache_detail {
+
+// Count-min à 4 lignes, compteurs 4 bits (deux par octet), remise à
+// l'échelle (÷2) après `sample` incréments : la popularité passée s'efface
+class frequency_sketch {
+public:
+  explicit frequency_sketch(std::size_t entries) {
+    std::size_t width = 64;
+    while (width < entries) width <<= 1;
+    mask_ = width - 1;
+    table_.assign(4 * width / 2, 0);
+    sample_ = 10 * width;
+  }
+
+  void increment(std::uint64_t h) {
+    bool grew = false;
+    for (int row = 0; row < 4; ++row) grew |= bump(row, index(h, row));
+    if (grew && ++additions_ >= sample_) halve();
+  }
+
+  unsigned estimate(std::uint64_t h) const {
+    unsigned best = 15;
+    for (int row = 0; row < 4; ++row) best = std::min(best, get(row, index(h, row)));
+    return best;
+  }
+
+private:
+  std::size_t index(std::uint64_t h, int row) const {
+    std::uint64_t x = (h + std::uint64_t(row) * 0x9E3779B97F4A7C15ull) * 0xBF58476D1CE4E5B9ull;
+    return static_cast<std::size_t>(x >> 32) & mask_;
+  }
+  unsigned get(int row, std::size_t i) const {
+    std::size_t cell = (std::size_t(row) * (mask_ + 1) + i);
+    return (table_[cell / 2] >> ((cell & 1) * 4)) & 15;
+  }
+  bool bump(int row, std::size_t i) {
+    std::size_t cell = (std::size_t(row) * (mask_ + 1) + i);
+    unsigned shift = (cell & 1) * 4;
+    if (((table_[cell / 2] >> shift) & 15) == 15) return false;
+    table_[cell / 2] = static_cast<std::uint8_t>(table_[cell / 2] + (1u << shift));
+    return true;
+  }
+  void halve() {
+    for (auto& b : table_) b = static_cast<std::uint8_t>((b >> 1) & 0x77);
+    additions_ /= 2;
+  }
+
+  std::vector<std::uint8_t> table_;
+  std::size_t mask_ = 0;
+  std::size_t sample_ = 0;
+  std::size_t additions_ = 0;
+};
+
+} // namespace cache_detail
+
+class chunk_cache {
+public:
+  // `budget` : octets de chunks au plus ; `typical_chunk` dimensionne l'esquisse.
+  // Moins de shards si le budget ne donne pas au moins un chunk typique à chacun.
+  explicit chunk_cache(std::size_t budget, std::size_t shards = 16, std::size_t typical_chunk = 16 * 1024) {
+    std::size_t fit = budget / std::max<std::size_t>(typical_chunk, 1);
+    shards = std::clamp<std::size_t>(fit, 1, std::max<std::size_t>(shards, 1));
+    for (std::size_t i = 0; i < shards; ++i)
+      shards_.push_back(std::make_unique<shard>(budget / shards, typical_chunk, stats_));
+  }
+
+  // Clone partagé du chunk (épingle les données sans copie), ou nullopt
+  std::optional<iobuf> get(const digest& id) {
+    shard& s = shard_for(id);
+    std::lock_guard lock(s.mutex);
+    s.sketch.increment(hash_of(id));
+    auto it = s.index.find(id);
+    if (it == s.index.end()) {
+      ++stats_.misses;
+      return std::nullopt;
+    }
+    ++stats_.hits;
+    s.touch(it->second);
+    return it->second->data.clone();
+  }
+
+  // Propose un chunk (typiquement après un défaut de cache et une lecture
+  // disque). Il entre dans la fenêtre ; l'admission se joue à sa sortie.
+  void put(const digest& id, iobuf data) {
+    shard& s = shard_for(id);
+    std::lock_guard lock(s.mutex);
+    if (data.size() > s.budget - s.window_budget) return;   // trop gros pour le shard : jamais en cache
+    auto it = s.index.find(id);
+    if (it != s.index.end()) {
+      s.touch(it->second);
+      return;
+    }
+    s.window.push_front(node{id, std::move(data), segment::window});
+    s.index.emplace(id, s.window.begin());
+    s.window_bytes += s.window.front().data.size();
+    s.rebalance();
+  }
+
+  bool contains(const digest& id) {
+    shard& s = shard_for(id);
+    std::lock_guard lock(s.mutex);
+    return s.index.count(id) != 0;
+  }
+
+  std::size_t bytes() const {
+    std::size_t total = 0;
+    for (const auto& s : shards_) {
+      std::lock_guard lock(s->mutex);
+      total += s->window_bytes + s->probation_bytes + s->protected_bytes;
+    }
+    return total;
+  }
+
+  std::size_t entries() const {
+    std::size_t total = 0;
+    for (const auto& s : shards_) {
+      std::lock_guard lock(s->mutex);
+      total += s->index.size();
+    }
+    return total;
+  }
+
+  const cache_stats& stats() const { return stats_; }
+
+private:
+  enum class segment : std::uint8_t { window, probation, protect };
+
+  struct node {
+    digest id;
+    iobuf data;
+    segment where;
+  };
+  using list = std::list<node>;
+
+  struct shard {
+    shard(std::size_t budget_, std::size_t typical_chunk, cache_stats& st)
+      : budget(budget_),
+        window_budget(std::min(budget_, std::max<std::size_t>(budget_ / 100, 1))),
+        protected_budget((budget_ - window_budget) * 4 / 5),
+        sketch(std::max<std::size_t>(budget_ / std::max<std::size_t>(typical_chunk, 1), 64)),
+        stats(st) {}
+
+    std::size_t main_bytes() const { return probation_bytes + protected_bytes; }
+
+    // Accès à une entrée présente
+    void touch(list::iterator n) {
+      switch (n->where) {
+        case segment::window:
+          window.splice(window.begin(), window, n);
+          break;
+        case segment::probation:   // deuxième accès : promotion
+          probation_bytes -= n->data.size();
+          protected_bytes += n->data.size();
+          n->where = segment::protect;
+          protected_.splice(protected_.begin(), probation, n);
+          while (protected_bytes > protected_budget) {   // rétrogradation, pas d'éviction
+            auto last = std::prev(protected_.end());
+            protected_bytes -= last->data.size();
+            probation_bytes += last->data.size();
+            last->where = segment::probation;
+            probation.splice(probation.begin(), protected_, last);
+          }
+          break;
+        case segment::protect:
+          protected_.splice(protected_.begin(), protected_, n);
+          break;
+      }
+    }
+
+    void rebalance() {
+      const std::size_t main_budget = budget - window_budget;
+      // La fenêtre déborde : ses plus anciens candidats passent l'admission
+      while (window_bytes > window_budget && !window.empty()) {
+        auto cand = std::prev(window.end());
+        std::size_t size = cand->data.size();
+        window_bytes -= size;
+        // Place à faire en zone principale : victimes depuis la queue de
+        // probation, puis de protected. Le candidat doit être plus fréquent
+        // que chacune ; sinon personne n'est évincé et il est rejeté.
+        bool admit = size <= main_budget;
+        victims.clear();
+        std::size_t freed = 0;
+        if (admit) {
+          unsigned cand_freq = sketch.estimate(hash_of(cand->id));
+          for (list* from : {&probation, &protected_}) {
+            for (auto it = from->end(); admit && main_bytes() - freed + size > main_budget && it != from->begin();) {
+              --it;
+              if (cand_freq <= sketch.estimate(hash_of(it->id))) admit = false;
+              victims.push_back({from, it});
+              freed += it->data.size();
+            }
+          }
+        }
+        if (admit) {
+          for (auto& [from, victim] : victims) drop(*from, victim);
+          cand->where = segment::probation;
+          probation_bytes += size;
+          probation.splice(probation.begin(), window, cand);
+          ++stats.admitted;
+        } else {
+          ++stats.rejected;
+          index.erase(cand->id);
+          window.erase(cand);
+          ++stats.evicted;
+        }
+      }
+    }
+
+    void drop(list& from, list::iterator n) {
+      (n->where == segment::protect ? protected_bytes : probation_bytes) -= n->data.size();
+      index.erase(n->id);
+      from.erase(n);   // libère la référence du cache ; les clones en vol restent valides
+      ++stats.evicted;
+    }
+
+    std::size_t budget;
+    std::size_t window_budget;
+    std::size_t protected_budget;
+    mutable std::mutex mutex;
+    list window, probation, protected_;
+    std::size_t window_bytes = 0, probation_bytes = 0, protected_bytes = 0;
+    std::unordered_map<digest, list::iterator, digest_hash> index;
+    std::vector<std::pair<list*, list::iterator>> victims;   // réutilisé par rebalance()
+    cache_detail::frequency_sketch sketch;
+    cache_stats& stats;
+  };
+
+  static std::uint64_t hash_of(const digest& id) {
+    std::uint64_t h;
+    std::memcpy(&h, id.data() + 8, sizeof h);   // indépendant des octets qui choisissent le shard
+    return h;
+  }
+
+  shard& shard_for(const digest& id) { return *shards_[id[0] % shards_.size()]; }
+
+  cache_stats stats_;
+  std::vector<std::unique_ptr<shard>> shards_;
+};
+
+} // namespace p2p
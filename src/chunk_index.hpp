@@ -0,0 +1,375 @@
+// ===========================================
+// CHUNK_INDEX.HPP
+// Index persistant empreinte → emplacement du chunk sur disque
+// Objectif : un nœud qui sert des téraoctets (des dizaines de millions de
+//            chunks) redémarre en quelques millisecondes, sans relire ses
+//            fichiers pour reconstruire la table.
+//
+//   <path>      : table de hachage à adressage ouvert, projetée en mémoire
+//                 (mmap MAP_SHARED) ; l'ouvrir ne lit rien, les pages sont
+//                 chargées à la demande par les recherches ;
+//   <path>.wal  : journal des modifications depuis le dernier checkpoint().
+//
+// Écriture : l'enregistrement est d'abord ajouté au journal (tampon en
+// mémoire), puis appliqué à la table. sync() rend durables toutes les
+// écritures précédentes d'un seul fdatasync (commit groupé). checkpoint()
+// force la table sur disque (msync) et vide le journal.
+//
+// Le journal étant tamponné, des pages de la table peuvent atteindre le
+// disque avant les enregistrements qui les décrivent : la première
+// modification après un checkpoint marque d'abord l'en-tête « sale » (msync),
+// checkpoint() efface la marque.
+// Après un arrêt brutal, l'ouverture rejoue le journal : chaque
+// enregistrement porte un CRC32C, la queue déchirée est ignorée, et rejouer
+// deux fois le même enregistrement ne change rien (écrasement idempotent) ;
+// si l'en-tête est sale, les compteurs sont ensuite recalculés par un
+// parcours de la table. Une fermeture normale fait un checkpoint :
+// l'ouverture suivante ne lit rien.
+//
+// Cases de 48 octets (empreinte complète + emplacement), sondage linéaire,
+// taux de remplissage ≤ 0,75 ; au-delà la table est reconstruite deux fois
+// plus grande dans un fichier voisin puis renommée atomiquement.
+// ===========================================
+#pragma once
+
+#include "crc32c.hpp"
+#include "sha256.hpp"    // digest
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace p2p {
+
+struct chunk_location {
+  std::uint64_t offset = 0;   // position dans le fichier de données
+  std::uint32_t file = 0;     // numéro du fichier de données
+  std::uint32_t length = 0;   // 0 = case vide (un chunk n'est jamais vide)
+};
+
+class chunk_index {
+public:
+  explicit chunk_index(std::string path, std::size_t expected = 1 << 16)
+    : path_(std::move(path)), wal_path_(path_ + ".wal") {
+    if (::access(path_.c_str(), F_OK) == 0)
+      map_table(path_);
+    else
+      create_table(path_, capacity_for(expected));
+    wal_fd_ = ::open(wal_path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (wal_fd_ < 0) fail("open " + wal_path_);
+    replay_wal();
+  }
+
+  chunk_index(const chunk_index&) = delete;
+  chunk_index& operator=(const chunk_index&) = delete;
+
+  // Fermeture propre = checkpoint : la prochaine ouverture ne rejoue rien
+  ~chunk_index() {
+    try {
+      checkpoint();
+    } catch (...) {
+    }
+    unmap();
+    if (wal_fd_ >= 0) ::close(wal_fd_);
+  }
+
+  std::size_t size() const { return header_->count; }
+  std::size_t capacity() const { return header_->capacity; }
+  std::size_t wal_records() const { return wal_records_; }
+
+  std::optional<chunk_location> find(const digest& id) const {
+    std::size_t i = home(id);
+    for (;;) {
+      const slot& s = slots_[i];
+      if (s.loc.length == 0) return std::nullopt;
+      if (s.loc.file != tombstone && s.id == id) return s.loc;
+      if (++i == header_->capacity) i = 0;
+    }
+  }
+
+  void insert(const digest& id, const chunk_location& loc) {
+    if (loc.length == 0 || loc.file == tombstone) throw std::invalid_argument("chunk_index: invalid location");
+    log(op_insert, id, loc);
+    mark_dirty();
+    apply(op_insert, id, loc);
+  }
+
+  bool erase(const digest& id) {
+    if (!find(id)) return false;
+    log(op_erase, id, {});
+    mark_dirty();
+    apply(op_erase, id, {});
+    return true;
+  }
+
+  // Toutes les écritures précédentes deviennent durables
+  void sync() {
+    flush_wal();
+    if (::fdatasync(wal_fd_) != 0) fail("fdatasync " + wal_path_);
+  }
+
+  // Table sur disque, journal vidé : la prochaine ouverture ne rejoue rien
+  void checkpoint() {
+    flush_wal();
+    if (::msync(map_, map_size_, MS_SYNC) != 0) fail("msync " + path_);
+    if (::ftruncate(wal_fd_, 0) != 0 || ::fsync(wal_fd_) != 0) fail("truncate " + wal_path_);
+    wal_records_ = 0;
+    if (dirty_) {
+      header_->dirty = 0;
+      if (::msync(map_, sizeof(header), MS_SYNC) != 0) fail("msync " + path_);
+      dirty_ = false;
+    }
+  }
+
+private:
+  static constexpr std::uint64_t magic = 0x3130584449503250ull;   // "P2PIDX01"
+  static constexpr std::uint32_t tombstone = UINT32_MAX;          // case effacée
+  static constexpr std::size_t wal_buffer = 64 * 1024;
+
+  enum : std::uint8_t { op_insert = 1, op_erase = 2 };
+
+  struct header {
+    std::uint64_t magic;
+    std::uint64_t capacity;
+    std::uint64_t count;        // entrées vivantes
+    std::uint64_t used;         // cases non vides (vivantes + tombes)
+    std::uint64_t dirty;        // modifiée depuis le dernier checkpoint
+    std::uint8_t pad[24];
+  };
+  static_assert(sizeof(header) == 64);
+
+  struct slot {
+    digest id;
+    chunk_location loc;
+  };
+  static_assert(sizeof(slot) == 48);
+
+  // | op u8 | id 32 | offset u64 | file u32 | length u32 | crc32c u32 |
+  static constexpr std::size_t record_size = 1 + 32 + 16 + 4;
+
+  [[noreturn]] static void fail(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+  }
+
+  static std::size_t capacity_for(std::size_t entries) {
+    return std::max<std::size_t>(64, entries + entries / 3 + 1);   // ≤ 0,75
+  }
+
+  // Les empreintes sont uniformes : 8 octets modulo la capacité (quelconque)
+  std::size_t home(const digest& id) const {
+    std::uint64_t h;
+    std::memcpy(&h, id.data(), sizeof h);
+    return static_cast<std::size_t>(h % header_->capacity);
+  }
+
+  // -------------------------------------------
+  // Table projetée
+  // -------------------------------------------
+  void create_table(const std::string& path, std::size_t capacity) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) fail("open " + path);
+    std::size_t bytes = sizeof(header) + capacity * sizeof(slot);
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {  // fichier creux : cases vides à zéro
+      ::close(fd);
+      fail("ftruncate " + path);
+    }
+    map_fd(fd, bytes, path);
+    header_->magic = magic;
+    header_->capacity = capacity;
+  }
+
+  void map_table(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) fail("open " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      fail("fstat " + path);
+    }
+    map_fd(fd, static_cast<std::size_t>(st.st_size), path);
+    if (map_size_ < sizeof(header) || header_->magic != magic ||
+        map_size_ != sizeof(header) + header_->capacity * sizeof(slot))
+      throw std::runtime_error("chunk_index: corrupt table " + path);
+    dirty_ = header_->dirty != 0;
+  }
+
+  void map_fd(int fd, std::size_t bytes, const std::string& path) {
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int err = errno;
+    ::close(fd);   // la projection garde le fichier ouvert
+    errno = err;
+    if (p == MAP_FAILED) fail("mmap " + path);
+    ::madvise(p, bytes, MADV_RANDOM);   // pas de lecture anticipée : accès dispersés
+    map_ = p;
+    map_size_ = bytes;
+    header_ = static_cast<header*>(p);
+    slots_ = reinterpret_cast<slot*>(static_cast<char*>(p) + sizeof(header));
+  }
+
+  void unmap() {
+    if (map_) ::munmap(map_, map_size_);
+    map_ = nullptr;
+  }
+
+  // Avant la première modification depuis le checkpoint : la marque est sur
+  // disque avant toute page de la table
+  void mark_dirty() {
+    if (dirty_) return;
+    header_->dirty = 1;
+    if (::msync(map_, sizeof(header), MS_SYNC) != 0) fail("msync " + path_);
+    dirty_ = true;
+  }
+
+  void apply(std::uint8_t op, const digest& id, const chunk_location& loc) {
+    if (op == op_insert && (header_->used + 1) * 4 > header_->capacity * 3) grow();
+    std::size_t i = home(id);
+    slot* reuse = nullptr;   // première tombe rencontrée : réutilisable
+    for (;; i = (i + 1 == header_->capacity) ? 0 : i + 1) {
+      slot& s = slots_[i];
+      if (s.loc.length == 0) break;
+      if (s.loc.file == tombstone) {
+        if (!reuse) reuse = &s;
+        continue;
+      }
+      if (s.id == id) {
+        if (op == op_insert) {
+          s.loc = loc;
+        } else {
+          s.loc.file = tombstone;
+          --header_->count;
+        }
+        return;
+      }
+    }
+    if (op != op_insert) return;
+    slot& dst = reuse ? *reuse : slots_[i];
+    if (!reuse) ++header_->used;
+    dst.id = id;
+    dst.loc = loc;
+    ++header_->count;
+  }
+
+  // Reconstruit la table (2× plus grande, sans les tombes) dans <path>.tmp,
+  // la force sur disque puis la renomme par-dessus l'ancienne.
+  // Le journal n'est pas vidé : le rejouer sur la nouvelle table est sans effet.
+  void grow() {
+    std::string tmp = path_ + ".tmp";
+    header* old_header = header_;
+    slot* old_slots = slots_;
+    void* old_map = map_;
+    std::size_t old_size = map_size_;
+    std::size_t old_capacity = header_->capacity;
+
+    create_table(tmp, capacity_for(header_->count * 2));
+    for (std::size_t i = 0; i < old_capacity; ++i) {
+      const slot& s = old_slots[i];
+      if (s.loc.length == 0 || s.loc.file == tombstone) continue;
+      std::size_t j = home(s.id);
+      while (slots_[j].loc.length != 0) j = (j + 1 == header_->capacity) ? 0 : j + 1;
+      slots_[j] = s;
+    }
+    header_->count = header_->used = old_header->count;
+    header_->dirty = old_header->dirty;   // les modifications continuent sur la nouvelle table
+    if (::msync(map_, map_size_, MS_SYNC) != 0) fail("msync " + tmp);
+    if (::rename(tmp.c_str(), path_.c_str()) != 0) fail("rename " + tmp);
+    ::munmap(old_map, old_size);
+  }
+
+  void recount() {
+    std::uint64_t count = 0, used = 0;
+    for (std::size_t i = 0; i < header_->capacity; ++i) {
+      used += slots_[i].loc.length != 0;
+      count += slots_[i].loc.length != 0 && slots_[i].loc.file != tombstone;
+    }
+    header_->count = count;
+    header_->used = used;
+  }
+
+  // -------------------------------------------
+  // Journal
+  // -------------------------------------------
+  void log(std::uint8_t op, const digest& id, const chunk_location& loc) {
+    unsigned char r[record_size];
+    r[0] = op;
+    std::memcpy(r + 1, id.data(), 32);
+    std::memcpy(r + 33, &loc.offset, 8);
+    std::memcpy(r + 41, &loc.file, 4);
+    std::memcpy(r + 45, &loc.length, 4);
+    std::uint32_t crc = crc32c::value(r, record_size - 4);
+    std::memcpy(r + 49, &crc, 4);
+    wal_.insert(wal_.end(), r, r + record_size);
+    ++wal_records_;
+    if (wal_.size() >= wal_buffer) flush_wal();
+  }
+
+  void flush_wal() {
+    std::size_t done = 0;
+    while (done < wal_.size()) {
+      ssize_t n = ::write(wal_fd_, wal_.data() + done, wal_.size() - done);
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) fail("write " + wal_path_);
+      done += static_cast<std::size_t>(n);
+    }
+    wal_.clear();
+  }
+
+  void replay_wal() {
+    struct stat st;
+    if (::fstat(wal_fd_, &st) != 0) fail("fstat " + wal_path_);
+    std::vector<unsigned char> bytes(static_cast<std::size_t>(st.st_size));
+    std::size_t got = 0;
+    while (got < bytes.size()) {
+      ssize_t n = ::pread(wal_fd_, bytes.data() + got, bytes.size() - got, static_cast<off_t>(got));
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) fail("read " + wal_path_);
+      got += static_cast<std::size_t>(n);
+    }
+    std::size_t valid = 0;
+    for (; valid + record_size <= bytes.size(); valid += record_size) {
+      const unsigned char* r = bytes.data() + valid;
+      std::uint32_t crc;
+      std::memcpy(&crc, r + 49, 4);
+      if (crc != crc32c::value(r, record_size - 4) || (r[0] != op_insert && r[0] != op_erase)) break;
+      digest id;
+      chunk_location loc;
+      std::memcpy(id.data(), r + 1, 32);
+      std::memcpy(&loc.offset, r + 33, 8);
+      std::memcpy(&loc.file, r + 41, 4);
+      std::memcpy(&loc.length, r + 45, 4);
+      mark_dirty();
+      apply(r[0], id, loc);
+      ++wal_records_;
+    }
+    // En-tête sale = arrêt brutal : des pages de la table ont pu être
+    // écrites ou non (journalisées ou pas), les compteurs ne sont plus fiables
+    if (dirty_) recount();
+    // Queue déchirée (écriture interrompue) : on la coupe
+    if (valid != bytes.size() && ::ftruncate(wal_fd_, static_cast<off_t>(valid)) != 0)
+      fail("truncate " + wal_path_);
+  }
+
+  std::string path_;
+  std::string wal_path_;
+  void* map_ = nullptr;
+  std::size_t map_size_ = 0;
+  header* header_ = nullptr;
+  slot* slots_ = nullptr;
+  int wal_fd_ = -1;
+  std::vector<unsigned char> wal_;
+  std::size_t wal_records_ = 0;
+  bool dirty_ = false;   // copie de header_->dirty
+};
+
+} // namespace p2p
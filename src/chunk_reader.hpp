@@ -0,0 +1,186 @@
+// ===========================================
+// CHUNK_READER.HPP
+// Lecture des chunks servis aux pairs : cache → index → disque → vérification
+// Objectif : quand un chunk populaire est annoncé, des centaines de
+//            sessions le demandent dans la même milliseconde ; il ne doit
+//            être lu et vérifié qu'une fois.
+//
+// async_get(id) :
+//   1) chunk_cache : succès → réponse immédiate (clone de l'iobuf) ;
+//   2) sinon, un chargement de ce chunk est-il déjà en vol ? La demande
+//      s'y rattache (single_flight) et recevra le même tampon ;
+//   3) sinon, elle le lance : chunk_index → disk_device::async_read →
+//      SHA-256 (sur le pool CPU s'il y en a un) → chunk_cache::put, puis
+//      tous les demandeurs rattachés reçoivent un clone de l'iobuf : un
+//      seul slab, compté par références, aucune copie.
+//
+// Erreurs : chunk absent de l'index → asio::error::not_found ; empreinte
+// fausse (disque corrompu) → errc::bad_message, le chunk n'entre pas en
+// cache et la demande suivante relit le disque.
+//
+// Mono-thread : le thread de l'io_context (comme disk_device) ; seul le
+// hachage part sur le pool CPU, le résultat revient sur l'io_context.
+// ===========================================
+#pragma once
+
+#include "chunk_cache.hpp"
+#include "chunk_index.hpp"
+#include "disk_io.hpp"
+#include "iobuf.hpp"
+#include "sha256.hpp"
+
+#include <asio/error.hpp>
+#include <asio/io_context.hpp>
+#include <asio/post.hpp>
+#include <asio/thread_pool.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace p2p {
+
+// -------------------------------------------
+// Un chargement en vol par clé, partagé par tous ses demandeurs
+// -------------------------------------------
+template <class Key, class Value, class Hash = std::hash<Key>>
+class single_flight {
+public:
+  using callback = std::function<void(std::error_code, Value)>;
+
+  // Rattache `cb` au chargement de `key`. true : aucun n'était en vol,
+  // l'appelant doit le lancer puis appeler complete().
+  bool join(const Key& key, callback cb) {
+    auto [it, leader] = flights_.try_emplace(key);
+    it->second.push_back(std::move(cb));
+    if (!leader) ++coalesced_;
+    return leader;
+  }
+
+  // Chaque demandeur reçoit sa copie de `value` (un iobuf : un clone).
+  // Un demandeur qui redemande la clé depuis son callback lance un
+  // nouveau chargement.
+  void complete(const Key& key, std::error_code ec, const Value& value) {
+    auto it = flights_.find(key);
+    if (it == flights_.end()) return;
+    std::vector<callback> waiters = std::move(it->second);
+    flights_.erase(it);
+    for (auto& cb : waiters) cb(ec, value);
+  }
+
+  std::size_t pending() const { return flights_.size(); }
+  std::uint64_t coalesced() const { return coalesced_; }
+
+private:
+  std::unordered_map<Key, std::vector<callback>, Hash> flights_;
+  std::uint64_t coalesced_ = 0;   // demandes rattachées à un chargement existant
+};
+
+struct chunk_reader_options {
+  bool coalesce = true;   // false : chaque défaut de cache relit le disque (comparaison)
+  bool verify = true;     // SHA-256 de chaque chunk lu
+};
+
+struct chunk_reader_stats {
+  std::uint64_t requests = 0;
+  std::uint64_t cache_hits = 0;
+  std::uint64_t coalesced = 0;     // rattachées à un chargement en vol
+  std::uint64_t disk_reads = 0;
+  std::uint64_t verified = 0;      // hachages effectués
+  std::uint64_t failed = 0;        // absents, erreurs disque, empreintes fausses
+};
+
+class chunk_reader {
+public:
+  using handler = std::function<void(std::error_code, iobuf)>;
+
+  // files[i] : fichier de données numéro i de chunk_location::file.
+  // cache et cpu facultatifs (sans pool, le hachage se fait sur l'io_context).
+  chunk_reader(asio::io_context& io, const chunk_index& index, disk_device& disk,
+               std::vector<std::shared_ptr<disk_file>> files, chunk_cache* cache = nullptr,
+               asio::thread_pool* cpu = nullptr, chunk_reader_options opts = {})
+    : io_(io), index_(index), disk_(disk), files_(std::move(files)), cache_(cache), cpu_(cpu), opts_(opts) {}
+
+  chunk_reader(const chunk_reader&) = delete;
+  chunk_reader& operator=(const chunk_reader&) = delete;
+
+  void async_get(const digest& id, handler h) {
+    ++stats_.requests;
+    if (cache_) {
+      if (auto hit = cache_->get(id)) {
+        ++stats_.cache_hits;
+        return asio::post(io_, [h = std::move(h), data = std::move(*hit)]() mutable { h({}, std::move(data)); });
+      }
+    }
+    if (!opts_.coalesce) return load(id, std::move(h));
+    if (!flights_.join(id, std::move(h))) {
+      ++stats_.coalesced;
+      return;
+    }
+    load(id, [this, id](std::error_code ec, iobuf data) { flights_.complete(id, ec, data); });
+  }
+
+  const chunk_reader_stats& stats() const { return stats_; }
+  std::size_t in_flight() const { return flights_.pending(); }
+
+private:
+  void load(const digest& id, handler done) {
+    auto loc = index_.find(id);
+    if (!loc || loc->file >= files_.size()) {
+      ++stats_.failed;
+      return asio::post(io_, [done = std::move(done)] { done(asio::error::not_found, iobuf()); });
+    }
+    ++stats_.disk_reads;
+    std::size_t length = loc->length;
+    disk_.async_read(files_[loc->file], loc->offset, length,
+                     [this, id, length, done = std::move(done)](std::error_code ec, iobuf data) mutable {
+                       if (!ec && data.size() != length) ec = asio::error::eof;
+                       if (ec || !opts_.verify) return finish(id, ec, std::move(data), std::move(done));
+                       verify(id, std::move(data), std::move(done));
+                     });
+  }
+
+  void verify(const digest& id, iobuf data, handler done) {
+    ++stats_.verified;
+    auto check = [this, id, data = std::move(data), done = std::move(done)]() mutable {
+      sha256 h;
+      h.update_buffers(data.buffers());
+      std::error_code ec;
+      if (h.finish() != id) ec = std::make_error_code(std::errc::bad_message);
+      // Le tampon appartient au buffer_pool du disque (mono-thread) : il
+      // revient sur l'io_context avant toute libération
+      asio::post(io_, [this, id, ec, data = std::move(data), done = std::move(done)]() mutable {
+        finish(id, ec, std::move(data), std::move(done));
+      });
+    };
+    if (cpu_) asio::post(*cpu_, std::move(check));
+    else check();
+  }
+
+  void finish(const digest& id, std::error_code ec, iobuf data, handler done) {
+    if (ec) {
+      ++stats_.failed;
+      data = iobuf();
+    } else if (cache_) {
+      cache_->put(id, data.clone());
+    }
+    done(ec, std::move(data));
+  }
+
+  asio::io_context& io_;
+  const chunk_index& index_;
+  disk_device& disk_;
+  std::vector<std::shared_ptr<disk_file>> files_;
+  chunk_cache* cache_;
+  asio::thread_pool* cpu_;
+  chunk_reader_options opts_;
+  single_flight<digest, iobuf, digest_hash> flights_;
+  chunk_reader_stats stats_;
+};
+
+} // namespace p2p
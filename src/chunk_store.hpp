@@ -0,0 +1,202 @@
+// ===========================================
+// CHUNK_STORE.HPP
+// Stockage des chunks adressés par leur contenu (SHA-256)
+// Objectif : un chunk identique dans deux fichiers, ou dans deux versions
+//            du même fichier, n'est stocké (et donc transféré) qu'une fois.
+//
+//   - put(data)       : hache et stocke ; si l'empreinte existe déjà,
+//                       seul le compteur de références augmente ;
+//   - add_file(...)   : découpe un fichier (FastCDC), hache les chunks en
+//                       lot (hash_many) et renvoie sa "recette" : la liste
+//                       ordonnée des chunks ;
+//   - assemble(recipe): reconstruit le fichier en chaînant les chunks
+//                       (iobuf : aucune copie) ;
+//   - release(recipe) : oublie un fichier ; un chunk sans référence est libéré ;
+//   - shards / put_decoded : envoi d'un chunk en k + m shards Reed-Solomon
+//                       (erasure.hpp) et stockage d'un chunk rebâti à partir
+//                       de k shards quelconques, vérifié par son empreinte.
+//
+// Thread-safe (mutex) : les chunks peuvent être ajoutés depuis le pool CPU.
+// ===========================================
+#pragma once
+
+#include "erasure.hpp"
+#include "fastcdc.hpp"
+#include "iobuf.hpp"
+#include "sha256.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace p2p {
+
+struct chunk_ref {
+  digest id;
+  std::uint32_t size = 0;
+};
+
+using file_recipe = std::vector<chunk_ref>;
+
+struct chunk_store_stats {
+  std::uint64_t logical_bytes = 0;  // octets ajoutés (avant déduplication)
+  std::uint64_t stored_bytes = 0;   // octets réellement conservés
+  std::uint64_t chunks = 0;         // chunks distincts stockés
+  std::uint64_t duplicate_chunks = 0;
+
+  double dedup_ratio() const { return stored_bytes ? double(logical_bytes) / double(stored_bytes) : 1.0; }
+  std::uint64_t bytes_saved() const { return logical_bytes - stored_bytes; }
+};
+
+class chunk_store {
+public:
+  explicit chunk_store(cdc_params params = {}) : chunker_(params) {}
+
+  const fastcdc& chunker() const { return chunker_; }
+
+  // Stocke un chunk dont l'empreinte est déjà connue (ex. reçu d'un pair et
+  // vérifié). Renvoie true s'il était nouveau.
+  bool put(const digest& id, const void* data, std::size_t n) {
+    std::lock_guard lock(mutex_);
+    stats_.logical_bytes += n;
+    auto [it, inserted] = chunks_.try_emplace(id);
+    ++it->second.refs;
+    if (!inserted) {
+      ++stats_.duplicate_chunks;
+      return false;
+    }
+    it->second.data = iobuf::copy(data, n);
+    stats_.stored_bytes += n;
+    ++stats_.chunks;
+    return true;
+  }
+
+  // Même chose pour un chunk déjà en iobuf (gardé tel quel, sans copie)
+  bool put(const digest& id, iobuf chunk) {
+    std::lock_guard lock(mutex_);
+    stats_.logical_bytes += chunk.size();
+    auto [it, inserted] = chunks_.try_emplace(id);
+    ++it->second.refs;
+    if (!inserted) {
+      ++stats_.duplicate_chunks;
+      return false;
+    }
+    stats_.stored_bytes += chunk.size();
+    ++stats_.chunks;
+    it->second.data = std::move(chunk);
+    return true;
+  }
+
+  digest put(const void* data, std::size_t n) {
+    digest id = sha256_of(data, n);
+    put(id, data, n);
+    return id;
+  }
+
+  bool contains(const digest& id) const {
+    std::lock_guard lock(mutex_);
+    return chunks_.count(id) != 0;
+  }
+
+  // Vue partagée sur le chunk (prête pour async_write), ou nullopt
+  std::optional<iobuf> get(const digest& id) const {
+    std::lock_guard lock(mutex_);
+    auto it = chunks_.find(id);
+    if (it == chunks_.end()) return std::nullopt;
+    return it->second.data.clone();
+  }
+
+  // Shards d'un chunk stocké, à répartir entre plusieurs pairs
+  std::optional<std::vector<iobuf>> shards(const digest& id, const erasure::codec& c) const {
+    auto chunk = get(id);
+    if (!chunk) return std::nullopt;
+    return erasure::encode_chunk(c, *chunk);
+  }
+
+  // Décode les shards rassemblés ; le chunk n'est stocké que si son
+  // empreinte est bien `id` (shard corrompu ou menteur → false)
+  bool put_decoded(const digest& id, const erasure::shard_collector& collected) {
+    auto chunk = collected.decode();
+    if (!chunk) return false;
+    sha256 h;
+    h.update_buffers(chunk->buffers());
+    if (h.finish() != id) return false;
+    put(id, std::move(*chunk));
+    return true;
+  }
+
+  file_recipe add_file(const std::uint8_t* data, std::size_t size) {
+    std::vector<std::span<const std::uint8_t>> pieces;
+    chunker_.split(data, size, [&](std::size_t off, std::size_t len) {
+      pieces.emplace_back(data + off, len);
+    });
+    std::vector<digest> ids(pieces.size());
+    hash_many(pieces, ids.data());
+
+    file_recipe recipe(pieces.size());
+    for (std::size_t i = 0; i < pieces.size(); ++i) {
+      put(ids[i], pieces[i].data(), pieces[i].size());
+      recipe[i] = {ids[i], static_cast<std::uint32_t>(pieces[i].size())};
+    }
+    return recipe;
+  }
+
+  // Chunks d'une recette absents du store : ce qu'il reste à télécharger
+  std::vector<chunk_ref> missing(const file_recipe& recipe) const {
+    std::vector<chunk_ref> out;
+    std::lock_guard lock(mutex_);
+    for (const auto& c : recipe)
+      if (!chunks_.count(c.id)) out.push_back(c);
+    return out;
+  }
+
+  std::optional<iobuf> assemble(const file_recipe& recipe) const {
+    iobuf out;
+    std::lock_guard lock(mutex_);
+    for (const auto& c : recipe) {
+      auto it = chunks_.find(c.id);
+      if (it == chunks_.end()) return std::nullopt;
+      out.append(it->second.data.clone());
+    }
+    return out;
+  }
+
+  void release(const file_recipe& recipe) {
+    std::lock_guard lock(mutex_);
+    for (const auto& c : recipe) {
+      auto it = chunks_.find(c.id);
+      if (it == chunks_.end()) continue;
+      stats_.logical_bytes -= c.size;
+      if (--it->second.refs == 0) {
+        stats_.stored_bytes -= it->second.data.size();
+        --stats_.chunks;
+        chunks_.erase(it);
+      } else {
+        --stats_.duplicate_chunks;
+      }
+    }
+  }
+
+  chunk_store_stats stats() const {
+    std::lock_guard lock(mutex_);
+    return stats_;
+  }
+
+private:
+  struct entry {
+    iobuf data;
+    std::uint32_t refs = 0;
+  };
+
+  fastcdc chunker_;
+  mutable std::mutex mutex_;
+  std::unordered_map<digest, entry, digest_hash> chunks_;
+  chunk_store_stats stats_;
+};
+
+} // namespace p2p
@@ -0,0 +1,245 @@
+// ===========================================
+// COMPRESSION.HPP
+// Compression optionnelle des trames (LZ4 / Zstd)
+// Objectif : économiser la bande passante sur les liens lents pour les
+//            messages très compressibles (manifestes, listes de pairs,
+//            lots de gossip).
+//
+//   - le codec est négocié au handshake (voir negotiate()) ;
+//   - sous `threshold` octets, une trame part brute (compresser ne paie pas) ;
+//   - Zstd peut utiliser un dictionnaire pré-entraîné pour les petits
+//     messages de contrôle :  zstd --train echantillons/* -o control.dict
+//   - les compteurs (ratio, temps CPU) sont dans compression_stats.
+//
+// Les codecs sont optionnels à la compilation : P2P_HAVE_LZ4 / P2P_HAVE_ZSTD
+// sont définis par CMake quand les bibliothèques sont trouvées. Sans eux,
+// seul le codec "none" est proposé et tout part brut.
+// ===========================================
+#pragma once
+
+#include <atomic>       // compteurs partagés avec le pool CPU
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef P2P_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef P2P_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace p2p {
+
+enum class codec : std::uint8_t { none = 0, lz4 = 1, zstd = 2 };
+
+inline const char* codec_name(codec c) {
+  switch (c) {
+    case codec::lz4: return "lz4";
+    case codec::zstd: return "zstd";
+    default: return "none";
+  }
+}
+
+inline std::optional<codec> codec_from_name(std::string_view name) {
+  if (name == "none") return codec::none;
+  if (name == "lz4") return codec::lz4;
+  if (name == "zstd") return codec::zstd;
+  return std::nullopt;
+}
+
+// Codecs compilés, par ordre de préférence (le meilleur ratio d'abord)
+inline std::vector<codec> available_codecs() {
+  std::vector<codec> out;
+#ifdef P2P_HAVE_ZSTD
+  out.push_back(codec::zstd);
+#endif
+#ifdef P2P_HAVE_LZ4
+  out.push_back(codec::lz4);
+#endif
+  out.push_back(codec::none);
+  return out;
+}
+
+// Liste annoncée au handshake : "zstd,lz4,none"
+inline std::string codec_list() {
+  std::string out;
+  for (codec c : available_codecs()) {
+    if (!out.empty()) out += ',';
+    out += codec_name(c);
+  }
+  return out;
+}
+
+// Choisit notre codec préféré parmi ceux que le pair annonce ("zstd,lz4")
+inline codec negotiate(std::string_view peer_list) {
+  for (codec c : available_codecs()) {
+    std::string_view rest = peer_list;
+    while (!rest.empty()) {
+      std::size_t comma = rest.find(',');
+      if (rest.substr(0, comma) == codec_name(c)) return c;
+      if (comma == std::string_view::npos) break;
+      rest.remove_prefix(comma + 1);
+    }
+  }
+  return codec::none;
+}
+
+// -------------------------------------------
+// Métriques (mises à jour depuis les threads du pool CPU)
+// -------------------------------------------
+struct compression_stats {
+  std::atomic<std::uint64_t> frames_compressed{0};  // trames envoyées compressées
+  std::atomic<std::uint64_t> frames_raw{0};         // sous le seuil ou incompressibles
+  std::atomic<std::uint64_t> bytes_in{0};           // octets avant compression
+  std::atomic<std::uint64_t> bytes_out{0};          // octets compressés produits
+  std::atomic<std::uint64_t> compress_ns{0};        // temps CPU de compression
+  std::atomic<std::uint64_t> decompress_ns{0};      // temps CPU de décompression
+
+  // Ratio sur les trames effectivement compressées (>1 = gain)
+  double ratio() const {
+    auto out = bytes_out.load();
+    return out ? double(bytes_in.load()) / double(out) : 1.0;
+  }
+};
+
+struct compression_config {
+  std::size_t threshold = 256;       // taille minimale pour tenter la compression
+                                     // (avec un dictionnaire, ~64 octets devient rentable)
+  int zstd_level = 3;
+  std::string zstd_dictionary;       // chemin d'un dictionnaire entraîné (optionnel)
+};
+
+// -------------------------------------------
+// Compresseur partagé par toutes les sessions.
+// Sans état mutable hors compteurs : les contextes Zstd sont par thread.
+// -------------------------------------------
+class compressor {
+public:
+  explicit compressor(compression_config cfg = {}) : cfg_(std::move(cfg)) {
+#ifdef P2P_HAVE_ZSTD
+    if (!cfg_.zstd_dictionary.empty()) {
+      std::ifstream in(cfg_.zstd_dictionary, std::ios::binary);
+      if (!in) throw std::runtime_error("cannot open zstd dictionary " + cfg_.zstd_dictionary);
+      std::string dict((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+      cdict_.reset(ZSTD_createCDict(dict.data(), dict.size(), cfg_.zstd_level));
+      ddict_.reset(ZSTD_createDDict(dict.data(), dict.size()));
+      if (!cdict_ || !ddict_) throw std::runtime_error("invalid zstd dictionary");
+    }
+#endif
+  }
+
+  const compression_config& config() const { return cfg_; }
+  compression_stats& stats() { return stats_; }
+
+  // Compresse `data` avec `c` dans `out`. Renvoie false si la trame doit
+  // partir brute (sous le seuil, codec none, ou résultat pas plus petit).
+  bool compress(codec c, const char* data, std::size_t n, std::string& out) {
+    if (c == codec::none || n < cfg_.threshold) {
+      ++stats_.frames_raw;
+      return false;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    std::size_t written = 0;
+    switch (c) {
+#ifdef P2P_HAVE_LZ4
+      case codec::lz4: {
+        out.resize(static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(n))));
+        int r = LZ4_compress_default(data, out.data(), static_cast<int>(n), static_cast<int>(out.size()));
+        written = r > 0 ? static_cast<std::size_t>(r) : 0;
+        break;
+      }
+#endif
+#ifdef P2P_HAVE_ZSTD
+      case codec::zstd: {
+        out.resize(ZSTD_compressBound(n));
+        ZSTD_CCtx* cctx = zstd_cctx();
+        std::size_t r = cdict_
+          ? ZSTD_compress_usingCDict(cctx, out.data(), out.size(), data, n, cdict_.get())
+          : ZSTD_compressCCtx(cctx, out.data(), out.size(), data, n, cfg_.zstd_level);
+        written = ZSTD_isError(r) ? 0 : r;
+        break;
+      }
+#endif
+      default:
+        (void)data;
+        break;
+    }
+    stats_.compress_ns += elapsed_ns(t0);
+    if (written == 0 || written >= n) {
+      ++stats_.frames_raw;
+      return false;
+    }
+    out.resize(written);
+    ++stats_.frames_compressed;
+    stats_.bytes_in += n;
+    stats_.bytes_out += written;
+    return true;
+  }
+
+  // Décompresse une trame dont la taille d'origine est `raw_size`.
+  // Renvoie false si les données sont corrompues ou le codec inconnu.
+  bool decompress(codec c, const char* data, std::size_t n, std::size_t raw_size, std::string& out) {
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = false;
+    out.resize(raw_size);
+    switch (c) {
+#ifdef P2P_HAVE_LZ4
+      case codec::lz4:
+        ok = LZ4_decompress_safe(data, out.data(), static_cast<int>(n), static_cast<int>(raw_size))
+             == static_cast<int>(raw_size);
+        break;
+#endif
+#ifdef P2P_HAVE_ZSTD
+      case codec::zstd: {
+        ZSTD_DCtx* dctx = zstd_dctx();
+        std::size_t r = ddict_
+          ? ZSTD_decompress_usingDDict(dctx, out.data(), raw_size, data, n, ddict_.get())
+          : ZSTD_decompressDCtx(dctx, out.data(), raw_size, data, n);
+        ok = !ZSTD_isError(r) && r == raw_size;
+        break;
+      }
+#endif
+      default:
+        (void)data;
+        (void)n;
+        break;
+    }
+    stats_.decompress_ns += elapsed_ns(t0);
+    return ok;
+  }
+
+private:
+  static std::uint64_t elapsed_ns(std::chrono::steady_clock::time_point t0) {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - t0).count());
+  }
+
+#ifdef P2P_HAVE_ZSTD
+  // Un contexte par thread du pool CPU (les contextes ne sont pas thread-safe)
+  static ZSTD_CCtx* zstd_cctx() {
+    thread_local std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> ctx(ZSTD_createCCtx(), &ZSTD_freeCCtx);
+    return ctx.get();
+  }
+  static ZSTD_DCtx* zstd_dctx() {
+    thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> ctx(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+    return ctx.get();
+  }
+
+  std::unique_ptr<ZSTD_CDict, decltype(&ZSTD_freeCDict)> cdict_{nullptr, &ZSTD_freeCDict};
+  std::unique_ptr<ZSTD_DDict, decltype(&ZSTD_freeDDict)> ddict_{nullptr, &ZSTD_freeDDict};
+#endif
+
+  compression_config cfg_;
+  compression_stats stats_;
+};
+
+} // namespace p2p
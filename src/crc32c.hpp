@@ -0,0 +1,237 @@
+// ===========================================
+// CRC32C.HPP
+// CRC32C (Castagnoli) pour l'intégrité des trames
+//
+// Plusieurs implémentations, choisies à l'exécution :
+//   - table       : un octet par itération (référence, la plus lente) ;
+//   - slice8      : 8 tables, 8 octets par itération (portable) ;
+//   - sse42       : instruction crc32 (8 octets par instruction) ;
+//   - sse42_3way  : trois flux crc32 indépendants entrelacés pour masquer
+//                   la latence de l'instruction, recombinés par une
+//                   multiplication sans retenue (PCLMULQDQ) ou, à défaut,
+//                   par une multiplication logicielle modulo P.
+//
+// API "extend" (comme google/crc32c) : extend(extend(0, A), B) == value(A+B),
+// ce qui permet de calculer le CRC d'une chaîne de tampons dispersés
+// (iobuf, séquence Asio) sans jamais les recopier bout à bout.
+// ===========================================
+#pragma once
+
+#include <asio/buffer.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define P2P_CRC32C_X86 1
+#include <immintrin.h>
+#endif
+
+namespace p2p::crc32c {
+
+// Polynôme de Castagnoli, forme réfléchie
+inline constexpr std::uint32_t poly = 0x82F63B78u;
+
+namespace detail {
+
+using tables_t = std::array<std::array<std::uint32_t, 256>, 8>;
+
+constexpr tables_t make_tables() {
+  tables_t t{};
+  for (std::uint32_t i = 0; i < 256; ++i) {
+    std::uint32_t c = i;
+    for (int k = 0; k < 8; ++k) c = (c & 1) ? (c >> 1) ^ poly : c >> 1;
+    t[0][i] = c;
+  }
+  for (std::size_t s = 1; s < 8; ++s)
+    for (std::size_t i = 0; i < 256; ++i)
+      t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+  return t;
+}
+
+inline constexpr tables_t tables = make_tables();
+
+// x^k mod P (forme réfléchie : x^0 = bit 31)
+constexpr std::uint32_t xpow_mod(std::uint64_t k) {
+  std::uint32_t p = 0x80000000u;
+  for (std::uint64_t i = 0; i < k; ++i) p = (p & 1) ? (p >> 1) ^ poly : p >> 1;
+  return p;
+}
+
+// a(x) * b(x) mod P en logiciel (même algorithme que crc32_combine de zlib)
+constexpr std::uint32_t multmod(std::uint32_t a, std::uint32_t b) {
+  std::uint32_t m = 0x80000000u, p = 0;
+  for (;;) {
+    if (a & m) {
+      p ^= b;
+      if ((a & (m - 1)) == 0) break;
+    }
+    m >>= 1;
+    b = (b & 1) ? (b >> 1) ^ poly : b >> 1;
+  }
+  return p;
+}
+
+inline std::uint64_t load64(const unsigned char* p) {
+  std::uint64_t v;
+  std::memcpy(&v, p, 8);  // lecture non alignée sûre (petit-boutiste sur x86)
+  return v;
+}
+
+} // namespace detail
+
+// -------------------------------------------
+// Implémentations sur l'état "brut" (sans inversion initiale/finale)
+// -------------------------------------------
+
+inline std::uint32_t raw_table(std::uint32_t s, const unsigned char* p, std::size_t n) {
+  const auto& t = detail::tables[0];
+  while (n--) s = (s >> 8) ^ t[(s ^ *p++) & 0xFF];
+  return s;
+}
+
+inline std::uint32_t raw_slice8(std::uint32_t s, const unsigned char* p, std::size_t n) {
+  const auto& t = detail::tables;
+  while (n >= 8) {
+    std::uint64_t v = detail::load64(p) ^ s;
+    s = t[7][v & 0xFF] ^ t[6][(v >> 8) & 0xFF] ^ t[5][(v >> 16) & 0xFF] ^ t[4][(v >> 24) & 0xFF] ^
+        t[3][(v >> 32) & 0xFF] ^ t[2][(v >> 40) & 0xFF] ^ t[1][(v >> 48) & 0xFF] ^ t[0][v >> 56];
+    p += 8;
+    n -= 8;
+  }
+  return raw_table(s, p, n);
+}
+
+#ifdef P2P_CRC32C_X86
+
+__attribute__((target("sse4.2")))
+inline std::uint32_t raw_sse42(std::uint32_t s, const unsigned char* p, std::size_t n) {
+  std::uint64_t c = s;
+  while (n >= 8) {
+    c = _mm_crc32_u64(c, detail::load64(p));
+    p += 8;
+    n -= 8;
+  }
+  auto s32 = static_cast<std::uint32_t>(c);
+  while (n--) s32 = _mm_crc32_u8(s32, *p++);
+  return s32;
+}
+
+namespace detail {
+
+// Longueur de chaque flux pour la version entrelacée (gros / petits tampons)
+inline constexpr std::size_t long_stream = 8192;
+inline constexpr std::size_t short_stream = 256;
+
+// Décalage de l'état de n octets : s * x^(8n) mod P.
+// Avec PCLMUL : clmul(s, x^(8n-33)) réduit par crc32_u64 (qui multiplie par x^32
+// et réduit modulo P ; le clmul réfléchi apporte le x restant).
+inline constexpr std::uint32_t long_k_clmul = xpow_mod(8 * long_stream - 33);
+inline constexpr std::uint32_t short_k_clmul = xpow_mod(8 * short_stream - 33);
+inline constexpr std::uint32_t long_k_soft = xpow_mod(8 * long_stream);
+inline constexpr std::uint32_t short_k_soft = xpow_mod(8 * short_stream);
+
+__attribute__((target("sse4.2,pclmul")))
+inline std::uint32_t shift_clmul(std::uint32_t s, std::uint32_t k) {
+  __m128i prod = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(s)),
+                                      _mm_cvtsi32_si128(static_cast<int>(k)), 0x00);
+  return static_cast<std::uint32_t>(
+    _mm_crc32_u64(0, static_cast<std::uint64_t>(_mm_cvtsi128_si64(prod))));
+}
+
+// Traite autant de blocs de 3 × len octets que possible ; avance p et n.
+// (Compilé pour SSE4.2 seul : shift_clmul n'est appelé que si le CPU a PCLMUL.)
+template <bool UseClmul>
+__attribute__((target("sse4.2")))
+inline std::uint32_t run_3way(std::uint32_t s, const unsigned char*& p, std::size_t& n,
+                              std::size_t len, std::uint32_t k_clmul, std::uint32_t k_soft) {
+  while (n >= 3 * len) {
+    std::uint64_t c0 = s, c1 = 0, c2 = 0;
+    const unsigned char* p0 = p;
+    const unsigned char* p1 = p + len;
+    const unsigned char* p2 = p + 2 * len;
+    // Trois chaînes de dépendances indépendantes : le CPU les exécute en parallèle
+    for (std::size_t i = 0; i < len; i += 8) {
+      c0 = _mm_crc32_u64(c0, load64(p0 + i));
+      c1 = _mm_crc32_u64(c1, load64(p1 + i));
+      c2 = _mm_crc32_u64(c2, load64(p2 + i));
+    }
+    // Recombinaison : crc(A|B|C) = A·x^(16L) ^ B·x^(8L) ^ C
+    auto a = static_cast<std::uint32_t>(c0);
+    auto b = static_cast<std::uint32_t>(c1);
+    if constexpr (UseClmul) {
+      a = shift_clmul(a, k_clmul) ^ b;
+      s = shift_clmul(a, k_clmul) ^ static_cast<std::uint32_t>(c2);
+    } else {
+      a = multmod(k_soft, a) ^ b;
+      s = multmod(k_soft, a) ^ static_cast<std::uint32_t>(c2);
+    }
+    p += 3 * len;
+    n -= 3 * len;
+  }
+  return s;
+}
+
+template <bool UseClmul>
+__attribute__((target("sse4.2")))
+inline std::uint32_t raw_3way(std::uint32_t s, const unsigned char* p, std::size_t n) {
+  s = run_3way<UseClmul>(s, p, n, long_stream, long_k_clmul, long_k_soft);
+  s = run_3way<UseClmul>(s, p, n, short_stream, short_k_clmul, short_k_soft);
+  return raw_sse42(s, p, n);
+}
+
+} // namespace detail
+
+inline std::uint32_t raw_sse42_3way(std::uint32_t s, const unsigned char* p, std::size_t n) {
+  static const bool clmul = __builtin_cpu_supports("pclmul");
+  return clmul ? detail::raw_3way<true>(s, p, n) : detail::raw_3way<false>(s, p, n);
+}
+
+#endif // P2P_CRC32C_X86
+
+// -------------------------------------------
+// Sélection à l'exécution
+// -------------------------------------------
+using raw_fn = std::uint32_t (*)(std::uint32_t, const unsigned char*, std::size_t);
+
+struct implementation_t {
+  raw_fn fn;
+  const char* name;
+};
+
+inline implementation_t select_implementation() {
+#ifdef P2P_CRC32C_X86
+  if (__builtin_cpu_supports("sse4.2"))
+    return {raw_sse42_3way, __builtin_cpu_supports("pclmul") ? "sse42_3way+pclmul" : "sse42_3way"};
+#endif
+  return {raw_slice8, "slice8"};
+}
+
+inline const implementation_t& implementation() {
+  static const implementation_t impl = select_implementation();
+  return impl;
+}
+
+// CRC32C standard (état initial et final inversés), prolongeable
+inline std::uint32_t extend(std::uint32_t crc, const void* data, std::size_t n) {
+  return ~implementation().fn(~crc, static_cast<const unsigned char*>(data), n);
+}
+
+inline std::uint32_t value(const void* data, std::size_t n) { return extend(0, data, n); }
+
+// CRC d'une séquence de tampons Asio (ou d'un iobuf via buffers()),
+// segment par segment, sans linéarisation
+template <typename ConstBufferSequence>
+std::uint32_t value_of(const ConstBufferSequence& buffers) {
+  std::uint32_t crc = 0;
+  auto end = asio::buffer_sequence_end(buffers);
+  for (auto it = asio::buffer_sequence_begin(buffers); it != end; ++it) {
+    asio::const_buffer b(*it);
+    crc = extend(crc, b.data(), b.size());
+  }
+  return crc;
+}
+
+} // namespace p2p::crc32c
@@ -0,0 +1,332 @@
+// ===========================================
+// DELTA.HPP
+// Synchronisation différentielle façon rsync
+// Objectif : un pair qui possède déjà une ancienne version d'un fichier
+//            ne reçoit que ce qui a changé.
+//
+//   1) le receveur découpe son ancienne copie en blocs de block_size et
+//      envoie leur signature : somme faible "roulante" + empreinte forte
+//      (SHA-256 tronquée à 16 octets) ;
+//   2) l'émetteur fait glisser une fenêtre sur sa version, octet par octet,
+//      cherche la somme faible dans la table, confirme par l'empreinte forte
+//      et produit une suite d'instructions : "copie les blocs i..j" ou
+//      "voici des octets littéraux" ;
+//   3) le receveur applique le delta à son ancienne copie.
+//
+// Recherche rapide :
+//   - la somme faible est calculée par lots de positions à partir de sommes
+//     préfixes (boucle sans dépendance entre itérations → vectorisée par le
+//     compilateur) au lieu d'un roulement octet par octet ;
+//   - après un bloc trouvé, la recherche reprend dans le lot déjà calculé ;
+//     au-delà du lot, la position suivante est testée seule (cas courant :
+//     les blocs se suivent) avant de relancer un lot ;
+//   - un filtre de bits (~16 bits par bloc, 8 KiB minimum) écarte presque
+//     toutes les positions avant de toucher la table ;
+//   - la table est en adressage ouvert, 8 octets par case, séparée des
+//     empreintes fortes (lues seulement sur un candidat).
+// ===========================================
+#pragma once
+
+#include "frame.hpp"     // detail::load_be32 / store_be32
+#include "sha256.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace p2p::delta {
+
+inline constexpr std::size_t strong_size = 16;
+using strong_hash = std::array<std::uint8_t, strong_size>;
+
+inline strong_hash strong_of(const std::uint8_t* p, std::size_t n) {
+  digest d = sha256_of(p, n);
+  strong_hash s;
+  std::memcpy(s.data(), d.data(), strong_size);
+  return s;
+}
+
+// Somme faible de rsync : a = Σ x, b = Σ (L - j) x_j, chacune modulo 2^16
+inline std::uint32_t weak_of(const std::uint8_t* p, std::size_t n) {
+  std::uint32_t a = 0, b = 0;
+  for (std::size_t j = 0; j < n; ++j) {
+    a += p[j];
+    b += static_cast<std::uint32_t>(n - j) * p[j];
+  }
+  return (a & 0xffff) | (b << 16);
+}
+
+// -------------------------------------------
+// Signature de l'ancienne copie (côté receveur)
+// -------------------------------------------
+struct signature {
+  std::uint32_t block_size = 0;
+  std::vector<std::uint32_t> weak;     // un par bloc complet
+  std::vector<strong_hash> strong;     // idem (le bloc final incomplet est ignoré)
+
+  std::size_t blocks() const { return weak.size(); }
+  std::size_t wire_size() const { return 8 + blocks() * (4 + strong_size); }
+};
+
+inline signature make_signature(const std::uint8_t* data, std::size_t n, std::size_t block_size) {
+  if (block_size == 0 || block_size > UINT32_MAX) throw std::invalid_argument("delta: invalid block size");
+  signature sig;
+  sig.block_size = static_cast<std::uint32_t>(block_size);
+  std::size_t count = n / block_size;
+  sig.weak.resize(count);
+  sig.strong.resize(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    sig.weak[i] = weak_of(data + i * block_size, block_size);
+    sig.strong[i] = strong_of(data + i * block_size, block_size);
+  }
+  return sig;
+}
+
+namespace detail {
+
+// Table somme faible → bloc, en adressage ouvert (plusieurs blocs peuvent
+// partager la même somme : on parcourt la séquence de sondage jusqu'au vide)
+class weak_table {
+public:
+  static constexpr std::uint32_t empty = UINT32_MAX;
+
+  explicit weak_table(const signature& sig) {
+    // ~16 bits de filtre par bloc (au moins 64 Kibits) : ~6 % de faux positifs
+    std::size_t bits = std::bit_ceil(std::max<std::size_t>(std::size_t(1) << 16, sig.blocks() * 16));
+    filter_shift_ = 32 - std::countr_zero(bits);
+    filter_.assign(bits / 64, 0);
+    std::size_t cap = std::bit_ceil(std::max<std::size_t>(16, sig.blocks() * 2));
+    shift_ = 64 - std::countr_zero(cap);
+    slots_.assign(cap, slot{0, empty});
+    for (std::uint32_t i = 0; i < sig.blocks(); ++i) {
+      std::uint32_t w = sig.weak[i];
+      filter_[mix(w) >> 6] |= std::uint64_t(1) << (mix(w) & 63);
+      std::size_t s = home(w);
+      while (slots_[s].block != empty) s = (s + 1) & (cap - 1);
+      slots_[s] = {w, i};
+    }
+  }
+
+  bool maybe(std::uint32_t w) const { return filter_[mix(w) >> 6] >> (mix(w) & 63) & 1; }
+
+  // Appelle f(bloc) pour chaque bloc de somme w, jusqu'à ce que f renvoie true
+  template <typename F>
+  std::uint32_t find(std::uint32_t w, F&& f) const {
+    for (std::size_t s = home(w);; s = (s + 1) & (slots_.size() - 1)) {
+      if (slots_[s].block == empty) return empty;
+      if (slots_[s].weak == w && f(slots_[s].block)) return slots_[s].block;
+    }
+  }
+
+private:
+  struct slot {
+    std::uint32_t weak;
+    std::uint32_t block;
+  };
+
+  std::uint32_t mix(std::uint32_t w) const { return (w * 0x9E3779B1u) >> filter_shift_; }
+  std::size_t home(std::uint32_t w) const { return (std::uint64_t(w) * 0x9E3779B97F4A7C15ull) >> shift_; }
+
+  std::vector<std::uint64_t> filter_;
+  std::vector<slot> slots_;
+  int shift_ = 0;
+  int filter_shift_ = 16;
+};
+
+// Sommes faibles des fenêtres p[k, k + L) pour k dans [0, count).
+// Avec S1 / S2 les sommes préfixes de x_i et de i·x_i (origine locale) :
+//   a(k) = S1[k+L] - S1[k]
+//   b(k) = (k+L)·a(k) - (S2[k+L] - S2[k])
+// Arithmétique 32 bits modulaire : exacte modulo 2^16.
+inline void weak_batch(const std::uint8_t* p, std::size_t count, std::size_t L,
+                       std::vector<std::uint32_t>& s1, std::vector<std::uint32_t>& s2,
+                       std::uint32_t* out) {
+  std::size_t span = count + L;
+  s1.resize(span + 1);
+  s2.resize(span + 1);
+  s1[0] = s2[0] = 0;
+  for (std::size_t i = 0; i < span; ++i) {
+    s1[i + 1] = s1[i] + p[i];
+    s2[i + 1] = s2[i] + static_cast<std::uint32_t>(i) * p[i];
+  }
+  const std::uint32_t* a1 = s1.data();
+  const std::uint32_t* a2 = s2.data();
+  const auto l32 = static_cast<std::uint32_t>(L);
+  for (std::size_t k = 0; k < count; ++k) {
+    std::uint32_t a = a1[k + L] - a1[k];
+    std::uint32_t b = (static_cast<std::uint32_t>(k) + l32) * a - (a2[k + L] - a2[k]);
+    out[k] = (a & 0xffff) | (b << 16);
+  }
+}
+
+} // namespace detail
+
+// -------------------------------------------
+// Delta (côté émetteur)
+//   0x01 | len u32 | octets        : littéral
+//   0x02 | first u32 | count u32   : copie des blocs [first, first + count)
+// -------------------------------------------
+enum : std::uint8_t { op_literal = 0x01, op_copy = 0x02 };
+
+struct delta_stats {
+  std::size_t copied_blocks = 0;
+  std::size_t literal_bytes = 0;
+  std::size_t weak_hits = 0;    // candidats passés par le filtre et la table
+  std::size_t false_hits = 0;   // somme faible égale, empreinte forte différente
+};
+
+class delta_encoder {
+public:
+  explicit delta_encoder(std::vector<std::uint8_t>& out) : out_(out) {}
+
+  void literal(const std::uint8_t* p, std::size_t n) {
+    if (!n) return;
+    flush_copy();
+    put_op(op_literal, static_cast<std::uint32_t>(n));
+    out_.insert(out_.end(), p, p + n);
+  }
+
+  void copy(std::uint32_t block) {
+    if (run_count_ && run_first_ + run_count_ == block) {
+      ++run_count_;  // blocs consécutifs : une seule instruction
+      return;
+    }
+    flush_copy();
+    run_first_ = block;
+    run_count_ = 1;
+  }
+
+  void finish() { flush_copy(); }
+
+private:
+  void put_u32(std::uint32_t v) {
+    unsigned char b[4];
+    p2p::detail::store_be32(b, v);
+    for (unsigned char c : b) out_.push_back(c);
+  }
+
+  void put_op(std::uint8_t op, std::uint32_t v) {
+    out_.push_back(op);
+    put_u32(v);
+  }
+
+  void flush_copy() {
+    if (!run_count_) return;
+    put_op(op_copy, run_first_);
+    put_u32(run_count_);
+    run_count_ = 0;
+  }
+
+  std::vector<std::uint8_t>& out_;
+  std::uint32_t run_first_ = 0;
+  std::uint32_t run_count_ = 0;
+};
+
+inline std::vector<std::uint8_t> make_delta(const signature& sig, const std::uint8_t* data,
+                                            std::size_t n, delta_stats* stats = nullptr) {
+  constexpr std::size_t batch = 16384;
+  std::vector<std::uint8_t> out;
+  delta_encoder enc(out);
+  delta_stats st;
+  const std::size_t L = sig.block_size;
+
+  if (!sig.blocks() || L == 0 || n < L) {   // L == 0 : signature reçue invalide
+    enc.literal(data, n);
+    enc.finish();
+    st.literal_bytes = n;
+    if (stats) *stats = st;
+    return out;
+  }
+
+  detail::weak_table table(sig);
+  // Bloc de l'ancienne copie dont la fenêtre [at, at + L) est l'image, ou empty
+  auto match = [&](std::size_t at, std::uint32_t w) {
+    if (!table.maybe(w)) return detail::weak_table::empty;
+    std::optional<strong_hash> strong;
+    return table.find(w, [&](std::uint32_t b) {
+      ++st.weak_hits;
+      if (!strong) strong = strong_of(data + at, L);
+      bool same = sig.strong[b] == *strong;
+      st.false_hits += !same;
+      return same;
+    });
+  };
+
+  std::vector<std::uint32_t> s1, s2, weak(batch);
+  std::size_t pos = 0, literal_start = 0;
+  std::size_t first = 0, count = 0;   // lot courant : weak[k] = somme de la fenêtre first + k
+  auto emit_copy = [&](std::size_t at, std::uint32_t block) {
+    enc.literal(data + literal_start, at - literal_start);
+    st.literal_bytes += at - literal_start;
+    enc.copy(block);
+    ++st.copied_blocks;
+    pos = literal_start = at + L;
+  };
+
+  while (pos + L <= n) {
+    if (pos >= first + count) {
+      // Chemin rapide : le bloc suivant fait souvent suite au précédent
+      if (pos == literal_start && pos > 0) {
+        std::uint32_t block = match(pos, weak_of(data + pos, L));
+        if (block != detail::weak_table::empty) {
+          emit_copy(pos, block);
+          continue;
+        }
+      }
+      first = pos;
+      count = std::min(batch, n - L + 1 - pos);
+      detail::weak_batch(data + pos, count, L, s1, s2, weak.data());
+    }
+    // Reprise dans le lot courant (après un bloc trouvé, pos a sauté par-dessus)
+    for (std::size_t end = first + count; pos < end; ++pos) {
+      std::uint32_t block = match(pos, weak[pos - first]);
+      if (block != detail::weak_table::empty) {
+        emit_copy(pos, block);
+        break;
+      }
+    }
+  }
+  enc.literal(data + literal_start, n - literal_start);
+  st.literal_bytes += n - literal_start;
+  enc.finish();
+  if (stats) *stats = st;
+  return out;
+}
+
+// Applique un delta à l'ancienne copie ; nullopt si le delta est invalide
+inline std::optional<std::vector<std::uint8_t>> apply_delta(const std::uint8_t* old, std::size_t old_size,
+                                                            std::size_t block_size,
+                                                            const std::uint8_t* d, std::size_t n) {
+  if (block_size == 0) return std::nullopt;
+  std::vector<std::uint8_t> out;
+  std::size_t i = 0;
+  while (i < n) {
+    if (n - i < 5) return std::nullopt;
+    std::uint8_t op = d[i];
+    std::uint32_t v = p2p::detail::load_be32(d + i + 1);
+    i += 5;
+    if (op == op_literal) {
+      if (n - i < v) return std::nullopt;
+      out.insert(out.end(), d + i, d + i + v);
+      i += v;
+    } else if (op == op_copy) {
+      if (n - i < 4) return std::nullopt;
+      std::uint32_t count = p2p::detail::load_be32(d + i);
+      i += 4;
+      std::size_t from = std::size_t(v) * block_size, len = std::size_t(count) * block_size;
+      if (from + len > old_size) return std::nullopt;
+      out.insert(out.end(), old + from, old + from + len);
+    } else {
+      return std::nullopt;
+    }
+  }
+  return out;
+}
+
+} // namespace p2p::delta
@@ -0,0 +1,381 @@
+// ===========================================
+// DISK_IO.HPP
+// Lectures / écritures disque asynchrones des chunks
+// Objectif : un disque lent ne bloque plus le thread de l'io_context.
+//            Un pread() bloquant sur ce thread gèle TOUTES les sessions
+//            qu'il sert le temps de l'accès disque.
+//
+// Un disk_device représente un périphérique : il borne le nombre
+// d'opérations en vol (max_in_flight) et met les suivantes en file FIFO,
+// pour ne pas noyer la file matérielle ni affamer les autres disques.
+//
+// Deux moteurs, choisis à la compilation :
+//   - ASIO_HAS_FILE (io_uring, liburing trouvée par CMake) :
+//     asio::random_access_file + async_read_at / async_write_at, aucun
+//     thread supplémentaire ;
+//   - sinon : pread / pwritev sur un petit asio::thread_pool propre au
+//     périphérique, la complétion revient sur l'exécuteur de l'io_context.
+// Dans les deux cas le handler est appelé sur l'io_context.
+//
+// Option O_DIRECT (contourne le page cache) : les tampons viennent d'un
+// buffer_pool aligné, les lectures sont étendues aux frontières
+// d'alignement puis recadrées (iobuf sans copie), les écritures doivent
+// commencer à un offset aligné et sont complétées par des zéros.
+// ===========================================
+#pragma once
+
+#include "buffer_pool.hpp"
+#include "iobuf.hpp"
+
+#include <asio/error.hpp>
+#include <asio/executor_work_guard.hpp>
+#include <asio/io_context.hpp>
+#include <asio/post.hpp>
+#include <asio/thread_pool.hpp>
+#if defined(ASIO_HAS_FILE)
+#include <asio/random_access_file.hpp>
+#include <asio/read_at.hpp>
+#include <asio/write_at.hpp>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>   // IOV_MAX
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace p2p {
+
+namespace disk_detail {
+
+// pwritev de tous les iovec (par paquets de IOV_MAX), reprise après écriture
+// partielle. `calls` compte les appels système effectués.
+inline std::error_code pwritev_all(int fd, std::uint64_t offset, std::vector<iovec>& iov,
+                                   std::uint64_t* calls = nullptr) {
+  std::size_t i = 0;
+  while (i < iov.size()) {
+    int count = static_cast<int>(std::min<std::size_t>(iov.size() - i, IOV_MAX));
+    ssize_t r = ::pwritev(fd, iov.data() + i, count, static_cast<off_t>(offset));
+    if (calls) ++*calls;
+    if (r < 0 && errno == EINTR) continue;
+    if (r < 0) return std::error_code(errno, std::generic_category());
+    auto left = static_cast<std::size_t>(r);
+    offset += left;
+    while (i < iov.size() && left >= iov[i].iov_len) left -= iov[i++].iov_len;
+    if (i < iov.size()) {
+      iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + left;
+      iov[i].iov_len -= left;
+    }
+  }
+  return {};
+}
+
+} // namespace disk_detail
+
+struct disk_options {
+  std::size_t max_in_flight = 32;      // opérations simultanées sur le périphérique
+  bool direct = false;                 // O_DIRECT
+  std::size_t alignment = 4096;        // alignement exigé par O_DIRECT (secteur logique)
+  std::size_t block_size = 256 * 1024; // taille des tampons alignés du pool
+  std::size_t threads = 4;             // moteur de repli : threads bloquants
+};
+
+// Compteurs (lus et écrits sur le thread de l'io_context)
+struct disk_stats {
+  std::size_t in_flight = 0;
+  std::size_t queued = 0;
+  std::size_t peak_in_flight = 0;
+  std::size_t peak_queued = 0;
+  std::uint64_t reads = 0;
+  std::uint64_t writes = 0;
+  std::uint64_t bytes_read = 0;
+  std::uint64_t bytes_written = 0;
+};
+
+// Fichier ouvert sur un périphérique (partagé par les opérations en vol)
+class disk_file {
+public:
+  disk_file(const disk_file&) = delete;
+  disk_file& operator=(const disk_file&) = delete;
+
+  ~disk_file() {
+#if !defined(ASIO_HAS_FILE)
+    ::close(fd_);
+#endif
+  }
+
+  std::uint64_t size() const {
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) throw std::system_error(errno, std::generic_category(), "fstat");
+    return static_cast<std::uint64_t>(st.st_size);
+  }
+
+  int native_handle() const { return fd_; }
+  bool direct() const { return direct_; }
+
+private:
+  friend class disk_device;
+
+#if defined(ASIO_HAS_FILE)
+  disk_file(asio::io_context& io, int fd, bool direct)
+    : fd_(fd), direct_(direct), file_(io, fd) {}   // random_access_file prend le descripteur
+#else
+  disk_file(asio::io_context&, int fd, bool direct) : fd_(fd), direct_(direct) {}
+#endif
+
+  int fd_;
+  bool direct_;
+#if defined(ASIO_HAS_FILE)
+  asio::random_access_file file_;
+#endif
+};
+
+class disk_device {
+public:
+  using read_handler = std::function<void(std::error_code, iobuf)>;
+  using write_handler = std::function<void(std::error_code, std::size_t)>;
+
+  explicit disk_device(asio::io_context& io, disk_options opts = {})
+    : io_(io),
+      opts_(opts),
+      pool_(opts.block_size, opts.max_in_flight, opts.direct ? opts.alignment : 0)
+#if !defined(ASIO_HAS_FILE)
+      , workers_(std::max<std::size_t>(opts.threads, 1))
+#endif
+  {
+    if (opts_.max_in_flight == 0) throw std::invalid_argument("disk_device: max_in_flight must be > 0");
+    if (opts_.direct && (opts_.alignment == 0 || (opts_.alignment & (opts_.alignment - 1))))
+      throw std::invalid_argument("disk_device: alignment must be a power of two");
+  }
+
+  disk_device(const disk_device&) = delete;
+  disk_device& operator=(const disk_device&) = delete;
+
+  ~disk_device() {
+#if !defined(ASIO_HAS_FILE)
+    workers_.join();   // plus aucun pread en cours sur nos tampons
+#endif
+  }
+
+  // flags : O_RDONLY, O_RDWR | O_CREAT... (O_DIRECT ajouté selon les options)
+  std::shared_ptr<disk_file> open(const std::string& path, int flags = O_RDWR | O_CREAT, mode_t mode = 0644) {
+    if (opts_.direct) flags |= O_DIRECT;
+    int fd = ::open(path.c_str(), flags | O_CLOEXEC, mode);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "open " + path);
+    return std::shared_ptr<disk_file>(new disk_file(io_, fd, opts_.direct));
+  }
+
+  // Lit `length` octets à `offset`. Fin de fichier atteinte avant : eof et
+  // les octets disponibles.
+  void async_read(std::shared_ptr<disk_file> file, std::uint64_t offset, std::size_t length,
+                  read_handler handler) {
+    submit([this, file = std::move(file), offset, length, handler = std::move(handler)]() mutable {
+      start_read(std::move(file), offset, length, std::move(handler));
+    });
+  }
+
+  // Écrit tout `data` à `offset`. En O_DIRECT, offset doit être aligné ;
+  // la fin est complétée par des zéros jusqu'à l'alignement suivant.
+  void async_write(std::shared_ptr<disk_file> file, std::uint64_t offset, iobuf data,
+                   write_handler handler) {
+    if (file->direct() && offset % opts_.alignment)
+      throw std::invalid_argument("disk_device: O_DIRECT write offset must be aligned");
+    submit([this, file = std::move(file), offset, data = std::move(data), handler = std::move(handler)]() mutable {
+      start_write(std::move(file), offset, std::move(data), std::move(handler));
+    });
+  }
+
+  const disk_stats& stats() const { return stats_; }
+  const disk_options& options() const { return opts_; }
+
+  static constexpr const char* engine() {
+#if defined(ASIO_HAS_FILE)
+    return "io_uring (asio::random_access_file)";
+#else
+    return "thread pool (pread/pwritev)";
+#endif
+  }
+
+private:
+  // -------------------------------------------
+  // Limite d'opérations en vol
+  // -------------------------------------------
+  void submit(std::function<void()> op) {
+    if (stats_.in_flight < opts_.max_in_flight) {
+      begin();
+      op();
+      return;
+    }
+    waiting_.push_back(std::move(op));
+    stats_.queued = waiting_.size();
+    stats_.peak_queued = std::max(stats_.peak_queued, stats_.queued);
+  }
+
+  void begin() {
+    ++stats_.in_flight;
+    stats_.peak_in_flight = std::max(stats_.peak_in_flight, stats_.in_flight);
+  }
+
+  // Appelé sur l'io_context à la fin de chaque opération
+  void done() {
+    --stats_.in_flight;
+    if (waiting_.empty()) return;
+    auto next = std::move(waiting_.front());
+    waiting_.pop_front();
+    stats_.queued = waiting_.size();
+    begin();
+    next();
+  }
+
+  // -------------------------------------------
+  // Tampons
+  // -------------------------------------------
+
+  // Slab de `size` octets, aligné si O_DIRECT (pool si la taille le permet)
+  std::shared_ptr<char[]> slab(std::size_t size, bool direct) {
+    if (!direct) return std::make_shared_for_overwrite<char[]>(size);
+    if (size <= pool_.block_size()) return pool_.acquire().share();
+    std::size_t a = opts_.alignment;
+    return std::shared_ptr<char[]>(static_cast<char*>(::operator new[](size, std::align_val_t(a))),
+                                   block_deleter{a});
+  }
+
+  // -------------------------------------------
+  // Lecture
+  // -------------------------------------------
+  void start_read(std::shared_ptr<disk_file> file, std::uint64_t offset, std::size_t length,
+                  read_handler handler) {
+    // En O_DIRECT : [first, first + span) couvre la demande aux frontières d'alignement
+    std::uint64_t first = offset;
+    std::size_t span = length;
+    if (file->direct()) {
+      std::uint64_t a = opts_.alignment;
+      first = offset & ~(a - 1);
+      span = static_cast<std::size_t>((offset + length + a - 1) / a * a - first);
+    }
+    std::size_t head = static_cast<std::size_t>(offset - first);
+    auto buf = slab(span, file->direct());
+
+    auto finish = [this, buf, span, head, length, handler = std::move(handler)](std::error_code ec,
+                                                                               std::size_t n) mutable {
+      std::size_t avail = n > head ? std::min(n - head, length) : 0;
+      if (ec == asio::error::eof && avail == length) ec = {};   // O_DIRECT : dernier bloc partiel
+      ++stats_.reads;
+      stats_.bytes_read += avail;
+      done();
+      handler(ec, iobuf::wrap(std::move(buf), span, head, avail));
+    };
+
+#if defined(ASIO_HAS_FILE)
+    char* p = buf.get();
+    asio::async_read_at(file->file_, first, asio::buffer(p, span),
+                        [file, finish = std::move(finish)](std::error_code ec, std::size_t n) mutable {
+                          finish(ec, n);
+                        });
+#else
+    char* p = buf.get();
+    // La garde maintient io_.run() actif tant que l'opération est chez les workers
+    asio::post(workers_, [this, work = asio::make_work_guard(io_), fd = file->fd_, file, p, first, span,
+                          finish = std::move(finish)]() mutable {
+      std::error_code ec;
+      std::size_t n = 0;
+      while (n < span) {
+        ssize_t r = ::pread(fd, p + n, span - n, static_cast<off_t>(first + n));
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) {
+          ec.assign(errno, std::generic_category());
+          break;
+        }
+        if (r == 0) {
+          ec = asio::error::eof;
+          break;
+        }
+        n += static_cast<std::size_t>(r);
+      }
+      asio::post(io_, [work = std::move(work), file = std::move(file), finish = std::move(finish), ec, n]() mutable {
+        finish(ec, n);
+      });
+    });
+#endif
+  }
+
+  // -------------------------------------------
+  // Écriture
+  // -------------------------------------------
+  void start_write(std::shared_ptr<disk_file> file, std::uint64_t offset, iobuf data, write_handler handler) {
+    std::size_t length = data.size();
+    if (file->direct()) {
+      // Copie dans un tampon aligné, complétée par des zéros
+      std::size_t a = opts_.alignment;
+      std::size_t span = (length + a - 1) / a * a;
+      auto buf = slab(span, true);
+      std::size_t pos = 0;
+      for (const auto& s : data.segments()) {
+        std::memcpy(buf.get() + pos, s.data(), s.length);
+        pos += s.length;
+      }
+      std::memset(buf.get() + length, 0, span - length);
+      data = iobuf::wrap(std::move(buf), span, 0, span);
+    }
+
+    auto finish = [this, length, handler = std::move(handler)](std::error_code ec, std::size_t n) mutable {
+      n = std::min(n, length);
+      ++stats_.writes;
+      stats_.bytes_written += n;
+      done();
+      handler(ec, n);
+    };
+
+#if defined(ASIO_HAS_FILE)
+    // buffers() est une vue sur les segments de l'iobuf : il doit vivre à
+    // une adresse fixe jusqu'à la complétion, d'où le shared_ptr
+    auto held = std::make_shared<iobuf>(std::move(data));
+    asio::async_write_at(file->file_, offset, held->buffers(),
+                         [file, held, finish = std::move(finish)](std::error_code ec, std::size_t n) mutable {
+                           finish(ec, n);
+                         });
+#else
+    asio::post(workers_, [this, work = asio::make_work_guard(io_), file, offset, data = std::move(data),
+                          finish = std::move(finish)]() mutable {
+      std::error_code ec = write_all(file->fd_, offset, data);
+      std::size_t n = ec ? 0 : data.size();
+      // data (slab du pool en O_DIRECT) est rendu sur l'io_context : le pool est mono-thread
+      asio::post(io_, [work = std::move(work), file = std::move(file), data = std::move(data),
+                       finish = std::move(finish), ec, n]() mutable { finish(ec, n); });
+    });
+#endif
+  }
+
+#if !defined(ASIO_HAS_FILE)
+  static std::error_code write_all(int fd, std::uint64_t offset, const iobuf& data) {
+    std::vector<iovec> iov;
+    for (const auto& s : data.segments()) iov.push_back(iovec{s.data(), s.length});
+    return disk_detail::pwritev_all(fd, offset, iov);
+  }
+#endif
+
+  asio::io_context& io_;
+  disk_options opts_;
+  buffer_pool pool_;   // tampons alignés O_DIRECT, mono-thread (io_context)
+  disk_stats stats_;
+  std::deque<std::function<void()>> waiting_;
+#if !defined(ASIO_HAS_FILE)
+  asio::thread_pool workers_;
+#endif
+};
+
+} // namespace p2p
@@ -0,0 +1,353 @@
+// ===========================================
+// ERASURE.HPP
+// Codage à effacement Reed-Solomon (k données + m parités) sur GF(2^8)
+// Objectif : la redondance d'un chunk coûte (k+m)/k fois sa taille au lieu
+//            de 3 fois pour une réplication triple, et n'importe quels k
+//            shards, venus de n'importe quels pairs, suffisent à le rebâtir.
+//
+//   - code systématique : les k premiers shards sont le chunk découpé
+//     (lisibles sans décodage), les m suivants des combinaisons linéaires ;
+//   - matrice de Cauchy sous l'identité : toute sous-matrice k×k de lignes
+//     est inversible, donc tout ensemble de k shards distincts décode ;
+//   - cœur de calcul dst ^= c·src par tables de quartets : deux tables de 16
+//     octets par coefficient, indexées par les 4 bits bas et hauts de chaque
+//     octet ; PSHUFB (SSSE3, 16 octets) ou VPSHUFB (AVX2, 32 octets) fait
+//     16 / 32 recherches d'un coup. Choix à l'exécution, repli portable.
+// ===========================================
+#pragma once
+
+#include "iobuf.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define P2P_ERASURE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace p2p::erasure {
+
+// -------------------------------------------
+// Arithmétique GF(2^8), polynôme x^8 + x^4 + x^3 + x^2 + 1 (0x11d)
+// -------------------------------------------
+namespace gf {
+
+struct tables_t {
+  std::array<std::uint8_t, 512> exp{};   // doublée : pas de modulo 255 dans mul()
+  std::array<std::uint8_t, 256> log{};
+};
+
+constexpr tables_t make_tables() {
+  tables_t t;
+  unsigned x = 1;
+  for (int i = 0; i < 255; ++i) {
+    t.exp[i] = t.exp[i + 255] = static_cast<std::uint8_t>(x);
+    t.log[x] = static_cast<std::uint8_t>(i);
+    x <<= 1;
+    if (x & 0x100) x ^= 0x11d;
+  }
+  return t;
+}
+
+inline constexpr tables_t tables = make_tables();
+
+constexpr std::uint8_t mul(std::uint8_t a, std::uint8_t b) {
+  return (a && b) ? tables.exp[tables.log[a] + tables.log[b]] : 0;
+}
+
+constexpr std::uint8_t inv(std::uint8_t a) { return tables.exp[255 - tables.log[a]]; }
+
+// Tables de quartets : nibbles[c][0][i] = c·i, nibbles[c][1][i] = c·(i << 4)
+using nibble_tables_t = std::array<std::array<std::array<std::uint8_t, 16>, 2>, 256>;
+
+constexpr nibble_tables_t make_nibbles() {
+  nibble_tables_t t{};
+  for (int c = 0; c < 256; ++c)
+    for (int i = 0; i < 16; ++i) {
+      t[c][0][i] = mul(static_cast<std::uint8_t>(c), static_cast<std::uint8_t>(i));
+      t[c][1][i] = mul(static_cast<std::uint8_t>(c), static_cast<std::uint8_t>(i << 4));
+    }
+  return t;
+}
+
+alignas(64) inline constexpr nibble_tables_t nibbles = make_nibbles();
+
+} // namespace gf
+
+// -------------------------------------------
+// dst[i] ^= c · src[i]
+// -------------------------------------------
+inline void muladd_portable(std::uint8_t c, const std::uint8_t* src, std::uint8_t* dst, std::size_t n) {
+  const auto& lo = gf::nibbles[c][0];
+  const auto& hi = gf::nibbles[c][1];
+  for (std::size_t i = 0; i < n; ++i) dst[i] ^= lo[src[i] & 15] ^ hi[src[i] >> 4];
+}
+
+#ifdef P2P_ERASURE_X86
+
+__attribute__((target("ssse3")))
+inline void muladd_ssse3(std::uint8_t c, const std::uint8_t* src, std::uint8_t* dst, std::size_t n) {
+  const __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(gf::nibbles[c][0].data()));
+  const __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(gf::nibbles[c][1].data()));
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i p = _mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(x, mask)),
+                              _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(x, 4), mask)));
+    __m128i* d = reinterpret_cast<__m128i*>(dst + i);
+    _mm_storeu_si128(d, _mm_xor_si128(_mm_loadu_si128(d), p));
+  }
+  muladd_portable(c, src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline void muladd_avx2(std::uint8_t c, const std::uint8_t* src, std::uint8_t* dst, std::size_t n) {
+  const __m256i lo = _mm256_broadcastsi128_si256(
+    _mm_load_si128(reinterpret_cast<const __m128i*>(gf::nibbles[c][0].data())));
+  const __m256i hi = _mm256_broadcastsi128_si256(
+    _mm_load_si128(reinterpret_cast<const __m128i*>(gf::nibbles[c][1].data())));
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  std::size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(x, mask)),
+                                 _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(x, 4), mask)));
+    __m256i* d = reinterpret_cast<__m256i*>(dst + i);
+    _mm256_storeu_si256(d, _mm256_xor_si256(_mm256_loadu_si256(d), p));
+  }
+  muladd_portable(c, src + i, dst + i, n - i);
+}
+
+#endif // P2P_ERASURE_X86
+
+using muladd_fn = void (*)(std::uint8_t, const std::uint8_t*, std::uint8_t*, std::size_t);
+
+struct implementation_t {
+  muladd_fn fn;
+  const char* name;
+};
+
+inline implementation_t select_implementation() {
+#ifdef P2P_ERASURE_X86
+  if (__builtin_cpu_supports("avx2")) return {muladd_avx2, "avx2"};
+  if (__builtin_cpu_supports("ssse3")) return {muladd_ssse3, "ssse3"};
+#endif
+  return {muladd_portable, "portable"};
+}
+
+inline const implementation_t& implementation() {
+  static const implementation_t impl = select_implementation();
+  return impl;
+}
+
+// -------------------------------------------
+// Code (k, m)
+// -------------------------------------------
+struct params {
+  std::size_t k = 4;   // shards de données
+  std::size_t m = 2;   // shards de parité
+
+  std::size_t total() const { return k + m; }
+  std::size_t shard_size(std::size_t chunk_size) const { return (chunk_size + k - 1) / k; }
+};
+
+class codec {
+public:
+  explicit codec(params p, muladd_fn fn = implementation().fn) : p_(p), muladd_(fn) {
+    if (p_.k == 0 || p_.total() > 256) throw std::invalid_argument("erasure: need 1 <= k and k + m <= 256");
+    // Ligne k + i, colonne j : 1 / (x_i + y_j) avec x_i = k + i, y_j = j (tous distincts)
+    parity_.resize(p_.m * p_.k);
+    for (std::size_t i = 0; i < p_.m; ++i)
+      for (std::size_t j = 0; j < p_.k; ++j)
+        parity_[i * p_.k + j] = gf::inv(static_cast<std::uint8_t>((p_.k + i) ^ j));
+  }
+
+  const params& config() const { return p_; }
+
+  // Coefficient (ligne r, colonne j) de la matrice de codage complète
+  std::uint8_t coefficient(std::size_t r, std::size_t j) const {
+    return r < p_.k ? (r == j) : parity_[(r - p_.k) * p_.k + j];
+  }
+
+  // parity[i] = Σ_j coef(k+i, j) · data[j], shards de `size` octets.
+  // Par tranches de 16 KiB : les k tranches sources restent en cache L1/L2
+  // pendant qu'on calcule les m parités.
+  void encode(const std::uint8_t* const* data, std::uint8_t* const* parity, std::size_t size) const {
+    constexpr std::size_t stripe = 16 * 1024;
+    for (std::size_t off = 0; off < size; off += stripe) {
+      std::size_t n = std::min(stripe, size - off);
+      for (std::size_t i = 0; i < p_.m; ++i) {
+        std::memset(parity[i] + off, 0, n);
+        for (std::size_t j = 0; j < p_.k; ++j) muladd_(parity_[i * p_.k + j], data[j] + off, parity[i] + off, n);
+      }
+    }
+  }
+
+  // Reconstruit les shards de données manquants à partir de k shards
+  // présents : index[i] ∈ [0, k + m) (distincts) et shards[i] leurs octets.
+  // out[d] reçoit le shard de données d (déjà présent ou reconstruit).
+  // Renvoie false si moins de k shards distincts sont fournis.
+  bool decode(const std::size_t* index, const std::uint8_t* const* shards, std::size_t count,
+              std::uint8_t* const* out, std::size_t size) const {
+    const std::size_t k = p_.k;
+    if (count < k) return false;
+    // Les shards de données présents d'abord : ils se recopient tels quels
+    std::vector<std::size_t> order(count);
+    for (std::size_t i = 0; i < count; ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) { return index[a] < index[b]; });
+    order.resize(k);
+    for (std::size_t i = 1; i < k; ++i)
+      if (index[order[i]] == index[order[i - 1]]) return false;
+
+    // Matrice k×k des lignes présentes, inversée par Gauss-Jordan
+    std::vector<std::uint8_t> a(k * k), inv(k * k, 0);
+    for (std::size_t r = 0; r < k; ++r) {
+      for (std::size_t j = 0; j < k; ++j) a[r * k + j] = coefficient(index[order[r]], j);
+      inv[r * k + r] = 1;
+    }
+    if (!invert(a, inv, k)) return false;
+
+    for (std::size_t d = 0; d < k; ++d) {
+      std::size_t present = k;
+      for (std::size_t r = 0; r < k; ++r)
+        if (index[order[r]] == d) present = r;
+      if (present < k) {
+        std::memcpy(out[d], shards[order[present]], size);
+        continue;
+      }
+      std::memset(out[d], 0, size);
+      for (std::size_t r = 0; r < k; ++r)
+        if (std::uint8_t c = inv[d * k + r]) muladd_(c, shards[order[r]], out[d], size);
+    }
+    return true;
+  }
+
+private:
+  static bool invert(std::vector<std::uint8_t>& a, std::vector<std::uint8_t>& inv, std::size_t k) {
+    for (std::size_t col = 0; col < k; ++col) {
+      std::size_t pivot = col;
+      while (pivot < k && !a[pivot * k + col]) ++pivot;
+      if (pivot == k) return false;
+      if (pivot != col)
+        for (std::size_t j = 0; j < k; ++j) {
+          std::swap(a[pivot * k + j], a[col * k + j]);
+          std::swap(inv[pivot * k + j], inv[col * k + j]);
+        }
+      std::uint8_t scale = gf::inv(a[col * k + col]);
+      for (std::size_t j = 0; j < k; ++j) {
+        a[col * k + j] = gf::mul(a[col * k + j], scale);
+        inv[col * k + j] = gf::mul(inv[col * k + j], scale);
+      }
+      for (std::size_t r = 0; r < k; ++r) {
+        std::uint8_t f = a[r * k + col];
+        if (r == col || !f) continue;
+        for (std::size_t j = 0; j < k; ++j) {
+          a[r * k + j] ^= gf::mul(f, a[col * k + j]);
+          inv[r * k + j] ^= gf::mul(f, inv[col * k + j]);
+        }
+      }
+    }
+    return true;
+  }
+
+  params p_;
+  muladd_fn muladd_;
+  std::vector<std::uint8_t> parity_;   // m × k
+};
+
+// -------------------------------------------
+// Chunks ↔ shards (iobuf)
+// -------------------------------------------
+
+// Découpe et code un chunk : k + m shards de shard_size(chunk) octets
+// (le dernier shard de données est complété par des zéros). Tous les shards
+// sont des fenêtres sur un seul slab : les shards de données ne coûtent
+// qu'une copie du chunk.
+inline std::vector<iobuf> encode_chunk(const codec& c, const iobuf& chunk) {
+  const params& p = c.config();
+  std::size_t size = std::max<std::size_t>(1, p.shard_size(chunk.size()));
+  std::size_t capacity = size * p.total();
+  auto slab = std::make_shared_for_overwrite<char[]>(capacity);
+  auto* base = reinterpret_cast<std::uint8_t*>(slab.get());
+  std::size_t off = 0;
+  for (const auto& seg : chunk.segments()) {
+    std::memcpy(base + off, seg.data(), seg.length);
+    off += seg.length;
+  }
+  std::memset(base + off, 0, p.k * size - off);
+
+  std::vector<const std::uint8_t*> data(p.k);
+  std::vector<std::uint8_t*> parity(p.m);
+  for (std::size_t j = 0; j < p.k; ++j) data[j] = base + j * size;
+  for (std::size_t i = 0; i < p.m; ++i) parity[i] = base + (p.k + i) * size;
+  c.encode(data.data(), parity.data(), size);
+
+  std::vector<iobuf> shards;
+  for (std::size_t s = 0; s < p.total(); ++s) shards.push_back(iobuf::wrap(slab, capacity, s * size, size));
+  return shards;
+}
+
+// Rassemble des shards reçus dans n'importe quel ordre, de n'importe quels
+// pairs ; ready() dès que k shards distincts sont là, puis decode().
+class shard_collector {
+public:
+  shard_collector(const codec& c, std::size_t chunk_size) : codec_(c), chunk_size_(chunk_size) {}
+
+  // Renvoie false si le shard est refusé (index invalide, taille fausse, doublon)
+  bool add(std::size_t index, iobuf shard) {
+    const params& p = codec_.config();
+    if (index >= p.total() || shard.size() != shard_size() || have(index)) return false;
+    if (ready()) return true;   // déjà assez : le surplus est ignoré
+    index_.push_back(index);
+    shards_.push_back(std::move(shard));
+    return true;
+  }
+
+  bool have(std::size_t index) const { return std::find(index_.begin(), index_.end(), index) != index_.end(); }
+  bool ready() const { return index_.size() >= codec_.config().k; }
+  std::size_t received() const { return index_.size(); }
+  std::size_t shard_size() const { return std::max<std::size_t>(1, codec_.config().shard_size(chunk_size_)); }
+
+  std::optional<iobuf> decode() const {
+    if (!ready()) return std::nullopt;
+    const params& p = codec_.config();
+    std::size_t size = shard_size();
+    // Shards en un seul segment : lus en place ; sinon linéarisés
+    std::vector<std::string> linear;
+    linear.reserve(shards_.size());
+    std::vector<const std::uint8_t*> in(shards_.size());
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+      const auto& segs = shards_[i].segments();
+      if (segs.size() == 1) {
+        in[i] = reinterpret_cast<const std::uint8_t*>(segs.front().data());
+      } else {
+        linear.push_back(shards_[i].to_string());
+        in[i] = reinterpret_cast<const std::uint8_t*>(linear.back().data());
+      }
+    }
+    iobuf out = iobuf::create(p.k * size);
+    auto* base = reinterpret_cast<std::uint8_t*>(out.prepare_tail(p.k * size).data());
+    std::vector<std::uint8_t*> dst(p.k);
+    for (std::size_t d = 0; d < p.k; ++d) dst[d] = base + d * size;
+    if (!codec_.decode(index_.data(), in.data(), in.size(), dst.data(), size)) return std::nullopt;
+    out.commit(chunk_size_);
+    return out;
+  }
+
+private:
+  const codec& codec_;
+  std::size_t chunk_size_;
+  std::vector<std::size_t> index_;
+  std::vector<iobuf> shards_;
+};
+
+} // namespace p2p::erasure
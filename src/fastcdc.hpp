@@ -0,0 +1,120 @@
+// ===========================================
+// FASTCDC.HPP
+// Découpage des fichiers en chunks définis par le contenu (FastCDC)
+// Objectif : un octet inséré au début d'un fichier ne déplace que les
+//            chunks voisins ; tous les autres gardent leurs frontières,
+//            donc leur empreinte, et ne sont ni stockés ni transférés
+//            une deuxième fois (voir chunk_store.hpp).
+//
+// Empreinte "gear" : fp = (fp << 1) + gear[octet]. Une frontière tombe
+// quand les bits testés par le masque sont tous à zéro.
+//   - rien n'est haché sur les min_size premiers octets (saut de frontière) ;
+//   - normalisation : masque exigeant (plus de bits) avant avg_size, masque
+//     permissif après → tailles resserrées autour de avg_size ;
+//   - deux octets par itération (FastCDC 2020) : le premier est testé avec
+//     des tables et masques pré-décalés d'un bit, ce qui économise un
+//     décalage et un test de fin de boucle par octet.
+// ===========================================
+#pragma once
+
+#include <array>
+#include <bit>          // std::countr_zero
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace p2p {
+
+struct cdc_params {
+  std::size_t min_size = 2 * 1024;
+  std::size_t avg_size = 8 * 1024;   // puissance de deux
+  std::size_t max_size = 64 * 1024;
+};
+
+namespace cdc_detail {
+
+// Table gear : 256 valeurs pseudo-aléatoires fixes (splitmix64).
+// Elle fait partie du format : la changer change toutes les frontières.
+constexpr std::array<std::uint64_t, 256> make_gear() {
+  std::array<std::uint64_t, 256> t{};
+  std::uint64_t x = 0x70326d6f6465ull;
+  for (auto& v : t) {
+    std::uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    v = z ^ (z >> 31);
+  }
+  return t;
+}
+
+constexpr std::array<std::uint64_t, 256> shift_left(std::array<std::uint64_t, 256> t) {
+  for (auto& v : t) v <<= 1;
+  return t;
+}
+
+inline constexpr std::array<std::uint64_t, 256> gear = make_gear();
+inline constexpr std::array<std::uint64_t, 256> gear_ls = shift_left(gear);
+
+// `bits` bits de poids fort, bit 63 exclu (il sort au décalage de gear_ls)
+constexpr std::uint64_t mask(int bits) { return ((std::uint64_t(1) << bits) - 1) << (63 - bits); }
+
+} // namespace cdc_detail
+
+class fastcdc {
+public:
+  explicit fastcdc(cdc_params p = {}) : p_(p) {
+    if (p_.avg_size & (p_.avg_size - 1) || p_.min_size >= p_.avg_size || p_.avg_size >= p_.max_size)
+      throw std::invalid_argument("fastcdc: need min < avg < max and avg a power of two");
+    int bits = std::countr_zero(p_.avg_size);
+    mask_s_ = cdc_detail::mask(bits + 2);
+    mask_l_ = cdc_detail::mask(bits - 2);
+  }
+
+  const cdc_params& params() const { return p_; }
+
+  // Longueur du prochain chunk au début de [p, p + n).
+  // Sans frontière avant min(n, max_size), renvoie min(n, max_size) : à la
+  // fin d'un fichier c'est le dernier chunk ; sur un flux, l'appelant qui
+  // attend encore des données doit garder ces octets et rappeler plus tard.
+  std::size_t cut(const std::uint8_t* p, std::size_t n) const {
+    if (n <= p_.min_size) return n;
+    if (n > p_.max_size) n = p_.max_size;
+    std::size_t normal = n < p_.avg_size ? n : p_.avg_size;
+    const auto& g = cdc_detail::gear;
+    const auto& gls = cdc_detail::gear_ls;
+    const std::uint64_t mask_s_ls = mask_s_ << 1, mask_l_ls = mask_l_ << 1;
+
+    std::uint64_t fp = 0;
+    std::size_t i = p_.min_size;
+    for (; i + 2 <= normal; i += 2) {
+      fp = (fp << 2) + gls[p[i]];
+      if (!(fp & mask_s_ls)) return i + 1;
+      fp += g[p[i + 1]];
+      if (!(fp & mask_s_)) return i + 2;
+    }
+    for (; i + 2 <= n; i += 2) {
+      fp = (fp << 2) + gls[p[i]];
+      if (!(fp & mask_l_ls)) return i + 1;
+      fp += g[p[i + 1]];
+      if (!(fp & mask_l_)) return i + 2;
+    }
+    return n;
+  }
+
+  // Découpe un tampon complet : on_chunk(offset, length) pour chaque chunk
+  template <typename F>
+  void split(const std::uint8_t* data, std::size_t size, F&& on_chunk) const {
+    for (std::size_t off = 0; off < size;) {
+      std::size_t len = cut(data + off, size - off);
+      on_chunk(off, len);
+      off += len;
+    }
+  }
+
+private:
+  cdc_params p_;
+  std::uint64_t mask_s_ = 0;
+  std::uint64_t mask_l_ = 0;
+};
+
+} // namespace p2p
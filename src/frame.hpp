@@ -0,0 +1,108 @@
+// ===========================================
+// FRAME.HPP
+// Protocole binaire par trames (après le handshake "HELLO")
+//
+//   | length u32 | flags u8 | [raw_length u32] | [crc u32] | payload (length octets) |
+//
+//   - les entiers sont en big-endian (ordre réseau) ;
+//   - flags & codec_mask : codec du payload (0 = brut, voir compression.hpp) ;
+//   - raw_length n'est présent que si le payload est compressé : c'est la
+//     taille après décompression (nécessaire à LZ4, vérifiée pour Zstd) ;
+//   - crc n'est présent que si flags & crc_flag : CRC32C du payload tel
+//     qu'il circule sur le fil (donc compressé le cas échéant).
+// ===========================================
+#pragma once
+
+#include "compression.hpp"
+#include "crc32c.hpp"
+#include "iobuf.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace p2p {
+
+struct frame_header {
+  static constexpr std::uint8_t codec_mask = 0x03;
+  static constexpr std::uint8_t crc_flag = 0x04;
+  static constexpr std::size_t base_size = 5;   // length + flags
+  static constexpr std::size_t max_size = 13;   // + raw_length + crc
+
+  std::uint32_t length = 0;      // octets de payload sur le fil
+  std::uint8_t flags = 0;
+  std::uint32_t raw_length = 0;  // taille décompressée (== length si brut)
+  std::uint32_t crc = 0;         // CRC32C du payload (si has_crc())
+
+  codec payload_codec() const { return static_cast<codec>(flags & codec_mask); }
+  bool compressed() const { return payload_codec() != codec::none; }
+  bool has_crc() const { return flags & crc_flag; }
+  std::size_t size() const { return size_for(flags); }
+
+  // Taille de l'en-tête déduite de l'octet de flags
+  static std::size_t size_for(std::uint8_t flags) {
+    return base_size + ((flags & codec_mask) ? 4 : 0) + ((flags & crc_flag) ? 4 : 0);
+  }
+};
+
+namespace detail {
+inline std::uint32_t load_be32(const unsigned char* p) {
+  return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) |
+         (std::uint32_t(p[2]) << 8) | std::uint32_t(p[3]);
+}
+inline void store_be32(unsigned char* p, std::uint32_t v) {
+  p[0] = static_cast<unsigned char>(v >> 24);
+  p[1] = static_cast<unsigned char>(v >> 16);
+  p[2] = static_cast<unsigned char>(v >> 8);
+  p[3] = static_cast<unsigned char>(v);
+}
+} // namespace detail
+
+// Décode un en-tête si les n octets disponibles le contiennent en entier
+inline std::optional<frame_header> decode_frame_header(const char* data, std::size_t n) {
+  if (n < frame_header::base_size) return std::nullopt;
+  auto* p = reinterpret_cast<const unsigned char*>(data);
+  frame_header h;
+  h.length = detail::load_be32(p);
+  h.flags = p[4];
+  if (n < h.size()) return std::nullopt;
+  std::size_t off = frame_header::base_size;
+  h.raw_length = h.length;
+  if (h.compressed()) {
+    h.raw_length = detail::load_be32(p + off);
+    off += 4;
+  }
+  if (h.has_crc()) h.crc = detail::load_be32(p + off);
+  return h;
+}
+
+// Préfixe `payload` de son en-tête (dans le headroom de l'iobuf si possible).
+// Avec with_crc, le CRC32C est calculé segment par segment sur l'iobuf.
+inline void prepend_frame_header(iobuf& payload, codec c, std::size_t raw_length,
+                                 bool with_crc = false) {
+  unsigned char h[frame_header::max_size];
+  std::size_t n = frame_header::base_size;
+  detail::store_be32(h, static_cast<std::uint32_t>(payload.size()));
+  h[4] = static_cast<std::uint8_t>(c) & frame_header::codec_mask;
+  if (c != codec::none) {
+    detail::store_be32(h + n, static_cast<std::uint32_t>(raw_length));
+    n += 4;
+  }
+  if (with_crc) {
+    h[4] |= frame_header::crc_flag;
+    detail::store_be32(h + n, crc32c::value_of(payload.buffers()));
+    n += 4;
+  }
+  payload.prepend(h, n);
+}
+
+// Vérifie le CRC d'une trame complète (en-tête + payload) sans la linéariser :
+// `frame` peut être une chaîne de plusieurs segments.
+inline bool verify_frame_crc(const frame_header& h, const iobuf& frame) {
+  if (!h.has_crc()) return true;
+  iobuf payload = frame.clone();
+  payload.trim_start(h.size());
+  return crc32c::value_of(payload.buffers()) == h.crc;
+}
+
+} // namespace p2p
@@ -0,0 +1,303 @@
+// ===========================================
+// HYPARVIEW.HPP
+// Appartenance au réseau de recouvrement à degré borné (HyParView)
+// Objectif : chaque nœud garde un petit nombre fixe de sessions TCP,
+//            quelle que soit la taille de l'essaim, sans jamais le
+//            partitionner, et se répare vite quand des voisins tombent.
+//
+// Deux vues :
+//   - vue active (active_size, ~log N + 1) : voisins avec une session TCP
+//     ouverte, symétrique (A voit B ⇔ B voit A). C'est elle que les
+//     protocoles de diffusion utilisent ; une panne y est détectée par la
+//     session elle-même ;
+//   - vue passive (passive_size) : adresses de réserve, sans connexion,
+//     rafraîchies par des échanges aléatoires (shuffle).
+//
+// Messages :
+//   - join → le contact prend le nouveau dans sa vue active et lance
+//     un forward_join par voisin : marche aléatoire de arwl pas ; à
+//     prwl pas, le nouveau entre dans une vue passive ; en fin de marche
+//     (ou chez un nœud qui n'a qu'un voisin) il entre dans une vue active ;
+//   - neighbor(priorité) → demande de promotion passive → active :
+//     haute priorité (le demandeur n'a plus aucun voisin) toujours
+//     acceptée, sinon seulement s'il reste une place ; neighbor_reply ;
+//   - disconnect → un voisin actif évincé pour faire de la place repasse
+//     en vue passive ;
+//   - shuffle / shuffle_reply → maintain() envoie, par une marche
+//     aléatoire de shuffle_ttl pas, soi + ka actifs + kp passifs ; le
+//     nœud d'arrivée répond par autant de ses passifs, chacun les intègre
+//     en évinçant d'abord ce qu'il vient d'envoyer.
+//
+// Réparation : une session active rompue (connection_lost) ou un message
+// impossible à livrer retire le nœud ; des passifs sont aussitôt promus,
+// un par place libre ; après un refus, un autre passif est essayé, et
+// les nœuds qui ont refusé redeviennent candidats au maintain() suivant.
+//
+// Mémoire et connexions constantes : les deux vues sont bornées, rien ne
+// dépend de la taille de l'essaim.
+//
+// Sans E/S (voir overlay.hpp) : send(to, message) ; le transport ouvre une
+// connexion temporaire si `to` n'est pas dans la vue active (réponses de
+// shuffle, neighbor) et appelle on_active(node, up) pour garder ou fermer
+// la session d'un voisin actif. Mono-thread.
+// ===========================================
+#pragma once
+
+#include "overlay.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace p2p {
+
+struct hyparview_options {
+  std::size_t active_size = 5;      // vue active (log10(N) + 1 : 10^4 nœuds)
+  std::size_t passive_size = 30;    // vue passive
+  std::uint8_t arwl = 6;            // longueur de la marche d'un forward_join
+  std::uint8_t prwl = 3;            // pas où le nouveau entre en vue passive
+  std::size_t shuffle_active = 3;   // ka : actifs envoyés par shuffle
+  std::size_t shuffle_passive = 4;  // kp : passifs envoyés par shuffle
+  std::uint8_t shuffle_ttl = 6;     // longueur de la marche d'un shuffle
+};
+
+struct hyparview_message {
+  enum kind_t : std::uint8_t { join, forward_join, neighbor, neighbor_reply, disconnect, shuffle, shuffle_reply };
+
+  kind_t kind = join;
+  node_id origin = 0;          // forward_join, shuffle : nœud à l'origine de la marche
+  std::uint8_t ttl = 0;        // forward_join, shuffle : pas restants
+  bool flag = false;           // neighbor : haute priorité ; neighbor_reply : accepté
+  std::vector<node_id> nodes;  // shuffle, shuffle_reply
+
+  // Taille sur le fil (en-tête + identifiants)
+  std::size_t wire_size() const { return 20 + 8 * nodes.size(); }
+};
+
+struct hyparview_stats {
+  std::uint64_t sent = 0;             // messages émis
+  std::uint64_t promotions = 0;       // demandes neighbor envoyées
+  std::uint64_t rejected = 0;         // demandes refusées
+  std::uint64_t failures = 0;         // voisins ou passifs perdus
+  std::uint64_t shuffles = 0;
+};
+
+class hyparview {
+public:
+  using send_fn = std::function<void(node_id to, hyparview_message msg)>;
+  using active_fn = std::function<void(node_id node, bool up)>;
+
+  hyparview(node_id self, send_fn send, hyparview_options opts = {}, active_fn on_active = {})
+    : self_(self), send_(std::move(send)), on_active_(std::move(on_active)), opts_(opts), rng_(self) {
+    active_.reserve(opts_.active_size + 1);
+    passive_.reserve(opts_.passive_size + 1);
+  }
+
+  node_id self() const { return self_; }
+  const std::vector<node_id>& active() const { return active_; }
+  const std::vector<node_id>& passive() const { return passive_; }
+  const hyparview_stats& stats() const { return stats_; }
+
+  // Octets tenus par le nœud (bornés par les options)
+  std::size_t memory_bytes() const {
+    return sizeof(*this) + 8 * (active_.capacity() + passive_.capacity() + pending_.capacity() + rejected_.capacity() +
+                              last_shuffle_.capacity());
+  }
+
+  // Entrée dans l'essaim par un nœud déjà membre
+  void join(node_id contact) {
+    if (contact == self_) return;
+    add_active(contact);
+    send(contact, {hyparview_message::join, self_, 0, false, {}});
+  }
+
+  // -------------------------------------------
+  // Messages reçus
+  // -------------------------------------------
+  void receive(node_id from, const hyparview_message& m) {
+    switch (m.kind) {
+      case hyparview_message::join:
+        add_active(from);
+        for (node_id n : active_)
+          if (n != from) send(n, {hyparview_message::forward_join, from, opts_.arwl, false, {}});
+        break;
+
+      case hyparview_message::forward_join:
+        if (m.origin == self_) break;
+        if (m.ttl == 0 || active_.size() <= 1) {
+          if (!overlay::contains(active_, m.origin)) {
+            add_active(m.origin);
+            send(m.origin, {hyparview_message::neighbor, self_, 0, true, {}});
+          }
+        } else {
+          if (m.ttl == opts_.prwl) add_passive(m.origin);
+          if (auto next = random_active_except(from, m.origin))
+            send(*next, {hyparview_message::forward_join, m.origin, std::uint8_t(m.ttl - 1), false, {}});
+          else if (!overlay::contains(active_, m.origin)) {
+            add_active(m.origin);
+            send(m.origin, {hyparview_message::neighbor, self_, 0, true, {}});
+          }
+        }
+        break;
+
+      case hyparview_message::neighbor: {
+        bool accept = overlay::contains(active_, from) || m.flag || active_.size() < opts_.active_size;
+        if (accept) add_active(from);
+        send(from, {hyparview_message::neighbor_reply, self_, 0, accept, {}});
+        break;
+      }
+
+      case hyparview_message::neighbor_reply:
+        overlay::erase_unordered(pending_, from);
+        if (m.flag) {
+          add_active(from);
+        } else {
+          ++stats_.rejected;   // reste en vue passive ; un autre est essayé
+          if (!overlay::contains(rejected_, from)) rejected_.push_back(from);
+          repair();
+        }
+        break;
+
+      case hyparview_message::disconnect:
+        if (overlay::erase_unordered(active_, from)) {
+          if (on_active_) on_active_(from, false);
+          add_passive(from);
+          repair();
+        }
+        break;
+
+      case hyparview_message::shuffle:
+        if (m.origin == self_) break;
+        if (m.ttl > 1 && active_.size() > 1) {
+          if (auto next = random_active_except(from, m.origin)) {
+            send(*next, {hyparview_message::shuffle, m.origin, std::uint8_t(m.ttl - 1), false, m.nodes});
+            break;
+          }
+        }
+        {
+          std::vector<node_id> reply = overlay::random_sample(passive_, m.nodes.size(), rng_);
+          send(m.origin, {hyparview_message::shuffle_reply, self_, 0, false, reply});
+          integrate(m.nodes, reply);
+        }
+        break;
+
+      case hyparview_message::shuffle_reply:
+        integrate(m.nodes, last_shuffle_);
+        last_shuffle_.clear();
+        break;
+    }
+  }
+
+  // Session d'un voisin actif rompue, ou message vers `node` non livré
+  void connection_lost(node_id node) {
+    bool known = overlay::erase_unordered(passive_, node) | overlay::erase_unordered(pending_, node);
+    if (overlay::erase_unordered(active_, node)) {
+      known = true;
+      if (on_active_) on_active_(node, false);
+    }
+    if (!known) return;
+    ++stats_.failures;
+    repair();
+  }
+
+  // -------------------------------------------
+  // Entretien périodique (toutes les quelques secondes)
+  // -------------------------------------------
+  void maintain() {
+    rejected_.clear();
+    repair();
+    if (active_.empty()) return;
+    node_id target = overlay::random_element(active_, rng_);
+    std::vector<node_id> nodes{self_};
+    for (node_id n : overlay::random_sample(active_, opts_.shuffle_active, rng_))
+      if (n != target) nodes.push_back(n);
+    for (node_id n : overlay::random_sample(passive_, opts_.shuffle_passive, rng_)) nodes.push_back(n);
+    last_shuffle_ = nodes;
+    ++stats_.shuffles;
+    send(target, {hyparview_message::shuffle, self_, opts_.shuffle_ttl, false, std::move(nodes)});
+  }
+
+private:
+  void send(node_id to, hyparview_message m) {
+    ++stats_.sent;
+    send_(to, std::move(m));
+  }
+
+  std::optional<node_id> random_active_except(node_id a, node_id b) {
+    std::size_t n = 0;
+    node_id pick = 0;
+    for (node_id x : active_)   // réservoir de taille 1
+      if (x != a && x != b && std::uniform_int_distribution<std::size_t>(0, n++)(rng_) == 0) pick = x;
+    if (n == 0) return std::nullopt;
+    return pick;
+  }
+
+  void add_active(node_id n) {
+    if (n == self_ || overlay::contains(active_, n)) return;
+    if (active_.size() >= opts_.active_size) {
+      node_id drop = overlay::random_element(active_, rng_);
+      overlay::erase_unordered(active_, drop);
+      if (on_active_) on_active_(drop, false);
+      send(drop, {hyparview_message::disconnect, self_, 0, false, {}});
+      add_passive(drop);
+    }
+    overlay::erase_unordered(passive_, n);
+    overlay::erase_unordered(pending_, n);
+    active_.push_back(n);
+    if (on_active_) on_active_(n, true);
+  }
+
+  void add_passive(node_id n) {
+    if (n == self_ || overlay::contains(active_, n) || overlay::contains(passive_, n)) return;
+    if (passive_.size() >= opts_.passive_size)
+      overlay::erase_unordered(passive_, overlay::random_element(passive_, rng_));
+    passive_.push_back(n);
+  }
+
+  // Passifs reçus d'un shuffle ; évince d'abord ceux que l'on vient d'envoyer
+  void integrate(const std::vector<node_id>& received, const std::vector<node_id>& sent) {
+    std::size_t next_sent = 0;
+    for (node_id n : received) {
+      if (n == self_ || overlay::contains(active_, n) || overlay::contains(passive_, n)) continue;
+      if (passive_.size() >= opts_.passive_size) {
+        while (next_sent < sent.size() && !overlay::contains(passive_, sent[next_sent])) ++next_sent;
+        if (next_sent < sent.size()) overlay::erase_unordered(passive_, sent[next_sent++]);
+        else overlay::erase_unordered(passive_, overlay::random_element(passive_, rng_));
+      }
+      passive_.push_back(n);
+    }
+  }
+
+  // Une demande neighbor par place libre de la vue active
+  void repair() {
+    while (active_.size() + pending_.size() < opts_.active_size) {
+      std::optional<node_id> candidate;
+      std::size_t n = 0;
+      for (node_id p : passive_)
+        if (!overlay::contains(pending_, p) && !overlay::contains(rejected_, p) && std::uniform_int_distribution<std::size_t>(0, n++)(rng_) == 0)
+          candidate = p;
+      if (!candidate) return;
+      pending_.push_back(*candidate);
+      ++stats_.promotions;
+      send(*candidate, {hyparview_message::neighbor, self_, 0, active_.empty(), {}});
+    }
+  }
+
+  node_id self_;
+  send_fn send_;
+  active_fn on_active_;
+  hyparview_options opts_;
+  overlay::rng rng_;
+  std::vector<node_id> active_;
+  std::vector<node_id> passive_;
+  std::vector<node_id> pending_;        // demandes neighbor en vol
+  std::vector<node_id> rejected_;       // refus depuis le dernier maintain()
+  std::vector<node_id> last_shuffle_;   // envoyés au dernier shuffle
+  hyparview_stats stats_;
+};
+
+} // namespace p2p
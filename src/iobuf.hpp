@@ -0,0 +1,279 @@
+// ===========================================
+// IOBUF.HPP
+// Tampon chaîné à compteur de références (inspiré de folly::IOBuf)
+// Objectif : découper, préfixer, partager et transférer des données
+//            SANS les recopier.
+//
+// Un iobuf est une suite de segments. Chaque segment est une fenêtre
+// [offset, offset + length) sur un "slab" (bloc mémoire partagé) :
+//
+//     slab :  | headroom | données visibles | tailroom |
+//
+//   - clone()  : nouvelle chaîne qui partage les mêmes slabs ;
+//   - split(n) : détache les n premiers octets (aucune copie) ;
+//   - prepend  : écrit un en-tête dans le headroom si le slab est à nous ;
+//   - buffers(): vue directement utilisable par asio::async_write
+//                (scatter/gather, un const_buffer par segment).
+//
+// Règle de sécurité : on n'écrit jamais dans un slab partagé (use_count > 1) ;
+// dans ce cas un nouveau segment est ajouté à la place.
+// ===========================================
+#pragma once
+
+#include <asio/buffer.hpp>
+
+#include <algorithm>    // std::min, std::max
+#include <cstddef>      // std::size_t
+#include <cstring>      // std::memcpy
+#include <iterator>     // std::forward_iterator_tag
+#include <memory>       // std::shared_ptr
+#include <string>
+#include <vector>
+
+namespace p2p {
+
+class iobuf {
+public:
+  // Taille minimale d'un slab alloué par append() / prepend()
+  static constexpr std::size_t min_slab = 4096;
+
+  struct segment {
+    std::shared_ptr<char[]> slab;  // bloc partagé (vide = données statiques)
+    char* base = nullptr;          // début du slab
+    std::size_t capacity = 0;      // taille totale du slab
+    std::size_t offset = 0;        // début des données visibles
+    std::size_t length = 0;        // nombre d'octets visibles
+
+    char* data() const { return base + offset; }
+    std::size_t headroom() const { return offset; }
+    std::size_t tailroom() const { return capacity - offset - length; }
+    // Écriture autorisée seulement si personne d'autre ne voit ce slab
+    bool writable() const { return slab && slab.use_count() == 1; }
+  };
+
+  iobuf() = default;
+
+  // -------------------------------------------
+  // Fabriques
+  // -------------------------------------------
+
+  // Slab neuf, vide, avec `headroom` octets réservés devant
+  static iobuf create(std::size_t capacity, std::size_t headroom = 0) {
+    iobuf b;
+    auto slab = std::make_shared_for_overwrite<char[]>(capacity + headroom);
+    char* base = slab.get();
+    b.segs_.push_back(segment{std::move(slab), base, capacity + headroom, headroom, 0});
+    return b;
+  }
+
+  // Copie de n octets dans un slab neuf
+  static iobuf copy(const void* data, std::size_t n, std::size_t headroom = 0) {
+    iobuf b = create(n, headroom);
+    std::memcpy(b.segs_.back().data(), data, n);
+    b.segs_.back().length = n;
+    b.size_ = n;
+    return b;
+  }
+
+  // Prend un slab existant (ex. bloc du buffer_pool) sans copie
+  static iobuf wrap(std::shared_ptr<char[]> slab, std::size_t capacity,
+                    std::size_t offset, std::size_t length) {
+    iobuf b;
+    char* base = slab.get();
+    b.segs_.push_back(segment{std::move(slab), base, capacity, offset, length});
+    b.size_ = length;
+    return b;
+  }
+
+  // Données statiques (littéraux, tables) : ni copie ni allocation
+  static iobuf wrap_static(const void* data, std::size_t n) {
+    iobuf b;
+    char* p = const_cast<char*>(static_cast<const char*>(data));
+    b.segs_.push_back(segment{{}, p, n, 0, n});
+    b.size_ = n;
+    return b;
+  }
+
+  // -------------------------------------------
+  // Observateurs
+  // -------------------------------------------
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  std::size_t segment_count() const { return segs_.size(); }
+  const std::vector<segment>& segments() const { return segs_; }
+
+  std::size_t headroom() const {
+    return (!segs_.empty() && segs_.front().writable()) ? segs_.front().headroom() : 0;
+  }
+  std::size_t tailroom() const {
+    return (!segs_.empty() && segs_.back().writable()) ? segs_.back().tailroom() : 0;
+  }
+
+  // -------------------------------------------
+  // Partage / découpage (aucune copie de données)
+  // -------------------------------------------
+  iobuf clone() const { return *this; }
+
+  // Détache et renvoie les n premiers octets ; *this garde le reste
+  iobuf split(std::size_t n) {
+    iobuf head;
+    n = std::min(n, size_);
+    std::size_t i = 0;
+    while (n > 0) {
+      segment& s = segs_[i];
+      if (s.length <= n) {
+        head.segs_.push_back(std::move(s));
+        n -= head.segs_.back().length;
+        ++i;
+      } else {
+        segment front = s;       // partage le slab
+        front.length = n;
+        s.offset += n;
+        s.length -= n;
+        head.segs_.push_back(std::move(front));
+        n = 0;
+      }
+    }
+    segs_.erase(segs_.begin(), segs_.begin() + static_cast<std::ptrdiff_t>(i));
+    for (const auto& s : head.segs_) head.size_ += s.length;
+    size_ -= head.size_;
+    return head;
+  }
+
+  void trim_start(std::size_t n) { split(n); }
+
+  void trim_end(std::size_t n) {
+    n = std::min(n, size_);
+    size_ -= n;
+    while (n > 0) {
+      segment& s = segs_.back();
+      std::size_t cut = std::min(n, s.length);
+      s.length -= cut;
+      n -= cut;
+      if (s.length == 0) segs_.pop_back();
+    }
+  }
+
+  void clear() {
+    segs_.clear();
+    size_ = 0;
+  }
+
+  // -------------------------------------------
+  // Ajouts
+  // -------------------------------------------
+
+  // Chaîne `other` à la fin (transfert des segments, aucune copie)
+  void append(iobuf&& other) {
+    for (auto& s : other.segs_)
+      if (s.length) segs_.push_back(std::move(s));
+    size_ += other.size_;
+    other.clear();
+  }
+  void append(const iobuf& other) { append(other.clone()); }
+
+  // Copie n octets à la fin : dans le tailroom si possible, sinon slab neuf
+  void append(const void* data, std::size_t n) {
+    auto* p = static_cast<const char*>(data);
+    if (std::size_t room = std::min(tailroom(), n); room > 0) {
+      segment& s = segs_.back();
+      std::memcpy(s.data() + s.length, p, room);
+      s.length += room;
+      size_ += room;
+      p += room;
+      n -= room;
+    }
+    if (n == 0) return;
+    iobuf tail = create(std::max(n, min_slab));
+    std::memcpy(tail.segs_.back().data(), p, n);
+    tail.segs_.back().length = n;
+    tail.size_ = n;
+    append(std::move(tail));
+  }
+  void append(const std::string& s) { append(s.data(), s.size()); }
+
+  // Copie n octets au début : dans le headroom si possible, sinon slab neuf
+  void prepend(const void* data, std::size_t n) {
+    if (n == 0) return;
+    if (headroom() >= n) {
+      segment& s = segs_.front();
+      s.offset -= n;
+      s.length += n;
+      std::memcpy(s.data(), data, n);
+    } else {
+      // Nouveau slab : on garde de la place devant pour les en-têtes suivants
+      std::size_t room = std::max(n, min_slab);
+      auto slab = std::make_shared_for_overwrite<char[]>(room);
+      char* base = slab.get();
+      segment s{std::move(slab), base, room, room - n, n};
+      std::memcpy(s.data(), data, n);
+      segs_.insert(segs_.begin(), std::move(s));
+    }
+    size_ += n;
+  }
+
+  // Zone écrivable en fin de chaîne (pour un read_some direct), puis commit()
+  asio::mutable_buffer prepare_tail(std::size_t min_room = min_slab) {
+    if (tailroom() < min_room) {
+      iobuf fresh = create(std::max(min_room, min_slab));
+      segs_.push_back(std::move(fresh.segs_.back()));
+    }
+    segment& s = segs_.back();
+    return asio::buffer(s.data() + s.length, s.tailroom());
+  }
+  void commit(std::size_t n) {
+    segs_.back().length += n;
+    size_ += n;
+  }
+
+  // -------------------------------------------
+  // Conversion
+  // -------------------------------------------
+
+  // Vue "ConstBufferSequence" d'Asio : un const_buffer par segment.
+  // La vue ne possède rien : l'iobuf doit vivre jusqu'à la fin de l'écriture.
+  class const_sequence {
+  public:
+    class iterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = asio::const_buffer;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const asio::const_buffer*;
+      using reference = asio::const_buffer;
+
+      iterator() = default;
+      explicit iterator(const segment* s) : s_(s) {}
+      asio::const_buffer operator*() const { return asio::const_buffer(s_->data(), s_->length); }
+      iterator& operator++() { ++s_; return *this; }
+      iterator operator++(int) { iterator t = *this; ++s_; return t; }
+      bool operator==(const iterator&) const = default;
+
+    private:
+      const segment* s_ = nullptr;
+    };
+
+    explicit const_sequence(const std::vector<segment>& segs) : segs_(&segs) {}
+    iterator begin() const { return iterator(segs_->data()); }
+    iterator end() const { return iterator(segs_->data() + segs_->size()); }
+
+  private:
+    const std::vector<segment>* segs_;
+  };
+
+  const_sequence buffers() const { return const_sequence(segs_); }
+
+  // Copie linéaire (journalisation, tests manuels) : à éviter sur le chemin chaud
+  std::string to_string() const {
+    std::string out;
+    out.reserve(size_);
+    for (const auto& s : segs_) out.append(s.data(), s.length);
+    return out;
+  }
+
+private:
+  std::vector<segment> segs_;
+  std::size_t size_ = 0;
+};
+
+} // namespace p2p
@@ -0,0 +1,74 @@
+// ===========================================
+// LINE_LIMITS.HPP
+// Limites de taille des lignes reçues + débordement sur disque
+// Objectif : un pair qui envoie des gigaoctets sans '\n' ne doit pas
+//            faire grossir la mémoire du serveur.
+//
+//   - memory_limit : au-delà, la ligne en cours n'est plus gardée en
+//                    mémoire mais écrite par morceaux dans un fichier
+//                    temporaire (spill_file) ;
+//   - max_line     : au-delà, la ligne est refusée et la connexion fermée ;
+//   - max_frame    : taille maximale d'une trame binaire, avant comme après
+//                    décompression. Une trame incomplète reste en mémoire
+//                    (pas de débordement sur disque) : la limite est petite.
+// ===========================================
+#pragma once
+
+#include <cerrno>       // errno
+#include <cstddef>      // std::size_t
+#include <cstdio>       // std::FILE, std::tmpfile
+#include <cstdlib>      // std::strtoull
+#include <memory>       // std::unique_ptr
+#include <system_error> // std::system_error
+
+namespace p2p {
+
+struct line_limits {
+  std::size_t memory_limit = 64 * 1024;        // 64 KiB gardés en RAM au maximum
+  std::size_t max_line = 64 * 1024 * 1024;     // 64 MiB par ligne au maximum
+  std::size_t max_frame = 1024 * 1024;         // 1 MiB par trame au maximum
+
+  // Lecture depuis la ligne de commande : argv[first] = memory_limit,
+  // argv[first + 1] = max_line (les deux optionnels).
+  static line_limits from_args(int argc, char** argv, int first) {
+    line_limits l;
+    if (argc > first) l.memory_limit = std::strtoull(argv[first], nullptr, 10);
+    if (argc > first + 1) l.max_line = std::strtoull(argv[first + 1], nullptr, 10);
+    if (l.max_line < l.memory_limit) l.max_line = l.memory_limit;
+    return l;
+  }
+};
+
+// -------------------------------------------
+// Fichier temporaire anonyme (supprimé automatiquement à la fermeture).
+// On y écrit en séquence, puis on relit depuis le début.
+// -------------------------------------------
+class spill_file {
+public:
+  spill_file() : file_(std::tmpfile()) {
+    if (!file_) throw std::system_error(errno, std::generic_category(), "tmpfile");
+  }
+
+  void append(const char* data, std::size_t n) {
+    if (n && std::fwrite(data, 1, n, file_.get()) != n)
+      throw std::system_error(errno, std::generic_category(), "spill write");
+    size_ += n;
+  }
+
+  // Se replace au début pour la relecture
+  void rewind() { std::rewind(file_.get()); }
+
+  // Lit au plus n octets (0 = fin du fichier)
+  std::size_t read(char* dst, std::size_t n) { return std::fread(dst, 1, n, file_.get()); }
+
+  std::size_t size() const { return size_; }
+
+private:
+  struct closer {
+    void operator()(std::FILE* f) const { std::fclose(f); }
+  };
+  std::unique_ptr<std::FILE, closer> file_;
+  std::size_t size_ = 0;
+};
+
+} // namespace p2p
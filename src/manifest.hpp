@@ -0,0 +1,566 @@
+// ===========================================
+// MANIFEST.HPP
+// Manifeste d'une collection partagée (fichiers → chunks), lu sur place
+// Objectif : ouvrir le manifeste d'une collection de dizaines de millions
+//            de fichiers en quelques microsecondes et sans mémoire propre :
+//            aucun parsing, aucune structure reconstruite sur le tas.
+//
+// Format binaire plat, versionné, little-endian ; uniquement des positions
+// (jamais de pointeurs), sections alignées sur 8 octets :
+//
+//   en-tête (128 octets)   magic, version, nombre d'entrées, position et
+//                          taille de chaque section, CRC32C de l'en-tête
+//   fichiers               file_entry[files]   : chemin (position, longueur
+//                          dans la table des chaînes), taille, chunks
+//                          [first_chunk, first_chunk + chunk_count)
+//   chunks                 chunk_entry[chunks] : empreinte, position dans le
+//                          fichier, longueur, fichier propriétaire
+//   chaînes                chemins concaténés (sans terminateur)
+//   index des chemins      table de hachage à adressage ouvert
+//   index des empreintes   idem, première occurrence de chaque empreinte
+//
+// Les index sont des cases de 8 octets : (étiquette 32 bits << 32) |
+// (numéro d'entrée + 1), 0 = vide ; capacité en puissance de deux, taux de
+// remplissage ≤ 0,75, sondage linéaire. L'étiquette évite de toucher
+// l'entrée (et sa page) pour les collisions de case.
+//
+// manifest_writer : écriture en flux (add_file au fil du parcours de la
+// collection) ; seuls des tampons d'1 Mio sont en mémoire. Les entrées de
+// fichiers vont directement dans <path>.tmp, chunks et chaînes dans deux
+// fichiers voisins, concaténés par finish() (copy_file_range) ; les index
+// sont ensuite construits directement dans la projection du fichier final,
+// qui est forcé sur disque puis renommé atomiquement.
+//
+// manifest : mmap en lecture seule ; l'ouverture ne vérifie que l'en-tête
+// (CRC, sections dans le fichier). Les entrées sont contrôlées à l'accès
+// (bornes), un fichier corrompu lève une exception au lieu de lire ailleurs.
+// Thread-safe en lecture (rien n'est modifié après l'ouverture).
+//
+// Version : un lecteur refuse une version plus récente que la sienne ;
+// header_size permet d'allonger l'en-tête sans changer de version.
+// ===========================================
+#pragma once
+
+#include "chunk_store.hpp"   // chunk_ref
+#include "crc32c.hpp"
+#include "sha256.hpp"        // digest
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace p2p {
+
+namespace manifest_format {
+
+inline constexpr std::uint64_t magic = 0x46494e414d503250ull;   // "P2PMANIF"
+inline constexpr std::uint32_t version = 1;
+
+struct header {
+  std::uint64_t magic;
+  std::uint32_t version;
+  std::uint32_t header_size;
+  std::uint64_t files;
+  std::uint64_t chunks;
+  std::uint64_t files_offset;
+  std::uint64_t chunks_offset;
+  std::uint64_t strings_offset;
+  std::uint64_t strings_size;
+  std::uint64_t path_index_offset;
+  std::uint64_t path_slots;
+  std::uint64_t chunk_index_offset;
+  std::uint64_t chunk_slots;
+  std::uint64_t total_size;
+  std::uint32_t crc;            // CRC32C de l'en-tête (crc = 0)
+  std::uint8_t pad[20];
+};
+static_assert(sizeof(header) == 128);
+
+struct file_entry {
+  std::uint64_t path_offset;    // dans la section des chaînes
+  std::uint32_t path_length;
+  std::uint32_t chunk_count;
+  std::uint64_t size;
+  std::uint64_t first_chunk;
+};
+static_assert(sizeof(file_entry) == 32);
+
+struct chunk_entry {
+  digest id;
+  std::uint64_t offset;         // position du chunk dans son fichier
+  std::uint32_t length;
+  std::uint32_t file;
+};
+static_assert(sizeof(chunk_entry) == 48);
+
+// Hachage des chemins (fait partie du format) : FNV-1a 64 bits puis
+// mélange final (splitmix64) pour que les bits faibles soient uniformes
+inline std::uint64_t path_hash(std::string_view path) {
+  std::uint64_t h = 0xcbf29ce484222325ull;
+  for (unsigned char c : path) {
+    h ^= c;
+    h *= 0x100000001b3ull;
+  }
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ull;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebull;
+  h ^= h >> 31;
+  return h;
+}
+
+// Les empreintes sont uniformes : octets 0..7 pour la case, 8..11 pour l'étiquette
+inline std::uint64_t chunk_hash(const digest& id) {
+  std::uint64_t lo;
+  std::uint32_t tag;
+  std::memcpy(&lo, id.data(), sizeof lo);
+  std::memcpy(&tag, id.data() + 8, sizeof tag);
+  return (std::uint64_t(tag) << 32) | (lo & 0xffffffffull);
+}
+
+inline std::uint64_t slots_for(std::uint64_t entries) {
+  std::uint64_t n = 16;
+  while (n * 3 < entries * 4) n <<= 1;   // ≤ 0,75
+  return n;
+}
+
+inline std::uint64_t align8(std::uint64_t n) { return (n + 7) & ~std::uint64_t(7); }
+
+} // namespace manifest_format
+
+// Vue d'une entrée de fichier (pointe dans la projection)
+struct manifest_file {
+  std::uint32_t index = 0;
+  std::string_view path;
+  std::uint64_t size = 0;
+  std::span<const manifest_format::chunk_entry> chunks;
+};
+
+// ===========================================
+// Lecture : projection en place
+// ===========================================
+class manifest {
+public:
+  explicit manifest(const std::string& path) : path_(path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) fail("open " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      int err = errno;
+      ::close(fd);
+      errno = err;
+      fail("fstat " + path);
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ < sizeof(manifest_format::header)) {
+      ::close(fd);
+      throw std::runtime_error("manifest: truncated " + path);
+    }
+    void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    int err = errno;
+    ::close(fd);   // la projection garde le fichier ouvert
+    errno = err;
+    if (p == MAP_FAILED) fail("mmap " + path);
+    ::madvise(p, size_, MADV_RANDOM);   // recherches dispersées : pas de lecture anticipée
+    base_ = static_cast<const char*>(p);
+    try {
+      validate();
+    } catch (...) {
+      ::munmap(p, size_);
+      throw;
+    }
+  }
+
+  manifest(const manifest&) = delete;
+  manifest& operator=(const manifest&) = delete;
+
+  ~manifest() { ::munmap(const_cast<char*>(base_), size_); }
+
+  std::uint32_t version() const { return header_->version; }
+  std::size_t file_count() const { return static_cast<std::size_t>(header_->files); }
+  std::size_t chunk_count() const { return static_cast<std::size_t>(header_->chunks); }
+  std::size_t mapped_bytes() const { return size_; }
+
+  manifest_file file(std::size_t i) const {
+    if (i >= header_->files) throw std::out_of_range("manifest: file index");
+    const auto& e = files_[i];
+    if (e.path_offset > header_->strings_size || e.path_length > header_->strings_size - e.path_offset ||
+        e.first_chunk > header_->chunks || e.chunk_count > header_->chunks - e.first_chunk)
+      throw std::runtime_error("manifest: corrupt file entry in " + path_);
+    manifest_file f;
+    f.index = static_cast<std::uint32_t>(i);
+    f.path = std::string_view(strings_ + e.path_offset, e.path_length);
+    f.size = e.size;
+    f.chunks = {chunks_ + e.first_chunk, e.chunk_count};
+    return f;
+  }
+
+  const manifest_format::chunk_entry& chunk(std::size_t i) const {
+    if (i >= header_->chunks) throw std::out_of_range("manifest: chunk index");
+    return chunks_[i];
+  }
+
+  // Fichier par chemin
+  std::optional<manifest_file> find(std::string_view path) const {
+    std::uint64_t h = manifest_format::path_hash(path);
+    std::uint64_t mask = header_->path_slots - 1;
+    for (std::uint64_t i = h & mask, probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+      std::uint64_t s = path_slots_[i];
+      if (s == 0) return std::nullopt;
+      if ((s >> 32) != (h >> 32)) continue;
+      manifest_file f = file(entry_of(s, header_->files));
+      if (f.path == path) return f;
+    }
+    return std::nullopt;
+  }
+
+  // Chunk par empreinte (première occurrence dans la collection)
+  const manifest_format::chunk_entry* find_chunk(const digest& id) const {
+    std::uint64_t h = manifest_format::chunk_hash(id);
+    std::uint64_t mask = header_->chunk_slots - 1;
+    for (std::uint64_t i = h & mask, probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+      std::uint64_t s = chunk_slots_[i];
+      if (s == 0) return nullptr;
+      if ((s >> 32) != (h >> 32)) continue;
+      const auto& c = chunks_[entry_of(s, header_->chunks)];
+      if (c.id == id) return &c;
+    }
+    return nullptr;
+  }
+
+  template <class F>
+  void for_each_file(F&& f) const {
+    for (std::size_t i = 0; i < file_count(); ++i) f(file(i));
+  }
+
+private:
+  [[noreturn]] static void fail(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+  }
+
+  std::size_t entry_of(std::uint64_t slot, std::uint64_t count) const {
+    std::uint64_t e = (slot & 0xffffffffull) - 1;
+    if (e >= count) throw std::runtime_error("manifest: corrupt index in " + path_);
+    return static_cast<std::size_t>(e);
+  }
+
+  // En-tête seulement : O(1), rien d'autre n'est lu
+  void validate() {
+    using namespace manifest_format;
+    header_ = reinterpret_cast<const header*>(base_);
+    header h = *header_;
+    auto corrupt = [&](const char* why) { throw std::runtime_error("manifest: " + std::string(why) + " " + path_); };
+    if (h.magic != manifest_format::magic) corrupt("not a manifest");
+    if (h.version > manifest_format::version) corrupt("unsupported version in");
+    if (h.header_size < sizeof(header) || h.header_size > size_) corrupt("bad header in");
+    std::uint32_t stored = h.crc;
+    h.crc = 0;
+    if (crc32c::value(&h, sizeof h) != stored) corrupt("header checksum mismatch in");
+    if (h.total_size != size_) corrupt("truncated");
+    auto section = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t item) {
+      if (offset % 8 || offset < h.header_size || offset > size_ || count > (size_ - offset) / item)
+        corrupt("section out of bounds in");
+    };
+    section(h.files_offset, h.files, sizeof(file_entry));
+    section(h.chunks_offset, h.chunks, sizeof(chunk_entry));
+    section(h.path_index_offset, h.path_slots, 8);
+    section(h.chunk_index_offset, h.chunk_slots, 8);
+    if (h.strings_offset < h.header_size || h.strings_offset > size_ || h.strings_size > size_ - h.strings_offset)
+      corrupt("section out of bounds in");
+    auto pow2 = [](std::uint64_t n) { return n != 0 && (n & (n - 1)) == 0; };
+    if (!pow2(h.path_slots) || !pow2(h.chunk_slots) || h.files > 0xffffffffull || h.chunks > 0xffffffffull)
+      corrupt("bad index geometry in");
+    files_ = reinterpret_cast<const file_entry*>(base_ + h.files_offset);
+    chunks_ = reinterpret_cast<const chunk_entry*>(base_ + h.chunks_offset);
+    strings_ = base_ + h.strings_offset;
+    path_slots_ = reinterpret_cast<const std::uint64_t*>(base_ + h.path_index_offset);
+    chunk_slots_ = reinterpret_cast<const std::uint64_t*>(base_ + h.chunk_index_offset);
+  }
+
+  std::string path_;
+  const char* base_ = nullptr;
+  std::size_t size_ = 0;
+  const manifest_format::header* header_ = nullptr;
+  const manifest_format::file_entry* files_ = nullptr;
+  const manifest_format::chunk_entry* chunks_ = nullptr;
+  const char* strings_ = nullptr;
+  const std::uint64_t* path_slots_ = nullptr;
+  const std::uint64_t* chunk_slots_ = nullptr;
+};
+
+// ===========================================
+// Écriture en flux
+// ===========================================
+class manifest_writer {
+public:
+  explicit manifest_writer(std::string path)
+    : path_(std::move(path)),
+      tmp_path_(path_ + ".tmp"),
+      files_(tmp_path_, sizeof(manifest_format::header)),
+      chunks_(tmp_path_ + ".chunks", 0),
+      strings_(tmp_path_ + ".strings", 0) {}
+
+  manifest_writer(const manifest_writer&) = delete;
+  manifest_writer& operator=(const manifest_writer&) = delete;
+
+  // Abandon (finish() jamais appelé ou en échec) : rien ne reste sur disque
+  ~manifest_writer() {
+    if (!finished_) ::unlink(tmp_path_.c_str());
+  }
+
+  // Ajoute un fichier et sa recette ; renvoie son numéro d'entrée
+  std::uint32_t add_file(std::string_view path, std::uint64_t size, std::span<const chunk_ref> chunks) {
+    if (finished_) throw std::logic_error("manifest_writer: already finished");
+    if (path.size() > 0xffffffffull || chunks.size() > 0xffffffffull)
+      throw std::length_error("manifest_writer: entry too large");
+    if (files_count_ >= 0xffffffffull || chunks_count_ + chunks.size() > 0xffffffffull)
+      throw std::length_error("manifest_writer: too many entries");
+    auto index = static_cast<std::uint32_t>(files_count_);
+    manifest_format::file_entry e{};
+    e.path_offset = strings_.written();
+    e.path_length = static_cast<std::uint32_t>(path.size());
+    e.chunk_count = static_cast<std::uint32_t>(chunks.size());
+    e.size = size;
+    e.first_chunk = chunks_count_;
+    files_.append(&e, sizeof e);
+    strings_.append(path.data(), path.size());
+    std::uint64_t offset = 0;
+    for (const chunk_ref& c : chunks) {
+      manifest_format::chunk_entry ce{};
+      ce.id = c.id;
+      ce.offset = offset;
+      ce.length = c.size;
+      ce.file = index;
+      chunks_.append(&ce, sizeof ce);
+      offset += c.size;
+    }
+    ++files_count_;
+    chunks_count_ += chunks.size();
+    return index;
+  }
+
+  std::size_t file_count() const { return static_cast<std::size_t>(files_count_); }
+  std::size_t chunk_count() const { return static_cast<std::size_t>(chunks_count_); }
+
+  // Concatène les sections, construit les index, force sur disque, renomme.
+  // Un chemin en double lève std::invalid_argument (rien n'est publié).
+  void finish() {
+    using namespace manifest_format;
+    if (finished_) throw std::logic_error("manifest_writer: already finished");
+    header h{};
+    h.magic = magic;
+    h.version = version;
+    h.header_size = sizeof(header);
+    h.files = files_count_;
+    h.chunks = chunks_count_;
+    h.files_offset = sizeof(header);
+    h.chunks_offset = h.files_offset + files_count_ * sizeof(file_entry);
+    h.strings_offset = h.chunks_offset + chunks_count_ * sizeof(chunk_entry);
+    h.strings_size = strings_.written();
+    h.path_index_offset = align8(h.strings_offset + h.strings_size);
+    h.path_slots = slots_for(files_count_);
+    h.chunk_index_offset = h.path_index_offset + h.path_slots * 8;
+    h.chunk_slots = slots_for(chunks_count_);
+    h.total_size = h.chunk_index_offset + h.chunk_slots * 8;
+
+    files_.flush();
+    chunks_.flush();
+    strings_.flush();
+    chunks_.copy_to(files_.fd, h.chunks_offset);
+    strings_.copy_to(files_.fd, h.strings_offset);
+    chunks_.close_and_remove();
+    strings_.close_and_remove();
+    if (::ftruncate(files_.fd, static_cast<off_t>(h.total_size)) != 0)   // index creux : cases vides à zéro
+      fail("ftruncate " + tmp_path_);
+
+    void* p = ::mmap(nullptr, h.total_size, PROT_READ | PROT_WRITE, MAP_SHARED, files_.fd, 0);
+    if (p == MAP_FAILED) fail("mmap " + tmp_path_);
+    char* base = static_cast<char*>(p);
+    try {
+      build_indexes(base, h);
+    } catch (...) {
+      ::munmap(p, h.total_size);
+      throw;
+    }
+    h.crc = crc32c::value(&h, sizeof h);
+    std::memcpy(base, &h, sizeof h);
+    int rc = ::msync(p, h.total_size, MS_SYNC);
+    int err = errno;
+    ::munmap(p, h.total_size);
+    errno = err;
+    if (rc != 0) fail("msync " + tmp_path_);
+    if (::fsync(files_.fd) != 0) fail("fsync " + tmp_path_);
+    files_.close();
+    if (::rename(tmp_path_.c_str(), path_.c_str()) != 0) fail("rename " + tmp_path_);
+    finished_ = true;
+  }
+
+private:
+  [[noreturn]] static void fail(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+  }
+
+  // Section écrite en flux : tampon d'1 Mio, pwrite à la suite
+  struct section {
+    section(std::string p, std::uint64_t start) : path(std::move(p)), base(start) {
+      fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+      if (fd < 0) fail("open " + path);
+      buffer.reserve(buffer_size);
+    }
+    section(const section&) = delete;
+    section& operator=(const section&) = delete;
+    ~section() {
+      if (fd >= 0) close_and_remove();
+    }
+
+    std::uint64_t written() const { return flushed + buffer.size(); }
+
+    void append(const void* p, std::size_t n) {
+      const char* c = static_cast<const char*>(p);
+      if (buffer.size() + n > buffer_size) flush();
+      if (n > buffer_size) {
+        write_at(c, n, base + flushed);
+        flushed += n;
+        return;
+      }
+      buffer.insert(buffer.end(), c, c + n);
+    }
+
+    void flush() {
+      write_at(buffer.data(), buffer.size(), base + flushed);
+      flushed += buffer.size();
+      buffer.clear();
+    }
+
+    void write_at(const char* p, std::size_t n, std::uint64_t at) {
+      while (n > 0) {
+        ssize_t w = ::pwrite(fd, p, n, static_cast<off_t>(at));
+        if (w < 0) {
+          if (errno == EINTR) continue;
+          fail("pwrite " + path);
+        }
+        p += w;
+        n -= static_cast<std::size_t>(w);
+        at += static_cast<std::uint64_t>(w);
+      }
+    }
+
+    // Copie la section (déjà vidée) dans out à partir de at, sans passer
+    // par l'espace utilisateur quand le noyau le permet
+    void copy_to(int out, std::uint64_t at) {
+      auto in_off = static_cast<off_t>(base);
+      auto out_off = static_cast<off_t>(at);
+      std::uint64_t left = flushed;
+      while (left > 0) {
+        ssize_t n = ::copy_file_range(fd, &in_off, out, &out_off, left, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;   // EXDEV, ENOSYS... : copie classique ci-dessous
+        left -= static_cast<std::uint64_t>(n);
+      }
+      std::vector<char> buf(left ? buffer_size : 0);
+      while (left > 0) {
+        ssize_t n = ::pread(fd, buf.data(), std::min<std::uint64_t>(left, buf.size()), in_off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) fail("pread " + path);
+        std::size_t got = static_cast<std::size_t>(n);
+        std::uint64_t dst = static_cast<std::uint64_t>(out_off);
+        for (std::size_t done = 0; done < got;) {
+          ssize_t w = ::pwrite(out, buf.data() + done, got - done, static_cast<off_t>(dst + done));
+          if (w < 0) {
+            if (errno == EINTR) continue;
+            fail("pwrite " + path);
+          }
+          done += static_cast<std::size_t>(w);
+        }
+        in_off += n;
+        out_off += n;
+        left -= got;
+      }
+    }
+
+    void close() {
+      ::close(fd);
+      fd = -1;
+    }
+
+    void close_and_remove() {
+      close();
+      ::unlink(path.c_str());
+    }
+
+    static constexpr std::size_t buffer_size = 1 << 20;
+    std::string path;
+    std::uint64_t base;          // position de la section dans son fichier
+    std::uint64_t flushed = 0;
+    std::vector<char> buffer;
+    int fd = -1;
+  };
+
+  // Index construits dans la projection : parcours séquentiel des entrées,
+  // écritures dispersées dans les tables (en cache de pages, pas sur le tas)
+  void build_indexes(char* base, const manifest_format::header& h) {
+    using namespace manifest_format;
+    const auto* files = reinterpret_cast<const file_entry*>(base + h.files_offset);
+    const auto* chunks = reinterpret_cast<const chunk_entry*>(base + h.chunks_offset);
+    const char* strings = base + h.strings_offset;
+    auto* path_slots = reinterpret_cast<std::uint64_t*>(base + h.path_index_offset);
+    auto* chunk_slots = reinterpret_cast<std::uint64_t*>(base + h.chunk_index_offset);
+    auto path_of = [&](std::uint64_t i) {
+      return std::string_view(strings + files[i].path_offset, files[i].path_length);
+    };
+
+    std::uint64_t mask = h.path_slots - 1;
+    for (std::uint64_t f = 0; f < h.files; ++f) {
+      std::string_view path = path_of(f);
+      std::uint64_t hash = path_hash(path);
+      std::uint64_t i = hash & mask;
+      for (; path_slots[i] != 0; i = (i + 1) & mask) {
+        std::uint64_t s = path_slots[i];
+        if ((s >> 32) == (hash >> 32) && path_of((s & 0xffffffffull) - 1) == path)
+          throw std::invalid_argument("manifest_writer: duplicate path " + std::string(path));
+      }
+      path_slots[i] = (hash & ~std::uint64_t(0xffffffff)) | (f + 1);
+    }
+
+    mask = h.chunk_slots - 1;
+    for (std::uint64_t c = 0; c < h.chunks; ++c) {
+      std::uint64_t hash = chunk_hash(chunks[c].id);
+      std::uint64_t i = hash & mask;
+      bool seen = false;
+      for (; chunk_slots[i] != 0; i = (i + 1) & mask) {
+        std::uint64_t s = chunk_slots[i];
+        if ((s >> 32) == (hash >> 32) && chunks[(s & 0xffffffffull) - 1].id == chunks[c].id) {
+          seen = true;   // chunk partagé : l'index garde la première occurrence
+          break;
+        }
+      }
+      if (!seen) chunk_slots[i] = (hash & ~std::uint64_t(0xffffffff)) | (c + 1);
+    }
+  }
+
+  std::string path_;
+  std::string tmp_path_;
+  section files_;      // directement dans <path>.tmp, après l'en-tête
+  section chunks_;
+  section strings_;
+  std::uint64_t files_count_ = 0;
+  std::uint64_t chunks_count_ = 0;
+  bool finished_ = false;
+};
+
+} // namespace p2p
@@ -0,0 +1,545 @@
+// ===========================================
+// MESSAGE_QUEUE.HPP
+// File d'attente persistante des messages pour les pairs hors ligne
+// Objectif : un message adressé à un pair momentanément déconnecté n'est
+//            plus perdu ; il attend sur disque et part dès son retour.
+//
+// Journal segmenté, en ajout seul, dans un répertoire :
+//   segment-<n:016x>.log, préalloué (fallocate) à segment_size octets et
+//   projeté en lecture (mmap). Enregistrements alignés sur 8 octets :
+//   | crc32c u32 | length u32 | seq u64 | peer u64 | kind u32 | pad u32 | payload |
+//     - message : seq croissant, attribué par la file ;
+//     - ack     : le pair a reçu tous ses messages de seq ≤ seq.
+//
+//   - commit groupé : append() écrit l'enregistrement (pwrite, cache de
+//     pages) et rend la main ; un seul fdatasync, sur un thread dédié,
+//     couvre tout ce qui a été écrit par toutes les sessions depuis le
+//     précédent. Pendant qu'il tourne, les ajouts suivants s'accumulent
+//     pour le prochain : plus le disque est lent, plus les lots sont gros.
+//     Le handler de chaque append() est appelé, sur l'io_context, une fois
+//     son message durable ;
+//   - échec du fdatasync : le handler reçoit l'erreur et le message n'est
+//     PAS en file : il est retiré des messages en attente (next_batch ne le
+//     rend plus), l'appelant peut le réajouter. Les ajouts suivants partent
+//     dans un segment neuf. L'enregistrement reste dans l'ancien segment :
+//     s'il atteint quand même le disque, une reprise après arrêt brutal le
+//     relit (doublon possible, comme pour un ack perdu) ;
+//   - reprise : chaque segment est relu par sa projection mmap ; la
+//     première entrée incomplète ou de CRC faux marque la fin du journal
+//     (arrêt brutal pendant une écriture) ; les ajouts repartent dans
+//     un segment neuf ;
+//   - livraison par lots : au retour du pair, next_batch() rend ses
+//     messages en attente dans l'ordre, par paquets bornés (nombre,
+//     octets) à envoyer d'une seule écriture ; ack() les retire ;
+//   - compaction : un segment dont tous les messages sont livrés est
+//     supprimé (par l'avant du journal seulement : un ack d'un segment
+//     plus récent peut porter sur lui). compact() recopie en tête les
+//     messages encore en attente des plus vieux segments presque vides,
+//     qu'un pair longtemps absent empêcherait sinon de libérer.
+//
+// Livraison au moins une fois : un ack perdu dans un arrêt brutal fait
+// renvoyer les messages concernés. Les pairs sont désignés par un
+// identifiant stable sur 64 bits choisi par l'appelant (condensé de sa
+// clé, par exemple), pas par l'indice de session qui change à chaque
+// connexion.
+//
+// Mono-thread : le thread de l'io_context ; seuls les fdatasync partent
+// sur le thread de synchronisation. À détruire après l'arrêt de
+// l'io_context (les complétions y sont postées).
+// ===========================================
+#pragma once
+
+#include "crc32c.hpp"
+#include "iobuf.hpp"
+
+#include <asio/executor_work_guard.hpp>
+#include <asio/io_context.hpp>
+#include <asio/post.hpp>
+#include <asio/thread_pool.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace p2p {
+
+struct message_queue_options {
+  std::size_t segment_size = 64 << 20;   // octets par segment (préalloués)
+  bool group_commit = true;              // false : un fdatasync par message (comparaison)
+};
+
+struct message_queue_stats {
+  std::uint64_t appended = 0;       // messages ajoutés
+  std::uint64_t durable = 0;        // rendus durables (handler appelé sans erreur)
+  std::uint64_t syncs = 0;          // lots rendus durables par au moins un fdatasync
+  std::uint64_t largest_batch = 0;  // messages couverts par un même fdatasync
+  std::uint64_t failed_syncs = 0;   // lots en échec, retirés de la file
+  std::uint64_t delivered = 0;      // retirés par ack()
+  std::uint64_t replayed = 0;       // messages en attente retrouvés à l'ouverture
+  std::uint64_t moved = 0;          // recopiés par compact()
+  std::uint64_t segments_removed = 0;
+};
+
+struct queued_message {
+  std::uint64_t seq;
+  iobuf payload;
+};
+
+class message_queue {
+public:
+  using handler = std::function<void(std::error_code, std::uint64_t seq)>;
+
+  // Ouvre (ou crée) le journal du répertoire `dir` et rejoue ses segments
+  message_queue(asio::io_context& io, std::string dir, message_queue_options opts = {})
+    : io_(io), dir_(std::move(dir)), opts_(opts), syncer_(1) {
+    if (opts_.segment_size < segment_header + record_header + 8 || opts_.segment_size % 8)
+      throw std::invalid_argument("message_queue: segment_size");
+    std::filesystem::create_directories(dir_);
+    // Jamais d'ajout dans un segment rejoué : au-delà d'une fin déchirée
+    // peuvent traîner des enregistrements valides jamais confirmés, qu'un
+    // nouvel enregistrement de même position ferait relire
+    replay();
+    rotate();
+  }
+
+  ~message_queue() {
+    syncer_.join();
+    // Acks et messages écrits depuis le dernier lot : rendus durables en partant
+    for (auto& s : dirty_) ::fdatasync(s->fd);
+  }
+
+  message_queue(const message_queue&) = delete;
+  message_queue& operator=(const message_queue&) = delete;
+
+  // -------------------------------------------
+  // Ajout (commit groupé)
+  // -------------------------------------------
+
+  // Range un message pour `peer` ; `done(ec, seq)` une fois durable
+  std::uint64_t append(std::uint64_t peer, std::span<const char> payload, handler done = {}) {
+    std::uint64_t seq = next_seq_++;
+    locator at = write(peer, seq, kind_message, payload);
+    peers_[peer].pending.emplace(seq, at);
+    ++at.seg->live;
+    at.seg->live_payload += at.length;
+    ++stats_.appended;
+    waiting_.push_back({peer, seq, std::move(done)});
+    if (!syncing_) start_sync();
+    return seq;
+  }
+
+  std::uint64_t append(std::uint64_t peer, const iobuf& payload, handler done = {}) {
+    std::vector<char> flat(payload.size());
+    std::size_t pos = 0;
+    for (const auto& seg : payload.segments()) {
+      std::memcpy(flat.data() + pos, seg.data(), seg.length);
+      pos += seg.length;
+    }
+    return append(peer, std::span<const char>(flat), std::move(done));
+  }
+
+  // -------------------------------------------
+  // Livraison
+  // -------------------------------------------
+
+  // Messages en attente de `peer` de seq > after, dans l'ordre, au plus
+  // max_messages et max_bytes (au moins un). Les appels successifs avec
+  // after = dernier seq rendu pipelinent l'envoi avant les acks.
+  std::vector<queued_message> next_batch(std::uint64_t peer, std::uint64_t after = 0, std::size_t max_messages = 64,
+                                         std::size_t max_bytes = 1 << 20) const {
+    std::vector<queued_message> out;
+    auto p = peers_.find(peer);
+    if (p == peers_.end()) return out;
+    std::size_t bytes = 0;
+    for (auto it = p->second.pending.upper_bound(after); it != p->second.pending.end(); ++it) {
+      const locator& at = it->second;
+      if (out.size() == max_messages || (!out.empty() && bytes + at.length > max_bytes)) break;
+      out.push_back({it->first, iobuf::copy(at.seg->map + at.offset + record_header, at.length)});
+      bytes += at.length;
+    }
+    return out;
+  }
+
+  // Le pair a reçu tous ses messages de seq ≤ seq. L'ack est journalisé
+  // sans attendre de fdatasync : il part avec le prochain lot.
+  void ack(std::uint64_t peer, std::uint64_t seq) {
+    auto p = peers_.find(peer);
+    if (p == peers_.end()) return;
+    auto& pending = p->second.pending;
+    auto last = pending.upper_bound(seq);
+    if (last == pending.begin()) return;
+    for (auto it = pending.begin(); it != last; ++it) release(it->second);
+    stats_.delivered += static_cast<std::uint64_t>(std::distance(pending.begin(), last));
+    pending.erase(pending.begin(), last);
+    if (pending.empty()) peers_.erase(p);
+    write(peer, seq, kind_ack, {});
+    drop_delivered();
+  }
+
+  std::size_t pending(std::uint64_t peer) const {
+    auto p = peers_.find(peer);
+    return p == peers_.end() ? 0 : p->second.pending.size();
+  }
+
+  std::size_t pending_peers() const { return peers_.size(); }
+
+  // -------------------------------------------
+  // Compaction
+  // -------------------------------------------
+
+  // Recopie en tête les messages en attente des plus vieux segments dont
+  // la part encore utile est < max_live, puis les supprime. Bloquant (un
+  // fdatasync avant de supprimer les originaux). Rend le nombre de
+  // segments supprimés.
+  std::size_t compact(double max_live = 0.25) {
+    std::size_t candidates = 0;
+    for (std::size_t i = 0; i + 1 < segments_.size(); ++i) {
+      const segment& s = *segments_[i];
+      if (double(s.live_bytes()) > max_live * double(s.end)) break;
+      candidates = i + 1;
+    }
+    if (candidates == 0) return 0;
+    std::vector<segment*> old;
+    for (std::size_t i = 0; i < candidates; ++i) old.push_back(segments_[i].get());
+    // Même seq, même pair : à la reprise, un doublon laissé par un arrêt
+    // pendant la compaction est reconnu à son seq
+    for (auto& [peer, q] : peers_) {
+      for (auto& [seq, at] : q.pending) {
+        if (std::find(old.begin(), old.end(), at.seg.get()) == old.end()) continue;
+        locator moved = write(peer, seq, kind_message,
+                              std::span<const char>(at.seg->map + at.offset + record_header, at.length));
+        release(at);
+        at = moved;
+        ++at.seg->live;
+        at.seg->live_payload += at.length;
+        ++stats_.moved;
+      }
+    }
+    for (auto& s : dirty_)
+      if (::fdatasync(s->fd) != 0) fail("fdatasync " + s->path);
+    dirty_.clear();
+    return drop_delivered();
+  }
+
+  std::size_t segments() const { return segments_.size(); }
+  std::uint64_t disk_bytes() const { return std::uint64_t(segments_.size()) * opts_.segment_size; }
+  const message_queue_stats& stats() const { return stats_; }
+
+private:
+  static constexpr std::uint64_t magic = 0x3130514d50325032ull;   // "P2PMQ01"
+  static constexpr std::size_t segment_header = 64;                // magic u64 | numéro u64 | réservé
+  static constexpr std::size_t record_header = 32;
+  static constexpr std::uint32_t kind_message = 1;
+  static constexpr std::uint32_t kind_ack = 2;
+
+  struct segment {
+    std::uint64_t number = 0;
+    std::string path;
+    int fd = -1;
+    const char* map = nullptr;
+    std::size_t size = 0;
+    std::size_t end = segment_header;   // prochain enregistrement
+    std::size_t live = 0;               // messages encore en attente
+    std::size_t live_payload = 0;       // octets (compact)
+
+    std::size_t live_bytes() const { return live_payload + live * record_header; }
+
+    ~segment() {
+      if (map) ::munmap(const_cast<char*>(map), size);
+      if (fd >= 0) ::close(fd);
+    }
+  };
+
+  struct locator {
+    std::shared_ptr<segment> seg;
+    std::size_t offset = 0;   // début de l'enregistrement
+    std::uint32_t length = 0; // charge utile
+  };
+
+  struct peer_queue {
+    std::map<std::uint64_t, locator> pending;   // seq → message
+  };
+
+  struct waiter {
+    std::uint64_t peer;
+    std::uint64_t seq;
+    handler done;
+  };
+
+  [[noreturn]] static void fail(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+  }
+
+  static std::size_t align8(std::size_t n) { return (n + 7) & ~std::size_t(7); }
+
+  static std::uint32_t record_crc(const char* r, std::size_t payload) {
+    return crc32c::extend(crc32c::value(r + 4, record_header - 4), r + record_header, payload);
+  }
+
+  std::string segment_path(std::uint64_t number) const {
+    char name[40];
+    std::snprintf(name, sizeof name, "/segment-%016llx.log", static_cast<unsigned long long>(number));
+    return dir_ + name;
+  }
+
+  // -------------------------------------------
+  // Écriture
+  // -------------------------------------------
+  locator write(std::uint64_t peer, std::uint64_t seq, std::uint32_t kind, std::span<const char> payload) {
+    std::size_t total = align8(record_header + payload.size());
+    if (segment_header + total > opts_.segment_size) throw std::invalid_argument("message_queue: message larger than a segment");
+    if (segments_.back()->end + total > opts_.segment_size) rotate();
+    auto& s = segments_.back();
+
+    record_.assign(total, 0);
+    char* r = record_.data();
+    std::uint32_t length = static_cast<std::uint32_t>(payload.size());
+    std::memcpy(r + 4, &length, 4);
+    std::memcpy(r + 8, &seq, 8);
+    std::memcpy(r + 16, &peer, 8);
+    std::memcpy(r + 24, &kind, 4);
+    if (!payload.empty()) std::memcpy(r + record_header, payload.data(), payload.size());
+    std::uint32_t crc = record_crc(r, payload.size());
+    std::memcpy(r, &crc, 4);
+    pwrite_all(*s, r, total, s->end);
+
+    locator at{s, s->end, length};
+    s->end += total;
+    mark_dirty(s);
+    return at;
+  }
+
+  void pwrite_all(const segment& s, const char* p, std::size_t n, std::size_t offset) {
+    while (n > 0) {
+      ssize_t w = ::pwrite(s.fd, p, n, static_cast<off_t>(offset));
+      if (w < 0 && errno == EINTR) continue;
+      if (w < 0) fail("pwrite " + s.path);
+      p += w;
+      n -= static_cast<std::size_t>(w);
+      offset += static_cast<std::size_t>(w);
+    }
+  }
+
+  static void release(const locator& at) {
+    --at.seg->live;
+    at.seg->live_payload -= at.length;
+  }
+
+  void mark_dirty(const std::shared_ptr<segment>& s) {
+    if (std::find(dirty_.begin(), dirty_.end(), s) == dirty_.end()) dirty_.push_back(s);
+  }
+
+  // Nouveau segment en tête. L'ancien reste dans dirty_ jusqu'au prochain lot.
+  void rotate() {
+    auto s = std::make_shared<segment>();
+    s->number = segments_.empty() ? 0 : segments_.back()->number + 1;
+    s->path = segment_path(s->number);
+    s->size = opts_.segment_size;
+    s->fd = ::open(s->path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (s->fd < 0) fail("open " + s->path);
+    if (::fallocate(s->fd, 0, 0, static_cast<off_t>(s->size)) != 0 &&
+        (errno != EOPNOTSUPP || ::ftruncate(s->fd, static_cast<off_t>(s->size)) != 0))
+      fail("fallocate " + s->path);
+    char header[segment_header] = {};
+    std::memcpy(header, &magic, 8);
+    std::memcpy(header + 8, &s->number, 8);
+    pwrite_all(*s, header, segment_header, 0);
+    map(*s);
+    segments_.push_back(s);
+    mark_dirty(s);
+  }
+
+  void map(segment& s) {
+    void* p = ::mmap(nullptr, s.size, PROT_READ, MAP_SHARED, s.fd, 0);
+    if (p == MAP_FAILED) fail("mmap " + s.path);
+    s.map = static_cast<const char*>(p);
+  }
+
+  // -------------------------------------------
+  // Commit groupé
+  // -------------------------------------------
+  void start_sync() {
+    syncing_ = true;
+    std::vector<waiter> batch;
+    if (opts_.group_commit) {
+      batch.swap(waiting_);
+    } else {
+      batch.push_back(std::move(waiting_.front()));
+      waiting_.erase(waiting_.begin());
+    }
+    // Tout ce qui précède a déjà été écrit (pwrite) : le fdatasync lancé
+    // maintenant le couvre, les segments restent ouverts par leurs shared_ptr
+    std::vector<std::shared_ptr<segment>> files;
+    files.swap(dirty_);
+    // Sans commit groupé, le lot précédent a pu couvrir ce message : son
+    // fdatasync a quand même lieu (c'est le coût comparé)
+    if (!opts_.group_commit && files.empty()) files.push_back(segments_.back());
+    bool ran = !files.empty();
+    asio::post(syncer_, [this, work = asio::make_work_guard(io_), files = std::move(files), ran,
+                         batch = std::move(batch)]() mutable {
+      std::error_code ec;
+      for (auto& s : files)
+        if (::fdatasync(s->fd) != 0) ec.assign(errno, std::generic_category());
+      files.clear();
+      asio::post(io_, [this, ec, ran, batch = std::move(batch)]() mutable { synced(ec, ran, std::move(batch)); });
+    });
+  }
+
+  void synced(std::error_code ec, bool ran, std::vector<waiter> batch) {
+    stats_.syncs += ran;
+    stats_.largest_batch = std::max<std::uint64_t>(stats_.largest_batch, batch.size());
+    if (ec) {
+      // Non durable : le lot sort de la file (sauf ce qui a déjà été acquitté)
+      for (const auto& w : batch) forget(w.peer, w.seq);
+      ++stats_.failed_syncs;
+      try {
+        rotate();   // ne plus écrire derrière des pages dont l'écriture a échoué
+      } catch (const std::system_error&) {
+      }
+      drop_delivered();
+    } else {
+      stats_.durable += batch.size();
+    }
+    // Les ajouts faits depuis les handlers rejoignent le lot suivant
+    for (auto& w : batch)
+      if (w.done) w.done(ec, w.seq);
+    syncing_ = false;
+    if (!waiting_.empty()) start_sync();
+  }
+
+  void forget(std::uint64_t peer, std::uint64_t seq) {
+    auto p = peers_.find(peer);
+    if (p == peers_.end()) return;
+    auto it = p->second.pending.find(seq);
+    if (it == p->second.pending.end()) return;
+    release(it->second);
+    p->second.pending.erase(it);
+    if (p->second.pending.empty()) peers_.erase(p);
+  }
+
+  // Segments de tête entièrement livrés → supprimés
+  std::size_t drop_delivered() {
+    std::size_t removed = 0;
+    while (segments_.size() > 1 && segments_.front()->live == 0) {
+      ::unlink(segments_.front()->path.c_str());
+      dirty_.erase(std::remove(dirty_.begin(), dirty_.end(), segments_.front()), dirty_.end());
+      segments_.pop_front();
+      ++removed;
+    }
+    stats_.segments_removed += removed;
+    return removed;
+  }
+
+  // -------------------------------------------
+  // Reprise
+  // -------------------------------------------
+  void replay() {
+    std::vector<std::pair<std::uint64_t, std::string>> found;
+    for (const auto& e : std::filesystem::directory_iterator(dir_)) {
+      std::string name = e.path().filename().string();
+      unsigned long long number = 0;
+      char tail = 0;
+      if (std::sscanf(name.c_str(), "segment-%16llx.lo%c", &number, &tail) == 2 && tail == 'g' &&
+          name.size() == 28)
+        found.emplace_back(number, e.path().string());
+    }
+    std::sort(found.begin(), found.end());
+
+    std::unordered_map<std::uint64_t, std::uint64_t> acked;   // pair → plus grand seq acquitté
+    for (auto& [number, path] : found) {
+      auto s = std::make_shared<segment>();
+      s->number = number;
+      s->path = path;
+      s->fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+      if (s->fd < 0) fail("open " + path);
+      struct stat st;
+      if (::fstat(s->fd, &st) != 0) fail("fstat " + path);
+      s->size = static_cast<std::size_t>(st.st_size);
+      std::uint64_t m = 0;
+      if (s->size < segment_header) continue;
+      map(*s);
+      std::memcpy(&m, s->map, 8);
+      if (m != magic) continue;
+      ::madvise(const_cast<char*>(s->map), s->size, MADV_SEQUENTIAL);
+
+      std::size_t pos = segment_header;
+      while (pos + record_header <= s->size) {
+        const char* r = s->map + pos;
+        std::uint32_t crc, length, kind;
+        std::uint64_t seq, peer;
+        std::memcpy(&crc, r, 4);
+        std::memcpy(&length, r + 4, 4);
+        std::memcpy(&seq, r + 8, 8);
+        std::memcpy(&peer, r + 16, 8);
+        std::memcpy(&kind, r + 24, 4);
+        std::size_t total = align8(record_header + std::size_t(length));
+        if ((kind != kind_message && kind != kind_ack) || pos + total > s->size || crc != record_crc(r, length)) break;
+        if (kind == kind_message) {
+          auto a = acked.find(peer);
+          if (a == acked.end() || seq > a->second) {
+            auto [it, fresh] = peers_[peer].pending.try_emplace(seq, locator{s, pos, length});
+            if (!fresh) {   // copie laissée par une compaction interrompue
+              release(it->second);
+              it->second = locator{s, pos, length};
+            }
+            ++s->live;
+            s->live_payload += length;
+          }
+        } else {
+          std::uint64_t& a = acked[peer];
+          a = std::max(a, seq);
+          auto p = peers_.find(peer);
+          if (p != peers_.end()) {
+            auto& pending = p->second.pending;
+            auto last = pending.upper_bound(seq);
+            for (auto it = pending.begin(); it != last; ++it) release(it->second);
+            pending.erase(pending.begin(), last);
+            if (pending.empty()) peers_.erase(p);
+          }
+        }
+        next_seq_ = std::max(next_seq_, seq + 1);
+        pos += total;
+      }
+      s->end = pos;
+      ::madvise(const_cast<char*>(s->map), s->size, MADV_RANDOM);
+      segments_.push_back(std::move(s));
+    }
+    for (const auto& [peer, q] : peers_) stats_.replayed += q.pending.size();
+    drop_delivered();
+  }
+
+  asio::io_context& io_;
+  std::string dir_;
+  message_queue_options opts_;
+  asio::thread_pool syncer_;   // un thread : les fdatasync
+  std::deque<std::shared_ptr<segment>> segments_;
+  std::vector<std::shared_ptr<segment>> dirty_;   // écrits depuis le dernier lot lancé
+  std::unordered_map<std::uint64_t, peer_queue> peers_;
+  std::vector<waiter> waiting_;                   // ajouts pas encore couverts par un lot lancé
+  bool syncing_ = false;
+  std::uint64_t next_seq_ = 1;
+  std::vector<char> record_;
+  message_queue_stats stats_;
+};
+
+} // namespace p2p
@@ -0,0 +1,79 @@
+// ===========================================
+// OVERLAY.HPP
+// Briques communes aux protocoles du réseau de recouvrement
+//
+// Les protocoles d'appartenance et de diffusion (hyparview.hpp, ...) sont
+// écrits sans E/S : ils reçoivent les messages et événements de
+// l'appelant et émettent les leurs par un callback `send`. Le transport
+// (sessions TCP de async_server, ou le lanceur d'essaim en processus des
+// benchmarks) décide comment les acheminer.
+//
+// Les nœuds sont désignés par un identifiant stable sur 64 bits (condensé
+// de leur clé publique, par exemple), le même d'une connexion à l'autre.
+// ===========================================
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace p2p {
+
+using node_id = std::uint64_t;
+
+namespace overlay {
+
+// Générateur compact (splitmix64, 8 octets d'état) : un par nœud, là où
+// mt19937_64 en coûterait 2,5 Kio
+class rng {
+public:
+  using result_type = std::uint64_t;
+  explicit rng(std::uint64_t seed) : state_(seed) {}
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+  result_type operator()() {
+    std::uint64_t z = (state_ += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+private:
+  std::uint64_t state_;
+};
+
+// Élément tiré au hasard (v non vide)
+template <class T, class Rng>
+const T& random_element(const std::vector<T>& v, Rng& rng) {
+  return v[std::uniform_int_distribution<std::size_t>(0, v.size() - 1)(rng)];
+}
+
+// Jusqu'à n éléments distincts de v, au hasard (tirage partiel de Fisher-Yates)
+template <class T, class Rng>
+std::vector<T> random_sample(std::vector<T> v, std::size_t n, Rng& rng) {
+  n = std::min(n, v.size());
+  for (std::size_t i = 0; i < n; ++i)
+    std::swap(v[i], v[std::uniform_int_distribution<std::size_t>(i, v.size() - 1)(rng)]);
+  v.resize(n);
+  return v;
+}
+
+template <class T>
+bool contains(const std::vector<T>& v, const T& x) {
+  return std::find(v.begin(), v.end(), x) != v.end();
+}
+
+// Retire x de v (ordre non conservé) : true s'il y était
+template <class T>
+bool erase_unordered(std::vector<T>& v, const T& x) {
+  auto it = std::find(v.begin(), v.end(), x);
+  if (it == v.end()) return false;
+  *it = v.back();
+  v.pop_back();
+  return true;
+}
+
+} // namespace overlay
+} // namespace p2p
@@ -0,0 +1,482 @@
+// ===========================================
+// PIECE_BITMAP.HPP
+// Ensemble de pièces compressé (à la Roaring)
+// Objectif : garder "quelles pièces possède ce pair" pour des milliers de
+//            pairs et des centaines de milliers de pièces sans un bitfield
+//            plein par pair, avec mises à jour have / lose en O(1) amorti.
+//
+// L'espace des indices est découpé en tranches de 65536 pièces ; chaque
+// tranche non vide a un conteneur :
+//   - array  : indices triés sur 16 bits (≤ 4096 pièces, 2 octets chacune) ;
+//   - bitmap : 1024 mots de 64 bits (8 KiB) ;
+//   - run    : préfixe [0, card) de la tranche (un seed, un téléchargement
+//              séquentiel) : aucun stockage.
+// Un conteneur change de forme quand son cardinal franchit les seuils.
+//
+// Noyaux vectorisés (AVX2, choisis à l'exécution, repli portable) :
+//   - and_popcount  : |a ∧ b| sur des mots de 64 bits (intérêt pour un pair) ;
+//   - and_nonzero   : mots non nuls de a ∧ b (candidats d'un bloc) ;
+//   - masked_min    : minimum (et position) de 64 compteurs 16 bits parmi
+//                     ceux dont le bit est à 1 (choix de la pièce la plus rare).
+// ===========================================
+#pragma once
+
+#include <algorithm>
+#include <bit>          // std::popcount, std::countr_zero
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define P2P_BITMAP_X86 1
+#include <immintrin.h>
+#endif
+
+namespace p2p {
+
+namespace bitmap_detail {
+
+// (min << 8) | position du minimum parmi les compteurs sélectionnés ;
+// no_candidate si aucun bit n'est à 1
+inline constexpr std::uint32_t no_candidate = UINT32_MAX;
+
+// -------------------------------------------
+// Versions portables
+// -------------------------------------------
+inline std::size_t and_popcount_portable(const std::uint64_t* a, const std::uint64_t* b, std::size_t n) {
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < n; ++i) total += static_cast<std::size_t>(std::popcount(a[i] & b[i]));
+  return total;
+}
+
+inline std::size_t and_nonzero_portable(const std::uint64_t* a, const std::uint64_t* b, std::size_t n,
+                                        std::uint64_t* out, std::uint32_t* index) {
+  std::size_t found = 0;
+  for (std::size_t i = 0; i < n; ++i)
+    if (std::uint64_t w = a[i] & b[i]) {
+      out[found] = w;
+      index[found++] = static_cast<std::uint32_t>(i);
+    }
+  return found;
+}
+
+inline std::uint32_t masked_min_portable(const std::uint16_t* counts, std::uint64_t bits) {
+  std::uint32_t best = no_candidate;
+  while (bits) {
+    int i = std::countr_zero(bits);
+    bits &= bits - 1;
+    std::uint32_t v = (std::uint32_t(counts[i]) << 8) | std::uint32_t(i);
+    best = std::min(best, v);
+  }
+  return best;
+}
+
+#ifdef P2P_BITMAP_X86
+
+__attribute__((target("avx2")))
+inline std::size_t and_popcount_avx2(const std::uint64_t* a, const std::uint64_t* b, std::size_t n) {
+  // Popcount par quartets (vpshufb) puis somme horizontale par octets (vpsadbw)
+  const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                       0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0f);
+  __m256i acc = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                 _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+    __m256i c = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(x, low)),
+                                _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi64(x, 4), low)));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(c, _mm256_setzero_si256()));
+  }
+  alignas(32) std::uint64_t lanes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+  return static_cast<std::size_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]) +
+         and_popcount_portable(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline std::size_t and_nonzero_avx2(const std::uint64_t* a, const std::uint64_t* b, std::size_t n,
+                                    std::uint64_t* out, std::uint32_t* index) {
+  std::size_t found = 0;
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                 _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+    if (_mm256_testz_si256(x, x)) continue;   // cas courant : 256 pièces sans candidat
+    alignas(32) std::uint64_t w[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(w), x);
+    for (std::size_t k = 0; k < 4; ++k)
+      if (w[k]) {
+        out[found] = w[k];
+        index[found++] = static_cast<std::uint32_t>(i + k);
+      }
+  }
+  for (; i < n; ++i)
+    if (std::uint64_t w = a[i] & b[i]) {
+      out[found] = w;
+      index[found++] = static_cast<std::uint32_t>(i);
+    }
+  return found;
+}
+
+__attribute__((target("avx2,sse4.1")))
+inline std::uint32_t masked_min_avx2(const std::uint16_t* counts, std::uint64_t bits) {
+  if (!bits) return no_candidate;
+  // Bit j du masque 16 bits → voie j à 0xFFFF ; les compteurs non
+  // sélectionnés sont forcés à 0xFFFF (jamais atteint : < 65535 pairs)
+  const __m256i lane_bits = _mm256_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192,
+                                              16384, static_cast<short>(0x8000));
+  const __m256i ones = _mm256_set1_epi16(-1);
+  __m256i v[4];
+  __m256i best = ones;
+  for (int g = 0; g < 4; ++g) {
+    __m256i m = _mm256_set1_epi16(static_cast<short>(bits >> (16 * g)));
+    __m256i sel = _mm256_cmpeq_epi16(_mm256_and_si256(m, lane_bits), lane_bits);
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(counts + 16 * g));
+    v[g] = _mm256_or_si256(c, _mm256_andnot_si256(sel, ones));
+    best = _mm256_min_epu16(best, v[g]);
+  }
+  __m128i half = _mm_min_epu16(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+  std::uint32_t min = static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm_minpos_epu16(half)) & 0xffff);
+  // Première position qui atteint le minimum
+  __m256i target = _mm256_set1_epi16(static_cast<short>(min));
+  for (int g = 0; g < 4; ++g) {
+    auto eq = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(v[g], target)));
+    if (eq) return (min << 8) | std::uint32_t(16 * g + std::countr_zero(eq) / 2);
+  }
+  return no_candidate;
+}
+
+#endif // P2P_BITMAP_X86
+
+using and_popcount_fn = std::size_t (*)(const std::uint64_t*, const std::uint64_t*, std::size_t);
+using and_nonzero_fn = std::size_t (*)(const std::uint64_t*, const std::uint64_t*, std::size_t, std::uint64_t*,
+                                       std::uint32_t*);
+using masked_min_fn = std::uint32_t (*)(const std::uint16_t*, std::uint64_t);
+
+struct implementation_t {
+  and_popcount_fn and_popcount;
+  and_nonzero_fn and_nonzero;
+  masked_min_fn masked_min;
+  const char* name;
+};
+
+inline constexpr implementation_t portable = {and_popcount_portable, and_nonzero_portable, masked_min_portable,
+                                              "portable"};
+
+inline implementation_t select_implementation() {
+#ifdef P2P_BITMAP_X86
+  if (__builtin_cpu_supports("avx2")) return {and_popcount_avx2, and_nonzero_avx2, masked_min_avx2, "avx2"};
+#endif
+  return portable;
+}
+
+inline const implementation_t& implementation() {
+  static const implementation_t impl = select_implementation();
+  return impl;
+}
+
+} // namespace bitmap_detail
+
+class piece_bitmap {
+public:
+  static constexpr std::size_t slice = 65536;            // pièces par conteneur
+  static constexpr std::size_t slice_words = slice / 64;
+  static constexpr std::size_t array_max = 4096;         // au-delà : bitmap
+
+  enum class kind : std::uint8_t { array, bitmap, run };
+
+  struct container {
+    std::uint16_t key = 0;              // indice >> 16
+    kind type = kind::array;
+    std::uint32_t card = 0;             // run : préfixe [0, card)
+    std::vector<std::uint16_t> values;  // array
+    std::vector<std::uint64_t> words;   // bitmap
+
+    bool contains(std::uint16_t low) const {
+      switch (type) {
+        case kind::array: return std::binary_search(values.begin(), values.end(), low);
+        case kind::bitmap: return words[low / 64] >> (low % 64) & 1;
+        case kind::run: return low < card;
+      }
+      return false;
+    }
+  };
+
+  piece_bitmap() = default;
+
+  // Depuis un bitfield plein (message "bitfield" d'un pair) : forme la plus compacte
+  static piece_bitmap from_words(const std::uint64_t* words, std::size_t pieces) {
+    piece_bitmap b;
+    std::size_t nwords = (pieces + 63) / 64;
+    for (std::size_t first = 0; first < nwords; first += slice_words) {
+      std::size_t n = std::min(slice_words, nwords - first);
+      std::size_t card = 0, prefix = 0;
+      bool in_prefix = true;
+      for (std::size_t i = 0; i < n; ++i) {
+        card += static_cast<std::size_t>(std::popcount(words[first + i]));
+        if (in_prefix) {
+          prefix += static_cast<std::size_t>(std::countr_one(words[first + i]));
+          in_prefix = words[first + i] == ~std::uint64_t(0);
+        }
+      }
+      if (!card) continue;
+      container c;
+      c.key = static_cast<std::uint16_t>(first / slice_words);
+      c.card = static_cast<std::uint32_t>(card);
+      if (prefix == card) {
+        c.type = kind::run;
+      } else if (card <= array_max) {
+        for (std::size_t i = 0; i < n; ++i)
+          for (std::uint64_t w = words[first + i]; w; w &= w - 1)
+            c.values.push_back(static_cast<std::uint16_t>(i * 64 + std::size_t(std::countr_zero(w))));
+      } else {
+        c.type = kind::bitmap;
+        c.words.assign(slice_words, 0);
+        std::copy(words + first, words + first + n, c.words.begin());
+      }
+      b.containers_.push_back(std::move(c));
+    }
+    b.card_ = 0;
+    for (const auto& c : b.containers_) b.card_ += c.card;
+    return b;
+  }
+
+  // true si la pièce n'y était pas
+  bool add(std::uint32_t i) {
+    container& c = slot(static_cast<std::uint16_t>(i >> 16));
+    auto low = static_cast<std::uint16_t>(i & 0xffff);
+    switch (c.type) {
+      case kind::array: {
+        auto it = std::lower_bound(c.values.begin(), c.values.end(), low);
+        if (it != c.values.end() && *it == low) return false;
+        if (c.values.size() < array_max) {
+          c.values.insert(it, low);
+          break;
+        }
+        to_bitmap(c);
+        [[fallthrough]];
+      }
+      case kind::bitmap: {
+        std::uint64_t& w = c.words[low / 64];
+        std::uint64_t bit = std::uint64_t(1) << (low % 64);
+        if (w & bit) return false;
+        w |= bit;
+        if (c.card + 1 == slice) {   // tranche pleine : plus aucun stockage
+          c.words = {};
+          c.type = kind::run;
+        }
+        break;
+      }
+      case kind::run:
+        if (low < c.card) return false;
+        if (low != c.card) {
+          to_bitmap(c);
+          c.words[low / 64] |= std::uint64_t(1) << (low % 64);
+        }
+        break;
+    }
+    ++c.card;
+    ++card_;
+    return true;
+  }
+
+  // true si la pièce y était
+  bool remove(std::uint32_t i) {
+    auto it = find(static_cast<std::uint16_t>(i >> 16));
+    if (it == containers_.end()) return false;
+    container& c = *it;
+    auto low = static_cast<std::uint16_t>(i & 0xffff);
+    switch (c.type) {
+      case kind::array: {
+        auto v = std::lower_bound(c.values.begin(), c.values.end(), low);
+        if (v == c.values.end() || *v != low) return false;
+        c.values.erase(v);
+        break;
+      }
+      case kind::run:
+        if (low >= c.card) return false;
+        if (low + 1u != c.card) {
+          to_bitmap(c);
+          c.words[low / 64] &= ~(std::uint64_t(1) << (low % 64));
+        }
+        break;
+      case kind::bitmap: {
+        std::uint64_t& w = c.words[low / 64];
+        std::uint64_t bit = std::uint64_t(1) << (low % 64);
+        if (!(w & bit)) return false;
+        w &= ~bit;
+        break;
+      }
+    }
+    --c.card;
+    --card_;
+    if (c.type == kind::bitmap && c.card <= array_max) to_array(c);
+    if (c.card == 0) containers_.erase(it);
+    return true;
+  }
+
+  bool contains(std::uint32_t i) const {
+    auto it = find(static_cast<std::uint16_t>(i >> 16));
+    return it != containers_.end() && it->contains(static_cast<std::uint16_t>(i & 0xffff));
+  }
+
+  std::size_t cardinality() const { return card_; }
+  bool empty() const { return card_ == 0; }
+  void clear() {
+    containers_.clear();
+    card_ = 0;
+  }
+
+  template <typename F>
+  void for_each(F&& f) const {
+    for (const auto& c : containers_) {
+      std::uint32_t base = std::uint32_t(c.key) << 16;
+      switch (c.type) {
+        case kind::array:
+          for (auto v : c.values) f(base | v);
+          break;
+        case kind::bitmap:
+          for (std::size_t i = 0; i < slice_words; ++i)
+            for (std::uint64_t w = c.words[i]; w; w &= w - 1)
+              f(base + std::uint32_t(i * 64 + std::size_t(std::countr_zero(w))));
+          break;
+        case kind::run:
+          for (std::uint32_t v = 0; v < c.card; ++v) f(base + v);
+          break;
+      }
+    }
+  }
+
+  // |this ∧ dense| : dense est un bitfield plein de `nwords` mots
+  std::size_t and_cardinality(const std::uint64_t* dense, std::size_t nwords,
+                              const bitmap_detail::implementation_t& impl = bitmap_detail::implementation()) const {
+    std::size_t total = 0;
+    for (const auto& c : containers_) {
+      std::size_t first = std::size_t(c.key) * slice_words;
+      if (first >= nwords) break;
+      std::size_t n = std::min(slice_words, nwords - first);
+      switch (c.type) {
+        case kind::array:
+          for (auto v : c.values) total += dense[first + v / 64] >> (v % 64) & 1;
+          break;
+        case kind::bitmap:
+          total += impl.and_popcount(c.words.data(), dense + first, n);
+          break;
+        case kind::run: {
+          std::size_t full = std::min<std::size_t>(c.card / 64, n);
+          total += impl.and_popcount(dense + first, dense + first, full);
+          if (c.card % 64 && full < n)
+            total += static_cast<std::size_t>(
+              std::popcount(dense[first + full] & ((std::uint64_t(1) << (c.card % 64)) - 1)));
+          break;
+        }
+      }
+    }
+    return total;
+  }
+
+  // Mots non nuls de this ∧ dense sur les mots [first, first + n) de dense,
+  // sans sortir d'une tranche. Écrit les mots dans out et leur indice dans
+  // index ; renvoie leur nombre (≤ n).
+  std::size_t common_words(const std::uint64_t* dense, std::size_t first, std::size_t n, std::uint64_t* out,
+                           std::uint32_t* index,
+                           const bitmap_detail::implementation_t& impl = bitmap_detail::implementation()) const {
+    auto it = find(static_cast<std::uint16_t>(first / slice_words));
+    if (it == containers_.end()) return 0;
+    const container& c = *it;
+    std::size_t local = first % slice_words;
+    n = std::min(n, slice_words - local);
+    std::size_t found = 0;
+    switch (c.type) {
+      case kind::array: {
+        auto v = std::lower_bound(c.values.begin(), c.values.end(), static_cast<std::uint16_t>(local * 64));
+        while (v != c.values.end() && *v / 64 < local + n) {   // regroupe les indices d'un même mot
+          std::size_t word = *v / 64;
+          std::uint64_t bits = 0;
+          for (; v != c.values.end() && *v / 64 == word; ++v) bits |= std::uint64_t(1) << (*v % 64);
+          if (std::uint64_t w = bits & dense[first + word - local]) {
+            out[found] = w;
+            index[found++] = static_cast<std::uint32_t>(first + word - local);
+          }
+        }
+        break;
+      }
+      case kind::bitmap:
+        found = impl.and_nonzero(c.words.data() + local, dense + first, n, out, index);
+        for (std::size_t f = 0; f < found; ++f) index[f] += static_cast<std::uint32_t>(first);
+        break;
+      case kind::run:
+        for (std::size_t i = 0; i < n && (local + i) * 64 < c.card; ++i) {
+          std::size_t left = c.card - (local + i) * 64;
+          std::uint64_t mask = left >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << left) - 1;
+          if (std::uint64_t w = dense[first + i] & mask) {
+            out[found] = w;
+            index[found++] = static_cast<std::uint32_t>(first + i);
+          }
+        }
+        break;
+    }
+    return found;
+  }
+
+  const std::vector<container>& containers() const { return containers_; }
+
+  std::size_t memory_bytes() const {
+    std::size_t total = sizeof(*this) + containers_.capacity() * sizeof(container);
+    for (const auto& c : containers_) total += c.values.capacity() * 2 + c.words.capacity() * 8;
+    return total;
+  }
+
+private:
+  std::vector<container>::iterator find(std::uint16_t key) {
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                               [](const container& c, std::uint16_t k) { return c.key < k; });
+    return (it != containers_.end() && it->key == key) ? it : containers_.end();
+  }
+  std::vector<container>::const_iterator find(std::uint16_t key) const {
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                               [](const container& c, std::uint16_t k) { return c.key < k; });
+    return (it != containers_.end() && it->key == key) ? it : containers_.end();
+  }
+
+  // Conteneur de la tranche `key`, créé vide (array) s'il n'existe pas
+  container& slot(std::uint16_t key) {
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                               [](const container& c, std::uint16_t k) { return c.key < k; });
+    if (it == containers_.end() || it->key != key) {
+      it = containers_.insert(it, container{});
+      it->key = key;
+    }
+    return *it;
+  }
+
+  static void to_bitmap(container& c) {
+    std::vector<std::uint64_t> words(slice_words, 0);
+    if (c.type == kind::array) {
+      for (auto v : c.values) words[v / 64] |= std::uint64_t(1) << (v % 64);
+    } else {   // run
+      std::fill(words.begin(), words.begin() + c.card / 64, ~std::uint64_t(0));
+      if (c.card % 64) words[c.card / 64] = (std::uint64_t(1) << (c.card % 64)) - 1;
+    }
+    c.values = {};
+    c.words = std::move(words);
+    c.type = kind::bitmap;
+  }
+
+  static void to_array(container& c) {
+    std::vector<std::uint16_t> values;
+    values.reserve(c.card);
+    for (std::size_t i = 0; i < slice_words; ++i)
+      for (std::uint64_t w = c.words[i]; w; w &= w - 1)
+        values.push_back(static_cast<std::uint16_t>(i * 64 + std::size_t(std::countr_zero(w))));
+    c.words = {};
+    c.values = std::move(values);
+    c.type = kind::array;
+  }
+
+  std::vector<container> containers_;   // triés par clé
+  std::size_t card_ = 0;
+};
+
+} // namespace p2p
@@ -0,0 +1,202 @@
+// ===========================================
+// PIECE_WRITER.HPP
+// Écriture des pièces d'un fichier téléchargé
+// Objectif : les pièces arrivent dans le désordre, depuis de nombreux pairs.
+//            Les écrire une à une, chacune suivie d'un fsync, produit une
+//            pluie de petites écritures et un fichier fragmenté.
+//
+//   - préallocation : fallocate() réserve toute la taille du fichier dès
+//     l'ouverture, en extents contigus ;
+//   - regroupement : les pièces terminées restent en mémoire (iobuf, sans
+//     copie) ; une suite de pièces adjacentes part en UN pwritev dès
+//     qu'elle ne peut plus grandir (voisines déjà écrites ou bords du
+//     fichier), ou quand le tampon dépasse max_buffered ;
+//   - fsync groupé : fdatasync() après sync_bytes octets écrits (ou sur
+//     sync()), pas après chaque pièce.
+//
+// Mono-thread : à utiliser depuis un seul thread (typiquement un worker
+// disque, pas le thread de l'io_context).
+// ===========================================
+#pragma once
+
+#include "disk_io.hpp"   // disk_detail::pwritev_all
+#include "iobuf.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace p2p {
+
+struct piece_writer_options {
+  bool preallocate = true;                     // fallocate() à l'ouverture
+  std::size_t max_buffered = 32 * 1024 * 1024; // pièces gardées en mémoire au plus
+  std::size_t sync_bytes = 64 * 1024 * 1024;   // fdatasync() tous les sync_bytes écrits
+};
+
+struct piece_writer_stats {
+  std::uint64_t pieces = 0;          // pièces reçues
+  std::uint64_t runs = 0;            // suites contiguës écrites
+  std::uint64_t write_calls = 0;     // appels pwritev
+  std::uint64_t bytes_written = 0;
+  std::uint64_t syncs = 0;           // appels fdatasync
+  std::size_t peak_buffered = 0;     // octets en attente au plus fort
+
+  double pieces_per_write() const { return write_calls ? double(pieces) / double(write_calls) : 0.0; }
+};
+
+// Nombre d'extents du fichier (ioctl FIEMAP, données synchronisées d'abord)
+inline std::size_t file_extents(int fd) {
+  struct fiemap fm {};
+  fm.fm_length = FIEMAP_MAX_OFFSET;
+  fm.fm_flags = FIEMAP_FLAG_SYNC;
+  fm.fm_extent_count = 0;   // compter seulement
+  if (::ioctl(fd, FS_IOC_FIEMAP, &fm) != 0) throw std::system_error(errno, std::generic_category(), "FIEMAP");
+  return fm.fm_mapped_extents;
+}
+
+class piece_writer {
+public:
+  // Ouvre (ou crée) `path` pour un fichier de `file_size` octets découpé en
+  // pièces de `piece_size` (la dernière peut être plus courte)
+  piece_writer(const std::string& path, std::uint64_t file_size, std::size_t piece_size,
+               piece_writer_options opts = {})
+    : file_size_(file_size), piece_size_(piece_size), opts_(opts) {
+    if (piece_size_ == 0) throw std::invalid_argument("piece_writer: piece_size must be > 0");
+    pieces_ = static_cast<std::size_t>((file_size_ + piece_size_ - 1) / piece_size_);
+    written_.assign(pieces_, false);
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) throw std::system_error(errno, std::generic_category(), "open " + path);
+    if (opts_.preallocate && file_size_ > 0) {
+      // Extents réservés d'un bloc ; FALLOC_FL_KEEP_SIZE inutile, la taille finale est connue
+      if (::fallocate(fd_, 0, 0, static_cast<off_t>(file_size_)) != 0 && errno != EOPNOTSUPP) {
+        int err = errno;
+        ::close(fd_);
+        throw std::system_error(err, std::generic_category(), "fallocate " + path);
+      }
+    }
+    if (::ftruncate(fd_, static_cast<off_t>(file_size_)) != 0) {
+      int err = errno;
+      ::close(fd_);
+      throw std::system_error(err, std::generic_category(), "ftruncate " + path);
+    }
+  }
+
+  piece_writer(const piece_writer&) = delete;
+  piece_writer& operator=(const piece_writer&) = delete;
+
+  ~piece_writer() {
+    try {
+      sync();
+    } catch (...) {
+      // destructeur : l'erreur est perdue ; appeler sync() pour la voir
+    }
+    ::close(fd_);
+  }
+
+  // Pièce terminée et vérifiée. Ne retourne qu'après avoir éventuellement
+  // écrit les suites devenues complètes.
+  void add(std::size_t index, iobuf data) {
+    if (index >= pieces_) throw std::out_of_range("piece_writer: piece index");
+    if (data.size() != piece_length(index)) throw std::invalid_argument("piece_writer: wrong piece size");
+    if (written_[index] || pending_.count(index)) return;   // doublon (deux pairs, même pièce)
+    buffered_ += data.size();
+    stats_.peak_buffered = std::max(stats_.peak_buffered, buffered_);
+    auto it = pending_.emplace(index, std::move(data)).first;
+    ++stats_.pieces;
+
+    // La suite qui contient la pièce peut-elle encore grandir ?
+    auto first = it;
+    while (first != pending_.begin() && std::prev(first)->first + 1 == first->first) --first;
+    auto last = it;
+    while (std::next(last) != pending_.end() && std::next(last)->first == last->first + 1) ++last;
+    bool closed_left = first->first == 0 || written_[first->first - 1];
+    bool closed_right = last->first + 1 == pieces_ || written_[last->first + 1];
+    if (closed_left && closed_right) write_run(first, std::next(last));
+
+    if (buffered_ > opts_.max_buffered) flush();
+    if (unsynced_ >= opts_.sync_bytes) sync_data();
+  }
+
+  // Écrit toutes les pièces en attente (une écriture par suite contiguë)
+  void flush() {
+    while (!pending_.empty()) {
+      auto first = pending_.begin();
+      auto end = std::next(first);
+      while (end != pending_.end() && end->first == std::prev(end)->first + 1) ++end;
+      write_run(first, end);
+    }
+  }
+
+  // flush() puis fdatasync()
+  void sync() {
+    flush();
+    if (unsynced_) sync_data();
+  }
+
+  bool complete() const { return stats_.bytes_written == file_size_ && pending_.empty(); }
+  bool has(std::size_t index) const { return index < pieces_ && (written_[index] || pending_.count(index)); }
+  std::size_t piece_count() const { return pieces_; }
+  std::size_t piece_length(std::size_t index) const {
+    std::uint64_t begin = std::uint64_t(index) * piece_size_;
+    return static_cast<std::size_t>(std::min<std::uint64_t>(piece_size_, file_size_ - begin));
+  }
+  std::size_t buffered() const { return buffered_; }
+  std::size_t extents() const { return file_extents(fd_); }
+  int native_handle() const { return fd_; }
+  const piece_writer_stats& stats() const { return stats_; }
+
+private:
+  using pending_map = std::map<std::size_t, iobuf>;
+
+  // [first, end) : pièces consécutives → un pwritev (plusieurs si > IOV_MAX segments)
+  void write_run(pending_map::iterator first, pending_map::iterator end) {
+    std::vector<iovec> iov;
+    std::size_t bytes = 0;
+    for (auto it = first; it != end; ++it) {
+      for (const auto& s : it->second.segments()) iov.push_back(iovec{s.data(), s.length});
+      bytes += it->second.size();
+    }
+    std::uint64_t offset = std::uint64_t(first->first) * piece_size_;
+    if (auto ec = disk_detail::pwritev_all(fd_, offset, iov, &stats_.write_calls))
+      throw std::system_error(ec, "pwritev");
+    for (auto it = first; it != end; ++it) written_[it->first] = true;
+    pending_.erase(first, end);
+    buffered_ -= bytes;
+    unsynced_ += bytes;
+    stats_.bytes_written += bytes;
+    ++stats_.runs;
+  }
+
+  void sync_data() {
+    if (::fdatasync(fd_) != 0) throw std::system_error(errno, std::generic_category(), "fdatasync");
+    unsynced_ = 0;
+    ++stats_.syncs;
+  }
+
+  int fd_ = -1;
+  std::uint64_t file_size_;
+  std::size_t piece_size_;
+  std::size_t pieces_ = 0;
+  piece_writer_options opts_;
+  std::vector<bool> written_;
+  pending_map pending_;
+  std::size_t buffered_ = 0;
+  std::size_t unsynced_ = 0;
+  piece_writer_stats stats_;
+};
+
+} // namespace p2p
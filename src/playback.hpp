@@ -0,0 +1,408 @@
+// ===========================================
+// PLAYBACK.HPP
+// Téléchargement en mode lecture continue (audio / vidéo)
+// Objectif : les données arrivent dans l'ordre et à temps pour la lecture,
+//            pas seulement au plus tôt pour l'ensemble du fichier.
+//
+// playback_picker : fenêtre glissante de `window` pièces à partir de la
+// position de lecture. Chaque pièce de la fenêtre a une échéance :
+//     échéance(i) = instant de la position + (début(i) − position) / débit
+// (débit du média en octets/s ; une pièce déjà dépassée est due tout de suite).
+//   - dans la fenêtre, par échéance croissante : une pièce n'est confiée à
+//     un pair que s'il peut la livrer à temps (octets déjà demandés à ce
+//     pair + la pièce, divisés par son débit mesuré) ; une pièce déjà en
+//     retard ne part que vers un pair presque aussi rapide que le plus
+//     rapide. Les pairs lents ne reçoivent donc pas les pièces urgentes ;
+//   - une pièce demandée qui va manquer son échéance peut être redemandée
+//     à un pair rapide qui la livrera plus tôt (max_duplicates) ; à la
+//     réception, completed() renvoie les autres pairs à annuler. Un pair
+//     qui tarde au-delà de son débit estimé voit son estimation baisser ;
+//   - hors fenêtre : rarest-first (availability), qui ne voit jamais les
+//     pièces de la fenêtre dans son ensemble "voulu". Tant qu'une pièce de
+//     la fenêtre est en danger, un pair rapide déjà occupé ne reçoit pas
+//     de pièce rarest-first (elle passerait devant dans sa file) ;
+//   - plus rien à demander : fin de partie, redemande d'une pièce en vol.
+//
+// playback_reader : lecture séquentielle d'un fichier en cours de
+// téléchargement. async_read() n'attend que si la pièce à la position
+// courante manque, lit au plus jusqu'à la fin de cette pièce (disk_device)
+// et fait glisser la fenêtre. read() est la version bloquante, pour un
+// lecteur multimédia qui tourne dans son propre thread.
+//
+// Mono-thread (le thread de l'io_context qui gère les pairs), comme
+// availability ; seul playback_reader::read() s'appelle d'ailleurs.
+// ===========================================
+#pragma once
+
+#include "availability.hpp"
+#include "disk_io.hpp"
+#include "iobuf.hpp"
+
+#include <asio/io_context.hpp>
+#include <asio/post.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace p2p {
+
+struct playback_options {
+  std::size_t window = 32;            // pièces sous échéance après la position de lecture
+  double bitrate = 1 << 20;           // débit du média, octets/s
+  double initial_rate = 256 << 10;    // débit supposé d'un pair pas encore mesuré, octets/s
+  double rate_smoothing = 0.3;        // poids d'une nouvelle mesure (moyenne exponentielle)
+  double late_tolerance = 2.0;        // pièce en retard : pair au plus 2× plus lent que le plus rapide
+  std::size_t max_duplicates = 1;     // demandes supplémentaires d'une pièce en retard
+};
+
+struct playback_stats {
+  std::uint64_t deadline_picks = 0;   // pièces de la fenêtre
+  std::uint64_t rarest_picks = 0;     // pièces hors fenêtre
+  std::uint64_t duplicates = 0;       // redemandes d'une pièce qui allait être en retard
+  std::uint64_t skipped = 0;          // pièces de la fenêtre refusées à un pair trop lent
+};
+
+class playback_picker {
+public:
+  using clock = std::chrono::steady_clock;
+  using time_point = clock::time_point;
+
+  playback_picker(availability& av, std::uint64_t file_size, std::size_t piece_size, playback_options opts = {})
+    : av_(av),
+      file_size_(file_size),
+      piece_size_(piece_size),
+      pieces_(piece_size ? static_cast<std::size_t>((file_size + piece_size - 1) / piece_size) : 0),
+      opts_(opts),
+      state_(pieces_, missing) {
+    if (piece_size == 0 || pieces_ != av.pieces())
+      throw std::invalid_argument("playback_picker: geometry does not match availability");
+    if (opts_.window == 0 || opts_.bitrate <= 0) throw std::invalid_argument("playback_picker: bad options");
+    for (std::uint32_t i = 0; i < pieces_; ++i) av_.set_wanted(i, i >= window_end());
+  }
+
+  std::size_t pieces() const { return pieces_; }
+  std::size_t piece_size() const { return piece_size_; }
+  std::size_t piece_length(std::size_t i) const {
+    return static_cast<std::size_t>(std::min<std::uint64_t>(piece_size_, file_size_ - std::uint64_t(i) * piece_size_));
+  }
+  bool have(std::uint32_t piece) const { return state_.at(piece) == done; }
+  std::size_t remaining() const { return remaining_; }
+  std::uint64_t position() const { return position_; }
+  const playback_stats& stats() const { return stats_; }
+
+  // -------------------------------------------
+  // Position de lecture : fait glisser la fenêtre
+  // -------------------------------------------
+  void set_playhead(std::uint64_t position, time_point now) {
+    std::size_t old_first = window_first(), old_end = window_end();
+    position_ = std::min(position, file_size_);
+    position_time_ = now;
+    std::size_t first = window_first(), end = window_end();
+    // Pièces qui sortent de la fenêtre (devant elle après un retour en
+    // arrière) : rendues au rarest-first ; celles qui y entrent en sortent
+    for (std::size_t i = old_first; i < old_end; ++i)
+      if ((i < first || i >= end) && state_[i] == missing) av_.set_wanted(static_cast<std::uint32_t>(i), true);
+    for (std::size_t i = first; i < end; ++i)
+      if (state_[i] == missing) av_.set_wanted(static_cast<std::uint32_t>(i), false);
+  }
+
+  time_point deadline(std::size_t piece) const {
+    std::uint64_t start = std::uint64_t(piece) * piece_size_;
+    if (start <= position_) return position_time_;
+    return position_time_ + std::chrono::duration_cast<clock::duration>(
+                                std::chrono::duration<double>(double(start - position_) / opts_.bitrate));
+  }
+
+  // -------------------------------------------
+  // Pairs
+  // -------------------------------------------
+
+  // Débit observé d'un transfert (octets reçus pendant `seconds`)
+  void record_rate(std::uint32_t peer, std::size_t bytes, double seconds) {
+    if (seconds <= 0) return;
+    peer_slot(peer);
+    double sample = double(bytes) / seconds;
+    double& r = rate_[peer];
+    r = measured_[peer] ? r + opts_.rate_smoothing * (sample - r) : sample;
+    measured_[peer] = true;
+    fastest_ = *std::max_element(rate_.begin(), rate_.end());
+  }
+
+  double rate(std::uint32_t peer) const { return peer < rate_.size() ? rate_[peer] : opts_.initial_rate; }
+
+  // Prochaine pièce à demander au pair (nullopt : rien pour lui)
+  std::optional<std::uint32_t> pick(std::uint32_t peer, time_point now) {
+    peer_slot(peer);
+    bool fast_enough = rate_at(peer, now) * opts_.late_tolerance >= fastest_;
+    bool at_risk = false;   // une pièce de la fenêtre que ce pair a va être en retard
+    for (std::size_t i = window_first(); i < window_end(); ++i) {
+      auto piece = static_cast<std::uint32_t>(i);
+      if (state_[i] == done || !av_.has(peer, piece)) continue;
+      time_point arrival = eta(peer, piece, now);
+      auto best = transfer_time(i, fastest_);   // le plus rapide, au repos
+      auto slack = std::chrono::duration_cast<clock::duration>(best * opts_.late_tolerance);
+      time_point due = deadline(i);
+      if (state_[i] == missing) {
+        // À temps avec ce pair ; ou déjà en retard et ce pair est presque
+        // aussi rapide que le meilleur ; ou en retard depuis si longtemps
+        // qu'aucun rapide ne l'a prise (seuls des pairs lents l'ont)
+        if (arrival <= due || (due < now + best && fast_enough) || due + slack < now) {
+          ++stats_.deadline_picks;
+          request(peer, piece, arrival, now);
+          return piece;
+        }
+        ++stats_.skipped;
+        at_risk = true;
+        continue;
+      }
+      // En vol : redemande à un pair rapide si la demande en cours va
+      // rater l'échéance et que celui-ci livrerait plus tôt
+      auto& f = inflight_.at(piece);
+      if (f.peers.size() > opts_.max_duplicates ||
+          std::find(f.peers.begin(), f.peers.end(), peer) != f.peers.end())
+        continue;
+      time_point expected = projected(f, now);
+      if (expected <= due) continue;
+      if (arrival < expected && fast_enough) {
+        ++stats_.duplicates;
+        request(peer, piece, arrival, now);
+        return piece;
+      }
+      at_risk = true;
+    }
+    // Un pair rapide qui a déjà du travail garde sa place libre pour la
+    // fenêtre en danger plutôt que de s'allonger la file en rarest-first
+    if (at_risk && fast_enough && outstanding_[peer] > 0) return std::nullopt;
+    if (auto piece = av_.pick(peer)) {
+      ++stats_.rarest_picks;
+      request(peer, *piece, eta(peer, *piece, now), now);
+      return piece;
+    }
+    return endgame(peer, now);
+  }
+
+  // Pièce reçue et vérifiée. Renvoie les autres pairs à qui elle était
+  // demandée (à annuler) ; réveille les lecteurs qui l'attendaient.
+  std::vector<std::uint32_t> completed(std::uint32_t peer, std::uint32_t piece, time_point now = clock::now()) {
+    std::vector<std::uint32_t> cancel;
+    if (state_.at(piece) == done) return cancel;
+    if (auto it = inflight_.find(piece); it != inflight_.end()) {
+      for (std::uint32_t p : it->second.peers) {
+        outstanding_[p] -= piece_length(piece);
+        if (p != peer) cancel.push_back(p);
+      }
+      inflight_.erase(it);
+    }
+    if (peer < busy_since_.size()) busy_since_[peer] = now;   // il passe à la demande suivante
+    av_.set_wanted(piece, false);
+    state_[piece] = done;
+    --remaining_;
+    if (auto it = waiters_.find(piece); it != waiters_.end()) {
+      auto handlers = std::move(it->second);
+      waiters_.erase(it);
+      for (auto& h : handlers) h();
+    }
+    return cancel;
+  }
+
+  // Demande échouée ou annulée (choke, délai, pair parti)
+  void failed(std::uint32_t peer, std::uint32_t piece) {
+    auto it = inflight_.find(piece);
+    if (it == inflight_.end()) return;
+    auto& peers = it->second.peers;
+    auto p = std::find(peers.begin(), peers.end(), peer);
+    if (p == peers.end()) return;
+    peers.erase(p);
+    outstanding_[peer] -= piece_length(piece);
+    if (!peers.empty()) return;
+    inflight_.erase(it);
+    state_[piece] = missing;
+    if (piece < window_first() || piece >= window_end()) av_.set_wanted(piece, true);
+  }
+
+  void remove_peer(std::uint32_t peer) {
+    std::vector<std::uint32_t> pending;
+    for (const auto& [piece, f] : inflight_)
+      if (std::find(f.peers.begin(), f.peers.end(), peer) != f.peers.end()) pending.push_back(piece);
+    for (std::uint32_t piece : pending) failed(peer, piece);
+    av_.remove_peer(peer);
+  }
+
+  // Appelle `handler` (tout de suite si la pièce est là) quand la pièce arrive
+  void when_available(std::uint32_t piece, std::function<void()> handler) {
+    if (state_.at(piece) == done) return handler();
+    waiters_[piece].push_back(std::move(handler));
+  }
+
+private:
+  enum piece_state : std::uint8_t { missing, requested, done };
+
+  struct flight {
+    std::vector<std::uint32_t> peers;   // pairs à qui la pièce est demandée
+    time_point eta;                     // arrivée estimée la plus tôt
+    time_point since;                   // dernière demande
+  };
+
+  // Arrivée attendue d'une pièce en vol. Une fois l'estimation dépassée,
+  // le pair est plus lent que prévu : on suppose qu'il reste autant à
+  // attendre que ce qui s'est déjà écoulé.
+  static time_point projected(const flight& f, time_point now) {
+    return (f.eta > now) ? f.eta : now + (now - f.since);
+  }
+
+  std::size_t window_first() const { return static_cast<std::size_t>(std::min<std::uint64_t>(position_ / piece_size_, pieces_)); }
+  std::size_t window_end() const { return std::min(pieces_, window_first() + opts_.window); }
+
+  void peer_slot(std::uint32_t peer) {
+    if (peer < rate_.size()) return;
+    rate_.resize(peer + 1, opts_.initial_rate);
+    measured_.resize(peer + 1, false);
+    outstanding_.resize(peer + 1, 0);
+    busy_since_.resize(peer + 1);
+    fastest_ = std::max(fastest_, opts_.initial_rate);
+  }
+
+  clock::duration transfer_time(std::size_t piece, double rate) const {
+    return std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(double(piece_length(piece)) / rate));
+  }
+
+  // Débit du pair, revu à la baisse s'il sert sa demande en cours depuis
+  // plus longtemps que son débit ne le laisse prévoir (pair pas encore
+  // mesuré et lent, congestion, choke silencieux)
+  double rate_at(std::uint32_t peer, time_point now) const {
+    double r = rate_[peer];
+    if (outstanding_[peer] == 0) return r;
+    double waited = std::chrono::duration<double>(now - busy_since_[peer]).count();
+    if (waited * r > double(piece_size_)) r = double(piece_size_) / waited;
+    return r;
+  }
+
+  // Arrivée estimée si l'on demande la pièce au pair maintenant : il sert
+  // d'abord ce qu'on lui a déjà demandé
+  time_point eta(std::uint32_t peer, std::uint32_t piece, time_point now) const {
+    return now + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(
+                     double(outstanding_[peer] + piece_length(piece)) / rate_at(peer, now)));
+  }
+
+  // Plus rien à demander à ce pair : il redemande la pièce en vol qu'il
+  // livrerait le plus en avance sur la demande en cours (fin de
+  // téléchargement bloquée par un pair lent, hors fenêtre)
+  std::optional<std::uint32_t> endgame(std::uint32_t peer, time_point now) {
+    std::optional<std::uint32_t> best;
+    clock::duration best_gain{};
+    for (const auto& [piece, f] : inflight_) {
+      if (f.peers.size() > opts_.max_duplicates || !av_.has(peer, piece) ||
+          std::find(f.peers.begin(), f.peers.end(), peer) != f.peers.end())
+        continue;
+      clock::duration gain = projected(f, now) - eta(peer, piece, now);
+      if (gain > best_gain) {
+        best_gain = gain;
+        best = piece;
+      }
+    }
+    if (best) {
+      ++stats_.duplicates;
+      request(peer, *best, eta(peer, *best, now), now);
+    }
+    return best;
+  }
+
+  void request(std::uint32_t peer, std::uint32_t piece, time_point arrival, time_point now) {
+    av_.set_wanted(piece, false);
+    if (outstanding_[peer] == 0) busy_since_[peer] = now;
+    outstanding_[peer] += piece_length(piece);
+    auto& f = inflight_[piece];
+    f.eta = (state_[piece] == requested) ? std::min(projected(f, now), arrival) : arrival;
+    f.since = now;
+    f.peers.push_back(peer);
+    state_[piece] = requested;
+  }
+
+  availability& av_;
+  std::uint64_t file_size_;
+  std::size_t piece_size_;
+  std::size_t pieces_;
+  playback_options opts_;
+  std::vector<piece_state> state_;
+  std::size_t remaining_ = pieces_;
+  std::uint64_t position_ = 0;
+  time_point position_time_ = clock::now();
+
+  std::vector<double> rate_;                 // débit estimé par pair, octets/s
+  std::vector<bool> measured_;
+  std::vector<std::uint64_t> outstanding_;   // octets demandés et pas encore reçus, par pair
+  std::vector<time_point> busy_since_;       // début de la demande en cours, par pair
+  double fastest_ = 0;
+  std::unordered_map<std::uint32_t, flight> inflight_;
+  std::unordered_map<std::uint32_t, std::vector<std::function<void()>>> waiters_;
+  playback_stats stats_;
+};
+
+// ===========================================
+// Lecture séquentielle pendant le téléchargement
+// ===========================================
+class playback_reader {
+public:
+  using read_handler = std::function<void(std::error_code, iobuf)>;
+
+  playback_reader(asio::io_context& io, playback_picker& picker, disk_device& disk, std::shared_ptr<disk_file> file,
+                  std::uint64_t file_size)
+    : io_(io), picker_(picker), disk_(disk), file_(std::move(file)), file_size_(file_size) {}
+
+  std::uint64_t position() const { return position_; }
+
+  // Saut dans le média : la fenêtre suit
+  void seek(std::uint64_t position) {
+    position_ = std::min(position, file_size_);
+    picker_.set_playhead(position_, playback_picker::clock::now());
+  }
+
+  // Au plus `max` octets à partir de la position, sans dépasser la pièce
+  // courante ; n'attend que si cette pièce manque. Fin du média : eof.
+  void async_read(std::size_t max, read_handler handler) {
+    if (position_ >= file_size_) return asio::post(io_, [handler] { handler(asio::error::eof, iobuf()); });
+    std::uint64_t piece_size = picker_.piece_size();
+    auto piece = static_cast<std::uint32_t>(position_ / piece_size);
+    std::uint64_t piece_end = std::min<std::uint64_t>((std::uint64_t(piece) + 1) * piece_size, file_size_);
+    std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(max, piece_end - position_));
+    std::uint64_t offset = position_;
+    position_ += length;
+    picker_.set_playhead(offset, playback_picker::clock::now());
+    picker_.when_available(piece, [this, offset, length, handler = std::move(handler)]() mutable {
+      disk_.async_read(file_, offset, length, std::move(handler));
+    });
+  }
+
+  // Version bloquante, pour un autre thread que celui de l'io_context
+  iobuf read(std::size_t max) {
+    std::promise<iobuf> done;
+    auto result = done.get_future();
+    asio::post(io_, [&] {
+      async_read(max, [&](std::error_code ec, iobuf data) {
+        if (ec && ec != asio::error::eof) done.set_exception(std::make_exception_ptr(std::system_error(ec, "playback read")));
+        else done.set_value(std::move(data));
+      });
+    });
+    return result.get();
+  }
+
+private:
+  asio::io_context& io_;
+  playback_picker& picker_;
+  disk_device& disk_;
+  std::shared_ptr<disk_file> file_;
+  std::uint64_t file_size_;
+  std::uint64_t position_ = 0;
+};
+
+} // namespace p2p
@@ -0,0 +1,328 @@
+// ===========================================
+// PLUMTREE.HPP
+// Diffusion par arbres épidémiques (Plumtree) sur les voisins actifs
+// Objectif : qu'un gros message (un manifeste, un bloc de plusieurs Mio)
+//            traverse chaque lien de l'essaim une fois, pas autant de fois
+//            que le nœud a de voisins comme avec une rumeur pure.
+//
+// Chaque nœud range ses voisins (vue active de hyparview.hpp) en deux :
+//   - eager : reçoivent le message complet (gossip) dès sa première
+//     réception ;
+//   - lazy  : ne reçoivent que son identifiant (ihave).
+// Au départ tous les voisins sont eager : le premier message inonde.
+// Un doublon reçu d'un voisin le fait passer lazy des deux côtés (prune) :
+// les liens eager restants forment un arbre couvrant, celui des chemins
+// les plus rapides depuis la source.
+//
+// Réparation : un ihave pour un message toujours absent au bout de
+// ihave_timeout (la branche de l'arbre qui devait l'apporter est cassée)
+// → graft à l'annonceur, qui redevient eager et renvoie le message ; s'il
+// ne le fait pas en graft_timeout, on essaie l'annonceur suivant.
+// Optimisation : un ihave arrivé par un chemin plus court de
+// `optimization` sauts que celui du message reçu échange les deux liens
+// (graft du raccourci, prune de l'ancien parent).
+//
+// Les messages reçus restent servis aux graft tant qu'ils sont dans le
+// cache (`cache` derniers). Les identifiants vus sont retenus sur `history`
+// messages, et au moins `forget` tant qu'ils sont moins de 4 × history : un
+// ihave tardif pour un message déjà livré ne déclenche pas de graft.
+// Un message annoncé mais jamais reçu est abandonné au bout de `forget`
+// (au plus `history` en attente, les plus anciens abandonnés d'abord).
+//
+// Sans E/S (voir overlay.hpp) : send(to, message), deliver(id, payload) ;
+// neighbor_up / neighbor_down branchés sur le on_active de hyparview : eux
+// seuls définissent les voisins. Un message en vol d'un nœud qui n'en est
+// plus un est livré s'il est nouveau, mais ne crée aucun lien (ni eager ni
+// lazy), n'est pas retenu comme annonceur et ses graft sont ignorés ;
+// tick(now) rend l'échéance suivante (next_deadline() après receive()).
+// Mono-thread.
+// ===========================================
+#pragma once
+
+#include "iobuf.hpp"
+#include "overlay.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace p2p {
+
+struct plumtree_options {
+  std::chrono::milliseconds ihave_timeout{500};   // ihave sans message → graft (gros messages : plusieurs sauts de transfert)
+  std::chrono::milliseconds graft_timeout{250};   // graft sans réponse → annonceur suivant
+  std::uint32_t optimization = 3;                 // sauts gagnés pour échanger deux liens (0 : jamais)
+  std::size_t cache = 64;                         // messages gardés pour les graft
+  std::size_t history = 1 << 16;                  // identifiants vus retenus, messages annoncés en attente
+  std::chrono::milliseconds forget{60000};        // rétention minimale des vus ; abandon d'un annoncé jamais reçu
+  bool prune = true;                              // false : inondation de tous les voisins (comparaison)
+};
+
+struct plumtree_message {
+  enum kind_t : std::uint8_t { gossip, ihave, graft, prune };
+
+  kind_t kind = gossip;
+  std::uint64_t id = 0;
+  std::uint32_t round = 0;   // sauts depuis la source ; graft : link_only si le message est déjà reçu
+  iobuf payload;             // gossip seulement
+
+  static constexpr std::uint32_t link_only = UINT32_MAX;
+
+  std::size_t wire_size() const { return 24 + payload.size(); }
+};
+
+struct plumtree_stats {
+  std::uint64_t delivered = 0;
+  std::uint64_t payloads_sent = 0;   // messages complets émis
+  std::uint64_t duplicates = 0;      // messages complets reçus en double
+  std::uint64_t ihaves = 0;
+  std::uint64_t grafts = 0;
+  std::uint64_t prunes = 0;
+};
+
+class plumtree {
+public:
+  using clock = std::chrono::steady_clock;
+  using time_point = clock::time_point;
+  using send_fn = std::function<void(node_id to, plumtree_message msg)>;
+  using deliver_fn = std::function<void(std::uint64_t id, const iobuf& payload)>;
+
+  plumtree(node_id self, send_fn send, deliver_fn deliver, plumtree_options opts = {})
+    : self_(self), send_(std::move(send)), deliver_(std::move(deliver)), opts_(opts) {}
+
+  const std::vector<node_id>& eager() const { return eager_; }
+  const std::vector<node_id>& lazy() const { return lazy_; }
+  const plumtree_stats& stats() const { return stats_; }
+
+  // -------------------------------------------
+  // Voisins (vue active)
+  // -------------------------------------------
+  void neighbor_up(node_id n) {
+    if (n == self_ || overlay::contains(neighbors_, n)) return;
+    neighbors_.push_back(n);
+    eager_.push_back(n);
+  }
+
+  void neighbor_down(node_id n) {
+    if (!overlay::erase_unordered(neighbors_, n)) return;
+    overlay::erase_unordered(eager_, n);
+    overlay::erase_unordered(lazy_, n);
+    for (auto& [id, m] : missing_)
+      m.sources.erase(std::remove_if(m.sources.begin(), m.sources.end(), [n](const source& s) { return s.from == n; }),
+                      m.sources.end());
+  }
+
+  // -------------------------------------------
+  // Diffusion
+  // -------------------------------------------
+  void broadcast(std::uint64_t id, iobuf payload) {
+    if (seen_.count(id)) return;
+    accept(id, 0, self_, std::move(payload));
+  }
+
+  void receive(node_id from, plumtree_message m, time_point now) {
+    now_ = now;
+    switch (m.kind) {
+      case plumtree_message::gossip: {
+        auto it = seen_.find(m.id);
+        if (it == seen_.end()) {
+          make_eager(from);
+          accept(m.id, m.round + 1, from, std::move(m.payload));
+        } else {
+          ++stats_.duplicates;
+          if (opts_.prune && is_neighbor(from)) {
+            make_lazy(from);
+            send(from, {plumtree_message::prune, m.id, 0, {}});
+          }
+        }
+        break;
+      }
+
+      case plumtree_message::ihave: {
+        if (!is_neighbor(from)) break;   // annonceur hors vue active : jamais grafté
+        auto it = seen_.find(m.id);
+        if (it != seen_.end()) {
+          // Raccourci : l'annonceur est plus près de la source que notre parent
+          if (opts_.prune && opts_.optimization && m.round + opts_.optimization < it->second.round &&
+              it->second.parent != self_ && it->second.parent != from && overlay::contains(eager_, it->second.parent)) {
+            node_id old = it->second.parent;
+            it->second.parent = from;
+            it->second.round = m.round + 1;
+            make_eager(from);
+            send(from, {plumtree_message::graft, m.id, plumtree_message::link_only, {}});
+            make_lazy(old);
+            send(old, {plumtree_message::prune, m.id, 0, {}});
+          }
+          break;
+        }
+        auto [mi, fresh] = missing_.try_emplace(m.id);
+        missing& e = mi->second;
+        if (fresh) {
+          e.deadline = now + opts_.ihave_timeout;
+          e.expires = now + opts_.forget;
+          missing_order_.push_back(m.id);
+          trim_missing();
+        } else if (e.parked) {
+          e.parked = false;   // annonceurs épuisés : graft immédiat au nouveau
+          e.deadline = now;
+        }
+        e.sources.push_back({from, m.round});
+        break;
+      }
+
+      case plumtree_message::graft: {
+        if (!is_neighbor(from)) break;
+        make_eager(from);
+        auto it = seen_.find(m.id);
+        auto p = payloads_.find(m.id);
+        if (m.round != plumtree_message::link_only && it != seen_.end() && p != payloads_.end())
+          send(from, {plumtree_message::gossip, m.id, it->second.round, p->second.clone()});
+        break;
+      }
+
+      case plumtree_message::prune:
+        make_lazy(from);
+        break;
+    }
+  }
+
+  // -------------------------------------------
+  // Minuteries des messages annoncés mais pas reçus
+  // -------------------------------------------
+  time_point tick(time_point now) {
+    now_ = now;
+    for (auto it = missing_.begin(); it != missing_.end();) {
+      auto& [id, m] = *it;
+      if (m.deadline > now) {
+        ++it;
+        continue;
+      }
+      if (m.sources.empty()) {
+        if (m.parked || m.expires <= now) {
+          it = missing_.erase(it);   // jamais reçu : abandonné
+          continue;
+        }
+        m.parked = true;             // en attente d'un autre ihave jusqu'à l'abandon
+        m.deadline = m.expires;
+        ++it;
+        continue;
+      }
+      source s = m.sources.front();
+      m.sources.erase(m.sources.begin());
+      make_eager(s.from);
+      ++stats_.grafts;
+      send(s.from, {plumtree_message::graft, id, s.round, {}});
+      m.deadline = now + opts_.graft_timeout;
+      ++it;
+    }
+    trim_missing();
+    return next_deadline();
+  }
+
+  time_point next_deadline() const {
+    time_point next = time_point::max();
+    for (const auto& [id, m] : missing_) next = std::min(next, m.deadline);
+    return next;
+  }
+
+private:
+  struct source {
+    node_id from;
+    std::uint32_t round;
+  };
+
+  struct missing {
+    std::vector<source> sources;   // annonceurs, dans l'ordre d'arrivée
+    time_point deadline;
+    time_point expires;            // abandon
+    bool parked = false;           // annonceurs épuisés
+  };
+
+  struct seen {
+    std::uint32_t round;
+    node_id parent;
+    time_point at;                 // première réception
+  };
+
+  // Au plus `history` messages annoncés en attente : les plus anciens
+  // sont abandonnés (les identifiants déjà reçus ou abandonnés sont sautés)
+  void trim_missing() {
+    while (!missing_order_.empty() &&
+           (missing_.size() > opts_.history || !missing_.count(missing_order_.front()))) {
+      missing_.erase(missing_order_.front());
+      missing_order_.pop_front();
+    }
+  }
+
+  void send(node_id to, plumtree_message m) {
+    if (m.kind == plumtree_message::gossip) ++stats_.payloads_sent;
+    if (m.kind == plumtree_message::ihave) ++stats_.ihaves;
+    if (m.kind == plumtree_message::prune) ++stats_.prunes;
+    send_(to, std::move(m));
+  }
+
+  bool is_neighbor(node_id n) const { return overlay::contains(neighbors_, n); }
+
+  // Les deux ignorent un nœud hors de la vue active
+  void make_eager(node_id n) {
+    if (!is_neighbor(n)) return;
+    overlay::erase_unordered(lazy_, n);
+    if (!overlay::contains(eager_, n)) eager_.push_back(n);
+  }
+
+  void make_lazy(node_id n) {
+    if (!overlay::erase_unordered(eager_, n)) return;
+    lazy_.push_back(n);
+  }
+
+  // Première réception (ou émission) : livraison, puis eager push / lazy push
+  void accept(std::uint64_t id, std::uint32_t round, node_id from, iobuf payload) {
+    missing_.erase(id);
+    trim_missing();
+    seen_.emplace(id, seen{round, from, now_});
+    seen_order_.push_back(id);
+    while (seen_order_.size() > opts_.history) {
+      const seen& oldest = seen_.at(seen_order_.front());
+      if (seen_order_.size() <= 4 * opts_.history && now_ - oldest.at < opts_.forget) break;
+      seen_.erase(seen_order_.front());
+      seen_order_.pop_front();
+    }
+    ++stats_.delivered;
+    if (deliver_) deliver_(id, payload);
+
+    for (node_id n : eager_)
+      if (n != from) send(n, {plumtree_message::gossip, id, round, payload.clone()});
+    for (node_id n : lazy_)
+      if (n != from) send(n, {plumtree_message::ihave, id, round, {}});
+
+    payloads_.emplace(id, std::move(payload));
+    payload_order_.push_back(id);
+    if (payload_order_.size() > opts_.cache) {
+      payloads_.erase(payload_order_.front());
+      payload_order_.pop_front();
+    }
+  }
+
+  node_id self_;
+  send_fn send_;
+  deliver_fn deliver_;
+  plumtree_options opts_;
+  std::vector<node_id> neighbors_;   // vue active (neighbor_up / neighbor_down)
+  std::vector<node_id> eager_, lazy_;   // partition de neighbors_
+  std::unordered_map<std::uint64_t, seen> seen_;
+  std::deque<std::uint64_t> seen_order_;
+  std::unordered_map<std::uint64_t, iobuf> payloads_;
+  std::deque<std::uint64_t> payload_order_;
+  std::unordered_map<std::uint64_t, missing> missing_;
+  std::deque<std::uint64_t> missing_order_;
+  time_point now_{};   // dernier instant reçu de receive() / tick()
+  plumtree_stats stats_;
+};
+
+} // namespace p2p
@@ -0,0 +1,298 @@
+// ===========================================
+// PUSH_CHAIN.HPP
+// Distribution poussée d'un gros fichier : réplication en chaîne pipelinée
+// Objectif : qu'une source unique remplisse des centaines de récepteurs en
+//            à peu près taille / débit + profondeur du pipeline, quel que
+//            soit leur nombre, au lieu de taille × récepteurs / débit quand
+//            elle les sert tous elle-même.
+//
+// push_plan : la source range les récepteurs en chaînes ou en arbre et
+// diffuse ce plan avec l'annonce du fichier (quelques Kio) :
+//   - (1, 1)  une chaîne : tout le débit montant de chaque nœud sert son
+//             unique successeur ; profondeur = nombre de récepteurs ;
+//   - (k, 1)  k chaînes : la source partage son débit en k, profondeur / k ;
+//   - (f, f)  arbre f-aire : profondeur log_f, mais débit / f à chaque saut.
+// nearest_first() ordonne les récepteurs du plus proche au plus proche
+// (tournée gloutonne) : des sauts courts dans chaque chaîne.
+//
+// push_node : chaque chunk reçu est vérifié (verify, typiquement
+// l'empreinte SHA-256 du manifeste, voir digest_verifier) puis rangé
+// (store) et relayé aussitôt aux enfants, sans attendre la fin du fichier
+// (cut-through). Par enfant, au plus `window` chunks non acquittés (ack
+// de l'enfant à chaque chunk rangé) : la file d'envoi de la source reste
+// bornée même pour un fichier de plusieurs Gio ; les chunks relus (load)
+// pour les enfants viennent du stockage, pas de la mémoire.
+//   - chunk corrompu : l'enfant le redemande seul (retry) ;
+//   - enfant perdu (peer_lost : envoi refusé, session rompue) : le nœud
+//     adopte ses enfants dans le plan (adopt) ; chacun répond par le
+//     premier chunk qui lui manque (resume) et le flux reprend de là.
+//
+// Sans E/S (voir overlay.hpp) : send(to, message). Mono-thread.
+// ===========================================
+#pragma once
+
+#include "iobuf.hpp"
+#include "overlay.hpp"
+#include "piece_bitmap.hpp"
+#include "sha256.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace p2p {
+
+struct push_options {
+  std::uint32_t window = 16;   // chunks non acquittés par enfant
+};
+
+struct push_message {
+  enum kind_t : std::uint8_t { chunk, ack, retry, adopt, resume };
+
+  kind_t kind = chunk;
+  std::uint32_t index = 0;   // chunk ; resume : premier chunk manquant
+  iobuf payload;             // chunk seulement
+
+  std::size_t wire_size() const { return 16 + payload.size(); }
+};
+
+struct push_stats {
+  std::uint64_t received = 0;     // chunks vérifiés et rangés
+  std::uint64_t sent = 0;         // chunks émis
+  std::uint64_t duplicates = 0;   // chunks déjà reçus (reprise après adoption)
+  std::uint64_t corrupt = 0;      // chunks rejetés par verify
+  std::uint64_t adopted = 0;      // enfants repris à un enfant perdu
+};
+
+// ===========================================
+// Plan : arbre de diffusion partagé par tous les nœuds
+// ===========================================
+class push_plan {
+public:
+  // root_fanout enfants pour la source, fanout pour chaque récepteur.
+  // fanout == 1 : root_fanout chaînes, chacune un segment contigu de
+  // `receivers` ; sinon arbre rempli en largeur dans l'ordre de `receivers`.
+  push_plan(node_id seed, std::vector<node_id> receivers, std::size_t root_fanout = 1, std::size_t fanout = 1) {
+    if (root_fanout == 0 || fanout == 0) throw std::invalid_argument("push_plan: fanout must be positive");
+    nodes_.reserve(receivers.size() + 1);
+    nodes_.push_back(seed);
+    nodes_.insert(nodes_.end(), receivers.begin(), receivers.end());
+    children_.resize(nodes_.size());
+    depth_.assign(nodes_.size(), 0);
+    for (std::size_t p = 0; p < nodes_.size(); ++p)
+      if (!pos_.emplace(nodes_[p], std::uint32_t(p)).second) throw std::invalid_argument("push_plan: duplicate node");
+
+    std::size_t n = receivers.size();
+    if (fanout == 1) {
+      std::size_t chains = std::min(root_fanout, n);
+      for (std::size_t c = 0, first = 1; c < chains; ++c) {
+        std::size_t len = n / chains + (c < n % chains);
+        link(0, first);
+        for (std::size_t p = first + 1; p < first + len; ++p) link(p - 1, p);
+        first += len;
+      }
+    } else {
+      std::size_t next = 1;
+      for (std::size_t p = 0; p < nodes_.size() && next < nodes_.size(); ++p)
+        for (std::size_t k = 0; k < (p == 0 ? root_fanout : fanout) && next < nodes_.size(); ++k) link(p, next++);
+    }
+  }
+
+  // Tournée gloutonne : à chaque pas, le récepteur restant le plus proche
+  // du précédent. latency(a, b) : estimation quelconque (mesurée, prédite).
+  template <class Latency>
+  static std::vector<node_id> nearest_first(node_id seed, std::vector<node_id> receivers, Latency&& latency) {
+    node_id at = seed;
+    for (std::size_t i = 0; i < receivers.size(); ++i) {
+      std::size_t best = i;
+      double best_latency = std::numeric_limits<double>::infinity();
+      for (std::size_t j = i; j < receivers.size(); ++j) {
+        double l = latency(at, receivers[j]);
+        if (l < best_latency) {
+          best_latency = l;
+          best = j;
+        }
+      }
+      std::swap(receivers[i], receivers[best]);
+      at = receivers[i];
+    }
+    return receivers;
+  }
+
+  node_id seed() const { return nodes_[0]; }
+  std::size_t size() const { return nodes_.size(); }
+  bool contains(node_id n) const { return pos_.count(n) != 0; }
+
+  std::span<const node_id> children(node_id n) const {
+    auto it = pos_.find(n);
+    if (it == pos_.end()) return {};
+    return children_[it->second];
+  }
+
+  // Profondeur maximale (sauts depuis la source)
+  std::size_t depth() const { return *std::max_element(depth_.begin(), depth_.end()); }
+
+private:
+  void link(std::size_t parent, std::size_t child) {
+    children_[parent].push_back(nodes_[child]);
+    depth_[child] = depth_[parent] + 1;
+  }
+
+  std::vector<node_id> nodes_;   // nodes_[0] = source
+  std::vector<std::vector<node_id>> children_;
+  std::vector<std::uint32_t> depth_;
+  std::unordered_map<node_id, std::uint32_t> pos_;
+};
+
+// -------------------------------------------
+// Vérification par les empreintes du manifeste (une par chunk)
+// -------------------------------------------
+inline std::function<bool(std::uint32_t, const iobuf&)> digest_verifier(std::vector<digest> digests) {
+  return [digests = std::move(digests)](std::uint32_t index, const iobuf& payload) {
+    if (index >= digests.size()) return false;
+    sha256 h;
+    for (const auto& s : payload.segments()) h.update(s.data(), s.length);
+    return h.finish() == digests[index];
+  };
+}
+
+// ===========================================
+// Nœud : reçoit, vérifie, range et relaie
+// ===========================================
+class push_node {
+public:
+  using send_fn = std::function<void(node_id to, push_message msg)>;
+  using verify_fn = std::function<bool(std::uint32_t index, const iobuf& payload)>;
+  using store_fn = std::function<void(std::uint32_t index, const iobuf& payload)>;
+  using load_fn = std::function<iobuf(std::uint32_t index)>;
+
+  push_node(node_id self, const push_plan& plan, std::uint32_t chunks, send_fn send, verify_fn verify, store_fn store,
+            load_fn load, push_options opts = {})
+    : self_(self), plan_(plan), chunks_(chunks), send_(std::move(send)), verify_(std::move(verify)),
+      store_(std::move(store)), load_(std::move(load)), opts_(opts) {
+    if (opts_.window == 0) throw std::invalid_argument("push_node: window must be positive");
+    for (node_id c : plan_.children(self_)) children_.push_back({c, 0, 0, false});
+  }
+
+  const push_stats& stats() const { return stats_; }
+  std::uint32_t received() const { return std::uint32_t(have_.cardinality()); }
+  bool complete() const { return have_.cardinality() == chunks_; }
+
+  // Source : possède déjà tous les chunks
+  void start() {
+    for (std::uint32_t i = 0; i < chunks_; ++i) have_.add(i);
+    contiguous_ = chunks_;
+    pump_all();
+  }
+
+  void receive(node_id from, push_message m) {
+    switch (m.kind) {
+      case push_message::chunk:
+        if (m.index >= chunks_) return;
+        if (have_.contains(m.index)) {
+          ++stats_.duplicates;
+        } else if (verify_ && !verify_(m.index, m.payload)) {
+          ++stats_.corrupt;
+          send_(from, {push_message::retry, m.index, {}});
+          return;
+        } else {
+          have_.add(m.index);
+          while (contiguous_ < chunks_ && have_.contains(contiguous_)) ++contiguous_;
+          ++stats_.received;
+          if (store_) store_(m.index, m.payload);
+        }
+        send_(from, {push_message::ack, m.index, {}});
+        pump_all();
+        break;
+
+      case push_message::ack:
+        if (child* c = find(from)) {
+          c->acked = std::max(c->acked, m.index + 1);
+          pump(*c);
+        }
+        break;
+
+      case push_message::retry:
+        if (find(from) && have_.contains(m.index)) send_chunk(from, m.index);
+        break;
+
+      case push_message::adopt:
+        send_(from, {push_message::resume, contiguous_, {}});
+        break;
+
+      case push_message::resume:
+        if (child* c = find(from)) {
+          c->next = c->acked = m.index;
+          c->waiting = false;
+          pump(*c);
+        }
+        break;
+    }
+  }
+
+  // Envoi vers n refusé ou session rompue : s'il était un enfant, ses
+  // enfants du plan passent sous ce nœud
+  void peer_lost(node_id n) {
+    auto it = std::find_if(children_.begin(), children_.end(), [n](const child& c) { return c.id == n; });
+    if (it == children_.end()) return;
+    children_.erase(it);
+    for (node_id g : plan_.children(n)) {
+      if (g == self_ || find(g)) continue;
+      children_.push_back({g, 0, 0, true});
+      ++stats_.adopted;
+      send_(g, {push_message::adopt, 0, {}});
+    }
+  }
+
+private:
+  struct child {
+    node_id id;
+    std::uint32_t next;    // prochain chunk à envoyer
+    std::uint32_t acked;   // chunks acquittés en deçà
+    bool waiting;          // adopté, en attente de son resume
+  };
+
+  child* find(node_id n) {
+    for (auto& c : children_)
+      if (c.id == n) return &c;
+    return nullptr;
+  }
+
+  void send_chunk(node_id to, std::uint32_t index) {
+    ++stats_.sent;
+    send_(to, {push_message::chunk, index, load_(index)});
+  }
+
+  // Chunks dans l'ordre, dès qu'ils sont là, dans la limite de la fenêtre
+  void pump(child& c) {
+    if (c.waiting) return;
+    while (c.next < chunks_ && have_.contains(c.next) && c.next - std::min(c.acked, c.next) < opts_.window)
+      send_chunk(c.id, c.next++);
+  }
+
+  void pump_all() {
+    for (auto& c : children_) pump(c);
+  }
+
+  node_id self_;
+  const push_plan& plan_;
+  std::uint32_t chunks_;
+  send_fn send_;
+  verify_fn verify_;
+  store_fn store_;
+  load_fn load_;
+  push_options opts_;
+  piece_bitmap have_;
+  std::uint32_t contiguous_ = 0;   // chunks [0, contiguous_) tous reçus
+  std::vector<child> children_;
+  push_stats stats_;
+};
+
+} // namespace p2p
@@ -0,0 +1,526 @@
+// ===========================================
+// RESUME_STATE.HPP
+// Reprise d'un téléchargement après redémarrage
+// Objectif : un pair qui redémarre au milieu d'un téléchargement reprend
+//            tout de suite, sans re-hacher des gigaoctets pour savoir ce
+//            qu'il possède déjà.
+//
+// Fichier annexe <data>.resume :
+//   - instantané : en-tête (géométrie, mtime du fichier de données au
+//     moment de l'instantané, CRC32C), bitfield des pièces complètes,
+//     empreinte SHA-256 attendue de chaque pièce ;
+//   - journal : enregistrements de 16 octets ajoutés à la suite
+//     (pièce complète / pièce invalidée, mtime des données, CRC32C).
+//     commit() les écrit d'un seul fdatasync ; checkpoint() réécrit
+//     l'instantané (fichier voisin + rename) et vide le journal.
+//
+// À la réouverture, le dernier mtime enregistré est comparé à celui du
+// fichier de données :
+//   - identiques : le bitfield est cru tel quel, rien n'est relu ;
+//   - différents (arrêt brutal entre une écriture et son commit, fichier
+//     modifié à la main...) : les pièces possédées passent "à vérifier".
+//     Le téléchargement reprend aussitôt (elles ne sont pas redemandées) ;
+//     verify_async() les re-hache par lots en arrière-plan sur le pool CPU,
+//     les plus récentes du journal d'abord, et prioritize() fait passer
+//     devant une pièce qu'un pair demande. Une pièce fausse redevient
+//     manquante.
+//
+// Contrat : mark_complete(i) seulement quand les données de la pièce sont
+// durables (piece_writer::sync()), sinon le mtime enregistré ment.
+// Thread-safe (un mutex) : le pool de vérification et le thread du
+// téléchargement y accèdent en même temps.
+// ===========================================
+#pragma once
+
+#include "crc32c.hpp"
+#include "sha256.hpp"    // digest, hash_many
+
+#include <asio/post.hpp>
+#include <asio/thread_pool.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace p2p {
+
+enum class piece_state : std::uint8_t { missing, unverified, complete };
+
+struct resume_stats {
+  std::size_t pieces = 0;
+  std::size_t complete = 0;        // vérifiées (ou crues : mtime cohérent)
+  std::size_t unverified = 0;      // possédées, en attente de vérification
+  std::size_t verified = 0;        // re-hachées depuis l'ouverture
+  std::size_t failed = 0;          // re-hachées et fausses (redevenues manquantes)
+  std::size_t replayed = 0;        // enregistrements du journal rejoués à l'ouverture
+  bool resumed = false;            // état repris d'un fichier annexe existant
+};
+
+class resume_state {
+public:
+  // Crée ou reprend l'état du téléchargement de `data_path`. Un fichier
+  // annexe absent, corrompu ou d'un autre contenu (géométrie, empreintes)
+  // est remplacé par un état vide.
+  resume_state(std::string data_path, std::uint64_t file_size, std::size_t piece_size,
+               std::vector<digest> piece_hashes)
+    : data_path_(std::move(data_path)), path_(data_path_ + ".resume") {
+    if (piece_size == 0 || piece_size > UINT32_MAX)   // l'en-tête stocke la taille sur 32 bits
+      throw std::invalid_argument("resume_state: piece size must be in [1, 2^32)");
+    if (piece_hashes.size() != (file_size + piece_size - 1) / piece_size)
+      throw std::invalid_argument("resume_state: piece count does not match file and piece sizes");
+    if (!load(&piece_hashes, file_size, piece_size)) reset(file_size, piece_size, std::move(piece_hashes));
+    open_journal();
+  }
+
+  // Reprend uniquement depuis le fichier annexe (géométrie et empreintes comprises)
+  explicit resume_state(std::string data_path) : data_path_(std::move(data_path)), path_(data_path_ + ".resume") {
+    if (!load(nullptr, 0, 0)) throw std::runtime_error("resume_state: no usable " + path_);
+    open_journal();
+  }
+
+  resume_state(const resume_state&) = delete;
+  resume_state& operator=(const resume_state&) = delete;
+
+  // Fermeture propre : vérification interrompue, journal repris dans l'instantané
+  ~resume_state() {
+    {
+      std::unique_lock lock(mutex_);
+      stop_ = true;
+      idle_.wait(lock, [&] { return !verifying_; });
+    }
+    try {
+      checkpoint();
+    } catch (...) {
+    }
+    ::close(fd_);
+    if (data_fd_ >= 0) ::close(data_fd_);
+  }
+
+  // -------------------------------------------
+  // Lecture de l'état
+  // -------------------------------------------
+  piece_state state(std::size_t i) const {
+    std::lock_guard lock(mutex_);
+    return state_.at(i);
+  }
+  // Possédée (ne pas la redemander), vérifiée ou non
+  bool have(std::size_t i) const { return state(i) != piece_state::missing; }
+  // Servable à un pair
+  bool verified(std::size_t i) const { return state(i) == piece_state::complete; }
+
+  std::size_t piece_count() const { return state_.size(); }
+  std::size_t piece_size() const { return piece_size_; }
+  std::uint64_t file_size() const { return file_size_; }
+  const digest& expected(std::size_t i) const { return hashes_.at(i); }
+  const std::string& path() const { return path_; }
+
+  bool needs_verification() const {
+    std::lock_guard lock(mutex_);
+    return stats_.unverified != 0;
+  }
+
+  resume_stats stats() const {
+    std::lock_guard lock(mutex_);
+    return stats_;
+  }
+
+  // -------------------------------------------
+  // Progression du téléchargement
+  // -------------------------------------------
+
+  // Pièce écrite, vérifiée et durable dans le fichier de données
+  void mark_complete(std::size_t i) {
+    std::lock_guard lock(mutex_);
+    set_state(i, piece_state::complete);
+    log(static_cast<std::uint32_t>(i));
+  }
+
+  // Enregistrements en attente → fichier annexe, un seul fdatasync
+  void commit() {
+    std::lock_guard lock(mutex_);
+    flush_records();
+  }
+
+  // Instantané réécrit (mtime actuel des données), journal vidé
+  void checkpoint() {
+    std::lock_guard lock(mutex_);
+    write_snapshot();
+  }
+
+  // -------------------------------------------
+  // Vérification paresseuse
+  // -------------------------------------------
+
+  // Re-hache les pièces "à vérifier" sur `pool`, `batch` pièces par tâche
+  // (une seule chaîne de tâches : le pool reste disponible pour le reste).
+  // `on_done` est appelé sur un thread du pool à la fin, wait_verified() déjà
+  // débloqué.
+  void verify_async(asio::thread_pool& pool, std::function<void(const resume_stats&)> on_done = {},
+                    std::size_t batch = 16) {
+    std::lock_guard lock(mutex_);
+    if (verifying_) return;
+    if (data_fd_ < 0) {
+      data_fd_ = ::open(data_path_.c_str(), O_RDONLY | O_CLOEXEC);
+      if (data_fd_ < 0) throw std::system_error(errno, std::generic_category(), "open " + data_path_);
+    }
+    verifying_ = true;
+    asio::post(pool, [this, &pool, on_done = std::move(on_done), batch = std::max<std::size_t>(batch, 1)] {
+      verify_step(pool, on_done, batch);
+    });
+  }
+
+  // Un pair demande la pièce i : la vérifier avant les autres
+  void prioritize(std::size_t i) {
+    std::lock_guard lock(mutex_);
+    if (state_.at(i) == piece_state::unverified) urgent_.push_back(i);
+  }
+
+  // Attend la fin de la vérification en cours
+  void wait_verified() {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [&] { return !verifying_; });
+  }
+
+private:
+  static constexpr std::uint64_t magic = 0x3130534552503250ull;   // "P2PRES01"
+  static constexpr std::size_t record_size = 16;
+  static constexpr std::uint32_t cleared = 1u << 31;              // pièce invalidée
+  static constexpr std::int64_t unverified_mtime = -1;            // vérification inachevée
+
+  struct header {
+    std::uint64_t magic;
+    std::uint64_t file_size;
+    std::uint32_t piece_size;
+    std::uint32_t pieces;
+    std::int64_t data_mtime;    // ns ; -1 = vérification inachevée
+    std::uint32_t crc;          // CRC32C de l'en-tête (crc = 0), du bitfield et des empreintes
+    std::uint8_t pad[28];
+  };
+  static_assert(sizeof(header) == 64);
+
+  // -------------------------------------------
+  // Ouverture
+  // -------------------------------------------
+  static std::int64_t mtime_of(const std::string& path, std::uint64_t* size = nullptr) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) return 0;
+    if (size) *size = static_cast<std::uint64_t>(st.st_size);
+    return std::int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+  }
+
+  std::size_t snapshot_size(std::size_t pieces) const { return sizeof(header) + (pieces + 7) / 8 + pieces * 32; }
+
+  // Instantané + journal ; false si absent ou inutilisable. Si `want` est
+  // fourni, la géométrie (want_size, want_piece) doit aussi correspondre.
+  bool load(const std::vector<digest>* want, std::uint64_t want_size, std::size_t want_piece) {
+    int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    std::vector<unsigned char> bytes;
+    struct stat st;
+    bool ok = ::fstat(fd, &st) == 0;
+    if (ok) {
+      bytes.resize(static_cast<std::size_t>(st.st_size));
+      std::size_t got = 0;
+      while (ok && got < bytes.size()) {
+        ssize_t n = ::pread(fd, bytes.data() + got, bytes.size() - got, static_cast<off_t>(got));
+        if (n < 0 && errno == EINTR) continue;
+        ok = n > 0;
+        if (ok) got += static_cast<std::size_t>(n);
+      }
+    }
+    ::close(fd);
+    if (!ok || bytes.size() < sizeof(header)) return false;
+
+    header h;
+    std::memcpy(&h, bytes.data(), sizeof h);
+    if (h.magic != magic || h.piece_size == 0 || bytes.size() < snapshot_size(h.pieces) ||
+        h.pieces != (h.file_size + h.piece_size - 1) / h.piece_size)
+      return false;
+    std::size_t snap = snapshot_size(h.pieces);
+    std::uint32_t crc = h.crc;
+    std::memset(bytes.data() + offsetof(header, crc), 0, sizeof h.crc);
+    if (crc32c::value(bytes.data(), snap) != crc) return false;
+
+    const unsigned char* bits = bytes.data() + sizeof(header);
+    const unsigned char* sums = bits + (h.pieces + 7) / 8;
+    hashes_.resize(h.pieces);
+    for (std::size_t i = 0; i < h.pieces; ++i) std::memcpy(hashes_[i].data(), sums + 32 * i, 32);
+    if (want && (h.file_size != want_size || h.piece_size != want_piece || want->size() != h.pieces ||
+                 *want != hashes_))
+      return false;   // autre contenu ou autre découpage
+
+    file_size_ = h.file_size;
+    piece_size_ = h.piece_size;
+    state_.assign(h.pieces, piece_state::missing);
+    stats_ = {};
+    stats_.pieces = h.pieces;
+    for (std::size_t i = 0; i < h.pieces; ++i)
+      if (bits[i / 8] >> (i % 8) & 1) set_state(i, piece_state::complete);
+
+    // Journal : rejoué jusqu'au premier enregistrement invalide (queue déchirée)
+    std::int64_t expected_mtime = h.data_mtime;
+    std::vector<std::uint32_t> recent;
+    std::size_t valid = snap;
+    for (; valid + record_size <= bytes.size(); valid += record_size) {
+      const unsigned char* r = bytes.data() + valid;
+      std::uint32_t word, rcrc;
+      std::int64_t mtime;
+      std::memcpy(&word, r, 4);
+      std::memcpy(&mtime, r + 4, 8);
+      std::memcpy(&rcrc, r + 12, 4);
+      std::uint32_t index = word & ~cleared;
+      if (rcrc != crc32c::value(r, 12) || index >= h.pieces) break;
+      set_state(index, (word & cleared) ? piece_state::missing : piece_state::complete);
+      if (!(word & cleared)) recent.push_back(index);
+      expected_mtime = mtime;
+      ++stats_.replayed;
+    }
+    journal_end_ = valid;
+    torn_ = valid != bytes.size();
+    stats_.resumed = true;
+
+    // Données modifiées depuis le dernier enregistrement : tout ce qui est
+    // possédé est à vérifier, les pièces du journal (les plus récentes) d'abord
+    std::uint64_t data_size = 0;
+    std::int64_t now = mtime_of(data_path_, &data_size);
+    if (now == 0) {
+      for (std::size_t i = 0; i < h.pieces; ++i) set_state(i, piece_state::missing);
+    } else if (now != expected_mtime || data_size != file_size_) {
+      std::vector<bool> queued(h.pieces, false);
+      for (auto it = recent.rbegin(); it != recent.rend(); ++it)
+        if (state_[*it] == piece_state::complete && !queued[*it]) {
+          queued[*it] = true;
+          queue_.push_back(*it);
+        }
+      for (std::size_t i = 0; i < h.pieces; ++i)
+        if (state_[i] == piece_state::complete && !queued[i]) queue_.push_back(i);
+      for (std::size_t i : queue_) set_state(i, piece_state::unverified);
+    }
+    return true;
+  }
+
+  void reset(std::uint64_t file_size, std::size_t piece_size, std::vector<digest> hashes) {
+    file_size_ = file_size;
+    piece_size_ = piece_size;
+    hashes_ = std::move(hashes);
+    state_.assign(hashes_.size(), piece_state::missing);
+    queue_.clear();
+    stats_ = {};
+    stats_.pieces = hashes_.size();
+    journal_end_ = 0;
+    write_snapshot();
+  }
+
+  void open_journal() {
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd_ < 0) throw std::system_error(errno, std::generic_category(), "open " + path_);
+    if (torn_ && ::ftruncate(fd_, static_cast<off_t>(journal_end_)) != 0)
+      throw std::system_error(errno, std::generic_category(), "truncate " + path_);
+    torn_ = false;
+  }
+
+  // -------------------------------------------
+  // Écriture
+  // -------------------------------------------
+  void set_state(std::size_t i, piece_state s) {
+    piece_state& cur = state_.at(i);
+    if (cur == s) return;
+    if (cur == piece_state::complete) --stats_.complete;
+    if (cur == piece_state::unverified) --stats_.unverified;
+    if (s == piece_state::complete) ++stats_.complete;
+    if (s == piece_state::unverified) ++stats_.unverified;
+    cur = s;
+  }
+
+  void log(std::uint32_t word) { pending_.push_back(word); }
+
+  // mtime à enregistrer : tant qu'il reste des pièces à vérifier, une valeur
+  // qu'aucun fichier n'aura, pour que le prochain démarrage les revérifie
+  std::int64_t recorded_mtime() const { return stats_.unverified ? unverified_mtime : mtime_of(data_path_); }
+
+  void flush_records() {
+    if (pending_.empty()) return;
+    std::int64_t mtime = recorded_mtime();
+    std::vector<unsigned char> out(pending_.size() * record_size);
+    for (std::size_t k = 0; k < pending_.size(); ++k) {
+      unsigned char* r = out.data() + k * record_size;
+      std::memcpy(r, &pending_[k], 4);
+      std::memcpy(r + 4, &mtime, 8);
+      std::uint32_t crc = crc32c::value(r, 12);
+      std::memcpy(r + 12, &crc, 4);
+    }
+    write_at(fd_, out.data(), out.size(), journal_end_);
+    if (::fdatasync(fd_) != 0) throw std::system_error(errno, std::generic_category(), "fdatasync " + path_);
+    journal_end_ += out.size();
+    pending_.clear();
+  }
+
+  // <path>.tmp puis rename : l'ancien instantané reste valide jusqu'au bout
+  void write_snapshot() {
+    std::size_t pieces = state_.size();
+    std::vector<unsigned char> out(snapshot_size(pieces), 0);
+    header h{};
+    h.magic = magic;
+    h.file_size = file_size_;
+    h.piece_size = static_cast<std::uint32_t>(piece_size_);
+    h.pieces = static_cast<std::uint32_t>(pieces);
+    h.data_mtime = recorded_mtime();
+    std::memcpy(out.data(), &h, sizeof h);
+    unsigned char* bits = out.data() + sizeof(header);
+    unsigned char* sums = bits + (pieces + 7) / 8;
+    for (std::size_t i = 0; i < pieces; ++i) {
+      if (state_[i] != piece_state::missing) bits[i / 8] |= static_cast<unsigned char>(1u << (i % 8));
+      std::memcpy(sums + 32 * i, hashes_[i].data(), 32);
+    }
+    h.crc = crc32c::value(out.data(), out.size());
+    std::memcpy(out.data() + offsetof(header, crc), &h.crc, sizeof h.crc);
+
+    std::string tmp = path_ + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "open " + tmp);
+    try {
+      write_at(fd, out.data(), out.size(), 0);
+      if (::fsync(fd) != 0) throw std::system_error(errno, std::generic_category(), "fsync " + tmp);
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+    ::close(fd);
+    if (::rename(tmp.c_str(), path_.c_str()) != 0)
+      throw std::system_error(errno, std::generic_category(), "rename " + tmp);
+    // Le descripteur du journal pointe encore sur l'ancien fichier : rouvrir
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = ::open(path_.c_str(), O_RDWR | O_CLOEXEC);
+      if (fd_ < 0) throw std::system_error(errno, std::generic_category(), "open " + path_);
+    }
+    journal_end_ = out.size();
+    pending_.clear();
+  }
+
+  static void write_at(int fd, const unsigned char* p, std::size_t n, std::size_t offset) {
+    std::size_t done = 0;
+    while (done < n) {
+      ssize_t w = ::pwrite(fd, p + done, n - done, static_cast<off_t>(offset + done));
+      if (w < 0 && errno == EINTR) continue;
+      if (w < 0) throw std::system_error(errno, std::generic_category(), "write");
+      done += static_cast<std::size_t>(w);
+    }
+  }
+
+  // -------------------------------------------
+  // Vérification (threads du pool)
+  // -------------------------------------------
+  std::size_t piece_length(std::size_t i) const {
+    return static_cast<std::size_t>(std::min<std::uint64_t>(piece_size_, file_size_ - std::uint64_t(i) * piece_size_));
+  }
+
+  void verify_step(asio::thread_pool& pool, const std::function<void(const resume_stats&)>& on_done,
+                   std::size_t batch) {
+    // Lot suivant : urgences d'abord, pièces déjà traitées ignorées
+    std::vector<std::size_t> ids;
+    {
+      std::lock_guard lock(mutex_);
+      while (ids.size() < batch && !stop_ && (!urgent_.empty() || !queue_.empty())) {
+        auto& from = urgent_.empty() ? queue_ : urgent_;
+        std::size_t i = from.front();
+        from.pop_front();
+        if (state_[i] == piece_state::unverified && std::find(ids.begin(), ids.end(), i) == ids.end())
+          ids.push_back(i);
+      }
+    }
+
+    if (!ids.empty()) {
+      std::vector<std::vector<std::uint8_t>> data(ids.size());
+      std::vector<std::span<const std::uint8_t>> views(ids.size());
+      std::vector<bool> readable(ids.size(), true);
+      for (std::size_t k = 0; k < ids.size(); ++k) {
+        data[k].resize(piece_length(ids[k]));
+        std::size_t got = 0;
+        while (got < data[k].size()) {
+          ssize_t n = ::pread(data_fd_, data[k].data() + got, data[k].size() - got,
+                              static_cast<off_t>(std::uint64_t(ids[k]) * piece_size_ + got));
+          if (n < 0 && errno == EINTR) continue;
+          if (n <= 0) break;
+          got += static_cast<std::size_t>(n);
+        }
+        readable[k] = got == data[k].size();
+        views[k] = data[k];
+      }
+      std::vector<digest> sums(ids.size());
+      hash_many(views, sums.data());
+
+      std::lock_guard lock(mutex_);
+      for (std::size_t k = 0; k < ids.size(); ++k) {
+        if (state_[ids[k]] != piece_state::unverified) continue;   // retéléchargée entre-temps
+        if (readable[k] && sums[k] == hashes_[ids[k]]) {
+          set_state(ids[k], piece_state::complete);
+          ++stats_.verified;
+        } else {
+          set_state(ids[k], piece_state::missing);
+          log(static_cast<std::uint32_t>(ids[k]) | cleared);
+          ++stats_.failed;
+        }
+      }
+      asio::post(pool, [this, &pool, on_done, batch] { verify_step(pool, on_done, batch); });
+      return;
+    }
+
+    // Fin : si tout est vérifié, l'instantané enregistre le mtime actuel et
+    // le prochain démarrage ne relira rien
+    resume_stats final;
+    {
+      std::lock_guard lock(mutex_);
+      try {
+        if (stats_.unverified == 0) write_snapshot();
+        else flush_records();
+      } catch (...) {
+        // l'état en mémoire reste juste ; le prochain démarrage revérifiera
+      }
+      final = stats_;
+      verifying_ = false;
+      idle_.notify_all();
+    }
+    // Après la remise à zéro : le rappel peut appeler wait_verified() ou
+    // relancer verify_async(). Il ne doit plus toucher *this si le
+    // propriétaire peut le détruire dès la fin de la vérification.
+    if (on_done) on_done(final);
+  }
+
+  std::string data_path_;
+  std::string path_;
+  std::uint64_t file_size_ = 0;
+  std::size_t piece_size_ = 0;
+  std::vector<digest> hashes_;
+  std::vector<piece_state> state_;
+  std::vector<std::uint32_t> pending_;   // enregistrements pas encore écrits
+  std::size_t journal_end_ = 0;          // fin des enregistrements valides
+  bool torn_ = false;
+  int fd_ = -1;
+  int data_fd_ = -1;
+
+  mutable std::mutex mutex_;
+  std::condition_variable idle_;
+  std::deque<std::size_t> queue_;       // à vérifier, ordre de fond
+  std::deque<std::size_t> urgent_;      // à vérifier, demandées par un pair
+  bool verifying_ = false;
+  bool stop_ = false;
+  resume_stats stats_;
+};
+
+} // namespace p2p
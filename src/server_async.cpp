@@ -0,0 +1,63 @@
+// ===========================================
+// SERVER_ASYNC.CPP
+// Serveur TCP asynchrone avec Asio
+// Objectif : même protocole que server_sync (lignes terminées par '\n',
+//            réponse "# echo> <message>"), mais plusieurs clients à la fois
+//            et des sessions inactives qui ne coûtent presque rien.
+// Usage : server_async [port] [memory_limit] [max_line] [zstd_dictionary]
+//         (port défaut 5555)
+// Un client qui envoie "HELLO codecs=zstd,lz4" passe en mode trames
+// compressées (voir frame.hpp / compression.hpp).
+// ===========================================
+
+#include "async_server.hpp"
+
+#include <asio.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+namespace net = asio;
+using tcp = net::ip::tcp;
+
+int main(int argc, char** argv) {
+  try {
+    unsigned short port = (argc > 1) ? static_cast<unsigned short>(std::atoi(argv[1])) : 5555;
+
+    p2p::line_limits limits = p2p::line_limits::from_args(argc, argv, 2);
+
+    p2p::compression_config compression;
+    if (argc > 4) compression.zstd_dictionary = argv[4];
+
+    net::io_context io;
+    // Pool CPU pour la (dé)compression : le thread d'E/S ne fait que des E/S
+    net::thread_pool cpu(std::max(1u, std::thread::hardware_concurrency()));
+    p2p::async_server server(io, tcp::endpoint(tcp::v4(), port), p2p::read_sizing{}, limits);
+    server.set_compression(compression, &cpu);
+    server.start();
+
+    std::cout << "[server] listening on 0.0.0.0:" << port
+              << " (codecs: " << p2p::codec_list() << ")\n";
+
+    // Arrêt propre sur Ctrl+C
+    net::signal_set signals(io, SIGINT, SIGTERM);
+    signals.async_wait([&](const net::error_code&, int) { io.stop(); });
+
+    io.run();
+    cpu.join();  // plus aucun travail CPU en vol avant de détruire le serveur
+
+    // Bilan des métriques à l'arrêt
+    const auto& rs = server.stats();
+    auto& cs = server.compression().stats();
+    std::cout << "[server] reads: " << rs.reads << " (" << rs.bytes_per_read() << " bytes/read)\n"
+              << "[server] frames compressed: " << cs.frames_compressed << ", raw: " << cs.frames_raw
+              << ", ratio: " << cs.ratio() << "\n"
+              << "[server] compression cpu: " << cs.compress_ns / 1000 << " us, decompression cpu: "
+              << cs.decompress_ns / 1000 << " us\n";
+  } catch (const std::exception& ex) {
+    std::cerr << "[server] fatal: " << ex.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -3,18 +3,88 @@
 // Serveur TCP synchrone minimal avec Asio
 // Objectif : écouter sur le port 5555, recevoir un message texte terminé par '\n'
 //             et renvoyer "# echo> <message>"
+// Usage : server_sync [port] [memory_limit] [max_line]
 // ===========================================
 
+#include "line_limits.hpp" // Limites de taille des lignes + débordement disque
+
 #include <asio.hpp>     // Librairie réseau C++ moderne (standalone, sans Boost)
+#include <cstdlib>      // std::atoi
+#include <cstring>      // std::memchr
 #include <iostream>     // Pour afficher des logs dans le terminal
 #include <string>       // Pour manipuler des chaînes de caractères
+#include <system_error> // std::system_error (fichier de débordement)
 
 // Pour raccourcir les noms (plutôt que asio::ip::tcp, on écrira tcp)
 namespace net = asio;
 using tcp = net::ip::tcp;
 
-int main() {
+// -------------------------------------------
+// Ligne trop longue pour la mémoire : on la traite comme un flux.
+// -------------------------------------------
+// `buf` est plein (memory_limit octets sans '\n'). On vide son contenu dans
+// un fichier temporaire, puis on continue à lire par morceaux de taille fixe
+// jusqu'au '\n'. La mémoire utilisée reste bornée quelle que soit la taille
+// envoyée par le client. La réponse est elle aussi renvoyée par morceaux.
+static void stream_oversized_line(tcp::socket& sock, net::streambuf& buf,
+                                  const p2p::line_limits& limits, net::error_code& ec) {
+  p2p::spill_file spill;
+  auto pending = buf.data();
+  spill.append(static_cast<const char*>(pending.data()), pending.size());
+  buf.consume(buf.size());
+
+  char chunk[16 * 1024];  // seul tampon utilisé pendant la lecture en flux
+  for (;;) {
+    std::size_t n = sock.read_some(net::buffer(chunk), ec);
+    if (ec) return;
+
+    auto* nl = static_cast<const char*>(std::memchr(chunk, '\n', n));
+    std::size_t take = nl ? static_cast<std::size_t>(nl - chunk) : n;
+    if (spill.size() + take > limits.max_line) {
+      std::cerr << "[server] line exceeds max_line (" << limits.max_line << " bytes)\n";
+      std::string err = "# error> line too long\n";
+      net::write(sock, net::buffer(err), ec);
+      ec = net::error::message_size;
+      return;
+    }
+    spill.append(chunk, take);
+    if (nl) break;  // fin de ligne atteinte (le reste du morceau est ignoré)
+  }
+
+  std::cout << "[server] streamed " << spill.size() << " bytes through spill file\n";
+
+  // Réponse "# echo> <message>\n" relue depuis le disque, morceau par morceau
+  net::write(sock, net::buffer("# echo> ", 8), ec);
+  spill.rewind();
+  while (!ec) {
+    std::size_t n = spill.read(chunk, sizeof chunk);
+    if (n == 0) break;
+    net::write(sock, net::buffer(chunk, n), ec);
+  }
+  if (!ec) net::write(sock, net::buffer("\n", 1), ec);
+}
+
+// Le fichier temporaire peut échouer (tmpfile impossible, disque plein) :
+// seule cette connexion est refusée, le serveur continue d'accepter.
+static void echo_oversized_line(tcp::socket& sock, net::streambuf& buf,
+                                const p2p::line_limits& limits, net::error_code& ec) {
+  try {
+    stream_oversized_line(sock, buf, limits, ec);
+  } catch (const std::system_error& ex) {
+    std::cerr << "[server] spill file error: " << ex.what() << "\n";
+    std::string err = "# error> line could not be buffered\n";
+    net::error_code ignore;
+    net::write(sock, net::buffer(err), ignore);
+    ec = ex.code();
+  }
+}
+
+int main(int argc, char** argv) {
   try {
+    // Paramètres : port, taille max gardée en mémoire, taille max d'une ligne
+    unsigned short port = (argc > 1) ? static_cast<unsigned short>(std::atoi(argv[1])) : 5555;
+    p2p::line_limits limits = p2p::line_limits::from_args(argc, argv, 2);
+
     // -------------------------------------------
     // 1️⃣ Création du moteur d'E/S réseau
     // -------------------------------------------
@@ -27,9 +97,9 @@ int main() {
     // -------------------------------------------
     // tcp::v4()  → on écoute sur toutes les interfaces IPv4 locales (0.0.0.0)
     // Port 5555  → choisi arbitrairement, non privilégié (>1024)
-    tcp::acceptor acceptor(io, tcp::endpoint(tcp::v4(), 5555));
+    tcp::acceptor acceptor(io, tcp::endpoint(tcp::v4(), port));
 
-    std::cout << "[server] listening on 0.0.0.0:5555\n";
+    std::cout << "[server] listening on 0.0.0.0:" << port << "\n";
 
     // -------------------------------------------
     // 3️⃣ Boucle principale : accepter plusieurs clients successifs
@@ -61,13 +131,19 @@ int main() {
       // -------------------------------------------
       // On lit dans la socket jusqu’à recevoir un caractère '\n'.
       // Cela définit un protocole simple : chaque message est une ligne.
-      net::streambuf buf; // tampon interne de réception
+      // Le tampon est BORNÉ : il ne grossira jamais au-delà de memory_limit.
+      net::streambuf buf(limits.memory_limit); // tampon interne de réception
 
       std::size_t n = net::read_until(sock, buf, '\n', ec);
+      (void)n;
       // Cette opération est BLOQUANTE :
       //   → si le client ne finit pas par '\n', le serveur attendra indéfiniment.
 
-      if (ec) {
+      if (ec == net::error::not_found) {
+        // Tampon plein sans '\n' : la ligne dépasse memory_limit → mode flux
+        echo_oversized_line(sock, buf, limits, ec);
+        if (ec) std::cerr << "[server] oversized line error: " << ec.message() << "\n";
+      } else if (ec) {
         std::cerr << "[server] read_until error: " << ec.message() << "\n";
       } else {
         // -------------------------------------------
@@ -0,0 +1,330 @@
+// ===========================================
+// SHA256.HPP
+// Moteur de hachage des chunks (SHA-256)
+// Objectif : vérifier chaque chunk reçu et hacher les fichiers à partager
+//            le plus vite possible, sur tous les cœurs.
+//
+//   - sha256           : API en flux (update au fil des lectures socket,
+//                        y compris sur une séquence de tampons / un iobuf) ;
+//   - hash_many        : hache beaucoup de chunks indépendants ; avec
+//                        SHA-NI, deux chunks avancent en même temps
+//                        ("multi-buffer" : deux chaînes de dépendances
+//                        entrelacées pour masquer la latence des sha256rnds2) ;
+//   - hash_chunks      : découpe un gros tampon en chunks et répartit
+//                        hash_many sur un asio::thread_pool.
+//
+// Implémentation choisie à l'exécution : SHA-NI si le CPU l'a, sinon
+// une version portable.
+// ===========================================
+#pragma once
+
+#include <asio/buffer.hpp>
+#include <asio/post.hpp>
+#include <asio/thread_pool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <latch>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define P2P_SHA256_X86 1
+#include <immintrin.h>
+#endif
+
+namespace p2p {
+
+using digest = std::array<std::uint8_t, 32>;
+
+// Les empreintes sont déjà uniformes : leurs 8 premiers octets suffisent
+struct digest_hash {
+  std::size_t operator()(const digest& d) const {
+    std::size_t h;
+    std::memcpy(&h, d.data(), sizeof h);
+    return h;
+  }
+};
+
+inline std::string to_hex(const digest& d) {
+  static const char digits[] = "0123456789abcdef";
+  std::string out;
+  out.reserve(64);
+  for (auto b : d) {
+    out += digits[b >> 4];
+    out += digits[b & 15];
+  }
+  return out;
+}
+
+namespace sha256_detail {
+
+inline constexpr std::uint32_t k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+inline constexpr std::uint32_t initial_state[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+inline std::uint32_t rotr(std::uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+// Version portable : un bloc de 64 octets à la fois
+inline void compress_portable(std::uint32_t* state, const std::uint8_t* data, std::size_t blocks) {
+  for (; blocks--; data += 64) {
+    std::uint32_t w[64];
+    for (int i = 0; i < 16; ++i)
+      w[i] = (std::uint32_t(data[4 * i]) << 24) | (std::uint32_t(data[4 * i + 1]) << 16) |
+             (std::uint32_t(data[4 * i + 2]) << 8) | std::uint32_t(data[4 * i + 3]);
+    for (int i = 16; i < 64; ++i) {
+      std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    std::uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+      std::uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+      std::uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+      h = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+  }
+}
+
+#ifdef P2P_SHA256_X86
+
+// -------------------------------------------
+// SHA-NI, N flux en parallèle (N = 1 ou 2).
+// Les N chaînes sha256rnds2 sont indépendantes : le CPU les entrelace.
+// Planification des messages : W[j] = MSG[j % 4] pour le groupe de 4 tours j.
+// -------------------------------------------
+template <int N>
+__attribute__((target("sha,sse4.1,ssse3")))
+inline void compress_shani(std::uint32_t* const* states, const std::uint8_t* const* data, std::size_t blocks) {
+  const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i state0[N], state1[N];
+  const std::uint8_t* p[N];
+
+  for (int l = 0; l < N; ++l) {
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(states[l]));
+    __m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(states[l] + 4));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);            // CDAB
+    s1 = _mm_shuffle_epi32(s1, 0x1B);              // EFGH
+    state0[l] = _mm_alignr_epi8(tmp, s1, 8);       // ABEF
+    state1[l] = _mm_blend_epi16(s1, tmp, 0xF0);    // CDGH
+    p[l] = data[l];
+  }
+
+  for (; blocks--;) {
+    __m128i save0[N], save1[N], msg[N][4];
+    for (int l = 0; l < N; ++l) {
+      save0[l] = state0[l];
+      save1[l] = state1[l];
+    }
+    for (int j = 0; j < 16; ++j) {
+      const __m128i kj = _mm_loadu_si128(reinterpret_cast<const __m128i*>(k + 4 * j));
+      for (int l = 0; l < N; ++l) {
+        if (j < 4)
+          msg[l][j] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p[l] + 16 * j)), mask);
+        __m128i m = _mm_add_epi32(msg[l][j % 4], kj);
+        state1[l] = _mm_sha256rnds2_epu32(state1[l], state0[l], m);
+        if (j >= 3 && j <= 14) {
+          __m128i& next = msg[l][(j + 1) % 4];
+          next = _mm_add_epi32(next, _mm_alignr_epi8(msg[l][j % 4], msg[l][(j + 3) % 4], 4));
+          next = _mm_sha256msg2_epu32(next, msg[l][j % 4]);
+        }
+        m = _mm_shuffle_epi32(m, 0x0E);
+        state0[l] = _mm_sha256rnds2_epu32(state0[l], state1[l], m);
+        if (j >= 1 && j <= 12)
+          msg[l][(j + 3) % 4] = _mm_sha256msg1_epu32(msg[l][(j + 3) % 4], msg[l][j % 4]);
+      }
+    }
+    for (int l = 0; l < N; ++l) {
+      state0[l] = _mm_add_epi32(state0[l], save0[l]);
+      state1[l] = _mm_add_epi32(state1[l], save1[l]);
+      p[l] += 64;
+    }
+  }
+
+  for (int l = 0; l < N; ++l) {
+    __m128i tmp = _mm_shuffle_epi32(state0[l], 0x1B);   // FEBA
+    __m128i s1 = _mm_shuffle_epi32(state1[l], 0xB1);    // DCHG
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(states[l]), _mm_blend_epi16(tmp, s1, 0xF0));     // DCBA
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(states[l] + 4), _mm_alignr_epi8(s1, tmp, 8));  // HGFE
+  }
+}
+
+inline void compress_shani1(std::uint32_t* state, const std::uint8_t* data, std::size_t blocks) {
+  compress_shani<1>(&state, &data, blocks);
+}
+
+#endif // P2P_SHA256_X86
+
+using compress_fn = void (*)(std::uint32_t*, const std::uint8_t*, std::size_t);
+
+struct implementation_t {
+  compress_fn fn;
+  bool shani;
+  const char* name;
+};
+
+inline const implementation_t& implementation() {
+  static const implementation_t impl = [] {
+#ifdef P2P_SHA256_X86
+    if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1"))
+      return implementation_t{compress_shani1, true, "sha-ni"};
+#endif
+    return implementation_t{compress_portable, false, "portable"};
+  }();
+  return impl;
+}
+
+} // namespace sha256_detail
+
+inline const char* sha256_implementation() { return sha256_detail::implementation().name; }
+
+inline void hash_many(std::span<const std::span<const std::uint8_t>> chunks, digest* out);
+
+// -------------------------------------------
+// Hachage en flux
+// -------------------------------------------
+class sha256 {
+public:
+  sha256() { std::memcpy(state_, sha256_detail::initial_state, sizeof state_); }
+
+  void update(const void* data, std::size_t n) {
+    auto* p = static_cast<const std::uint8_t*>(data);
+    total_ += n;
+    if (buffered_) {
+      std::size_t take = std::min(n, 64 - buffered_);
+      std::memcpy(buffer_ + buffered_, p, take);
+      buffered_ += take;
+      p += take;
+      n -= take;
+      if (buffered_ < 64) return;
+      compress(buffer_, 1);
+      buffered_ = 0;
+    }
+    if (std::size_t blocks = n / 64) {
+      compress(p, blocks);  // blocs complets hachés en place, sans copie
+      p += blocks * 64;
+      n -= blocks * 64;
+    }
+    std::memcpy(buffer_, p, n);
+    buffered_ = n;
+  }
+
+  // Séquence de tampons Asio (ou iobuf::buffers()) : segment par segment
+  template <typename ConstBufferSequence>
+  void update_buffers(const ConstBufferSequence& buffers) {
+    auto end = asio::buffer_sequence_end(buffers);
+    for (auto it = asio::buffer_sequence_begin(buffers); it != end; ++it) {
+      asio::const_buffer b(*it);
+      update(b.data(), b.size());
+    }
+  }
+
+  digest finish() {
+    std::uint64_t bits = total_ * 8;
+    std::uint8_t pad[72] = {0x80};
+    std::size_t pad_len = (buffered_ < 56) ? 56 - buffered_ : 120 - buffered_;
+    for (int i = 0; i < 8; ++i) pad[pad_len + i] = static_cast<std::uint8_t>(bits >> (56 - 8 * i));
+    update(pad, pad_len + 8);
+    digest out;
+    for (int i = 0; i < 8; ++i)
+      for (int b = 0; b < 4; ++b) out[4 * i + b] = static_cast<std::uint8_t>(state_[i] >> (24 - 8 * b));
+    return out;
+  }
+
+private:
+  friend void hash_many(std::span<const std::span<const std::uint8_t>>, digest*);
+
+  void compress(const std::uint8_t* p, std::size_t blocks) {
+    sha256_detail::implementation().fn(state_, p, blocks);
+  }
+
+  std::uint32_t state_[8];
+  std::uint8_t buffer_[64];
+  std::size_t buffered_ = 0;
+  std::uint64_t total_ = 0;
+};
+
+inline digest sha256_of(const void* data, std::size_t n) {
+  sha256 h;
+  h.update(data, n);
+  return h.finish();
+}
+
+// -------------------------------------------
+// Multi-buffer : hache chunks[i] dans out[i].
+// Avec SHA-NI, les chunks sont traités deux par deux sur leurs blocs
+// complets communs ; le reste (fin + padding) passe par l'API en flux.
+// -------------------------------------------
+inline void hash_many(std::span<const std::span<const std::uint8_t>> chunks, digest* out) {
+  std::size_t i = 0;
+#ifdef P2P_SHA256_X86
+  if (sha256_detail::implementation().shani) {
+    for (; i + 1 < chunks.size(); i += 2) {
+      sha256 h[2];
+      std::size_t blocks = std::min(chunks[i].size(), chunks[i + 1].size()) / 64;
+      std::uint32_t* states[2] = {h[0].state_, h[1].state_};
+      const std::uint8_t* data[2] = {chunks[i].data(), chunks[i + 1].data()};
+      sha256_detail::compress_shani<2>(states, data, blocks);
+      for (int l = 0; l < 2; ++l) {
+        h[l].total_ = blocks * 64;
+        h[l].update(chunks[i + l].data() + blocks * 64, chunks[i + l].size() - blocks * 64);
+        out[i + l] = h[l].finish();
+      }
+    }
+  }
+#endif
+  for (; i < chunks.size(); ++i) out[i] = sha256_of(chunks[i].data(), chunks[i].size());
+}
+
+// -------------------------------------------
+// Gros tampon → empreinte de chaque chunk de chunk_size octets (le dernier
+// peut être plus court), calculées en parallèle sur `pool`.
+// Bloquant : appelé depuis un thread de ce même pool, il attendrait des
+// tâches qui ne peuvent pas tourner (pool d'un thread) → std::logic_error.
+// chunk_size nul → std::invalid_argument.
+// -------------------------------------------
+inline std::vector<digest> hash_chunks(asio::thread_pool& pool, const std::uint8_t* data,
+                                       std::size_t size, std::size_t chunk_size,
+                                       std::size_t workers) {
+  if (chunk_size == 0) throw std::invalid_argument("hash_chunks: chunk_size must be positive");
+  if (pool.get_executor().running_in_this_thread())
+    throw std::logic_error("hash_chunks: called from a thread of its own pool");
+  std::size_t count = (size + chunk_size - 1) / chunk_size;
+  std::vector<std::span<const std::uint8_t>> chunks(count);
+  for (std::size_t c = 0; c < count; ++c)
+    chunks[c] = {data + c * chunk_size, std::min(chunk_size, size - c * chunk_size)};
+
+  std::vector<digest> out(count);
+  workers = std::max<std::size_t>(1, std::min(workers, count));
+  std::latch done(static_cast<std::ptrdiff_t>(workers));
+  for (std::size_t w = 0; w < workers; ++w) {
+    // Tranches contiguës de chunks : chaque thread lit une zone distincte
+    std::size_t first = count * w / workers, last = count * (w + 1) / workers;
+    asio::post(pool, [&, first, last] {
+      hash_many(std::span(chunks).subspan(first, last - first), out.data() + first);
+      done.count_down();
+    });
+  }
+  done.wait();
+  return out;
+}
+
+} // namespace p2p
@@ -0,0 +1,404 @@
+// ===========================================
+// SWIM.HPP
+// Détecteur de pannes SWIM, diffusion de l'appartenance par piggyback
+// Objectif : détecter un pair mort en un temps et pour un trafic par nœud
+//            qui ne dépendent pas de la taille du groupe, sans fausses
+//            alertes quand le réseau perd des paquets ou qu'un nœud est
+//            lent.
+//
+// Une période de sondage (period) par nœud :
+//   - ping direct à un membre, choisi en tourniquet sur une permutation
+//     aléatoire de la table (chaque membre est sondé au plus une fois
+//     par tour : détection bornée, pas seulement en moyenne) ;
+//   - pas d'ack après ping_timeout → ping_req à `indirect` membres tirés
+//     au hasard, qui sondent la cible pour nous et relaient son ack (un
+//     lien momentanément mauvais entre deux nœuds n'accuse personne) ;
+//   - toujours pas d'ack à la fin de la période → la cible devient
+//     suspecte. Au bout de suspicion_mult × log10(N) périodes sans
+//     démenti, elle est déclarée morte ;
+//   - un nœud qui se voit suspecté dément : il incrémente son
+//     incarnation et se rediffuse vivant. Priorités : alive(i) l'emporte
+//     sur suspect(j) si i > j, suspect(i) sur alive(j) si i ≥ j, dead sur
+//     tout (un nœud déclaré mort revient avec une incarnation plus
+//     grande).
+//
+// Diffusion : chaque changement d'état est ajouté aux ping / ack /
+// ping_req suivants (au plus max_piggyback par message, les moins
+// retransmis d'abord), retransmit_mult × log10(N) fois : il atteint tout
+// le groupe en O(log N) périodes sans aucun message dédié. Un membre
+// suspect est prévenu directement (un ping au moment de la suspicion,
+// puis sa suspicion en tête de tout message qui lui est adressé) : son
+// démenti ne dépend pas de la rumeur.
+//
+// Mémoire : table triée de 16 octets par membre (l'appartenance complète
+// est le but) ; le tourniquet se fait par pas premier avec la taille de
+// la table, sans permutation stockée.
+//
+// Sans E/S (voir overlay.hpp), pour un transport par datagrammes (UDP) :
+// send(to, message) ; tick(now) rend l'instant où le rappeler ; les
+// changements d'état vus localement sont signalés par on_change, le RTT de
+// chaque sondage direct acquitté par on_rtt, avec les coordonnées Vivaldi
+// portées par l'ack (voir vivaldi.hpp : aucune mesure dédiée). Après
+// set_coord(), chaque message émis porte nos coordonnées (+16 octets).
+// Mono-thread.
+// ===========================================
+#pragma once
+
+#include "overlay.hpp"
+#include "vivaldi.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace p2p {
+
+enum class member_state : std::uint8_t { alive, suspect, dead };
+
+struct swim_options {
+  std::chrono::milliseconds period{2000};        // période de sondage
+  std::chrono::milliseconds ping_timeout{800};   // avant les sondages indirects
+  std::size_t indirect = 3;                      // k : relais d'un sondage indirect
+  double suspicion_mult = 3;                     // suspicion : mult × log10(N) périodes
+  double retransmit_mult = 4;                    // diffusion : mult × log10(N) envois
+  std::size_t max_piggyback = 32;                // mises à jour par message (≤ 444 octets)
+};
+
+struct swim_update {
+  node_id node = 0;
+  std::uint32_t incarnation = 0;
+  member_state state = member_state::alive;
+};
+
+struct swim_message {
+  enum kind_t : std::uint8_t { ping, ack, ping_req };
+
+  kind_t kind = ping;
+  std::uint32_t seq = 0;
+  node_id target = 0;      // ping_req : membre à sonder
+  node_id origin = 0;      // ping / ack relayés : nœud qui attend l'ack
+  bool relayed = false;
+  std::vector<swim_update> updates;
+  std::optional<vivaldi_coord> coord;   // coordonnées de l'émetteur (voir swim::set_coord)
+
+  std::size_t wire_size() const { return 28 + 13 * updates.size() + (coord ? vivaldi_coord::wire_size : 0); }
+};
+
+struct swim_stats {
+  std::uint64_t sent = 0;
+  std::uint64_t probes = 0;
+  std::uint64_t indirect_probes = 0;   // sondages passés aux relais
+  std::uint64_t suspected = 0;         // cibles déclarées suspectes par nous
+  std::uint64_t confirmed = 0;         // suspicions arrivées à échéance chez nous
+  std::uint64_t refuted = 0;           // démentis de notre propre suspicion
+};
+
+class swim {
+public:
+  using clock = std::chrono::steady_clock;
+  using time_point = clock::time_point;
+  using send_fn = std::function<void(node_id to, swim_message msg)>;
+  using change_fn = std::function<void(node_id node, member_state state)>;
+  // coord : coordonnées portées par l'ack (nullopt si le pair n'en publie pas)
+  using rtt_fn = std::function<void(node_id node, clock::duration rtt, const std::optional<vivaldi_coord>& coord)>;
+
+  swim(node_id self, send_fn send, swim_options opts = {}, change_fn on_change = {}, rtt_fn on_rtt = {})
+    : self_(self), send_(std::move(send)), on_change_(std::move(on_change)), on_rtt_(std::move(on_rtt)), opts_(opts),
+      rng_(self) {}
+
+  // Membres connus au démarrage (liste d'amorçage), vivants, incarnation 0
+  void add_members(std::span<const node_id> nodes) {
+    for (node_id n : nodes)
+      if (n != self_) members_.push_back({n, 0, member_state::alive});
+    std::sort(members_.begin(), members_.end(), [](const member& a, const member& b) { return a.id < b.id; });
+    members_.erase(std::unique(members_.begin(), members_.end(), [](const member& a, const member& b) { return a.id == b.id; }),
+                   members_.end());
+    live_ = static_cast<std::size_t>(
+        std::count_if(members_.begin(), members_.end(), [](const member& m) { return m.state != member_state::dead; }));
+    round_left_ = 0;
+  }
+
+  // Entrée dans un groupe existant par un de ses membres : notre
+  // existence part avec nos premiers messages
+  void join(node_id seed) {
+    add_members(std::span<const node_id>(&seed, 1));
+    enqueue({self_, incarnation_, member_state::alive});
+  }
+
+  node_id self() const { return self_; }
+  std::uint32_t incarnation() const { return incarnation_; }
+  std::size_t members() const { return live_; }   // vivants ou suspects, hors nous
+  const swim_stats& stats() const { return stats_; }
+
+  // Coordonnées jointes à chaque message émis (à rafraîchir après chaque
+  // vivaldi::update) ; nullopt : aucune
+  void set_coord(std::optional<vivaldi_coord> c) { coord_ = c; }
+
+  std::optional<member_state> state(node_id n) const {
+    const member* m = find(n);
+    if (!m) return std::nullopt;
+    return m->state;
+  }
+
+  std::size_t memory_bytes() const {
+    return sizeof(*this) + members_.capacity() * sizeof(member) + broadcasts_.capacity() * sizeof(broadcast) +
+           suspects_.size() * (sizeof(node_id) + sizeof(time_point) + 16);
+  }
+
+  // -------------------------------------------
+  // Horloge : à rappeler à l'instant rendu (ou avant)
+  // -------------------------------------------
+  time_point tick(time_point now) {
+    for (auto it = suspects_.begin(); it != suspects_.end();) {
+      if (it->second > now) {
+        ++it;
+        continue;
+      }
+      node_id n = it->first;
+      it = suspects_.erase(it);
+      if (member* m = find(n)) {
+        ++stats_.confirmed;
+        set_state(*m, m->incarnation, member_state::dead);
+      }
+    }
+
+    if (probe_ && !probe_->acked && !probe_->indirect && now >= probe_->started + opts_.ping_timeout) {
+      probe_->indirect = true;
+      ++stats_.indirect_probes;
+      for (node_id helper : helpers(probe_->target))
+        send(helper, {swim_message::ping_req, probe_->seq, probe_->target, self_, false, {}, {}});
+    }
+
+    if (now >= next_period_) {
+      if (probe_ && !probe_->acked) suspect(probe_->target, now);
+      probe_.reset();
+      if (auto target = next_target()) {
+        ++stats_.probes;
+        probe_ = probe{*target, ++seq_, now, false, false};
+        send(*target, {swim_message::ping, seq_, *target, self_, false, {}, {}});
+      }
+      next_period_ = now + opts_.period;
+    }
+
+    time_point next = next_period_;
+    if (probe_ && !probe_->acked && !probe_->indirect) next = std::min(next, probe_->started + opts_.ping_timeout);
+    for (const auto& [n, deadline] : suspects_) next = std::min(next, deadline);
+    return next;
+  }
+
+  // -------------------------------------------
+  // Messages reçus
+  // -------------------------------------------
+  void receive(node_id from, const swim_message& m, time_point now) {
+    for (const auto& u : m.updates) apply(u, now);
+    switch (m.kind) {
+      case swim_message::ping:
+        send(from, {swim_message::ack, m.seq, self_, m.origin, m.relayed, {}, {}});
+        break;
+      case swim_message::ping_req:
+        send(m.target, {swim_message::ping, m.seq, m.target, from, true, {}, {}});
+        break;
+      case swim_message::ack:
+        if (m.relayed) {
+          send(m.origin, {swim_message::ack, m.seq, m.target, self_, false, {}, {}});
+        } else if (probe_ && probe_->seq == m.seq && probe_->target == m.target) {
+          if (on_rtt_ && !probe_->acked && from == m.target) on_rtt_(from, now - probe_->started, m.coord);
+          probe_->acked = true;
+        }
+        break;
+    }
+  }
+
+private:
+  struct member {
+    node_id id;
+    std::uint32_t incarnation;
+    member_state state;
+  };
+
+  struct broadcast {
+    swim_update update;
+    std::uint32_t sent;
+  };
+
+  struct probe {
+    node_id target;
+    std::uint32_t seq;
+    time_point started;
+    bool acked;
+    bool indirect;
+  };
+
+  double log_members() const { return std::max(1.0, std::log10(double(live_ + 1))); }
+
+  member* find(node_id n) {
+    auto it = std::lower_bound(members_.begin(), members_.end(), n, [](const member& m, node_id id) { return m.id < id; });
+    return it != members_.end() && it->id == n ? &*it : nullptr;
+  }
+  const member* find(node_id n) const { return const_cast<swim*>(this)->find(n); }
+
+  void send(node_id to, swim_message m) {
+    ++stats_.sent;
+    m.updates = piggyback(to);
+    m.coord = coord_;
+    send_(to, std::move(m));
+  }
+
+  // -------------------------------------------
+  // Sondage
+  // -------------------------------------------
+
+  // Tourniquet : pas `stride_` premier avec la taille de la table
+  std::optional<node_id> next_target() {
+    for (std::size_t tries = 0; tries < members_.size(); ++tries) {
+      if (round_left_ == 0) {
+        std::size_t n = members_.size();
+        if (n == 0) return std::nullopt;
+        cursor_ = std::uniform_int_distribution<std::size_t>(0, n - 1)(rng_);
+        do stride_ = std::uniform_int_distribution<std::size_t>(1, std::max<std::size_t>(n, 2) - 1)(rng_) % n;
+        while (n > 1 && std::gcd(stride_, n) != 1);
+        if (n == 1) stride_ = 0;
+        round_left_ = n;
+      }
+      --round_left_;
+      cursor_ = (cursor_ + stride_) % members_.size();
+      if (members_[cursor_].state != member_state::dead) return members_[cursor_].id;
+    }
+    return std::nullopt;
+  }
+
+  std::vector<node_id> helpers(node_id target) {
+    std::vector<node_id> out;
+    for (std::size_t tries = 0; out.size() < opts_.indirect && tries < 4 * opts_.indirect && !members_.empty(); ++tries) {
+      const member& m = overlay::random_element(members_, rng_);
+      if (m.state == member_state::alive && m.id != target && !overlay::contains(out, m.id)) out.push_back(m.id);
+    }
+    return out;
+  }
+
+  void suspect(node_id n, time_point now) {
+    member* m = find(n);
+    if (!m || m->state != member_state::alive) return;
+    ++stats_.suspected;
+    set_state(*m, m->incarnation, member_state::suspect, now);
+    // Prévient le suspect lui-même : s'il est vivant, son démenti part
+    // en même temps que la suspicion au lieu de l'attendre
+    send(n, {swim_message::ping, 0, n, self_, false, {}, {}});
+  }
+
+  // -------------------------------------------
+  // Appartenance
+  // -------------------------------------------
+  void apply(const swim_update& u, time_point now) {
+    if (u.node == self_) {
+      if (u.state != member_state::alive && u.incarnation >= incarnation_) {
+        incarnation_ = u.incarnation + 1;
+        ++stats_.refuted;
+        enqueue({self_, incarnation_, member_state::alive});
+      }
+      return;
+    }
+    member* m = find(u.node);
+    if (!m) {
+      if (u.state == member_state::dead) return;
+      auto it = std::lower_bound(members_.begin(), members_.end(), u.node,
+                                 [](const member& x, node_id id) { return x.id < id; });
+      m = &*members_.insert(it, member{u.node, u.incarnation, member_state::dead});
+      round_left_ = 0;   // la table a changé de taille : nouveau tour
+      set_state(*m, u.incarnation, u.state, now);
+      return;
+    }
+    bool newer = false;
+    switch (u.state) {
+      case member_state::alive:
+        newer = u.incarnation > m->incarnation;
+        break;
+      case member_state::suspect:
+        newer = (m->state == member_state::alive && u.incarnation >= m->incarnation) ||
+                (m->state == member_state::suspect && u.incarnation > m->incarnation);
+        break;
+      case member_state::dead:
+        newer = m->state != member_state::dead && u.incarnation >= m->incarnation;
+        break;
+    }
+    if (newer) set_state(*m, u.incarnation, u.state, now);
+  }
+
+  void set_state(member& m, std::uint32_t incarnation, member_state state, time_point now = {}) {
+    if (m.state != member_state::dead && state == member_state::dead) --live_;
+    if (m.state == member_state::dead && state != member_state::dead) ++live_;
+    m.incarnation = incarnation;
+    m.state = state;
+    if (state == member_state::suspect) {
+      auto timeout = std::chrono::duration_cast<clock::duration>(opts_.period * (opts_.suspicion_mult * log_members()));
+      suspects_[m.id] = now + timeout;
+    } else {
+      suspects_.erase(m.id);
+    }
+    enqueue({m.id, incarnation, state});
+    if (on_change_) on_change_(m.id, state);
+  }
+
+  // -------------------------------------------
+  // Diffusion par piggyback
+  // -------------------------------------------
+  void enqueue(const swim_update& u) {
+    for (auto& b : broadcasts_)
+      if (b.update.node == u.node) {
+        b = {u, 0};
+        return;
+      }
+    broadcasts_.push_back({u, 0});
+  }
+
+  // `to` suspect chez nous : sa suspicion part en premier (il peut la démentir)
+  std::vector<swim_update> piggyback(node_id to) {
+    std::vector<swim_update> out;
+    const member* buddy = suspects_.count(to) ? find(to) : nullptr;
+    if (buddy) out.push_back({to, buddy->incarnation, member_state::suspect});
+    if (broadcasts_.empty()) return out;
+    std::size_t n = std::min(opts_.max_piggyback, broadcasts_.size());
+    std::partial_sort(broadcasts_.begin(), broadcasts_.begin() + std::ptrdiff_t(n), broadcasts_.end(),
+                      [](const broadcast& a, const broadcast& b) { return a.sent < b.sent; });
+    auto limit = static_cast<std::uint32_t>(std::ceil(opts_.retransmit_mult * log_members()));
+    for (std::size_t i = 0; i < n; ++i) {
+      if (buddy && broadcasts_[i].update.node == to) continue;
+      out.push_back(broadcasts_[i].update);
+      ++broadcasts_[i].sent;
+    }
+    broadcasts_.erase(std::remove_if(broadcasts_.begin(), broadcasts_.end(),
+                                     [limit](const broadcast& b) { return b.sent >= limit; }),
+                      broadcasts_.end());
+    return out;
+  }
+
+  node_id self_;
+  send_fn send_;
+  change_fn on_change_;
+  rtt_fn on_rtt_;
+  std::optional<vivaldi_coord> coord_;
+  swim_options opts_;
+  overlay::rng rng_;
+  std::uint32_t incarnation_ = 0;
+  std::vector<member> members_;   // triée par id, morts compris (incarnation retenue)
+  std::size_t live_ = 0;
+  std::size_t cursor_ = 0, stride_ = 1, round_left_ = 0;
+  std::unordered_map<node_id, time_point> suspects_;   // échéance de la suspicion
+  std::vector<broadcast> broadcasts_;
+  std::optional<probe> probe_;
+  std::uint32_t seq_ = 0;
+  time_point next_period_{};
+  swim_stats stats_;
+};
+
+} // namespace p2p
@@ -0,0 +1,176 @@
+// ===========================================
+// VIVALDI.HPP
+// Coordonnées réseau synthétiques (Vivaldi) : prédire le RTT entre deux
+// pairs quelconques sans les sonder
+// Objectif : choisir un contact DHT, une source de téléchargement ou un
+//            relais parmi des dizaines de candidats sans mesurer le RTT de
+//            chacun : une soustraction de coordonnées suffit.
+//
+// Chaque nœud a une position dans un plan plus une hauteur (le dernier
+// kilomètre, qui s'ajoute à tous ses trajets) : RTT prédit(a, b) =
+// |xa − xb| + ha + hb. Chaque échantillon de RTT vers un pair (mesuré par
+// un échange qui a lieu de toute façon : ping SWIM, requête DHT, chunk)
+// arrive avec les coordonnées du pair et le rapproche ou l'éloigne d'elles,
+// comme un ressort de longueur le RTT mesuré.
+// Pas adaptatif : le déplacement est pondéré par notre erreur relative
+// face à celle du pair (un nœud sûr de lui bouge peu ; un nouveau venu
+// s'aligne sur les nœuds déjà placés) ; l'erreur est une moyenne mobile
+// de |prédit − mesuré| / mesuré.
+//
+// Fil : 16 octets (2 floats de position, hauteur, erreur), en ms.
+// nearest() et best_relay() classent des candidats par RTT prédit.
+// Mono-thread.
+// ===========================================
+#pragma once
+
+#include "overlay.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace p2p {
+
+struct vivaldi_coord {
+  static constexpr std::size_t dimensions = 2;
+
+  std::array<float, dimensions> position{};   // ms
+  float height = 0;                           // ms
+  float error = 1;                            // erreur relative estimée (1 : inconnue)
+
+  static constexpr std::size_t wire_size = 4 * (dimensions + 2);
+};
+
+struct vivaldi_options {
+  double cc = 0.5;             // pas maximal (fraction de l'écart corrigée)
+  double ce = 0.25;            // poids d'un échantillon dans l'erreur
+  double min_height = 0.1;     // ms
+  double max_rtt_ms = 10000;   // au-delà : échantillon ignoré (aberrant)
+};
+
+// RTT prédit, en ms
+inline double vivaldi_distance(const vivaldi_coord& a, const vivaldi_coord& b) {
+  double sum = 0;
+  for (std::size_t d = 0; d < vivaldi_coord::dimensions; ++d) {
+    double x = double(a.position[d]) - b.position[d];
+    sum += x * x;
+  }
+  return std::sqrt(sum) + a.height + b.height;
+}
+
+class vivaldi {
+public:
+  explicit vivaldi(node_id self, vivaldi_options opts = {}) : opts_(opts), rng_(self) {
+    coord_.height = float(opts_.min_height);
+  }
+
+  const vivaldi_coord& coord() const { return coord_; }
+  std::uint64_t samples() const { return samples_; }
+
+  // RTT prédit vers un pair dont on connaît les coordonnées
+  std::chrono::microseconds predict(const vivaldi_coord& remote) const { return predict(coord_, remote); }
+
+  static std::chrono::microseconds predict(const vivaldi_coord& a, const vivaldi_coord& b) {
+    return std::chrono::microseconds(std::int64_t(vivaldi_distance(a, b) * 1000));
+  }
+
+  // -------------------------------------------
+  // Échantillon : RTT mesuré vers un pair et ses coordonnées (piggyback)
+  // -------------------------------------------
+  void update(const vivaldi_coord& remote, std::chrono::nanoseconds rtt) {
+    double sample = std::chrono::duration<double, std::milli>(rtt).count();
+    if (!(sample > 0) || sample > opts_.max_rtt_ms) return;
+    ++samples_;
+
+    std::array<double, vivaldi_coord::dimensions> dir;
+    double plane = 0;
+    for (std::size_t d = 0; d < dir.size(); ++d) {
+      dir[d] = double(coord_.position[d]) - remote.position[d];
+      plane += dir[d] * dir[d];
+    }
+    plane = std::sqrt(plane);
+    double predicted = plane + coord_.height + remote.height;
+
+    double w = coord_.error / std::max(1e-6, double(coord_.error) + remote.error);
+    double relative = std::abs(predicted - sample) / sample;
+    coord_.error = float(std::clamp(relative * opts_.ce * w + coord_.error * (1 - opts_.ce * w), 1e-3, 1.5));
+
+    // Direction : vers l'autre (ou s'en éloigner) ; au hasard si confondus,
+    // et alors la hauteur ne bouge pas (elle absorberait tout l'écart)
+    bool coincident = plane < 1e-6;
+    if (coincident) {
+      std::normal_distribution<double> gauss;
+      plane = 0;
+      for (auto& x : dir) {
+        x = gauss(rng_);
+        plane += x * x;
+      }
+      for (auto& x : dir) x /= std::sqrt(plane);
+      plane = 1;
+      predicted = plane + coord_.height + remote.height;
+    }
+    double force = opts_.cc * w * (sample - predicted);
+    for (std::size_t d = 0; d < dir.size(); ++d)
+      coord_.position[d] = float(coord_.position[d] + force * dir[d] / predicted);
+    if (!coincident)
+      coord_.height = float(std::max(opts_.min_height, coord_.height + force * (coord_.height + remote.height) / predicted));
+  }
+
+private:
+  vivaldi_options opts_;
+  overlay::rng rng_;
+  vivaldi_coord coord_;
+  std::uint64_t samples_ = 0;
+};
+
+// -------------------------------------------
+// Choix par RTT prédit. coord_of(node) → const vivaldi_coord*
+// (nullptr : coordonnées inconnues, classé en dernier)
+// -------------------------------------------
+
+// Les n candidats les plus proches de `from` (source de téléchargement,
+// contacts d'un seau DHT, prochain saut d'une recherche)
+template <class CoordOf>
+std::vector<node_id> nearest(const vivaldi_coord& from, std::span<const node_id> candidates, std::size_t n,
+                             CoordOf&& coord_of) {
+  std::vector<std::pair<double, node_id>> ranked;
+  ranked.reserve(candidates.size());
+  for (node_id c : candidates) {
+    const vivaldi_coord* p = coord_of(c);
+    ranked.emplace_back(p ? vivaldi_distance(from, *p) : std::numeric_limits<double>::infinity(), c);
+  }
+  n = std::min(n, ranked.size());
+  std::partial_sort(ranked.begin(), ranked.begin() + std::ptrdiff_t(n), ranked.end());
+  std::vector<node_id> out(n);
+  for (std::size_t i = 0; i < n; ++i) out[i] = ranked[i].second;
+  return out;
+}
+
+// Relais minimisant RTT(a, r) + RTT(r, b)
+template <class CoordOf>
+std::optional<node_id> best_relay(const vivaldi_coord& a, const vivaldi_coord& b, std::span<const node_id> candidates,
+                                  CoordOf&& coord_of) {
+  std::optional<node_id> best;
+  double best_rtt = std::numeric_limits<double>::infinity();
+  for (node_id c : candidates) {
+    const vivaldi_coord* p = coord_of(c);
+    if (!p) continue;
+    double rtt = vivaldi_distance(a, *p) + vivaldi_distance(*p, b);
+    if (rtt < best_rtt) {
+      best_rtt = rtt;
+      best = c;
+    }
+  }
+  return best;
+}
+
+} // namespace p2p